@@ -17,7 +17,7 @@ Usage: python sdlog2_dump.py <log.bin> [-v] [-e] [-d delimiter] [-n null] [-m MS
         Multiple -m options allowed."""
 
 __author__  = "Anton Babushkin"
-__version__ = "1.2"
+__version__ = "1.3"
 
 import struct, sys
 
@@ -49,6 +49,13 @@ class SDLog2Parser:
         "q": ("q", None),
         "Q": ("Q", None),
     }
+    # field types of topics logged from their uORB metadata (enum orb_field_type)
+    FIELD_TYPE_TO_STRUCT = {
+        0: "b", 1: "B", 2: "h", 3: "H", 4: "i", 5: "I", 6: "q", 7: "Q",
+        8: "f", 9: "d", 10: "?", 11: "s",
+    }
+    MSG_NAME_TOPIC = "TOPC"
+    MSG_NAME_FIELD = "FELD"
     __csv_delim = ","
     __csv_null = ""
     __msg_filter = []
@@ -71,6 +78,7 @@ class SDLog2Parser:
         self.__csv_data = {}        # current values for all columns
         self.__csv_updated = False
         self.__msg_filter_map = {}  # filter in form of map, with '*" expanded to full list of fields
+        self.__topics = {}          # topics logged from metadata by message type: (name, size, fields)
     
     def setCSVDelimiter(self, csv_delim):
         self.__csv_delim = csv_delim
@@ -136,6 +144,10 @@ class SDLog2Parser:
                     msg_length = msg_descr[0]
                     if self.__bytesLeft() < msg_length:
                         break
+                    if msg_descr[1] in (self.MSG_NAME_TOPIC, self.MSG_NAME_FIELD):
+                        # part of a topic description, not data
+                        self.__parseTopicDescr(msg_descr)
+                        continue
                     if first_data_msg:
                         # build CSV columns and init data map
                         self.__initCSV()
@@ -205,16 +217,66 @@ class SDLog2Parser:
                     msg_mults.append(f[1])
                 except KeyError as e:
                     raise Exception("Unsupported format char: %s in message %s (%i)" % (c, msg_name, msg_type))
+            if msg_format == "":
+                # a topic logged from its metadata, described by TOPC and FELD messages
+                msg_labels = []
+                msg_struct = "%ix" % (msg_length - self.MSG_HEADER_LEN)
             msg_struct = "<" + msg_struct   # force little-endian
             self.__msg_descrs[msg_type] = (msg_length, msg_name, msg_format, msg_labels, msg_struct, msg_mults)
             self.__msg_labels[msg_name] = msg_labels
-            self.__msg_names.append(msg_name)
+            if msg_name not in (self.MSG_NAME_TOPIC, self.MSG_NAME_FIELD):
+                self.__msg_names.append(msg_name)
             if self.__debug_out:
                 if self.__filterMsg(msg_name) != None:
                     print "MSG FORMAT: type = %i, length = %i, name = %s, format = %s, labels = %s, struct = %s, mults = %s" % (
                                 msg_type, msg_length, msg_name, msg_format, str(msg_labels), msg_struct, msg_mults)
         self.__ptr += self.MSG_FORMAT_PACKET_LEN
     
+    def __parseTopicDescr(self, msg_descr):
+        msg_length, msg_name, msg_format, msg_labels, msg_struct, msg_mults = msg_descr
+        data = struct.unpack(msg_struct, self.__buffer[self.__ptr+self.MSG_HEADER_LEN:self.__ptr+msg_length])
+        self.__ptr += msg_length
+        msg_type = data[0]
+        if msg_name == self.MSG_NAME_TOPIC:
+            self.__topics[msg_type] = (data[2].strip("\0"), data[1], [])
+        elif msg_type in self.__topics:
+            self.__topics[msg_type][2].append((data[1], data[2], data[3], data[4].strip("\0")))
+        else:
+            return
+        if msg_type not in self.__msg_descrs:
+            return
+        # rebuild the topic's description from its fields
+        topic_name, topic_size, fields = self.__topics[msg_type]
+        old_name = self.__msg_descrs[msg_type][1]
+        topic_struct = ""
+        topic_labels = []
+        offset = 0
+        for field_offset, field_type, field_count, field_name in sorted(fields):
+            if field_offset < offset or field_type not in self.FIELD_TYPE_TO_STRUCT:
+                continue
+            if field_offset > offset:
+                topic_struct += "%ix" % (field_offset - offset)
+            c = self.FIELD_TYPE_TO_STRUCT[field_type]
+            if c == "s":
+                topic_struct += "%is" % field_count
+                topic_labels.append(field_name)
+                size = field_count
+            else:
+                topic_struct += c * field_count
+                if field_count == 1:
+                    topic_labels.append(field_name)
+                else:
+                    topic_labels.extend(["%s%i" % (field_name, i) for i in range(field_count)])
+                size = struct.calcsize("<" + c) * field_count
+            offset = field_offset + size
+        if topic_size > offset:
+            topic_struct += "%ix" % (topic_size - offset)
+        self.__msg_descrs[msg_type] = (self.MSG_HEADER_LEN + topic_size, topic_name, "", topic_labels,
+                                       "<" + topic_struct, [None] * len(topic_labels))
+        self.__msg_labels.pop(old_name, None)
+        self.__msg_labels[topic_name] = topic_labels
+        self.__msg_names = [topic_name if n == old_name else n for n in self.__msg_names]
+
     def __parseMsg(self, msg_descr):
         msg_length, msg_name, msg_format, msg_labels, msg_struct, msg_mults = msg_descr
         if not self.__debug_out and self.__time_msg != None and msg_name == self.__time_msg and self.__csv_updated:
@@ -280,7 +342,7 @@ def _main():
             	file_name = arg
             elif opt == "m":
                 show_fields = "*"
-                a = arg.split("_")
+                a = arg.split(".", 1)
                 if len(a) > 1:
                     show_fields = a[1].split(",")
                 msg_filter.append((a[0], show_fields))
@@ -0,0 +1,136 @@
+#!/usr/bin/env python
+
+"""Convert a dump from the hot-path event tracer to Chrome trace-event JSON
+
+Usage: python trace_to_chrome.py <trace.bin> [<trace.json>]
+
+    Writes to stdout when no output file is given.  Load the result in
+    chrome://tracing or https://ui.perfetto.dev.
+
+    Take the dump on the vehicle with 'trace start', then 'trace dump <file>'."""
+
+from __future__ import print_function
+
+import json, struct, sys
+
+FILE_MAGIC = b"PX4trace"
+FILE_VERSION = 1
+HEADER = struct.Struct("<8sII")
+RECORD = struct.Struct("<BBHI")
+EVENT = struct.Struct("<QHBBI")
+
+RECORD_TASK = 1
+RECORD_NAME = 2
+RECORD_EVENTS = 3
+
+TYPE_BEGIN = 1
+TYPE_END = 2
+TYPE_INSTANT = 3
+
+CAT_PERF = 1
+CAT_ORB_PUBLISH = 2
+CAT_ORB_COPY = 3
+
+CATEGORIES = {
+    CAT_PERF: "perf",
+    CAT_ORB_PUBLISH: "orb_publish",
+    CAT_ORB_COPY: "orb_copy",
+}
+
+PHASES = {
+    TYPE_BEGIN: "B",
+    TYPE_END: "E",
+    TYPE_INSTANT: "i",
+}
+
+
+def read_dump(data):
+    """Return the task names, the ID names and the events of each task."""
+    magic, version, event_size = HEADER.unpack_from(data, 0)
+    if magic != FILE_MAGIC:
+        raise ValueError("not a trace dump")
+    if version != FILE_VERSION or event_size != EVENT.size:
+        raise ValueError("unsupported trace dump version %u" % version)
+
+    tasks = {}
+    names = {}
+    events = {}
+    offset = HEADER.size
+
+    while offset + RECORD.size <= len(data):
+        rtype, category, rid, length = RECORD.unpack_from(data, offset)
+        offset += RECORD.size
+        payload = data[offset:offset + length]
+        offset += length
+
+        if rtype == RECORD_TASK:
+            tasks[rid] = payload.decode("ascii", "replace")
+        elif rtype == RECORD_NAME:
+            names[(category, rid)] = payload.decode("ascii", "replace")
+        elif rtype == RECORD_EVENTS:
+            task_events = events.setdefault(rid, [])
+            for i in range(0, len(payload) - EVENT.size + 1, EVENT.size):
+                task_events.append(EVENT.unpack_from(payload, i))
+
+    return tasks, names, events
+
+
+def event_name(names, category, eid):
+    if category == CAT_PERF:
+        return names.get((CAT_PERF, eid), "perf %u" % eid)
+    topic = names.get((CAT_ORB_PUBLISH, eid), "topic %u" % eid)
+    return "%s(%s)" % (CATEGORIES.get(category, "?"), topic)
+
+
+def convert(tasks, names, events):
+    trace = []
+
+    for tid in sorted(events):
+        trace.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": tid,
+                      "args": {"name": tasks.get(tid, "task %u" % tid)}})
+
+        # an overwritten ring can start with ends whose begins are lost
+        depth = 0
+
+        for timestamp, eid, etype, category, _ in events[tid]:
+            if etype == TYPE_BEGIN:
+                depth += 1
+            elif etype == TYPE_END:
+                if depth == 0:
+                    continue
+                depth -= 1
+
+            event = {"name": event_name(names, category, eid),
+                     "cat": CATEGORIES.get(category, "unknown"),
+                     "ph": PHASES.get(etype, "i"),
+                     "ts": timestamp,
+                     "pid": 1,
+                     "tid": tid}
+            if etype == TYPE_INSTANT:
+                event["s"] = "t"
+            trace.append(event)
+
+    return {"traceEvents": trace, "displayTimeUnit": "ms"}
+
+
+def _main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return 1
+
+    with open(sys.argv[1], "rb") as f:
+        data = f.read()
+
+    result = convert(*read_dump(data))
+
+    if len(sys.argv) > 2:
+        with open(sys.argv[2], "w") as f:
+            json.dump(result, f)
+    else:
+        json.dump(result, sys.stdout)
+        print()
+
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(_main())
@@ -52,6 +52,7 @@ MODULES		+= systemcmds/preflight_check
 MODULES		+= systemcmds/pwm
 MODULES		+= systemcmds/reboot
 MODULES		+= systemcmds/top
+MODULES		+= systemcmds/trace
 MODULES		+= systemcmds/tests
 
 #
@@ -86,6 +87,7 @@ MODULES		+= examples/flow_speed_control
 # Logging
 #
 MODULES		+= modules/sdlog2
+MODULES		+= modules/latency_monitor
 
 #
 # Library modules
@@ -0,0 +1,189 @@
+#
+#   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in
+#    the documentation and/or other materials provided with the
+#    distribution.
+# 3. Neither the name PX4 nor the names of its contributors may be
+#    used to endorse or promote products derived from this software
+#    without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+# FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+# COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+# INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+# BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+# OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+# AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+# ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+#
+
+
+#
+# Makefile for the POSIX host build.
+#
+# Builds uORB and the device framework into a static library for the
+# build host, and links it into px4_posix, a program that runs shell
+# commands (e.g. 'uorb test') against an in-process uORB.
+#
+# Requires:
+#
+# WORK_DIR:
+#	Directory in which the library and program are built.
+#
+# Optional:
+#
+# HOST_CC, HOST_CXX, HOST_AR:
+#	Host compilers and archiver; default to the system ones.
+#
+
+################################################################################
+# Paths and configuration
+################################################################################
+
+MK_DIR			?= $(dir $(lastword $(MAKEFILE_LIST)))
+ifeq ($(PX4_BASE),)
+export PX4_BASE		:= $(abspath $(MK_DIR)/..)
+endif
+
+all:		program
+
+include $(MK_DIR)/setup.mk
+
+ifeq ($(WORK_DIR),)
+$(error WORK_DIR must be set)
+endif
+
+POSIX_SRC		 = $(PX4_MODULE_SRC)platforms/posix/
+
+#
+# Sources, relative to PX4_MODULE_SRC
+#
+LIBRARY_SRCS		 = modules/uORB/uORB.cpp \
+			   modules/uORB/objects_common.cpp \
+			   modules/uORB/timer_wheel.cpp \
+			   modules/uORB/recorder.cpp \
+			   modules/uORB/topic_list.cpp \
+			   drivers/device/cdev.cpp \
+			   drivers/device/device.cpp \
+			   modules/systemlib/perf_counter.c \
+			   modules/systemlib/trace.c \
+			   modules/systemlib/param/param.c \
+			   modules/systemlib/bson/tinybson.c \
+			   modules/sdlog2/logbuffer.c \
+			   modules/sdlog2/logwriter.c \
+			   modules/sensors/sensor_select.c \
+			   platforms/posix/crc32.c \
+			   platforms/posix/hrt.c \
+			   platforms/posix/irq.c \
+			   platforms/posix/queue.c \
+			   platforms/posix/vfs.cpp
+
+#
+# The program also links some parameter definitions, which would
+# otherwise not be pulled out of the library, and the host-capable tests.
+#
+PROGRAM_SRCS		 = platforms/posix/main.cpp \
+			   modules/sensors/sensor_params.c \
+			   modules/fixedwing_backside/params.c \
+			   modules/att_pos_estimator_ekf/params.c \
+			   systemcmds/tests/tests_param.c \
+			   systemcmds/tests/tests_perf.c \
+			   systemcmds/tests/test_bson.c \
+			   systemcmds/tests/tests_logbuffer.c \
+			   systemcmds/tests/tests_sensor_select.c \
+			   systemcmds/perf/perf_export.c \
+			   systemcmds/trace/trace.c
+
+################################################################################
+# Host toolchain
+################################################################################
+
+HOST_CC			?= cc
+HOST_CXX		?= c++
+HOST_AR			?= ar
+
+# the tracer is compiled in so that it is tested
+HOST_DEFINES		 = -D__PX4_POSIX -DPX4_TRACE
+HOST_INCLUDES		 = -I$(POSIX_SRC)include \
+			   $(addprefix -I,$(INCLUDE_DIRS)) \
+			   -include $(PX4_INCLUDE_DIR)visibility.h
+
+# printf formats and register casts in the tree assume a 32-bit target
+HOST_WARNINGS		 = -Wall \
+			   -Wno-unused-parameter \
+			   -Wno-format \
+			   -Wno-int-to-pointer-cast
+
+HOST_CFLAGS		 = -std=gnu99 -g -O2 -pthread \
+			   $(HOST_WARNINGS) $(HOST_DEFINES) $(HOST_INCLUDES)
+
+HOST_CXXFLAGS		 = -std=gnu++0x -fno-exceptions -fno-rtti -g -O2 -pthread \
+			   $(HOST_WARNINGS) \
+			   -Wno-delete-non-virtual-dtor \
+			   $(HOST_DEFINES) $(HOST_INCLUDES)
+
+HOST_LIBS		 = -pthread -lm -lrt
+
+################################################################################
+# Build rules
+################################################################################
+
+LIBRARY			 = $(WORK_DIR)libpx4_posix.a
+PROGRAM			 = $(WORK_DIR)px4_posix
+
+LIBRARY_OBJS		 = $(addprefix $(WORK_DIR),$(addsuffix .o,$(basename $(LIBRARY_SRCS))))
+PROGRAM_OBJS		 = $(addprefix $(WORK_DIR),$(addsuffix .o,$(basename $(PROGRAM_SRCS))))
+
+.PHONY:			library program test clean
+library:		$(LIBRARY)
+program:		$(PROGRAM)
+
+$(WORK_DIR)%.o:		$(PX4_MODULE_SRC)%.c
+	@$(ECHO) "CC:      $<"
+	@$(MKDIR) -p $(dir $@)
+	$(Q) $(HOST_CC) -MD -c $(HOST_CFLAGS) $< -o $@
+
+$(WORK_DIR)%.o:		$(PX4_MODULE_SRC)%.cpp
+	@$(ECHO) "CXX:     $<"
+	@$(MKDIR) -p $(dir $@)
+	$(Q) $(HOST_CXX) -MD -c $(HOST_CXXFLAGS) $< -o $@
+
+$(LIBRARY):		$(LIBRARY_OBJS)
+	@$(ECHO) "AR:      $@"
+	$(Q) $(REMOVE) $@
+	$(Q) $(HOST_AR) rcs $@ $^
+
+$(PROGRAM):		$(PROGRAM_OBJS) $(LIBRARY)
+	@$(ECHO) "LINK:    $@"
+	$(Q) $(HOST_CXX) -o $@ $(PROGRAM_OBJS) $(LIBRARY) $(HOST_LIBS)
+
+#
+# Run the uORB self-tests on the host.  The replay and perf tests leave
+# the clock in virtual time, so each runs in a process of its own.
+#
+test:			$(PROGRAM)
+	$(Q) $(PROGRAM) uorb test
+	$(Q) $(PROGRAM) tests param
+	$(Q) $(PROGRAM) tests perf
+	$(Q) $(PROGRAM) tests bson
+	$(Q) $(PROGRAM) tests logbuffer
+	$(Q) $(PROGRAM) tests sensor_select
+	$(Q) $(PROGRAM) uorb test replay
+
+clean:
+	$(Q) $(REMOVE) $(LIBRARY) $(PROGRAM) $(LIBRARY_OBJS) $(PROGRAM_OBJS)
+	$(Q) $(REMOVE) $(LIBRARY_OBJS:.o=.d) $(PROGRAM_OBJS:.o=.d)
+
+-include $(LIBRARY_OBJS:.o=.d) $(PROGRAM_OBJS:.o=.d)
@@ -65,7 +65,7 @@ static ssize_t	cdev_read(struct file *filp, char *buffer, size_t buflen);
 static ssize_t	cdev_write(struct file *filp, const char *buffer, size_t buflen);
 static off_t	cdev_seek(struct file *filp, off_t offset, int whence);
 static int	cdev_ioctl(struct file *filp, int cmd, unsigned long arg);
-static int	cdev_poll(struct file *filp, struct pollfd *fds, bool setup);
+static int	cdev_poll(struct file *filp, px4_pollfd_struct_t *fds, bool setup);
 
 /**
  * Character device indirection table.
@@ -226,7 +226,7 @@ CDev::ioctl(struct file *filp, int cmd, unsigned long arg)
 }
 
 int
-CDev::poll(struct file *filp, struct pollfd *fds, bool setup)
+CDev::poll(struct file *filp, px4_pollfd_struct_t *fds, bool setup)
 {
 	int ret = OK;
 
@@ -263,8 +263,13 @@ CDev::poll(struct file *filp, struct pollfd *fds, bool setup)
 	} else {
 		/*
 		 * Handle a teardown request.
+		 *
+		 * Once this returns the waiter may go away, so make sure that
+		 * poll_notify() is not still walking the set on another thread.
 		 */
+		irqstate_t state = irqsave();
 		ret = remove_poll_waiter(fds);
+		irqrestore(state);
 	}
 
 	unlock();
@@ -286,15 +291,25 @@ CDev::poll_notify(pollevent_t events)
 }
 
 void
-CDev::poll_notify_one(struct pollfd *fds, pollevent_t events)
+CDev::poll_notify_one(px4_pollfd_struct_t *fds, pollevent_t events)
 {
 	/* update the reported event set */
 	fds->revents |= fds->events & events;
 
 	/* if the state is now interesting, wake the waiter if it's still asleep */
 	/* XXX semcount check here is a vile hack; counting semphores should not be abused as cvars */
+#ifdef __PX4_POSIX
+	int semcount;
+
+	if ((fds->revents != 0) && (sem_getvalue(fds->sem, &semcount) == 0) && (semcount <= 0))
+		sem_post(fds->sem);
+
+#else
+
 	if ((fds->revents != 0) && (fds->sem->semcount <= 0))
 		sem_post(fds->sem);
+
+#endif
 }
 
 pollevent_t
@@ -305,7 +320,7 @@ CDev::poll_state(struct file *filp)
 }
 
 int
-CDev::store_poll_waiter(struct pollfd *fds)
+CDev::store_poll_waiter(px4_pollfd_struct_t *fds)
 {
 	/*
 	 * Look for a free slot.
@@ -324,7 +339,7 @@ CDev::store_poll_waiter(struct pollfd *fds)
 }
 
 int
-CDev::remove_poll_waiter(struct pollfd *fds)
+CDev::remove_poll_waiter(px4_pollfd_struct_t *fds)
 {
 	for (unsigned i = 0; i < _max_pollwaiters; i++) {
 		if (fds == _pollset[i]) {
@@ -388,7 +403,7 @@ cdev_ioctl(struct file *filp, int cmd, unsigned long arg)
 }
 
 static int
-cdev_poll(struct file *filp, struct pollfd *fds, bool setup)
+cdev_poll(struct file *filp, px4_pollfd_struct_t *fds, bool setup)
 {
 	CDev *cdev = (CDev *)(filp->f_inode->i_private);
 
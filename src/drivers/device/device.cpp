@@ -41,6 +41,7 @@
 
 #include <nuttx/arch.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <unistd.h>
 
 namespace device
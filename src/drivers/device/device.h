@@ -53,6 +53,8 @@
 
 #include <nuttx/fs/fs.h>
 
+#include "vfs.h"
+
 /**
  * Namespace encapsulating all device framework classes, functions and data.
  */
@@ -276,7 +278,7 @@ public:
 	 *			it is being torn down.
 	 * @return		OK on success, or -errno otherwise.
 	 */
-	virtual int	poll(struct file *filp, struct pollfd *fds, bool setup);
+	virtual int	poll(struct file *filp, px4_pollfd_struct_t *fds, bool setup);
 
 	/**
 	 * Test whether the device is currently open.
@@ -324,7 +326,7 @@ protected:
 	 * @param fds		A poll waiter to notify.
 	 * @param events	The event(s) to send to the waiter.
 	 */
-	virtual void	poll_notify_one(struct pollfd *fds, pollevent_t events);
+	virtual void	poll_notify_one(px4_pollfd_struct_t *fds, pollevent_t events);
 
 	/**
 	 * Notification of the first open.
@@ -359,7 +361,7 @@ private:
 	bool		_registered;		/**< true if device name was registered */
 	unsigned	_open_count;		/**< number of successful opens */
 
-	struct pollfd	*_pollset[_max_pollwaiters];
+	px4_pollfd_struct_t	*_pollset[_max_pollwaiters];
 
 	/**
 	 * Store a pollwaiter in a slot where we can find it later.
@@ -368,14 +370,14 @@ private:
 	 *
 	 * @return		OK, or -errno on error.
 	 */
-	int		store_poll_waiter(struct pollfd *fds);
+	int		store_poll_waiter(px4_pollfd_struct_t *fds);
 
 	/**
 	 * Remove a poll waiter.
 	 *
 	 * @return		OK, or -errno on error.
 	 */
-	int		remove_poll_waiter(struct pollfd *fds);
+	int		remove_poll_waiter(px4_pollfd_struct_t *fds);
 };
 
 /**
@@ -0,0 +1,95 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file vfs.h
+ *
+ * File operations on device framework nodes.
+ *
+ * On NuttX device nodes live in the system VFS and these map directly
+ * onto the standard calls.  On a POSIX host (__PX4_POSIX) the nodes are
+ * kept in a private table inside the process, and the px4_* calls must
+ * be used to reach them.
+ */
+
+#ifndef _DEVICE_VFS_H
+#define _DEVICE_VFS_H
+
+#include <sys/types.h>
+#include <poll.h>
+
+#ifdef __PX4_POSIX
+
+#include <semaphore.h>
+
+typedef short pollevent_t;
+
+/**
+ * Poll descriptor.
+ *
+ * Mirrors the NuttX struct pollfd; the semaphore and private pointer
+ * are used by the driver to wake the waiter.
+ */
+typedef struct {
+	int		fd;		/**< file descriptor being polled */
+	pollevent_t	events;		/**< events of interest */
+	pollevent_t	revents;	/**< events that occurred */
+	sem_t		*sem;		/**< posted by the driver to wake the waiter */
+	void		*priv;		/**< driver-private data */
+} px4_pollfd_struct_t;
+
+__BEGIN_DECLS
+
+__EXPORT int		px4_open(const char *path, int flags, ...);
+__EXPORT int		px4_close(int fd);
+__EXPORT ssize_t	px4_read(int fd, void *buffer, size_t buflen);
+__EXPORT ssize_t	px4_write(int fd, const void *buffer, size_t buflen);
+__EXPORT int		px4_ioctl(int fd, int cmd, unsigned long arg);
+__EXPORT int		px4_poll(px4_pollfd_struct_t *fds, nfds_t nfds, int timeout);
+
+__END_DECLS
+
+#else
+
+typedef struct pollfd px4_pollfd_struct_t;
+
+#define px4_open	open
+#define px4_close	close
+#define px4_read	read
+#define px4_write	write
+#define px4_ioctl	ioctl
+#define px4_poll	poll
+
+#endif
+
+#endif /* _DEVICE_VFS_H */
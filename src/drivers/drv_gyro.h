@@ -44,7 +44,13 @@
 #include "drv_sensor.h"
 #include "drv_orb_dev.h"
 
-#define GYRO_DEVICE_PATH	"/dev/gyro"
+/*
+ * Each gyro driver registers the first free node, so that more than one
+ * may run at once; GYRO_DEVICE_PATH is the first gyro started.
+ */
+#define GYRO0_DEVICE_PATH	"/dev/gyro0"
+#define GYRO1_DEVICE_PATH	"/dev/gyro1"
+#define GYRO_DEVICE_PATH	GYRO0_DEVICE_PATH
 
 /**
  * gyro report structure.  Reads from the device must be in multiples of this
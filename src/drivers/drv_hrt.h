@@ -41,6 +41,7 @@
 
 #include <sys/types.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include <time.h>
 #include <queue.h>
@@ -146,4 +147,18 @@ __EXPORT extern void	hrt_cancel(struct hrt_call *entry);
  */
 __EXPORT extern void	hrt_init(void);
 
+#ifdef __PX4_POSIX
+
+/*
+ * Switch to virtual time and advance it to now.
+ *
+ * From the first call on, hrt_absolute_time() returns the virtual time,
+ * which only moves when this is called again; it is never moved backwards.
+ * Callouts that fall due are run before this returns.  Used to replay
+ * recorded data faster than real time.
+ */
+__EXPORT extern void	hrt_set_virtual_time(hrt_abstime now);
+
+#endif
+
 __END_DECLS
@@ -58,6 +58,12 @@
 /** maximum ogbject name length */
 #define ORB_MAXNAME		32
 
+/** maximum number of objects a queued topic can hold */
+#define ORB_MAX_QUEUE_SIZE	32
+
+/** maximum number of instances of a multi-instance topic */
+#define ORB_MULTI_MAX_INSTANCES	4
+
 #define _ORBIOCBASE		(0x2600)
 #define _ORBIOC(_n)		(_IOC(_ORBIOCBASE, _n))
 
@@ -65,9 +71,14 @@
  * IOCTLs for the uORB control device
  */
 
-/** Advertise a new topic described by *(uorb_metadata *)arg */
+/** Advertise a new topic instance described by *(struct orb_advertdata *)arg */
 #define ORBIOCADVERTISE		_ORBIOC(0)
 
+struct orb_advertdata {
+	const struct orb_metadata *meta;	/**< the topic being advertised */
+	unsigned instance;			/**< the instance of the topic to create */
+};
+
 /*
  * IOCTLs for individual topics.
  */
@@ -84,4 +95,13 @@
 /** Get the global advertiser handle for the topic */
 #define ORBIOCGADVERTISER	_ORBIOC(13)
 
+/** Set the number of objects queued by the topic; must be done before it is first published */
+#define ORBIOCSETQUEUESIZE	_ORBIOC(14)
+
+/** Get the node and subscriber state for a direct-call subscription into *(struct orb_subscription *)arg */
+#define ORBIOCGSUBSCRIBER	_ORBIOC(15)
+
+/** Claim the topic instance for a multi-instance advertiser; fails with EBUSY if already taken */
+#define ORBIOCCLAIM		_ORBIOC(16)
+
 #endif /* _DRV_UORB_H */
@@ -398,6 +398,7 @@ HIL::task_main()
 				/* do mixing */
 				outputs.noutputs = _mixers->mix(&outputs.output[0], num_outputs);
 				outputs.timestamp = hrt_absolute_time();
+				outputs.sensor_timestamp = _controls.sensor_timestamp;
 
 				/* iterate actuators */
 				for (unsigned i = 0; i < num_outputs; i++) {
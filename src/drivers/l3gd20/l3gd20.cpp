@@ -322,9 +322,10 @@ L3GD20::init()
 	if (_reports == nullptr)
 		goto out;
 
-	/* advertise sensor topic */
+	/* advertise sensor topic; there may be another gyro publishing alongside us */
+	int gyro_instance;
 	memset(&_reports[0], 0, sizeof(_reports[0]));
-	_gyro_topic = orb_advertise(ORB_ID(sensor_gyro), &_reports[0]);
+	_gyro_topic = orb_advertise_multi(ORB_ID(sensor_gyro), &_reports[0], &gyro_instance);
 
 	/* set default configuration */
 	write_reg(ADDR_CTRL_REG1, REG1_POWER_NORMAL | REG1_Z_ENABLE | REG1_Y_ENABLE | REG1_X_ENABLE);
@@ -729,6 +730,7 @@ namespace l3gd20
 {
 
 L3GD20	*g_dev;
+const char *g_path;		/**< gyro node the driver registered */
 
 void	start();
 void	test();
@@ -746,8 +748,17 @@ start()
 	if (g_dev != nullptr)
 		errx(1, "already started");
 
+	/* another gyro may be running already; take the next free node */
+	g_path = GYRO0_DEVICE_PATH;
+	fd = open(GYRO0_DEVICE_PATH, O_RDONLY);
+
+	if (fd >= 0) {
+		close(fd);
+		g_path = GYRO1_DEVICE_PATH;
+	}
+
 	/* create the driver */
-	g_dev = new L3GD20(1 /* XXX magic number */, GYRO_DEVICE_PATH, (spi_dev_e)PX4_SPIDEV_GYRO);
+	g_dev = new L3GD20(1 /* XXX magic number */, g_path, (spi_dev_e)PX4_SPIDEV_GYRO);
 
 	if (g_dev == nullptr)
 		goto fail;
@@ -756,7 +767,7 @@ start()
 		goto fail;
 
 	/* set the poll rate to default, starts automatic data collection */
-	fd = open(GYRO_DEVICE_PATH, O_RDONLY);
+	fd = open(g_path, O_RDONLY);
 
 	if (fd < 0)
 		goto fail;
@@ -787,11 +798,14 @@ test()
 	struct gyro_report g_report;
 	ssize_t sz;
 
+	if (g_dev == nullptr)
+		errx(1, "driver not running");
+
 	/* get the driver */
-	fd_gyro = open(GYRO_DEVICE_PATH, O_RDONLY);
+	fd_gyro = open(g_path, O_RDONLY);
 
 	if (fd_gyro < 0)
-		err(1, "%s open failed", GYRO_DEVICE_PATH);
+		err(1, "%s open failed", g_path);
 
 	/* reset to manual polling */
 	if (ioctl(fd_gyro, SENSORIOCSPOLLRATE, SENSOR_POLLRATE_MANUAL) < 0)
@@ -824,7 +838,10 @@ test()
 void
 reset()
 {
-	int fd = open(GYRO_DEVICE_PATH, O_RDONLY);
+	if (g_dev == nullptr)
+		errx(1, "driver not running");
+
+	int fd = open(g_path, O_RDONLY);
 
 	if (fd < 0)
 		err(1, "failed ");
@@ -591,6 +591,7 @@ MK::task_main()
 				/* do mixing */
 				outputs.noutputs = _mixers->mix(&outputs.output[0], _num_outputs);
 				outputs.timestamp = hrt_absolute_time();
+				outputs.sensor_timestamp = _controls.sensor_timestamp;
 
 				// XXX output actual limited values
 				memcpy(&controls_effective, &_controls, sizeof(controls_effective));
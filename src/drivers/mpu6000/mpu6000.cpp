@@ -150,7 +150,7 @@ class MPU6000_gyro;
 class MPU6000 : public device::SPI
 {
 public:
-	MPU6000(int bus, spi_dev_e device);
+	MPU6000(int bus, spi_dev_e device, const char *gyro_path);
 	virtual ~MPU6000();
 
 	virtual int		init();
@@ -285,7 +285,7 @@ private:
 class MPU6000_gyro : public device::CDev
 {
 public:
-	MPU6000_gyro(MPU6000 *parent);
+	MPU6000_gyro(MPU6000 *parent, const char *path);
 	~MPU6000_gyro();
 
 	virtual ssize_t		read(struct file *filp, char *buffer, size_t buflen);
@@ -302,9 +302,9 @@ private:
 /** driver 'main' command */
 extern "C" { __EXPORT int mpu6000_main(int argc, char *argv[]); }
 
-MPU6000::MPU6000(int bus, spi_dev_e device) :
+MPU6000::MPU6000(int bus, spi_dev_e device, const char *gyro_path) :
 	SPI("MPU6000", ACCEL_DEVICE_PATH, bus, device, SPIDEV_MODE3, 10000000),
-	_gyro(new MPU6000_gyro(this)),
+	_gyro(new MPU6000_gyro(this, gyro_path)),
 	_product(0),
 	_call_interval(0),
 	_accel_range_scale(0.0f),
@@ -366,9 +366,10 @@ MPU6000::init()
 		return ret;
 	}
 
-	/* advertise sensor topics */
+	/* advertise sensor topics; there may be another gyro publishing alongside us */
+	int gyro_instance;
 	_accel_topic = orb_advertise(ORB_ID(sensor_accel), &_accel_report);
-	_gyro_topic = orb_advertise(ORB_ID(sensor_gyro), &_gyro_report);
+	_gyro_topic = orb_advertise_multi(ORB_ID(sensor_gyro), &_gyro_report, &gyro_instance);
 
 	// Chip reset
 	write_reg(MPUREG_PWR_MGMT_1, BIT_H_RESET);
@@ -1013,8 +1014,8 @@ MPU6000::print_info()
 	printf("reads:          %u\n", _reads);
 }
 
-MPU6000_gyro::MPU6000_gyro(MPU6000 *parent) :
-	CDev("MPU6000_gyro", GYRO_DEVICE_PATH),
+MPU6000_gyro::MPU6000_gyro(MPU6000 *parent, const char *path) :
+	CDev("MPU6000_gyro", path),
 	_parent(parent)
 {
 }
@@ -1048,6 +1049,7 @@ namespace mpu6000
 {
 
 MPU6000	*g_dev;
+const char *g_gyro_path;	/**< gyro node the driver registered */
 
 void	start();
 void	test();
@@ -1066,8 +1068,17 @@ start()
 		/* if already started, the still command succeeded */
 		errx(0, "already started");
 
+	/* another gyro may be running already; take the next free node */
+	g_gyro_path = GYRO0_DEVICE_PATH;
+	fd = open(GYRO0_DEVICE_PATH, O_RDONLY);
+
+	if (fd >= 0) {
+		close(fd);
+		g_gyro_path = GYRO1_DEVICE_PATH;
+	}
+
 	/* create the driver */
-	g_dev = new MPU6000(1 /* XXX magic number */, (spi_dev_e)PX4_SPIDEV_MPU);
+	g_dev = new MPU6000(1 /* XXX magic number */, (spi_dev_e)PX4_SPIDEV_MPU, g_gyro_path);
 
 	if (g_dev == nullptr)
 		goto fail;
@@ -1117,10 +1128,10 @@ test()
 		    ACCEL_DEVICE_PATH);
 
 	/* get the driver */
-	fd_gyro = open(GYRO_DEVICE_PATH, O_RDONLY);
+	fd_gyro = open(g_gyro_path, O_RDONLY);
 
 	if (fd_gyro < 0)
-		err(1, "%s open failed", GYRO_DEVICE_PATH);
+		err(1, "%s open failed", g_gyro_path);
 
 	/* reset to manual polling */
 	if (ioctl(fd, SENSORIOCSPOLLRATE, SENSOR_POLLRATE_MANUAL) < 0)
@@ -463,6 +463,7 @@ PX4FMU::task_main()
 				/* do mixing */
 				outputs.noutputs = _mixers->mix(&outputs.output[0], num_outputs);
 				outputs.timestamp = hrt_absolute_time();
+				outputs.sensor_timestamp = _controls.sensor_timestamp;
 
 				// XXX output actual limited values
 				memcpy(&controls_effective, &_controls, sizeof(controls_effective));
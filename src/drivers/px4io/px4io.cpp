@@ -162,6 +162,7 @@ private:
 
 	/* subscribed topics */
 	int			_t_actuators;	///< actuator controls topic
+	uint64_t		_controls_sensor_timestamp; ///< sensor timestamp of the controls last sent to IO
 	int			_t_armed;	///< system armed control topic
 	int 			_t_vstatus;	///< system / vehicle status
 	int			_t_param;	///< parameter update topic
@@ -343,6 +344,7 @@ PX4IO::PX4IO() :
 	_status(0),
 	_alarms(0),
 	_t_actuators(-1),
+	_controls_sensor_timestamp(0),
 	_t_armed(-1),
 	_t_vstatus(-1),
 	_t_param(-1),
@@ -711,7 +713,12 @@ PX4IO::io_set_control_state()
 		regs[i] = FLOAT_TO_REG(controls.control[i]);
 
 	/* copy values to registers in IO */
-	return io_reg_set(PX4IO_PAGE_CONTROLS, 0, regs, _max_controls);
+	int ret = io_reg_set(PX4IO_PAGE_CONTROLS, 0, regs, _max_controls);
+
+	if (ret == OK)
+		_controls_sensor_timestamp = controls.sensor_timestamp;
+
+	return ret;
 }
 
 int
@@ -1092,6 +1099,9 @@ PX4IO::io_publish_pwm_outputs()
 	actuator_outputs_s outputs;
 	outputs.timestamp = hrt_absolute_time();
 
+	/* IO mixes the controls as they arrive, so the outputs reflect the last ones sent */
+	outputs.sensor_timestamp = _controls_sensor_timestamp;
+
 	/* get servo values from IO */
 	uint16_t ctl[_max_actuators];
 	int ret = io_reg_get(PX4IO_PAGE_SERVOS, 0, ctl, _max_actuators);
@@ -329,6 +329,7 @@ void KalmanNav::updatePublications()
 
 	// attitude publication
 	_att.timestamp = _pubTimeStamp;
+	_att.sensor_timestamp = _sensors.sensor_timestamp;
 	_att.roll = phi;
 	_att.pitch = theta;
 	_att.yaw = psi;
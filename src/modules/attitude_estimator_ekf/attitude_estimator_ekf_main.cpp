@@ -212,8 +212,6 @@ const unsigned int loop_interval_alarm = 6500;	// loop interval in microseconds
 	/* store start time to guard against too slow update rates */
 	uint64_t last_run = hrt_absolute_time();
 
-	struct sensor_combined_s raw;
-	memset(&raw, 0, sizeof(raw));
 	struct vehicle_attitude_s att;
 	memset(&att, 0, sizeof(att));
 	struct vehicle_status_s state;
@@ -222,10 +220,14 @@ const unsigned int loop_interval_alarm = 6500;	// loop interval in microseconds
 	uint64_t last_data = 0;
 	uint64_t last_measurement = 0;
 
-	/* subscribe to raw data */
-	int sub_raw = orb_subscribe(ORB_ID(sensor_combined));
+	/* subscribe to raw data; it is read in place rather than copied */
+	orb_sub_t sub_raw = orb_subscribe_direct(ORB_ID(sensor_combined));
+
+	if (sub_raw == nullptr)
+		errx(1, "could not subscribe to sensor_combined");
+
 	/* rate-limit raw data updates to 200Hz */
-	orb_set_interval(sub_raw, 4);
+	orb_set_interval(orb_sub_fd(sub_raw), 4);
 
 	/* subscribe to param changes */
 	int sub_params = orb_subscribe(ORB_ID(parameter_update));
@@ -273,7 +275,7 @@ const unsigned int loop_interval_alarm = 6500;	// loop interval in microseconds
 	while (!thread_should_exit) {
 
 		struct pollfd fds[2];
-		fds[0].fd = sub_raw;
+		fds[0].fd = orb_sub_fd(sub_raw);
 		fds[0].events = POLLIN;
 		fds[1].fd = sub_params;
 		fds[1].events = POLLIN;
@@ -306,13 +308,23 @@ const unsigned int loop_interval_alarm = 6500;	// loop interval in microseconds
 			if (fds[0].revents & POLLIN) {
 
 				/* get latest measurements */
-				orb_copy(ORB_ID(sensor_combined), sub_raw, &raw);
+				const struct sensor_combined_s *raw;
+
+				if (OK != orb_peek(sub_raw, (const void **)&raw))
+					continue;
+
+				/*
+				 * The measurements may be overwritten once sensors has published
+				 * again, so keep the timestamps needed after the filter has run.
+				 */
+				uint64_t raw_timestamp = raw->timestamp;
+				uint64_t raw_sensor_timestamp = raw->sensor_timestamp;
 
 				if (!initialized) {
 
-					gyro_offsets[0] += raw.gyro_rad_s[0];
-					gyro_offsets[1] += raw.gyro_rad_s[1];
-					gyro_offsets[2] += raw.gyro_rad_s[2];
+					gyro_offsets[0] += raw->gyro_rad_s[0];
+					gyro_offsets[1] += raw->gyro_rad_s[1];
+					gyro_offsets[2] += raw->gyro_rad_s[2];
 					offset_count++;
 
 					if (hrt_absolute_time() - start_time > 3000000LL) {
@@ -327,45 +339,45 @@ const unsigned int loop_interval_alarm = 6500;	// loop interval in microseconds
 					perf_begin(ekf_loop_perf);
 
 					/* Calculate data time difference in seconds */
-					dt = (raw.timestamp - last_measurement) / 1000000.0f;
-					last_measurement = raw.timestamp;
+					dt = (raw->timestamp - last_measurement) / 1000000.0f;
+					last_measurement = raw->timestamp;
 					uint8_t update_vect[3] = {0, 0, 0};
 
 					/* Fill in gyro measurements */
-					if (sensor_last_count[0] != raw.gyro_counter) {
+					if (sensor_last_count[0] != raw->gyro_counter) {
 						update_vect[0] = 1;
-						sensor_last_count[0] = raw.gyro_counter;
-						sensor_update_hz[0] = 1e6f / (raw.timestamp - sensor_last_timestamp[0]);
-						sensor_last_timestamp[0] = raw.timestamp;
+						sensor_last_count[0] = raw->gyro_counter;
+						sensor_update_hz[0] = 1e6f / (raw->timestamp - sensor_last_timestamp[0]);
+						sensor_last_timestamp[0] = raw->timestamp;
 					}
 
-					z_k[0] =  raw.gyro_rad_s[0] - gyro_offsets[0];
-					z_k[1] =  raw.gyro_rad_s[1] - gyro_offsets[1];
-					z_k[2] =  raw.gyro_rad_s[2] - gyro_offsets[2];
+					z_k[0] =  raw->gyro_rad_s[0] - gyro_offsets[0];
+					z_k[1] =  raw->gyro_rad_s[1] - gyro_offsets[1];
+					z_k[2] =  raw->gyro_rad_s[2] - gyro_offsets[2];
 
 					/* update accelerometer measurements */
-					if (sensor_last_count[1] != raw.accelerometer_counter) {
+					if (sensor_last_count[1] != raw->accelerometer_counter) {
 						update_vect[1] = 1;
-						sensor_last_count[1] = raw.accelerometer_counter;
-						sensor_update_hz[1] = 1e6f / (raw.timestamp - sensor_last_timestamp[1]);
-						sensor_last_timestamp[1] = raw.timestamp;
+						sensor_last_count[1] = raw->accelerometer_counter;
+						sensor_update_hz[1] = 1e6f / (raw->timestamp - sensor_last_timestamp[1]);
+						sensor_last_timestamp[1] = raw->timestamp;
 					}
 
-					z_k[3] = raw.accelerometer_m_s2[0];
-					z_k[4] = raw.accelerometer_m_s2[1];
-					z_k[5] = raw.accelerometer_m_s2[2];
+					z_k[3] = raw->accelerometer_m_s2[0];
+					z_k[4] = raw->accelerometer_m_s2[1];
+					z_k[5] = raw->accelerometer_m_s2[2];
 
 					/* update magnetometer measurements */
-					if (sensor_last_count[2] != raw.magnetometer_counter) {
+					if (sensor_last_count[2] != raw->magnetometer_counter) {
 						update_vect[2] = 1;
-						sensor_last_count[2] = raw.magnetometer_counter;
-						sensor_update_hz[2] = 1e6f / (raw.timestamp - sensor_last_timestamp[2]);
-						sensor_last_timestamp[2] = raw.timestamp;
+						sensor_last_count[2] = raw->magnetometer_counter;
+						sensor_update_hz[2] = 1e6f / (raw->timestamp - sensor_last_timestamp[2]);
+						sensor_last_timestamp[2] = raw->timestamp;
 					}
 
-					z_k[6] = raw.magnetometer_ga[0];
-					z_k[7] = raw.magnetometer_ga[1];
-					z_k[8] = raw.magnetometer_ga[2];
+					z_k[6] = raw->magnetometer_ga[0];
+					z_k[7] = raw->magnetometer_ga[1];
+					z_k[8] = raw->magnetometer_ga[2];
 
 					uint64_t now = hrt_absolute_time();
 					unsigned int time_elapsed = now - last_run;
@@ -424,12 +436,13 @@ const unsigned int loop_interval_alarm = 6500;	// loop interval in microseconds
 						continue;
 					}
 
-					if (last_data > 0 && raw.timestamp - last_data > 12000) printf("[attitude estimator ekf] sensor data missed! (%llu)\n", raw.timestamp - last_data);
+					if (last_data > 0 && raw_timestamp - last_data > 12000) printf("[attitude estimator ekf] sensor data missed! (%llu)\n", raw_timestamp - last_data);
 
-					last_data = raw.timestamp;
+					last_data = raw_timestamp;
 
 					/* send out */
-					att.timestamp = raw.timestamp;
+					att.timestamp = raw_timestamp;
+					att.sensor_timestamp = raw_sensor_timestamp;
 
 					// XXX Apply the same transformation to the rotation matrix
 					att.roll = euler[0] - ekf_params.roll_off;
@@ -763,6 +763,7 @@ const unsigned int loop_interval_alarm = 6500;	// loop interval in microseconds
 
 					/* send out */
 					att.timestamp = raw.timestamp;
+					att.sensor_timestamp = raw.sensor_timestamp;
 
 					// XXX Apply the same transformation to the rotation matrix
 					att.roll = euler[0] - so3_comp_params.roll_off;
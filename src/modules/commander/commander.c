@@ -571,8 +571,10 @@ void do_gyro_calibration(int status_pub, struct vehicle_status_s *status)
 	int calibration_counter = 0;
 	float gyro_offset[3] = {0.0f, 0.0f, 0.0f};
 
+	/* every gyro is calibrated, as sensors may switch to any of them */
+	const char *gyro_paths[] = { GYRO0_DEVICE_PATH, GYRO1_DEVICE_PATH };
+
 	/* set offsets to zero */
-	int fd = open(GYRO_DEVICE_PATH, 0);
 	struct gyro_scale gscale_null = {
 		0.0f,
 		1.0f,
@@ -582,10 +584,17 @@ void do_gyro_calibration(int status_pub, struct vehicle_status_s *status)
 		1.0f,
 	};
 
-	if (OK != ioctl(fd, GYROIOCSSCALE, (long unsigned int)&gscale_null))
-		warn("WARNING: failed to set scale / offsets for gyro");
+	for (unsigned i = 0; i < sizeof(gyro_paths) / sizeof(gyro_paths[0]); i++) {
+		int fd = open(gyro_paths[i], 0);
 
-	close(fd);
+		if (fd < 0)
+			continue;
+
+		if (OK != ioctl(fd, GYROIOCSSCALE, (long unsigned int)&gscale_null))
+			warn("WARNING: failed to set scale / offsets for gyro");
+
+		close(fd);
+	}
 
 	while (calibration_counter < calibration_count) {
 
@@ -625,7 +634,6 @@ void do_gyro_calibration(int status_pub, struct vehicle_status_s *status)
 		}
 
 		/* set offsets to actual value */
-		fd = open(GYRO_DEVICE_PATH, 0);
 		struct gyro_scale gscale = {
 			gyro_offset[0],
 			1.0f,
@@ -635,10 +643,17 @@ void do_gyro_calibration(int status_pub, struct vehicle_status_s *status)
 			1.0f,
 		};
 
-		if (OK != ioctl(fd, GYROIOCSSCALE, (long unsigned int)&gscale))
-			warn("WARNING: failed to set scale / offsets for gyro");
+		for (unsigned i = 0; i < sizeof(gyro_paths) / sizeof(gyro_paths[0]); i++) {
+			int fd = open(gyro_paths[i], 0);
 
-		close(fd);
+			if (fd < 0)
+				continue;
+
+			if (OK != ioctl(fd, GYROIOCSSCALE, (long unsigned int)&gscale))
+				warn("WARNING: failed to set scale / offsets for gyro");
+
+			close(fd);
+		}
 
 		/* auto-save to EEPROM */
 		int save_ret = param_save_default();
@@ -47,7 +47,8 @@ namespace control
 {
 
 BlockParamBase::BlockParamBase(Block *parent, const char *name, bool parent_prefix) :
-	_handle(PARAM_INVALID)
+	_handle(PARAM_INVALID),
+	_generation(0)
 {
 	char fullname[blockNameLengthMax];
 
@@ -76,4 +77,19 @@ BlockParamBase::BlockParamBase(Block *parent, const char *name, bool parent_pref
 		printf("error finding param: %s\n", fullname);
 };
 
+void BlockParamBase::update()
+{
+	if ((_handle != PARAM_INVALID) && param_changed_since(_handle, _generation))
+		refresh();
+}
+
+void BlockParamBase::refresh()
+{
+	/* take the generation first, so that a change made while reading is seen next time */
+	_generation = param_get_generation();
+
+	if (_handle != PARAM_INVALID)
+		fetch();
+}
+
 } // namespace control
@@ -60,10 +60,19 @@ public:
 	 */
 	BlockParamBase(Block *parent, const char *name, bool parent_prefix=true);
 	virtual ~BlockParamBase() {};
-	virtual void update() = 0;
+	/**
+	 * Read the value again if the parameter has changed since it was last read.
+	 */
+	void update();
+	/**
+	 * Read the value unconditionally.
+	 */
+	void refresh();
 	const char *getName() { return param_name(_handle); }
 protected:
+	virtual void fetch() = 0;
 	param_t _handle;
+	uint32_t _generation; /**< parameter generation when the value was last read */
 };
 
 /**
@@ -76,14 +85,14 @@ public:
 	BlockParam(Block *block, const char *name, bool parent_prefix=true) :
 		BlockParamBase(block, name, parent_prefix),
 		_val() {
-		update();
+		refresh();
 	}
 	T get() { return _val; }
 	void set(T val) { _val = val; }
-	void update() {
-		if (_handle != PARAM_INVALID) param_get(_handle, &_val);
-	}
 protected:
+	void fetch() {
+		param_get(_handle, &_val);
+	}
 	T _val;
 };
 
@@ -276,6 +276,7 @@ int fixedwing_att_control_thread_main(int argc, char *argv[])
 		    isfinite(actuators.control[1]) &&
 		    isfinite(actuators.control[2]) &&
 		    isfinite(actuators.control[3])) {
+			actuators.sensor_timestamp = att.sensor_timestamp;
 			orb_publish(ORB_ID_VEHICLE_ATTITUDE_CONTROLS, actuator_pub, &actuators);
 		}
 	}
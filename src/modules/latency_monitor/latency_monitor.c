@@ -0,0 +1,212 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file latency_monitor.c
+ *
+ * Histograms of the age of the gyro sample behind each stage of the
+ * control path: sensor_combined, vehicle_attitude, the attitude
+ * actuator controls and the actuator outputs.
+ *
+ * Each stage carries the time of the gyro sample it is based on in
+ * sensor_timestamp.  The age is taken at the time uORB saw the stage
+ * publish, so it does not depend on how promptly the monitor runs.  The
+ * histograms are ordinary performance counters, so they are shown by
+ * 'perf' and logged with it.
+ */
+
+#include <nuttx/config.h>
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <poll.h>
+
+#include <drivers/drv_hrt.h>
+#include <uORB/uORB.h>
+#include <uORB/topics/sensor_combined.h>
+#include <uORB/topics/vehicle_attitude.h>
+#include <uORB/topics/actuator_controls.h>
+#include <uORB/topics/actuator_outputs.h>
+#include <systemlib/perf_counter.h>
+#include <systemlib/systemlib.h>
+
+__EXPORT int latency_monitor_main(int argc, char *argv[]);
+
+static int latency_monitor_thread_main(int argc, char *argv[]);
+
+struct latency_stage {
+	const char			*name;		/**< counter name */
+	const struct orb_metadata	*meta;
+	size_t				offset;		/**< of sensor_timestamp in the topic */
+	int				sub;
+	perf_counter_t			perf;
+};
+
+/* in the order the sample passes through them */
+static struct latency_stage stages[] = {
+	{"latency sensor_combined",	ORB_ID(sensor_combined),	offsetof(struct sensor_combined_s, sensor_timestamp)},
+	{"latency vehicle_attitude",	ORB_ID(vehicle_attitude),	offsetof(struct vehicle_attitude_s, sensor_timestamp)},
+	{"latency actuator_controls",	ORB_ID_VEHICLE_ATTITUDE_CONTROLS, offsetof(struct actuator_controls_s, sensor_timestamp)},
+	{"latency actuator_outputs",	ORB_ID_VEHICLE_CONTROLS,	offsetof(struct actuator_outputs_s, sensor_timestamp)},
+};
+
+#define LATENCY_STAGES	(sizeof(stages) / sizeof(stages[0]))
+
+static bool thread_should_exit = false;		/**< Deamon exit flag */
+static bool thread_running = false;		/**< Deamon status flag */
+static int deamon_task;				/**< Handle of deamon task / thread */
+
+/**
+ * Record the age of the sample behind a stage's latest publication.
+ */
+static void
+latency_stage_update(struct latency_stage *stage)
+{
+	union {
+		struct sensor_combined_s	sensor;
+		struct vehicle_attitude_s	att;
+		struct actuator_controls_s	controls;
+		struct actuator_outputs_s	outputs;
+	} buf;
+	uint64_t published, republished, sampled;
+
+	orb_stat(stage->sub, &published);
+	orb_copy(stage->meta, stage->sub, &buf);
+	orb_stat(stage->sub, &republished);
+
+	/* a publication in between would pair one sample with another's time */
+	if (published != republished)
+		return;
+
+	memcpy(&sampled, (uint8_t *)&buf + stage->offset, sizeof(sampled));
+
+	/* publishers that don't know the sample time leave it zero */
+	if ((sampled == 0) || (sampled > published))
+		return;
+
+	perf_set_elapsed(stage->perf, published - sampled);
+}
+
+static int
+latency_monitor_thread_main(int argc, char *argv[])
+{
+	struct pollfd fds[LATENCY_STAGES];
+
+	for (unsigned i = 0; i < LATENCY_STAGES; i++) {
+		stages[i].sub = orb_subscribe(stages[i].meta);
+		fds[i].fd = stages[i].sub;
+		fds[i].events = POLLIN;
+	}
+
+	while (!thread_should_exit) {
+		int ret = poll(fds, LATENCY_STAGES, 500);
+
+		if (ret <= 0)
+			continue;
+
+		for (unsigned i = 0; i < LATENCY_STAGES; i++)
+			if (fds[i].revents & POLLIN)
+				latency_stage_update(&stages[i]);
+	}
+
+	for (unsigned i = 0; i < LATENCY_STAGES; i++)
+		close(stages[i].sub);
+
+	thread_running = false;
+	return 0;
+}
+
+static void
+usage(const char *reason)
+{
+	if (reason)
+		fprintf(stderr, "%s\n", reason);
+
+	fprintf(stderr, "usage: latency_monitor {start|stop|status}\n\n");
+	exit(1);
+}
+
+int
+latency_monitor_main(int argc, char *argv[])
+{
+	if (argc < 2)
+		usage("missing command");
+
+	if (!strcmp(argv[1], "start")) {
+
+		if (thread_running) {
+			printf("latency_monitor already running\n");
+			/* this is not an error */
+			exit(0);
+		}
+
+		/* the counters outlive the task, so that they can be shown after a stop */
+		for (unsigned i = 0; i < LATENCY_STAGES; i++) {
+			if (stages[i].perf == NULL)
+				stages[i].perf = perf_alloc(PC_HISTOGRAM, stages[i].name);
+		}
+
+		thread_should_exit = false;
+		deamon_task = task_spawn_cmd("latency_monitor",
+					 SCHED_DEFAULT,
+					 SCHED_PRIORITY_DEFAULT,
+					 2048,
+					 latency_monitor_thread_main,
+					 NULL);
+		thread_running = true;
+		exit(0);
+	}
+
+	if (!strcmp(argv[1], "stop")) {
+		thread_should_exit = true;
+		exit(0);
+	}
+
+	if (!strcmp(argv[1], "status")) {
+		printf("\tlatency_monitor %s\n", thread_running ? "is running" : "not started");
+
+		for (unsigned i = 0; i < LATENCY_STAGES; i++)
+			if (stages[i].perf != NULL)
+				perf_print_counter(stages[i].perf);
+
+		exit(0);
+	}
+
+	usage("unrecognized command");
+	exit(1);
+}
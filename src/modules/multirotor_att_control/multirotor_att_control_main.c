@@ -140,7 +140,7 @@ mc_thread_main(int argc, char *argv[])
 	int rates_sp_sub = orb_subscribe(ORB_ID(vehicle_rates_setpoint));
 
 	/* register the perf counter */
-	perf_counter_t mc_loop_perf = perf_alloc(PC_ELAPSED, "multirotor_att_control_runtime");
+	perf_counter_t mc_loop_perf = perf_alloc(PC_HISTOGRAM, "multirotor_att_control_runtime");
 	perf_counter_t mc_interval_perf = perf_alloc(PC_INTERVAL, "multirotor_att_control_interval");
 	perf_counter_t mc_err_perf = perf_alloc(PC_COUNT, "multirotor_att_control_err");
 
@@ -388,6 +388,7 @@ mc_thread_main(int argc, char *argv[])
 				gyro[2] = att.yawspeed;
 
 				multirotor_control_rates(&rates_sp, gyro, &actuators);
+				actuators.sensor_timestamp = att.sensor_timestamp;
 				orb_publish(ORB_ID_VEHICLE_ATTITUDE_CONTROLS, actuator_pub, &actuators);
 
 				/* update state */
@@ -35,23 +35,53 @@
 /**
  * @file logbuffer.c
  *
- * Ring FIFO buffer for binary log data.
+ * Lock-free ring FIFO buffer for binary log data.
  *
  * @author Anton Babushkin <anton.babushkin@me.com>
  */
 
+#include <nuttx/config.h>
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
 
 #include "logbuffer.h"
 
-int logbuffer_init(struct logbuffer_s *lb, int size)
+/* orders the ring data against the pointer that publishes it */
+#define logbuffer_barrier()	__sync_synchronize()
+
+int logbuffer_init(struct logbuffer_s *lb, int size, int watermark)
 {
 	lb->size  = size;
+	lb->watermark = watermark;
+	lb->reserve = 0;
 	lb->write_ptr = 0;
 	lb->read_ptr = 0;
+	lb->waiting = false;
 	lb->data = malloc(lb->size);
-	return (lb->data == 0) ? ERROR : OK;
+
+	if (lb->data == 0)
+		return ERROR;
+
+	if (sem_init(&lb->wakeup, 0, 0) != 0) {
+		free(lb->data);
+		lb->data = 0;
+		return ERROR;
+	}
+
+	return OK;
+}
+
+void logbuffer_free(struct logbuffer_s *lb)
+{
+	sem_destroy(&lb->wakeup);
+	free(lb->data);
+	lb->data = 0;
+}
+
+void logbuffer_set_reserve(struct logbuffer_s *lb, int reserve)
+{
+	lb->reserve = reserve;
 }
 
 int logbuffer_count(struct logbuffer_s *lb)
@@ -70,26 +100,31 @@ int logbuffer_is_empty(struct logbuffer_s *lb)
 	return lb->read_ptr == lb->write_ptr;
 }
 
-bool logbuffer_write(struct logbuffer_s *lb, void *ptr, int size)
+static bool logbuffer_put(struct logbuffer_s *lb, void *ptr, int size, int headroom)
 {
+	int write_ptr = lb->write_ptr;
+
 	// bytes available to write
-	int available = lb->read_ptr - lb->write_ptr - 1;
+	int available = lb->read_ptr - write_ptr - 1;
 
 	if (available < 0)
 		available += lb->size;
 
-	if (size > available) {
+	if (size + headroom > available) {
 		// buffer overflow
 		return false;
 	}
 
+	// don't overwrite bytes before the consumer is done with them
+	logbuffer_barrier();
+
 	char *c = (char *) ptr;
-	int n = lb->size - lb->write_ptr;	// bytes to end of the buffer
+	int n = lb->size - write_ptr;	// bytes to end of the buffer
 
 	if (n < size) {
 		// message goes over end of the buffer
-		memcpy(&(lb->data[lb->write_ptr]), c, n);
-		lb->write_ptr = 0;
+		memcpy(&(lb->data[write_ptr]), c, n);
+		write_ptr = 0;
 
 	} else {
 		n = 0;
@@ -97,20 +132,52 @@ bool logbuffer_write(struct logbuffer_s *lb, void *ptr, int size)
 
 	// now: n = bytes already written
 	int p = size - n;	// number of bytes to write
-	memcpy(&(lb->data[lb->write_ptr]), &(c[n]), p);
-	lb->write_ptr = (lb->write_ptr + p) % lb->size;
+	memcpy(&(lb->data[write_ptr]), &(c[n]), p);
+
+	// publish the data, then look for a sleeping consumer
+	logbuffer_barrier();
+	lb->write_ptr = (write_ptr + p) % lb->size;
+	logbuffer_barrier();
+
+	if (lb->waiting && (logbuffer_count(lb) > lb->watermark)) {
+		lb->waiting = false;
+		sem_post(&lb->wakeup);
+	}
+
 	return true;
 }
 
+bool logbuffer_write(struct logbuffer_s *lb, void *ptr, int size)
+{
+	return logbuffer_put(lb, ptr, size, lb->reserve);
+}
+
+bool logbuffer_write_critical(struct logbuffer_s *lb, void *ptr, int size)
+{
+	return logbuffer_put(lb, ptr, size, 0);
+}
+
+void logbuffer_wakeup(struct logbuffer_s *lb)
+{
+	lb->waiting = false;
+	sem_post(&lb->wakeup);
+}
+
 int logbuffer_get_ptr(struct logbuffer_s *lb, void **ptr, bool *is_part)
 {
+	int read_ptr = lb->read_ptr;
+	int write_ptr = lb->write_ptr;
+
 	// bytes available to read
-	int available = lb->write_ptr - lb->read_ptr;
+	int available = write_ptr - read_ptr;
 
 	if (available == 0) {
 		return 0;	// buffer is empty
 	}
 
+	// data is only read after the pointer that published it
+	logbuffer_barrier();
+
 	int n = 0;
 
 	if (available > 0) {
@@ -120,15 +187,32 @@ int logbuffer_get_ptr(struct logbuffer_s *lb, void **ptr, bool *is_part)
 
 	} else {
 		// read pointer is after write pointer, read bytes from read_ptr to end of the buffer
-		n = lb->size - lb->read_ptr;
-		*is_part = lb->write_ptr > 0;
+		n = lb->size - read_ptr;
+		*is_part = write_ptr > 0;
 	}
 
-	*ptr = &(lb->data[lb->read_ptr]);
+	*ptr = &(lb->data[read_ptr]);
 	return n;
 }
 
 void logbuffer_mark_read(struct logbuffer_s *lb, int n)
 {
+	// finish with the data before handing the space back
+	logbuffer_barrier();
 	lb->read_ptr = (lb->read_ptr + n) % lb->size;
 }
+
+void logbuffer_wait(struct logbuffer_s *lb)
+{
+	lb->waiting = true;
+
+	// the producer either sees the flag or we see its data
+	logbuffer_barrier();
+
+	if (logbuffer_count(lb) <= lb->watermark) {
+		while ((sem_wait(&lb->wakeup) != 0) && (errno == EINTR)) {
+		}
+	}
+
+	lb->waiting = false;
+}
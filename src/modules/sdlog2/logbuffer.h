@@ -44,25 +44,54 @@
 #define SDLOG2_RINGBUFFER_H_
 
 #include <stdbool.h>
+#include <semaphore.h>
 
+/**
+ * Single-producer, single-consumer ring.
+ *
+ * The producer only moves write_ptr and the consumer only moves read_ptr,
+ * so neither side takes a lock.  A consumer with nothing to do sleeps in
+ * logbuffer_wait and is woken by the producer once more than watermark
+ * bytes are queued, or by logbuffer_wakeup.
+ *
+ * The last reserve bytes of free space are kept for logbuffer_write_critical,
+ * so that important messages still fit when ordinary ones are dropped.
+ */
 struct logbuffer_s {
 	// pointers and size are in bytes
-	int write_ptr;
-	int read_ptr;
+	volatile int write_ptr;
+	volatile int read_ptr;
 	int size;
+	int watermark;
+	int reserve;		// free bytes only critical writes may use
 	char *data;
+
+	volatile bool waiting;	// consumer is asleep or about to be
+	sem_t wakeup;
 };
 
-int logbuffer_init(struct logbuffer_s *lb, int size);
+int logbuffer_init(struct logbuffer_s *lb, int size, int watermark);
+
+void logbuffer_free(struct logbuffer_s *lb);
+
+void logbuffer_set_reserve(struct logbuffer_s *lb, int reserve);
 
 int logbuffer_count(struct logbuffer_s *lb);
 
 int logbuffer_is_empty(struct logbuffer_s *lb);
 
+/* producer side */
 bool logbuffer_write(struct logbuffer_s *lb, void *ptr, int size);
 
+bool logbuffer_write_critical(struct logbuffer_s *lb, void *ptr, int size);
+
+void logbuffer_wakeup(struct logbuffer_s *lb);
+
+/* consumer side */
 int logbuffer_get_ptr(struct logbuffer_s *lb, void **ptr, bool *is_part);
 
 void logbuffer_mark_read(struct logbuffer_s *lb, int n);
 
+void logbuffer_wait(struct logbuffer_s *lb);
+
 #endif
@@ -0,0 +1,200 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file logwriter.c
+ *
+ * Block-aligned writing of binary log data to a file.
+ */
+
+#include <nuttx/config.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <drivers/drv_hrt.h>
+
+#include "logwriter.h"
+
+void logwriter_init(struct logwriter_s *w, int fd)
+{
+	w->fd = fd;
+	w->staged = 0;
+	w->written = 0;
+	w->unsynced = 0;
+	w->last_sync = hrt_absolute_time();
+	w->syncs = 0;
+	w->write = write;
+	w->sync = fsync;
+}
+
+static int logwriter_out(struct logwriter_s *w, const void *data, int size)
+{
+	if (w->write(w->fd, data, size) != size)
+		return ERROR;
+
+	w->written += size;
+	w->unsynced += size;
+	return OK;
+}
+
+static void logwriter_check_sync(struct logwriter_s *w)
+{
+	if (w->unsynced == 0)
+		return;
+
+	hrt_abstime now = hrt_absolute_time();
+
+	if ((w->unsynced >= LOGWRITER_SYNC_BYTES) || ((now - w->last_sync) >= LOGWRITER_SYNC_INTERVAL)) {
+		w->sync(w->fd);
+		w->unsynced = 0;
+		w->last_sync = now;
+		w->syncs++;
+	}
+}
+
+/**
+ * Copy into the staging block, writing it once it is full.
+ *
+ * @return bytes taken, or ERROR
+ */
+static int logwriter_stage(struct logwriter_s *w, const void *data, int size)
+{
+	int n = LOGWRITER_BLOCK_SIZE - w->staged;
+
+	if (n > size)
+		n = size;
+
+	memcpy(&w->block[w->staged], data, n);
+	w->staged += n;
+
+	if (w->staged == LOGWRITER_BLOCK_SIZE) {
+		if (logwriter_out(w, w->block, LOGWRITER_BLOCK_SIZE) != OK)
+			return ERROR;
+
+		w->staged = 0;
+	}
+
+	return n;
+}
+
+int logwriter_write(struct logwriter_s *w, const void *data, int size)
+{
+	const char *c = (const char *)data;
+
+	while (size > 0) {
+		int n = logwriter_stage(w, c, size);
+
+		if (n < 0)
+			return ERROR;
+
+		c += n;
+		size -= n;
+	}
+
+	logwriter_check_sync(w);
+	return OK;
+}
+
+int logwriter_drain(struct logwriter_s *w, struct logbuffer_s *lb)
+{
+	void *ptr;
+	bool is_part = false;
+	int available = logbuffer_get_ptr(lb, &ptr, &is_part);
+	int n;
+
+	if (available <= 0)
+		return 0;
+
+	if ((w->staged == 0) && (available >= LOGWRITER_BLOCK_SIZE)) {
+		// whole blocks straight from the ring, up to the next LOGWRITER_MAX_WRITE boundary
+		n = LOGWRITER_MAX_WRITE - (w->written % LOGWRITER_MAX_WRITE);
+
+		if (n > available)
+			n = available - (available % LOGWRITER_BLOCK_SIZE);
+
+		if (logwriter_out(w, ptr, n) != OK)
+			return ERROR;
+
+	} else if ((w->staged > 0) || is_part) {
+		// a block split by the end of the ring is put together in the staging block
+		n = logwriter_stage(w, ptr, available);
+
+		if (n < 0)
+			return ERROR;
+
+	} else {
+		// less than a block, wait for more
+		return 0;
+	}
+
+	logbuffer_mark_read(lb, n);
+	logwriter_check_sync(w);
+	return n;
+}
+
+int logwriter_flush(struct logwriter_s *w, struct logbuffer_s *lb)
+{
+	void *ptr;
+	bool is_part;
+	int n;
+
+	while ((n = logwriter_drain(w, lb)) > 0) {
+	}
+
+	if (n < 0)
+		return ERROR;
+
+	// what is left is less than a block and does not wrap
+	n = logbuffer_get_ptr(lb, &ptr, &is_part);
+
+	if (n > 0) {
+		if (logwriter_stage(w, ptr, n) != n)
+			return ERROR;
+
+		logbuffer_mark_read(lb, n);
+	}
+
+	if (w->staged > 0) {
+		if (logwriter_out(w, w->block, w->staged) != OK)
+			return ERROR;
+
+		w->staged = 0;
+	}
+
+	w->sync(w->fd);
+	w->unsynced = 0;
+	w->last_sync = hrt_absolute_time();
+	w->syncs++;
+	return OK;
+}
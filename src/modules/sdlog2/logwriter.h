@@ -0,0 +1,90 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file logwriter.h
+ *
+ * Block-aligned writing of binary log data to a file.
+ *
+ * SD cards and FAT work in 512 byte sectors and larger clusters; a write
+ * that starts or ends inside a sector costs a read-modify-write.  The
+ * writer only issues whole, aligned blocks, taking them straight from the
+ * log buffer where it can and assembling them in a staging block where
+ * the data is split by the end of the ring.  The file is synced on a
+ * byte and time budget rather than on every few writes.
+ */
+
+#ifndef SDLOG2_LOGWRITER_H_
+#define SDLOG2_LOGWRITER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "logbuffer.h"
+
+#define LOGWRITER_BLOCK_SIZE	512		/**< write granularity, one sector */
+#define LOGWRITER_MAX_WRITE	4096		/**< writes don't cross this alignment */
+#define LOGWRITER_SYNC_BYTES	(32 * 1024)	/**< sync after this much data ... */
+#define LOGWRITER_SYNC_INTERVAL	1000000		/**< ... or this long in us, whichever is first */
+
+struct logwriter_s {
+	int fd;
+
+	// staging block, always the next block of the file
+	char block[LOGWRITER_BLOCK_SIZE];
+	int staged;
+
+	unsigned long written;	// bytes written to the file
+	unsigned long unsynced;	// bytes written since the last sync
+	uint64_t last_sync;
+	unsigned syncs;
+
+	// file operations, replaceable to simulate a slow card
+	ssize_t (*write)(int fd, const void *buf, size_t count);
+	int (*sync)(int fd);
+};
+
+void logwriter_init(struct logwriter_s *w, int fd);
+
+/* write data through the staging block, e.g. a log header */
+int logwriter_write(struct logwriter_s *w, const void *data, int size);
+
+/* move data from the log buffer to the file, returns bytes taken, 0 if a block is not ready, <0 on error */
+int logwriter_drain(struct logwriter_s *w, struct logbuffer_s *lb);
+
+/* write out everything, including a final partial block, and sync */
+int logwriter_flush(struct logwriter_s *w, struct logbuffer_s *lb);
+
+#endif
@@ -40,4 +40,5 @@ MODULE_COMMAND  = sdlog2
 MODULE_PRIORITY = "SCHED_PRIORITY_MAX-30"
 
 SRCS = sdlog2.c \
-       logbuffer.c
+       logbuffer.c \
+       logwriter.c
@@ -81,21 +81,24 @@
 #include <uORB/topics/airspeed.h>
 #include <uORB/topics/rc_channels.h>
 #include <uORB/topics/esc_status.h>
+#include <uORB/topics/perf_counter.h>
+#include <uORB/topics/manual_control_setpoint.h>
+#include <uORB/topics/home_position.h>
+#include <uORB/topics/telemetry_status.h>
+#include <uORB/topics/vehicle_bodyframe_speed_setpoint.h>
+#include <uORB/topics/debug_key_value.h>
+#include <uORB/topics/navigation_capabilities.h>
 
 #include <systemlib/systemlib.h>
 
 #include <mavlink/mavlink_log.h>
 
 #include "logbuffer.h"
+#include "logwriter.h"
 #include "sdlog2_format.h"
 #include "sdlog2_messages.h"
 
-#define LOGBUFFER_WRITE_AND_COUNT(_msg) if (logbuffer_write(&lb, &log_msg, LOG_PACKET_SIZE(_msg))) { \
-		log_msgs_written++; \
-	} else { \
-		log_msgs_skipped++; \
-		/*printf("skip\n");*/ \
-	}
+#define LOGBUFFER_WRITE_AND_COUNT(_msg) log_write_and_count(&log_msg, LOG_PACKET_SIZE(_msg))
 
 #define LOG_ORB_SUBSCRIBE(_var, _topic) subs.##_var##_sub = orb_subscribe(ORB_ID(##_topic##)); \
 	fds[fdsc_count].fd = subs.##_var##_sub; \
@@ -112,16 +115,16 @@ static bool logwriter_should_exit = false;	/**< Logwriter thread exit flag */
 static const int MAX_NO_LOGFOLDER = 999;	/**< Maximum number of log folders */
 static const int MAX_NO_LOGFILE = 999;		/**< Maximum number of log files */
 static const int LOG_BUFFER_SIZE_DEFAULT = 8192;
-static const int MAX_WRITE_CHUNK = 512;
-static const int MIN_BYTES_TO_WRITE = 512;
+static const int MIN_BYTES_TO_WRITE = LOGWRITER_BLOCK_SIZE;
+static const int LOG_BUFFER_RESERVE_DIV = 8;	/**< 1/8 of the buffer is kept for critical messages */
+static const hrt_abstime LOG_DROPS_REPORT_INTERVAL = 1000000;
 
 static const char *mountpoint = "/fs/microsd";
 static int mavlink_fd = -1;
 struct logbuffer_s lb;
 
-/* mutex / condition to synchronize threads */
-static pthread_mutex_t logbuffer_mutex;
-static pthread_cond_t logbuffer_cond;
+/* block writer state of the writer thread, too big for its stack */
+static struct logwriter_s logwriter;
 
 static char folder_path[64];
 
@@ -131,6 +134,13 @@ static uint64_t start_time = 0;
 static unsigned long log_msgs_written = 0;
 static unsigned long log_msgs_skipped = 0;
 
+/* dropped messages by type: not yet reported in a DROP message, and in total */
+static uint16_t log_drops_pending[LOG_FORMAT_MSG];
+static uint32_t log_drops_total[LOG_FORMAT_MSG];
+static hrt_abstime log_drops_first = 0;		/**< first unreported drop, 0 if none */
+static hrt_abstime log_drops_last = 0;
+static hrt_abstime log_drops_reported = 0;
+
 /* current state of logging */
 static bool logging_enabled = false;
 /* enable logging on start (-e option) */
@@ -145,6 +155,102 @@ static bool flag_system_armed = false;
 
 static pthread_t logwriter_pthread = 0;
 
+/* performance counters whose names have been written to the current log */
+#define PERF_NAMES_MAX 512
+static uint8_t perf_names_logged[PERF_NAMES_MAX / 8];
+
+/*
+ * Topics logged from their uORB field metadata.  Any topic defined with
+ * ORB_DEFINE_FIELDS can be logged by adding it here.
+ */
+static const struct orb_metadata *const generic_topic_ids[] = {
+	ORB_ID(battery_status),
+	ORB_ID(manual_control_setpoint),
+	ORB_ID(home_position),
+	ORB_ID(actuator_armed),
+	ORB_ID(telemetry_status),
+	ORB_ID(vehicle_bodyframe_speed_setpoint),
+	ORB_ID(debug_key_value),
+	ORB_ID(navigation_capabilities),
+};
+
+#define GENERIC_TOPICS_MAX 16
+
+static struct {
+	const struct orb_metadata *meta;
+	int sub;
+	uint8_t msg_type;
+} generic_topics[GENERIC_TOPICS_MAX];
+static unsigned generic_topics_count = 0;
+
+/*
+ * Per-topic logging rates.  A rate caps how often a topic is logged and is
+ * applied with orb_set_interval on its subscription; a rate of 0 logs every
+ * update.  The entry "*" gives the rate of topics not listed otherwise.
+ */
+struct log_rate_s {
+	const char *topic;
+	unsigned rate;		/**< maximum logging rate in Hz, 0 = every update */
+};
+
+/* built-in profile: fast topics at 50 Hz, slow status topics below that */
+static const struct log_rate_s log_profile_standard[] = {
+	{ "*",				50 },
+	{ "perf_counter",		0 },
+	{ "battery_status",		5 },
+	{ "telemetry_status",		2 },
+	{ "home_position",		1 },
+	{ "navigation_capabilities",	1 },
+	{ NULL,				0 }
+};
+
+/* built-in profile: IMU, attitude and outputs at full rate for vibration analysis */
+static const struct log_rate_s log_profile_highrate[] = {
+	{ "*",				50 },
+	{ "perf_counter",		0 },
+	{ "sensor_combined",		0 },
+	{ "vehicle_attitude",		0 },
+	{ "vehicle_rates_setpoint",	0 },
+	{ "actuator_controls_0",	0 },
+	{ "actuator_controls_effective_0", 0 },
+	{ "actuator_outputs_0",		0 },
+	{ "battery_status",		5 },
+	{ "telemetry_status",		2 },
+	{ "home_position",		1 },
+	{ "navigation_capabilities",	1 },
+	{ NULL,				0 }
+};
+
+static const struct {
+	const char *name;
+	const struct log_rate_s *rates;
+} log_profiles[] = {
+	{ "standard",	log_profile_standard },
+	{ "highrate",	log_profile_highrate },
+};
+
+/* rate file on the SD card, applied on top of the selected profile */
+static const char *log_rates_file = "/fs/microsd/etc/logging/topics.txt";
+
+#define LOG_RATES_MAX		32
+#define LOG_RATE_TOPIC_LEN	40
+
+/* active rate table, empty when no profile or rate file is in use */
+static struct {
+	char topic[LOG_RATE_TOPIC_LEN];
+	unsigned rate;
+} log_rates[LOG_RATES_MAX];
+static unsigned log_rates_count = 0;
+static const char *log_profile_name = NULL;
+
+/* a generically logged sample: header and raw topic structure */
+static struct {
+	LOG_PACKET_HEADER;
+	uint8_t body[LOG_GENERIC_SIZE_MAX];
+} generic_msg = {
+	LOG_PACKET_HEADER_INIT(0)
+};
+
 /**
  * Log buffer writing thread. Open and close file here.
  */
@@ -183,7 +289,49 @@ static void sdlog2_stop_log(void);
 /**
  * Write a header to log file: list of message formats.
  */
-static void write_formats(int fd);
+static void write_formats(struct logwriter_s *w);
+
+/**
+ * Subscribe to a topic to be logged from its metadata.
+ */
+static int generic_topic_add(const struct orb_metadata *meta);
+
+/**
+ * Write a message to the log buffer, counting it as written or dropped.
+ *
+ * @return true if the message was queued.
+ */
+static bool log_write_and_count(void *msg, int size);
+
+/**
+ * Write a DROP message for each type dropped since the last report.
+ */
+static void log_drops_report(void);
+
+/**
+ * Set the logging rate of a topic, replacing an earlier entry.
+ */
+static int log_rate_set(const char *topic, unsigned rate);
+
+/**
+ * Load a built-in rate profile by name.
+ */
+static int log_rates_load_profile(const char *name);
+
+/**
+ * Load per-topic rates from a text file.
+ *
+ * Each line holds a topic name and a rate in Hz; "profile <name>" selects a
+ * built-in profile first and '#' starts a comment.
+ *
+ * @return the number of rates read, or ERROR if the file can't be opened.
+ */
+static int log_rates_load_file(const char *path);
+
+/**
+ * Look up the orb_set_interval period for a topic in ms, 0 = every update.
+ */
+static unsigned log_rate_interval(const char *topic);
 
 
 static bool file_exist(const char *filename);
@@ -210,11 +358,14 @@ sdlog2_usage(const char *reason)
 	if (reason)
 		fprintf(stderr, "%s\n", reason);
 
-	errx(1, "usage: sdlog2 {start|stop|status} [-r <log rate>] [-b <buffer size>] -e -a\n"
+	errx(1, "usage: sdlog2 {start|stop|status} [-r <log rate>] [-p <profile>] [-b <buffer size>] -e -a\n"
 	     "\t-r\tLog rate in Hz, 0 means unlimited rate\n"
+	     "\t-p\tPer-topic rate profile: standard or highrate, replaces -r\n"
+	     "\t\t%s is applied on top if present\n"
 	     "\t-b\tLog buffer size in KiB, default is 8\n"
 	     "\t-e\tEnable logging by default (if not, can be started by command)\n"
-	     "\t-a\tLog only when armed (can be still overriden by command)\n");
+	     "\t-a\tLog only when armed (can be still overriden by command)\n",
+	     log_rates_file);
 }
 
 /**
@@ -242,7 +393,7 @@ int sdlog2_main(int argc, char *argv[])
 		deamon_task = task_spawn_cmd("sdlog2",
 					 SCHED_DEFAULT,
 					 SCHED_PRIORITY_DEFAULT - 30,
-					 3000,
+					 3400,
 					 sdlog2_thread_main,
 					 (const char **)argv);
 		exit(0);
@@ -359,89 +510,51 @@ static void *logwriter_thread(void *arg)
 
 	int log_file = open_logfile();
 
-	/* write log messages formats */
-	write_formats(log_file);
-
-	int poll_count = 0;
+	logwriter_init(&logwriter, log_file);
 
-	void *read_ptr;
-	int n = 0;
-	bool should_wait = false;
-	bool is_part = false;
+	/* write log messages formats */
+	write_formats(&logwriter);
 
 	while (true) {
-		/* make sure threads are synchronized */
-		pthread_mutex_lock(&logbuffer_mutex);
-
-		/* update read pointer if needed */
-		if (n > 0) {
-			logbuffer_mark_read(&lb, n);
-		}
-
-		/* only wait if no data is available to process */
-		if (should_wait && !logwriter_should_exit) {
-			/* blocking wait for new data at this line */
-			pthread_cond_wait(&logbuffer_cond, &logbuffer_mutex);
-		}
-
-		/* only get pointer to thread-safe data, do heavy I/O a few lines down */
-		int available = logbuffer_get_ptr(logbuf, &read_ptr, &is_part);
+		/* write out whole blocks while there are any */
+		int n = logwriter_drain(&logwriter, logbuf);
 
 #ifdef SDLOG2_DEBUG
-		int rp = logbuf->read_ptr;
-		int wp = logbuf->write_ptr;
+		printf("write %i %i rp=%i wp=%i staged=%i\n", logwriter.written, n, logbuf->read_ptr, logbuf->write_ptr, logwriter.staged);
 #endif
 
-		/* continue */
-		pthread_mutex_unlock(&logbuffer_mutex);
-
-		if (available > 0) {
-			/* do heavy IO here */
-			if (available > MAX_WRITE_CHUNK) {
-				n = MAX_WRITE_CHUNK;
+		if (n < 0) {
+			main_thread_should_exit = true;
+			err(1, "error writing log file");
+		}
 
-			} else {
-				n = available;
-			}
+		log_bytes_written = logwriter.written;
 
-			n = write(log_file, read_ptr, n);
+		if (n > 0) {
+			continue;
+		}
 
-			should_wait = (n == available) && !is_part;
 #ifdef SDLOG2_DEBUG
-			printf("write %i %i of %i rp=%i wp=%i, is_part=%i, should_wait=%i\n", log_bytes_written, n, available, rp, wp, (int)is_part, (int)should_wait);
+		printf("no block available, main_thread_should_exit=%i, logwriter_should_exit=%i\n", (int)main_thread_should_exit, (int)logwriter_should_exit);
 #endif
 
-			if (n < 0) {
-				main_thread_should_exit = true;
-				err(1, "error writing log file");
-			}
-
-			if (n > 0) {
-				log_bytes_written += n;
-			}
-
-		} else {
-			n = 0;
-#ifdef SDLOG2_DEBUG
-			printf("no data available, main_thread_should_exit=%i, logwriter_should_exit=%i\n", (int)main_thread_should_exit, (int)logwriter_should_exit);
-#endif
-			/* exit only with empty buffer */
-			if (main_thread_should_exit || logwriter_should_exit) {
+		/* exit with the rest of the buffer written out */
+		if (main_thread_should_exit || logwriter_should_exit) {
 #ifdef SDLOG2_DEBUG
-				printf("break logwriter thread\n");
+			printf("break logwriter thread\n");
 #endif
-				break;
-			}
-			should_wait = true;
+			break;
 		}
 
-		if (++poll_count == 10) {
-			fsync(log_file);
-			poll_count = 0;
-		}
+		/* blocking wait until enough data is queued */
+		logbuffer_wait(logbuf);
 	}
 
-	fsync(log_file);
+	if (logwriter_flush(&logwriter, logbuf) != OK) {
+		warn("error writing log file");
+	}
+
+	log_bytes_written = logwriter.written;
 	close(log_file);
 
 #ifdef SDLOG2_DEBUG
@@ -461,6 +574,12 @@ void sdlog2_start_log()
 	start_time = hrt_absolute_time();
 	log_msgs_written = 0;
 	log_msgs_skipped = 0;
+	memset(log_drops_pending, 0, sizeof(log_drops_pending));
+	memset(log_drops_total, 0, sizeof(log_drops_total));
+	log_drops_first = 0;
+
+	/* performance counter names must be written again to the new log */
+	memset(perf_names_logged, 0, sizeof(perf_names_logged));
 
 	/* initialize log buffer emptying thread */
 	pthread_attr_t receiveloop_attr;
@@ -492,11 +611,8 @@ void sdlog2_stop_log()
 	logging_enabled = false;
 
 	/* wake up write thread one last time */
-	pthread_mutex_lock(&logbuffer_mutex);
 	logwriter_should_exit = true;
-	pthread_cond_signal(&logbuffer_cond);
-	/* unlock, now the writer thread may return */
-	pthread_mutex_unlock(&logbuffer_mutex);
+	logbuffer_wakeup(&lb);
 
 	/* wait for write thread to return */
 	int ret;
@@ -509,7 +625,7 @@ void sdlog2_stop_log()
 }
 
 
-void write_formats(int fd)
+void write_formats(struct logwriter_s *w)
 {
 	/* construct message format packet */
 	struct {
@@ -524,10 +640,281 @@ void write_formats(int fd)
 
 	for (i = 0; i < log_formats_num; i++) {
 		log_format_packet.body = log_formats[i];
-		log_bytes_written += write(fd, &log_format_packet, sizeof(log_format_packet));
+		logwriter_write(w, &log_format_packet, sizeof(log_format_packet));
+	}
+
+	/* describe the topics logged from their metadata */
+	for (unsigned i = 0; i < generic_topics_count; i++) {
+		const struct orb_metadata *meta = generic_topics[i].meta;
+		char name[5];
+
+		snprintf(name, sizeof(name), "T%u", generic_topics[i].msg_type);
+		memset(&log_format_packet.body, 0, sizeof(log_format_packet.body));
+		log_format_packet.body.type = generic_topics[i].msg_type;
+		log_format_packet.body.length = LOG_PACKET_HEADER_LEN + meta->o_size;
+		memcpy(log_format_packet.body.name, name, sizeof(log_format_packet.body.name));
+		logwriter_write(w, &log_format_packet, sizeof(log_format_packet));
+
+		struct {
+			LOG_PACKET_HEADER;
+			struct log_TOPC_s body;
+		} topc = {
+			LOG_PACKET_HEADER_INIT(LOG_TOPC_MSG),
+		};
+
+		topc.body.id = generic_topics[i].msg_type;
+		topc.body.size = meta->o_size;
+		strncpy(topc.body.name, meta->o_name, sizeof(topc.body.name) - 1);
+		logwriter_write(w, &topc, sizeof(topc));
+
+		for (unsigned f = 0; f < meta->o_nfields; f++) {
+			struct {
+				LOG_PACKET_HEADER;
+				struct log_FELD_s body;
+			} feld = {
+				LOG_PACKET_HEADER_INIT(LOG_FELD_MSG),
+			};
+
+			feld.body.id = generic_topics[i].msg_type;
+			feld.body.offset = meta->o_fields[f].offset;
+			feld.body.type = meta->o_fields[f].type;
+			feld.body.count = meta->o_fields[f].count;
+			strncpy(feld.body.name, meta->o_fields[f].name, sizeof(feld.body.name) - 1);
+			logwriter_write(w, &feld, sizeof(feld));
+		}
+	}
+
+	log_bytes_written = w->written;
+}
+
+int generic_topic_add(const struct orb_metadata *meta)
+{
+	if (generic_topics_count >= GENERIC_TOPICS_MAX || generic_topics_count >= LOG_GENERIC_MSG_MAX) {
+		warnx("too many topics, not logging %s", meta->o_name);
+		return ERROR;
+	}
+
+	if (meta->o_fields == NULL || meta->o_size > LOG_GENERIC_SIZE_MAX) {
+		warnx("%s has no field layout or is too big, not logging it", meta->o_name);
+		return ERROR;
+	}
+
+	int sub = orb_subscribe(meta);
+
+	if (sub < 0) {
+		warnx("can't subscribe to %s", meta->o_name);
+		return ERROR;
+	}
+
+	generic_topics[generic_topics_count].meta = meta;
+	generic_topics[generic_topics_count].sub = sub;
+	generic_topics[generic_topics_count].msg_type = LOG_GENERIC_MSG_BASE + generic_topics_count;
+	generic_topics_count++;
+
+	return OK;
+}
+
+/*
+ * Messages written with logbuffer_write_critical, which may use the reserved
+ * end of the buffer: vehicle state, GPS, control outputs, the names PERF
+ * messages refer to, and the drop reports themselves.
+ */
+static bool log_msg_critical(uint8_t msg_type)
+{
+	switch (msg_type) {
+	case LOG_STAT_MSG:
+	case LOG_GPS_MSG:
+	case LOG_GPSP_MSG:
+	case LOG_ATTC_MSG:
+	case LOG_PNAM_MSG:
+	case LOG_DROP_MSG:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+bool log_write_and_count(void *msg, int size)
+{
+	uint8_t msg_type = ((uint8_t *)msg)[LOG_PACKET_HEADER_LEN - 1];
+	bool written;
+
+	if (log_msg_critical(msg_type)) {
+		written = logbuffer_write_critical(&lb, msg, size);
+
+	} else {
+		written = logbuffer_write(&lb, msg, size);
+	}
+
+	if (written) {
+		log_msgs_written++;
+
+	} else {
+		log_msgs_skipped++;
+
+		if (msg_type < LOG_FORMAT_MSG) {
+			log_drops_last = hrt_absolute_time();
+
+			if (log_drops_first == 0)
+				log_drops_first = log_drops_last;
+
+			if (log_drops_pending[msg_type] < UINT16_MAX)
+				log_drops_pending[msg_type]++;
+
+			log_drops_total[msg_type]++;
+		}
+	}
+
+	return written;
+}
+
+void log_drops_report()
+{
+#pragma pack(push, 1)
+	struct {
+		LOG_PACKET_HEADER;
+		struct log_DROP_s body;
+	} drop = {
+		LOG_PACKET_HEADER_INIT(LOG_DROP_MSG)
+	};
+#pragma pack(pop)
+	bool pending = false;
+
+	drop.body.first = log_drops_first;
+	drop.body.last = log_drops_last;
+
+	for (unsigned t = 0; t < LOG_FORMAT_MSG; t++) {
+		if (log_drops_pending[t] == 0)
+			continue;
+
+		drop.body.type = t;
+		drop.body.count = log_drops_pending[t];
+
+		/* a report that doesn't fit is counted as a drop and retried next time */
+		if (logbuffer_write_critical(&lb, &drop, sizeof(drop))) {
+			log_msgs_written++;
+			log_drops_pending[t] = 0;
+
+		} else {
+			log_msgs_skipped++;
+			pending = true;
+		}
 	}
 
-	fsync(fd);
+	if (!pending)
+		log_drops_first = 0;
+}
+
+int log_rate_set(const char *topic, unsigned rate)
+{
+	unsigned i;
+
+	for (i = 0; i < log_rates_count; i++) {
+		if (!strcmp(log_rates[i].topic, topic)) {
+			break;
+		}
+	}
+
+	if (i == log_rates_count) {
+		if (log_rates_count >= LOG_RATES_MAX || strlen(topic) >= LOG_RATE_TOPIC_LEN) {
+			warnx("can't set rate for %s", topic);
+			return ERROR;
+		}
+
+		strcpy(log_rates[i].topic, topic);
+		log_rates_count++;
+	}
+
+	log_rates[i].rate = rate;
+	return OK;
+}
+
+int log_rates_load_profile(const char *name)
+{
+	for (unsigned p = 0; p < sizeof(log_profiles) / sizeof(log_profiles[0]); p++) {
+		if (!strcmp(log_profiles[p].name, name)) {
+			for (const struct log_rate_s *r = log_profiles[p].rates; r->topic != NULL; r++) {
+				log_rate_set(r->topic, r->rate);
+			}
+
+			log_profile_name = log_profiles[p].name;
+			return OK;
+		}
+	}
+
+	warnx("unknown rate profile %s", name);
+	return ERROR;
+}
+
+int log_rates_load_file(const char *path)
+{
+	FILE *f = fopen(path, "r");
+
+	if (f == NULL) {
+		return ERROR;
+	}
+
+	char line[80];
+	unsigned lineno = 0;
+	int count = 0;
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		char topic[LOG_RATE_TOPIC_LEN];
+		char arg[LOG_RATE_TOPIC_LEN];
+		lineno++;
+
+		char *comment = strchr(line, '#');
+
+		if (comment != NULL) {
+			*comment = '\0';
+		}
+
+		int n = sscanf(line, "%39s %39s", topic, arg);
+
+		if (n <= 0) {
+			continue;
+		}
+
+		if (n == 2 && !strcmp(topic, "profile")) {
+			log_rates_load_profile(arg);
+			continue;
+		}
+
+		char *end;
+		unsigned long rate = (n == 2) ? strtoul(arg, &end, 10) : 0;
+
+		if (n != 2 || *end != '\0') {
+			warnx("%s:%u: expected <topic> <rate>", path, lineno);
+			continue;
+		}
+
+		if (log_rate_set(topic, rate) == OK) {
+			count++;
+		}
+	}
+
+	fclose(f);
+	return count;
+}
+
+unsigned log_rate_interval(const char *topic)
+{
+	unsigned rate = 0;
+
+	for (unsigned i = 0; i < log_rates_count; i++) {
+		if (!strcmp(log_rates[i].topic, topic)) {
+			rate = log_rates[i].rate;
+			break;
+		}
+
+		if (!strcmp(log_rates[i].topic, "*")) {
+			rate = log_rates[i].rate;
+		}
+	}
+
+	/* rates above 1 kHz can't be expressed in ms and are not capped */
+	return (rate > 0 && rate <= 1000) ? 1000 / rate : 0;
 }
 
 int sdlog2_thread_main(int argc, char *argv[])
@@ -546,7 +933,7 @@ int sdlog2_thread_main(int argc, char *argv[])
 	argv += 2;
 	int ch;
 
-	while ((ch = getopt(argc, argv, "r:b:ea")) != EOF) {
+	while ((ch = getopt(argc, argv, "r:p:b:ea")) != EOF) {
 		switch (ch) {
 		case 'r': {
 				unsigned long r = strtoul(optarg, NULL, 10);
@@ -560,6 +947,13 @@ int sdlog2_thread_main(int argc, char *argv[])
 			}
 			break;
 
+		case 'p':
+			if (log_rates_load_profile(optarg) != OK) {
+				sdlog2_usage(NULL);
+			}
+
+			break;
+
 		case 'b': {
 				unsigned long s = strtoul(optarg, NULL, 10);
 
@@ -607,20 +1001,36 @@ int sdlog2_thread_main(int argc, char *argv[])
 	/* only print logging path, important to find log file later */
 	warnx("logging to directory: %s", folder_path);
 
+	/* per-topic rates from the SD card, on top of the -p profile */
+	int file_rates = log_rates_load_file(log_rates_file);
+
+	if (file_rates >= 0) {
+		warnx("%d topic rates from %s", file_rates, log_rates_file);
+	}
+
+	if (log_rates_count > 0 && sleep_delay > 0) {
+		warnx("per-topic rates in use, ignoring -r");
+		sleep_delay = 0;
+	}
+
 	/* initialize log buffer with specified size */
 	warnx("log buffer size: %i bytes.", log_buffer_size);
 
-	if (OK != logbuffer_init(&lb, log_buffer_size)) {
+	if (OK != logbuffer_init(&lb, log_buffer_size, MIN_BYTES_TO_WRITE)) {
 		errx(1, "can't allocate log buffer, exiting.");
 	}
 
+	logbuffer_set_reserve(&lb, log_buffer_size / LOG_BUFFER_RESERVE_DIV);
+
 	/* --- IMPORTANT: DEFINE NUMBER OF ORB STRUCTS TO WAIT FOR HERE --- */
 	/* number of messages */
-	const ssize_t fdsc = 19;
+	const ssize_t fdsc = 20 + GENERIC_TOPICS_MAX;
 	/* Sanity check variable and index */
 	ssize_t fdsc_count = 0;
 	/* file descriptors to wait for */
 	struct pollfd fds[fdsc];
+	/* topic of each poll fd, for the per-topic rates */
+	const struct orb_metadata *fds_meta[fdsc];
 
 	struct vehicle_status_s buf_status;
 	memset(&buf_status, 0, sizeof(buf_status));
@@ -646,6 +1056,7 @@ int sdlog2_thread_main(int argc, char *argv[])
 		struct differential_pressure_s diff_pres;
 		struct airspeed_s airspeed;
 		struct esc_status_s esc;
+		struct perf_counter_s perf;
 	} buf;
 	memset(&buf, 0, sizeof(buf));
 
@@ -669,6 +1080,7 @@ int sdlog2_thread_main(int argc, char *argv[])
 		int rc_sub;
 		int airspeed_sub;
 		int esc_sub;
+		int perf_sub;
 	} subs;
 
 	/* log message buffer: header + body */
@@ -694,6 +1106,8 @@ int sdlog2_thread_main(int argc, char *argv[])
 			struct log_GPOS_s log_GPOS;
 			struct log_GPSP_s log_GPSP;
 			struct log_ESC_s log_ESC;
+			struct log_PERF_s log_PERF;
+			struct log_PNAM_s log_PNAM;
 		} body;
 	} log_msg = {
 		LOG_PACKET_HEADER_INIT(0)
@@ -704,117 +1118,177 @@ int sdlog2_thread_main(int argc, char *argv[])
 	/* --- VEHICLE COMMAND --- */
 	subs.cmd_sub = orb_subscribe(ORB_ID(vehicle_command));
 	fds[fdsc_count].fd = subs.cmd_sub;
+	fds_meta[fdsc_count] = ORB_ID(vehicle_command);
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
 	/* --- VEHICLE STATUS --- */
 	subs.status_sub = orb_subscribe(ORB_ID(vehicle_status));
 	fds[fdsc_count].fd = subs.status_sub;
+	fds_meta[fdsc_count] = ORB_ID(vehicle_status);
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
 	/* --- GPS POSITION --- */
 	subs.gps_pos_sub = orb_subscribe(ORB_ID(vehicle_gps_position));
 	fds[fdsc_count].fd = subs.gps_pos_sub;
+	fds_meta[fdsc_count] = ORB_ID(vehicle_gps_position);
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
 	/* --- SENSORS COMBINED --- */
 	subs.sensor_sub = orb_subscribe(ORB_ID(sensor_combined));
 	fds[fdsc_count].fd = subs.sensor_sub;
+	fds_meta[fdsc_count] = ORB_ID(sensor_combined);
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
 	/* --- ATTITUDE --- */
 	subs.att_sub = orb_subscribe(ORB_ID(vehicle_attitude));
 	fds[fdsc_count].fd = subs.att_sub;
+	fds_meta[fdsc_count] = ORB_ID(vehicle_attitude);
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
 	/* --- ATTITUDE SETPOINT --- */
 	subs.att_sp_sub = orb_subscribe(ORB_ID(vehicle_attitude_setpoint));
 	fds[fdsc_count].fd = subs.att_sp_sub;
+	fds_meta[fdsc_count] = ORB_ID(vehicle_attitude_setpoint);
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
 	/* --- RATES SETPOINT --- */
 	subs.rates_sp_sub = orb_subscribe(ORB_ID(vehicle_rates_setpoint));
 	fds[fdsc_count].fd = subs.rates_sp_sub;
+	fds_meta[fdsc_count] = ORB_ID(vehicle_rates_setpoint);
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
 	/* --- ACTUATOR OUTPUTS --- */
 	subs.act_outputs_sub = orb_subscribe(ORB_ID_VEHICLE_CONTROLS);
 	fds[fdsc_count].fd = subs.act_outputs_sub;
+	fds_meta[fdsc_count] = ORB_ID_VEHICLE_CONTROLS;
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
 	/* --- ACTUATOR CONTROL --- */
 	subs.act_controls_sub = orb_subscribe(ORB_ID_VEHICLE_ATTITUDE_CONTROLS);
 	fds[fdsc_count].fd = subs.act_controls_sub;
+	fds_meta[fdsc_count] = ORB_ID_VEHICLE_ATTITUDE_CONTROLS;
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
 	/* --- ACTUATOR CONTROL EFFECTIVE --- */
 	subs.act_controls_effective_sub = orb_subscribe(ORB_ID_VEHICLE_ATTITUDE_CONTROLS_EFFECTIVE);
 	fds[fdsc_count].fd = subs.act_controls_effective_sub;
+	fds_meta[fdsc_count] = ORB_ID_VEHICLE_ATTITUDE_CONTROLS_EFFECTIVE;
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
 	/* --- LOCAL POSITION --- */
 	subs.local_pos_sub = orb_subscribe(ORB_ID(vehicle_local_position));
 	fds[fdsc_count].fd = subs.local_pos_sub;
+	fds_meta[fdsc_count] = ORB_ID(vehicle_local_position);
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
 	/* --- LOCAL POSITION SETPOINT --- */
 	subs.local_pos_sp_sub = orb_subscribe(ORB_ID(vehicle_local_position_setpoint));
 	fds[fdsc_count].fd = subs.local_pos_sp_sub;
+	fds_meta[fdsc_count] = ORB_ID(vehicle_local_position_setpoint);
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
 	/* --- GLOBAL POSITION --- */
 	subs.global_pos_sub = orb_subscribe(ORB_ID(vehicle_global_position));
 	fds[fdsc_count].fd = subs.global_pos_sub;
+	fds_meta[fdsc_count] = ORB_ID(vehicle_global_position);
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
 	/* --- GLOBAL POSITION SETPOINT--- */
 	subs.global_pos_sp_sub = orb_subscribe(ORB_ID(vehicle_global_position_setpoint));
 	fds[fdsc_count].fd = subs.global_pos_sp_sub;
+	fds_meta[fdsc_count] = ORB_ID(vehicle_global_position_setpoint);
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
 	/* --- VICON POSITION --- */
 	subs.vicon_pos_sub = orb_subscribe(ORB_ID(vehicle_vicon_position));
 	fds[fdsc_count].fd = subs.vicon_pos_sub;
+	fds_meta[fdsc_count] = ORB_ID(vehicle_vicon_position);
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
 	/* --- OPTICAL FLOW --- */
 	subs.flow_sub = orb_subscribe(ORB_ID(optical_flow));
 	fds[fdsc_count].fd = subs.flow_sub;
+	fds_meta[fdsc_count] = ORB_ID(optical_flow);
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
 	/* --- RC CHANNELS --- */
 	subs.rc_sub = orb_subscribe(ORB_ID(rc_channels));
 	fds[fdsc_count].fd = subs.rc_sub;
+	fds_meta[fdsc_count] = ORB_ID(rc_channels);
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
 	/* --- AIRSPEED --- */
 	subs.airspeed_sub = orb_subscribe(ORB_ID(airspeed));
 	fds[fdsc_count].fd = subs.airspeed_sub;
+	fds_meta[fdsc_count] = ORB_ID(airspeed);
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;	
 
 	/* --- ESCs --- */
 	subs.esc_sub = orb_subscribe(ORB_ID(esc_status));
 	fds[fdsc_count].fd = subs.esc_sub;
+	fds_meta[fdsc_count] = ORB_ID(esc_status);
+	fds[fdsc_count].events = POLLIN;
+	fdsc_count++;
+
+	/* --- PERFORMANCE COUNTERS --- */
+	subs.perf_sub = orb_subscribe(ORB_ID(perf_counter));
+	fds[fdsc_count].fd = subs.perf_sub;
+	fds_meta[fdsc_count] = ORB_ID(perf_counter);
 	fds[fdsc_count].events = POLLIN;
 	fdsc_count++;
 
+	/* --- TOPICS LOGGED FROM THEIR METADATA --- */
+	for (unsigned i = 0; i < sizeof(generic_topic_ids) / sizeof(generic_topic_ids[0]); i++) {
+		generic_topic_add(generic_topic_ids[i]);
+	}
+
+	/* topics in the rate table that are not logged yet, if they have a field layout */
+	for (unsigned i = 0; i < log_rates_count; i++) {
+		const struct orb_metadata *meta = orb_find_topic(log_rates[i].topic);
+		bool logged = false;
+
+		if (meta == NULL || meta->o_fields == NULL) {
+			continue;
+		}
+
+		for (ssize_t j = 0; j < fdsc_count; j++) {
+			logged = logged || fds_meta[j] == meta;
+		}
+
+		for (unsigned j = 0; j < generic_topics_count; j++) {
+			logged = logged || generic_topics[j].meta == meta;
+		}
+
+		if (!logged) {
+			generic_topic_add(meta);
+		}
+	}
+
+	for (unsigned i = 0; i < generic_topics_count; i++) {
+		fds[fdsc_count].fd = generic_topics[i].sub;
+		fds_meta[fdsc_count] = generic_topics[i].meta;
+		fds[fdsc_count].events = POLLIN;
+		fdsc_count++;
+	}
+
 	/* WARNING: If you get the error message below,
 	 * then the number of registered messages (fdsc)
 	 * differs from the number of messages in the above list.
@@ -824,6 +1298,15 @@ int sdlog2_thread_main(int argc, char *argv[])
 		fdsc_count = fdsc;
 	}
 
+	/* pace the logged topics, the management topics (command, status) are never paced */
+	for (ssize_t i = 2; i < fdsc_count && log_rates_count > 0; i++) {
+		unsigned interval = log_rate_interval(fds_meta[i]->o_name);
+
+		if (interval > 0) {
+			orb_set_interval(fds[i].fd, interval);
+		}
+	}
+
 	/*
 	 * set up poll to block for new data,
 	 * wait for a maximum of 1000 ms
@@ -832,10 +1315,6 @@ int sdlog2_thread_main(int argc, char *argv[])
 
 	thread_running = true;
 
-	/* initialize thread synchronization */
-	pthread_mutex_init(&logbuffer_mutex, NULL);
-	pthread_cond_init(&logbuffer_cond, NULL);
-
 	/* track changes in sensor_combined topic */
 	uint16_t gyro_counter = 0;
 	uint16_t accelerometer_counter = 0;
@@ -891,8 +1370,6 @@ int sdlog2_thread_main(int argc, char *argv[])
 
 			ifds = 1;	// Begin from fds[1] again
 
-			pthread_mutex_lock(&logbuffer_mutex);
-
 			/* write time stamp message */
 			log_msg.msg_type = LOG_TIME_MSG;
 			log_msg.body.log_TIME.t = hrt_absolute_time();
@@ -1166,20 +1643,67 @@ int sdlog2_thread_main(int argc, char *argv[])
 				}
 			}
 
+			/* --- PERFORMANCE COUNTERS --- */
+			if (fds[ifds++].revents & POLLIN) {
+				/* the topic is queued, drain everything published since the last pass */
+				bool updated = true;
+
+				while (updated) {
+					orb_copy(ORB_ID(perf_counter), subs.perf_sub, &buf.perf);
+
+					/* name the counter once per log, the records refer to it by ID */
+					if (buf.perf.id >= PERF_NAMES_MAX ||
+					    !(perf_names_logged[buf.perf.id / 8] & (1 << (buf.perf.id % 8)))) {
+						log_msg.msg_type = LOG_PNAM_MSG;
+						log_msg.body.log_PNAM.id = buf.perf.id;
+						memset(log_msg.body.log_PNAM.name, 0, sizeof(log_msg.body.log_PNAM.name));
+						strncpy(log_msg.body.log_PNAM.name, buf.perf.name, sizeof(log_msg.body.log_PNAM.name) - 1);
+
+						if (LOGBUFFER_WRITE_AND_COUNT(PNAM) && buf.perf.id < PERF_NAMES_MAX)
+							perf_names_logged[buf.perf.id / 8] |= (1 << (buf.perf.id % 8));
+					}
+
+					log_msg.msg_type = LOG_PERF_MSG;
+					log_msg.body.log_PERF.id = buf.perf.id;
+					log_msg.body.log_PERF.type = buf.perf.type;
+					log_msg.body.log_PERF.event_count = buf.perf.event_count;
+					log_msg.body.log_PERF.time_total = buf.perf.time_total;
+					log_msg.body.log_PERF.time_least = buf.perf.time_least;
+					log_msg.body.log_PERF.time_most = buf.perf.time_most;
+					log_msg.body.log_PERF.p50 = buf.perf.percentile[0];
+					log_msg.body.log_PERF.p90 = buf.perf.percentile[1];
+					log_msg.body.log_PERF.p99 = buf.perf.percentile[2];
+					log_msg.body.log_PERF.p999 = buf.perf.percentile[3];
+					log_msg.body.log_PERF.overflow = buf.perf.overflow;
+					LOGBUFFER_WRITE_AND_COUNT(PERF);
+
+					orb_check(subs.perf_sub, &updated);
+				}
+			}
+
+			/* --- TOPICS LOGGED FROM THEIR METADATA --- */
+			for (unsigned i = 0; i < generic_topics_count; i++) {
+				if (fds[ifds++].revents & POLLIN) {
+					/* the topic structure is the message body, copied once */
+					const struct orb_metadata *meta = generic_topics[i].meta;
+
+					orb_copy(meta, generic_topics[i].sub, generic_msg.body);
+					generic_msg.msg_type = generic_topics[i].msg_type;
+
+					log_write_and_count(&generic_msg, LOG_PACKET_HEADER_LEN + meta->o_size);
+				}
+			}
+
+			/* --- DROPPED MESSAGES --- */
+			if (log_drops_first != 0 && hrt_absolute_time() - log_drops_reported > LOG_DROPS_REPORT_INTERVAL) {
+				log_drops_report();
+				log_drops_reported = hrt_absolute_time();
+			}
+
 #ifdef SDLOG2_DEBUG
 				printf("fill rp=%i wp=%i count=%i\n", lb.read_ptr, lb.write_ptr, logbuffer_count(&lb));
 #endif
-			/* signal the other thread new data, but not yet unlock */
-			if (logbuffer_count(&lb) > MIN_BYTES_TO_WRITE) {
-#ifdef SDLOG2_DEBUG
-				printf("signal rp=%i wp=%i count=%i\n", lb.read_ptr, lb.write_ptr, logbuffer_count(&lb));
-#endif
-				/* only request write if several packets can be written at once */
-				pthread_cond_signal(&logbuffer_cond);
-			}
-
-			/* unlock, now the writer thread may run */
-			pthread_mutex_unlock(&logbuffer_mutex);
+			/* the writer is woken by logbuffer_write once MIN_BYTES_TO_WRITE are queued */
 		}
 
 		if (use_sleep) {
@@ -1190,8 +1714,7 @@ int sdlog2_thread_main(int argc, char *argv[])
 	if (logging_enabled)
 		sdlog2_stop_log();
 
-	pthread_mutex_destroy(&logbuffer_mutex);
-	pthread_cond_destroy(&logbuffer_cond);
+	logbuffer_free(&lb);
 
 	warnx("exiting.");
 
@@ -1208,6 +1731,24 @@ void sdlog2_status()
 
 	warnx("wrote %lu msgs, %4.2f MiB (average %5.3f KiB/s), skipped %lu msgs.", log_msgs_written, (double)mebibytes, (double)(kibibytes / seconds), log_msgs_skipped);
 	mavlink_log_info(mavlink_fd, "[sdlog2] wrote %lu msgs, skipped %lu msgs.", log_msgs_written, log_msgs_skipped);
+
+	for (unsigned t = 0; t < LOG_FORMAT_MSG; t++) {
+		if (log_drops_total[t] == 0)
+			continue;
+
+		const char *name = "generic";
+
+		for (int i = 0; i < log_formats_num; i++) {
+			if (log_formats[i].type == t)
+				name = log_formats[i].name;
+		}
+
+		warnx("  dropped %lu %.4s (type %u)", (unsigned long)log_drops_total[t], name, t);
+	}
+
+	if (log_rates_count > 0) {
+		warnx("per-topic rates: profile %s, %u entries", log_profile_name ? log_profile_name : "none", log_rates_count);
+	}
 }
 
 /**
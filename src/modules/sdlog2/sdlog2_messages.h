@@ -244,8 +244,68 @@ struct log_ESC_s {
 	uint16_t esc_setpoint_raw;
 };
 
+/* --- PERF - PERFORMANCE COUNTER --- */
+#define LOG_PERF_MSG 19
+struct log_PERF_s {
+	uint16_t id;
+	uint8_t type;
+	uint64_t event_count;
+	uint64_t time_total;
+	uint32_t time_least;
+	uint32_t time_most;
+	uint32_t p50;
+	uint32_t p90;
+	uint32_t p99;
+	uint32_t p999;
+	uint32_t overflow;
+};
+
+/* --- PNAM - PERFORMANCE COUNTER NAME --- */
+#define LOG_PNAM_MSG 20
+struct log_PNAM_s {
+	uint16_t id;
+	char name[64];
+};
+
+/* --- TOPC - TOPIC LOGGED FROM ITS METADATA --- */
+#define LOG_TOPC_MSG 21
+struct log_TOPC_s {
+	uint8_t id;
+	uint16_t size;
+	char name[64];
+};
+
+/* --- FELD - FIELD OF A TOPIC LOGGED FROM ITS METADATA --- */
+#define LOG_FELD_MSG 22
+struct log_FELD_s {
+	uint8_t id;
+	uint16_t offset;
+	uint8_t type;
+	uint8_t count;
+	char name[64];
+};
+
+/* --- DROP - MESSAGES DROPPED ON A FULL LOG BUFFER --- */
+#define LOG_DROP_MSG 23
+struct log_DROP_s {
+	uint64_t first;
+	uint64_t last;
+	uint8_t type;
+	uint32_t count;
+};
+
 #pragma pack(pop)
 
+/*
+ * Topics logged from their uORB metadata are given message types from
+ * LOG_GENERIC_MSG_BASE up.  Each is announced by a FORMAT message giving
+ * its length, a TOPC message naming it and a FELD message per field; the
+ * message body is the raw topic structure.
+ */
+#define LOG_GENERIC_MSG_BASE	64
+#define LOG_GENERIC_MSG_MAX	(LOG_FORMAT_MSG - LOG_GENERIC_MSG_BASE)
+#define LOG_GENERIC_SIZE_MAX	(255 - LOG_PACKET_HEADER_LEN)
+
 /* construct list of all message formats */
 
 static const struct log_format_s log_formats[] = {
@@ -267,6 +327,11 @@ static const struct log_format_s log_formats[] = {
 	LOG_FORMAT(GPOS, "LLffff", "Lat,Lon,Alt,VelN,VelE,VelD"),
 	LOG_FORMAT(GPSP, "BLLfffbBffff", "AltRel,Lat,Lon,Alt,Yaw,LoiterR,LoiterDir,NavCmd,P1,P2,P3,P4"),
 	LOG_FORMAT(ESC, "HBBBHHHHHHfH", "Counter,NumESC,Conn,No,Version,Adr,Volt,Amp,RPM,Temp,SetP,SetPRAW"),
+	LOG_FORMAT(PERF, "HBQQIIIIIII", "Id,Type,Events,Total,Min,Max,P50,P90,P99,P999,Over"),
+	LOG_FORMAT(PNAM, "HZ", "Id,Name"),
+	LOG_FORMAT(TOPC, "BHZ", "Id,Size,Name"),
+	LOG_FORMAT(FELD, "BHBBZ", "Id,Offset,Type,Count,Name"),
+	LOG_FORMAT(DROP, "QQBI", "First,Last,Type,Count"),
 };
 
 static const int log_formats_num = sizeof(log_formats) / sizeof(struct log_format_s);
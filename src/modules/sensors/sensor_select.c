@@ -0,0 +1,77 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file sensor_select.c
+ *
+ * Choice of the primary among redundant sensors.
+ */
+
+#include <nuttx/config.h>
+#include <string.h>
+
+#include "sensor_select.h"
+
+void sensor_select_init(struct sensor_select_s *ss, unsigned count, uint64_t interval)
+{
+	memset(ss, 0, sizeof(*ss));
+	ss->count = (count < SENSOR_SELECT_MAX) ? count : SENSOR_SELECT_MAX;
+	ss->interval = interval;
+}
+
+void sensor_select_update(struct sensor_select_s *ss, unsigned instance)
+{
+	if (instance < ss->count)
+		ss->updates[instance]++;
+}
+
+bool sensor_select_check(struct sensor_select_s *ss, uint64_t now)
+{
+	unsigned previous = ss->primary;
+
+	if ((now - ss->select_time) <= ss->interval)
+		return false;
+
+	for (unsigned i = 0; i < ss->count; i++) {
+		if (ss->updates[i] > ss->updates[ss->primary])
+			ss->primary = i;
+	}
+
+	for (unsigned i = 0; i < ss->count; i++)
+		ss->updates[i] = 0;
+
+	ss->select_time = now;
+
+	return ss->primary != previous;
+}
@@ -0,0 +1,75 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file sensor_select.h
+ *
+ * Choice of the primary among redundant sensors.
+ *
+ * Each instance's updates are counted, and at every interval the one that
+ * published the most takes over as the primary; a sensor that stops
+ * publishing is thus replaced within an interval or two.  The primary only
+ * changes to an instance that did strictly better, so equal sensors don't
+ * make it flap.
+ */
+
+#ifndef SENSORS_SENSOR_SELECT_H_
+#define SENSORS_SENSOR_SELECT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SENSOR_SELECT_MAX	4		/**< most instances of one sensor handled */
+
+struct sensor_select_s {
+	unsigned count;				// instances to choose from
+	unsigned primary;			// instance in use
+	unsigned updates[SENSOR_SELECT_MAX];	// updates per instance since the last selection
+	uint64_t interval;			// time between selections in us
+	uint64_t select_time;			// time of the last selection
+};
+
+__BEGIN_DECLS
+
+void sensor_select_init(struct sensor_select_s *ss, unsigned count, uint64_t interval);
+
+/* count an update from an instance */
+void sensor_select_update(struct sensor_select_s *ss, unsigned instance);
+
+/* re-select the primary if an interval has passed, returns true if it changed */
+bool sensor_select_check(struct sensor_select_s *ss, uint64_t now);
+
+__END_DECLS
+
+#endif
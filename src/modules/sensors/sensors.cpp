@@ -80,6 +80,8 @@
 #include <uORB/topics/differential_pressure.h>
 #include <uORB/topics/airspeed.h>
 
+#include "sensor_select.h"
+
 #define GYRO_HEALTH_COUNTER_LIMIT_ERROR 20   /* 40 ms downtime at 500 Hz update rate   */
 #define ACC_HEALTH_COUNTER_LIMIT_ERROR  20   /* 40 ms downtime at 500 Hz update rate   */
 #define MAGN_HEALTH_COUNTER_LIMIT_ERROR 100  /* 1000 ms downtime at 100 Hz update rate  */
@@ -110,6 +112,9 @@
 
 #define limit_minus_one_to_one(arg) (arg < -1.0f) ? -1.0f : ((arg > 1.0f) ? 1.0f : arg)
 
+/* gyro nodes, one per instance */
+static const char *const gyro_paths[] = { GYRO0_DEVICE_PATH, GYRO1_DEVICE_PATH };
+
 /**
  * Sensor app start / stop handling function
  *
@@ -139,6 +144,8 @@ public:
 
 private:
 	static const unsigned _rc_max_chan_count = RC_CHANNELS_MAX;	/**< maximum number of r/c channels we handle */
+	static const unsigned _gyro_max_count = 2;			/**< maximum number of redundant gyros we handle */
+	static const hrt_abstime _gyro_select_interval = 1000000;	/**< interval at which the primary gyro is re-selected */
 
 	hrt_abstime	_ppm_last_valid;		/**< last time we got a valid ppm signal */
 
@@ -157,7 +164,8 @@ private:
 	bool		_hil_enabled;			/**< if true, HIL is active */
 	bool		_publishing;			/**< if true, we are publishing sensor data */
 
-	int		_gyro_sub;			/**< raw gyro data subscription */
+	int		_gyro_sub[_gyro_max_count];	/**< raw gyro data subscriptions, one per instance */
+	struct sensor_select_s _gyro_select;		/**< choice of the gyro instance used for sensor_combined */
 	int		_accel_sub;			/**< raw accel data subscription */
 	int		_mag_sub;			/**< raw mag data subscription */
 	int 		_rc_sub;			/**< raw rc channels data subscription */
@@ -179,9 +187,19 @@ private:
 
 	struct rc_channels_s _rc;			/**< r/c channel data */
 	struct battery_status_s _battery_status;	/**< battery status */
+	struct accel_report _accel_report;		/**< accelerometer data */
+	struct gyro_report _gyro_report;		/**< primary gyro data */
+	struct mag_report _mag_report;			/**< magnetometer data */
 	struct baro_report _barometer;			/**< barometer data */
 	struct differential_pressure_s _diff_pres;
 	struct airspeed_s _airspeed;
+	float		_adc_voltage_v[4];		/**< raw ADC voltages */
+
+	uint16_t	_gyro_count;			/**< primary gyro updates, for sensor_combined */
+	uint32_t	_accel_count;			/**< accelerometer updates, for sensor_combined */
+	uint32_t	_mag_count;			/**< magnetometer updates, for sensor_combined */
+	uint32_t	_baro_count;			/**< barometer updates, for sensor_combined */
+	uint32_t	_diff_pres_count;		/**< differential pressure updates, for sensor_combined */
 
 	struct {
 		float min[_rc_max_chan_count];
@@ -285,6 +303,13 @@ private:
 
 	}		_parameter_handles;		/**< handles for interesting parameters */
 
+	uint32_t	_param_generation;		/**< parameter generation when last updated */
+
+	/**
+	 * Check whether any of a group of parameters changed since the last update.
+	 */
+	bool		params_changed(const param_t *handles, unsigned count, uint32_t generation);
+
 
 	/**
 	 * Update our local parameter cache.
@@ -318,43 +343,33 @@ private:
 
 	/**
 	 * Poll the accelerometer for updated data.
-	 *
-	 * @param raw			Combined sensor data structure into which
-	 *				data should be returned.
 	 */
-	void		accel_poll(struct sensor_combined_s &raw);
+	void		accel_poll();
 
 	/**
-	 * Poll the gyro for updated data.
+	 * Poll the gyros for updated data.
 	 *
-	 * @param raw			Combined sensor data structure into which
-	 *				data should be returned.
+	 * Data is taken from the primary gyro, which is periodically
+	 * re-selected as the one publishing at the highest rate.
+	 *
+	 * @return			True if the primary gyro was updated.
 	 */
-	void		gyro_poll(struct sensor_combined_s &raw);
+	bool		gyro_poll();
 
 	/**
 	 * Poll the magnetometer for updated data.
-	 *
-	 * @param raw			Combined sensor data structure into which
-	 *				data should be returned.
 	 */
-	void		mag_poll(struct sensor_combined_s &raw);
+	void		mag_poll();
 
 	/**
 	 * Poll the barometer for updated data.
-	 *
-	 * @param raw			Combined sensor data structure into which
-	 *				data should be returned.
 	 */
-	void		baro_poll(struct sensor_combined_s &raw);
+	void		baro_poll();
 
 	/**
 	 * Poll the differential pressure sensor for updated data.
-	 *
-	 * @param raw			Combined sensor data structure into which
-	 *				data should be returned.
 	 */
-	void		diff_pres_poll(struct sensor_combined_s &raw);
+	void		diff_pres_poll();
 
 	/**
 	 * Check for changes in vehicle status.
@@ -368,11 +383,19 @@ private:
 
 	/**
 	 * Poll the ADC and update readings to suit.
+	 */
+	void		adc_poll();
+
+	/**
+	 * Fill in a combined sensor object from the most recent data.
+	 *
+	 * Every field is written, so this may be used on an object
+	 * obtained from orb_publish_begin.
 	 *
 	 * @param raw			Combined sensor data structure into which
 	 *				data should be returned.
 	 */
-	void		adc_poll(struct sensor_combined_s &raw);
+	void		combined_fill(struct sensor_combined_s &raw);
 
 	/**
 	 * Shim for calling task_main from task_create.
@@ -409,7 +432,6 @@ Sensors::Sensors() :
 	_publishing(true),
 
 /* subscriptions */
-	_gyro_sub(-1),
 	_accel_sub(-1),
 	_mag_sub(-1),
 	_rc_sub(-1),
@@ -427,8 +449,30 @@ Sensors::Sensors() :
 	_diff_pres_pub(-1),
 
 /* performance counters */
-	_loop_perf(perf_alloc(PC_ELAPSED, "sensor task update"))
+	_loop_perf(perf_alloc(PC_HISTOGRAM, "sensor task update")),
+
+/* sensor update counts */
+	_gyro_count(0),
+	_accel_count(0),
+	_mag_count(0),
+	_baro_count(0),
+	_diff_pres_count(0),
+
+/* parameters */
+	_param_generation(0)
 {
+	memset(&_accel_report, 0, sizeof(_accel_report));
+	memset(&_gyro_report, 0, sizeof(_gyro_report));
+	memset(&_mag_report, 0, sizeof(_mag_report));
+	memset(&_barometer, 0, sizeof(_barometer));
+	memset(&_diff_pres, 0, sizeof(_diff_pres));
+	memset(&_adc_voltage_v, 0, sizeof(_adc_voltage_v));
+
+	for (unsigned i = 0; i < _gyro_max_count; i++) {
+		_gyro_sub[i] = -1;
+	}
+
+	sensor_select_init(&_gyro_select, _gyro_max_count, _gyro_select_interval);
 
 	/* basic r/c parameters */
 	for (unsigned i = 0; i < _rc_max_chan_count; i++) {
@@ -745,24 +789,33 @@ Sensors::accel_init()
 void
 Sensors::gyro_init()
 {
-	int	fd;
+	unsigned found = 0;
 
-	fd = open(GYRO_DEVICE_PATH, 0);
+	static_assert(sizeof(gyro_paths) / sizeof(gyro_paths[0]) == _gyro_max_count,
+		      "one gyro node per instance");
 
-	if (fd < 0) {
-		warn("%s", GYRO_DEVICE_PATH);
-		errx(1, "FATAL: no gyro found");
+	for (unsigned i = 0; i < _gyro_max_count; i++) {
+		int fd = open(gyro_paths[i], 0);
+
+		if (fd < 0)
+			continue;
 
-	} else {
 		/* set the gyro internal sampling rate up to at leat 500Hz */
 		ioctl(fd, GYROIOCSSAMPLERATE, 500);
 
 		/* set the driver to poll at 500Hz */
 		ioctl(fd, SENSORIOCSPOLLRATE, 500);
 
-		warnx("using system gyro");
 		close(fd);
+		found++;
 	}
+
+	if (found == 0) {
+		warn("%s", GYRO_DEVICE_PATH);
+		errx(1, "FATAL: no gyro found");
+	}
+
+	warnx("using %u system gyro(s)", found);
 }
 
 void
@@ -817,76 +870,66 @@ Sensors::adc_init()
 }
 
 void
-Sensors::accel_poll(struct sensor_combined_s &raw)
+Sensors::accel_poll()
 {
 	bool accel_updated;
 	orb_check(_accel_sub, &accel_updated);
 
 	if (accel_updated) {
-		struct accel_report	accel_report;
-
-		orb_copy(ORB_ID(sensor_accel), _accel_sub, &accel_report);
-
-		raw.accelerometer_m_s2[0] = accel_report.x;
-		raw.accelerometer_m_s2[1] = accel_report.y;
-		raw.accelerometer_m_s2[2] = accel_report.z;
+		orb_copy(ORB_ID(sensor_accel), _accel_sub, &_accel_report);
 
-		raw.accelerometer_raw[0] = accel_report.x_raw;
-		raw.accelerometer_raw[1] = accel_report.y_raw;
-		raw.accelerometer_raw[2] = accel_report.z_raw;
-
-		raw.accelerometer_counter++;
+		_accel_count++;
 	}
 }
 
-void
-Sensors::gyro_poll(struct sensor_combined_s &raw)
+bool
+Sensors::gyro_poll()
 {
-	bool gyro_updated;
-	orb_check(_gyro_sub, &gyro_updated);
+	bool primary_updated = false;
+
+	for (unsigned i = 0; i < _gyro_max_count; i++) {
+		bool gyro_updated;
+		orb_check(_gyro_sub[i], &gyro_updated);
 
-	if (gyro_updated) {
-		struct gyro_report	gyro_report;
+		if (!gyro_updated)
+			continue;
 
-		orb_copy(ORB_ID(sensor_gyro), _gyro_sub, &gyro_report);
+		sensor_select_update(&_gyro_select, i);
 
-		raw.gyro_rad_s[0] = gyro_report.x;
-		raw.gyro_rad_s[1] = gyro_report.y;
-		raw.gyro_rad_s[2] = gyro_report.z;
+		/* only the primary gyro is used; just consume the others */
+		if (i != _gyro_select.primary) {
+			orb_copy(ORB_ID(sensor_gyro), _gyro_sub[i], nullptr);
+			continue;
+		}
 
-		raw.gyro_raw[0] = gyro_report.x_raw;
-		raw.gyro_raw[1] = gyro_report.y_raw;
-		raw.gyro_raw[2] = gyro_report.z_raw;
+		orb_copy(ORB_ID(sensor_gyro), _gyro_sub[i], &_gyro_report);
 
-		raw.gyro_counter++;
+		_gyro_count++;
+		primary_updated = true;
 	}
+
+	/* periodically switch to whichever gyro is publishing fastest */
+	if (sensor_select_check(&_gyro_select, hrt_absolute_time()))
+		warnx("using gyro %u", _gyro_select.primary);
+
+	return primary_updated;
 }
 
 void
-Sensors::mag_poll(struct sensor_combined_s &raw)
+Sensors::mag_poll()
 {
 	bool mag_updated;
 	orb_check(_mag_sub, &mag_updated);
 
 	if (mag_updated) {
-		struct mag_report	mag_report;
-
-		orb_copy(ORB_ID(sensor_mag), _mag_sub, &mag_report);
-
-		raw.magnetometer_ga[0] = mag_report.x;
-		raw.magnetometer_ga[1] = mag_report.y;
-		raw.magnetometer_ga[2] = mag_report.z;
+		orb_copy(ORB_ID(sensor_mag), _mag_sub, &_mag_report);
 
-		raw.magnetometer_raw[0] = mag_report.x_raw;
-		raw.magnetometer_raw[1] = mag_report.y_raw;
-		raw.magnetometer_raw[2] = mag_report.z_raw;
-
-		raw.magnetometer_counter++;
+		_mag_count++;
 	}
 }
 
 void
-Sensors::baro_poll(struct sensor_combined_s &raw)
+Sensors::baro_poll()
 {
 	bool baro_updated;
 	orb_check(_baro_sub, &baro_updated);
@@ -895,16 +938,12 @@ Sensors::baro_poll(struct sensor_combined_s &raw)
 
 		orb_copy(ORB_ID(sensor_baro), _baro_sub, &_barometer);
 
-		raw.baro_pres_mbar = _barometer.pressure; // Pressure in mbar
-		raw.baro_alt_meter = _barometer.altitude; // Altitude in meters
-		raw.baro_temp_celcius = _barometer.temperature; // Temperature in degrees celcius
-
-		raw.baro_counter++;
+		_baro_count++;
 	}
 }
 
 void
-Sensors::diff_pres_poll(struct sensor_combined_s &raw)
+Sensors::diff_pres_poll()
 {
 	bool updated;
 	orb_check(_diff_pres_sub, &updated);
@@ -912,12 +951,11 @@ Sensors::diff_pres_poll(struct sensor_combined_s &raw)
 	if (updated) {
 		orb_copy(ORB_ID(differential_pressure), _diff_pres_sub, &_diff_pres);
 
-		raw.differential_pressure_pa = _diff_pres.differential_pressure_pa;
-		raw.differential_pressure_counter++;
+		_diff_pres_count++;
 
 		_airspeed.indicated_airspeed_m_s = calc_indicated_airspeed(_diff_pres.differential_pressure_pa);
-		_airspeed.true_airspeed_m_s = calc_true_airspeed(_diff_pres.differential_pressure_pa + raw.baro_pres_mbar*1e2f, 
-											 			 raw.baro_pres_mbar*1e2f, raw.baro_temp_celcius - PCB_TEMP_ESTIMATE_DEG);
+		_airspeed.true_airspeed_m_s = calc_true_airspeed(_diff_pres.differential_pressure_pa + _barometer.pressure*1e2f, 
+											 			 _barometer.pressure*1e2f, _barometer.temperature - PCB_TEMP_ESTIMATE_DEG);
 
 		/* announce the airspeed if needed, just publish else */
 		if (_airspeed_pub > 0) {
@@ -957,6 +995,16 @@ Sensors::vehicle_status_poll()
 	}
 }
 
+bool
+Sensors::params_changed(const param_t *handles, unsigned count, uint32_t generation)
+{
+	for (unsigned i = 0; i < count; i++)
+		if (param_changed_since(handles[i], generation))
+			return true;
+
+	return false;
+}
+
 void
 Sensors::parameter_update_poll(bool forced)
 {
@@ -970,67 +1018,110 @@ Sensors::parameter_update_poll(bool forced)
 		struct parameter_update_s update;
 		orb_copy(ORB_ID(parameter_update), _params_sub, &update);
 
+		/* find out what has changed since the last update */
+		uint32_t since = _param_generation;
+		_param_generation = param_get_generation();
+
+		/* ignore changes to parameters we don't use; the handles are checked as one array */
+		static_assert(sizeof(_parameter_handles) % sizeof(param_t) == 0,
+			      "_parameter_handles must only hold param_t");
+
+		if (!forced && !params_changed((const param_t *)&_parameter_handles,
+					       sizeof(_parameter_handles) / sizeof(param_t), since))
+			return;
+
 		/* update parameters */
 		parameters_update();
 
-		/* update sensor offsets */
-		int fd = open(GYRO_DEVICE_PATH, 0);
-		struct gyro_scale gscale = {
-			_parameters.gyro_offset[0],
-			_parameters.gyro_scale[0],
-			_parameters.gyro_offset[1],
-			_parameters.gyro_scale[1],
-			_parameters.gyro_offset[2],
-			_parameters.gyro_scale[2],
-		};
+		/* update the offsets of sensors whose calibration changed */
+		bool gyro_changed = forced ||
+				    params_changed(_parameter_handles.gyro_offset, 3, since) ||
+				    params_changed(_parameter_handles.gyro_scale, 3, since);
+		bool accel_changed = forced ||
+				     params_changed(_parameter_handles.accel_offset, 3, since) ||
+				     params_changed(_parameter_handles.accel_scale, 3, since);
+		bool mag_changed = forced ||
+				   params_changed(_parameter_handles.mag_offset, 3, since) ||
+				   params_changed(_parameter_handles.mag_scale, 3, since);
+		bool airspeed_changed = forced ||
+					params_changed(&_parameter_handles.diff_pres_offset_pa, 1, since);
+
+		int fd;
+
+		if (gyro_changed) {
+			struct gyro_scale gscale = {
+				_parameters.gyro_offset[0],
+				_parameters.gyro_scale[0],
+				_parameters.gyro_offset[1],
+				_parameters.gyro_scale[1],
+				_parameters.gyro_offset[2],
+				_parameters.gyro_scale[2],
+			};
 
-		if (OK != ioctl(fd, GYROIOCSSCALE, (long unsigned int)&gscale))
-			warn("WARNING: failed to set scale / offsets for gyro");
+			/* every gyro gets the calibration, as any of them may become the primary */
+			for (unsigned i = 0; i < _gyro_max_count; i++) {
+				fd = open(gyro_paths[i], 0);
 
-		close(fd);
+				if (fd < 0)
+					continue;
 
-		fd = open(ACCEL_DEVICE_PATH, 0);
-		struct accel_scale ascale = {
-			_parameters.accel_offset[0],
-			_parameters.accel_scale[0],
-			_parameters.accel_offset[1],
-			_parameters.accel_scale[1],
-			_parameters.accel_offset[2],
-			_parameters.accel_scale[2],
-		};
+				if (OK != ioctl(fd, GYROIOCSSCALE, (long unsigned int)&gscale))
+					warn("WARNING: failed to set scale / offsets for gyro %u", i);
 
-		if (OK != ioctl(fd, ACCELIOCSSCALE, (long unsigned int)&ascale))
-			warn("WARNING: failed to set scale / offsets for accel");
+				close(fd);
+			}
+		}
 
-		close(fd);
+		if (accel_changed) {
+			fd = open(ACCEL_DEVICE_PATH, 0);
+			struct accel_scale ascale = {
+				_parameters.accel_offset[0],
+				_parameters.accel_scale[0],
+				_parameters.accel_offset[1],
+				_parameters.accel_scale[1],
+				_parameters.accel_offset[2],
+				_parameters.accel_scale[2],
+			};
 
-		fd = open(MAG_DEVICE_PATH, 0);
-		struct mag_scale mscale = {
-			_parameters.mag_offset[0],
-			_parameters.mag_scale[0],
-			_parameters.mag_offset[1],
-			_parameters.mag_scale[1],
-			_parameters.mag_offset[2],
-			_parameters.mag_scale[2],
-		};
+			if (OK != ioctl(fd, ACCELIOCSSCALE, (long unsigned int)&ascale))
+				warn("WARNING: failed to set scale / offsets for accel");
 
-		if (OK != ioctl(fd, MAGIOCSSCALE, (long unsigned int)&mscale))
-			warn("WARNING: failed to set scale / offsets for mag");
+			close(fd);
+		}
 
-		close(fd);
+		if (mag_changed) {
+			fd = open(MAG_DEVICE_PATH, 0);
+			struct mag_scale mscale = {
+				_parameters.mag_offset[0],
+				_parameters.mag_scale[0],
+				_parameters.mag_offset[1],
+				_parameters.mag_scale[1],
+				_parameters.mag_offset[2],
+				_parameters.mag_scale[2],
+			};
 
-		fd = open(AIRSPEED_DEVICE_PATH, 0);
+			if (OK != ioctl(fd, MAGIOCSSCALE, (long unsigned int)&mscale))
+				warn("WARNING: failed to set scale / offsets for mag");
 
-		/* this sensor is optional, abort without error */
+			close(fd);
+		}
 
-		if (fd > 0) {
-			struct airspeed_scale airscale = {
-				_parameters.diff_pres_offset_pa,
-				1.0f,
-			};
+		if (airspeed_changed) {
+			fd = open(AIRSPEED_DEVICE_PATH, 0);
 
-			if (OK != ioctl(fd, AIRSPEEDIOCSSCALE, (long unsigned int)&airscale))
-				warn("WARNING: failed to set scale / offsets for airspeed sensor");
+			/* this sensor is optional, abort without error */
+
+			if (fd > 0) {
+				struct airspeed_scale airscale = {
+					_parameters.diff_pres_offset_pa,
+					1.0f,
+				};
+
+				if (OK != ioctl(fd, AIRSPEEDIOCSSCALE, (long unsigned int)&airscale))
+					warn("WARNING: failed to set scale / offsets for airspeed sensor");
+
+				close(fd);
+			}
 		}
 
 #if 0
@@ -1044,7 +1135,7 @@ Sensors::parameter_update_poll(bool forced)
 }
 
 void
-Sensors::adc_poll(struct sensor_combined_s &raw)
+Sensors::adc_poll()
 {
 
 	/* rate limit to 100 Hz */
@@ -1059,8 +1150,8 @@ Sensors::adc_poll(struct sensor_combined_s &raw)
 			if (ret >= (int)sizeof(buf_adc[0])) {
 
 				/* Save raw voltage values */
-				if (i < (sizeof(raw.adc_voltage_v)) / sizeof(raw.adc_voltage_v[0])) {
-					 raw.adc_voltage_v[i] = buf_adc[i].am_data / (4096.0f / 3.3f);
+				if (i < (sizeof(_adc_voltage_v)) / sizeof(_adc_voltage_v[0])) {
+					 _adc_voltage_v[i] = buf_adc[i].am_data / (4096.0f / 3.3f);
 				}
 
 				/* look for specific channels and process the raw voltage to measurement data */
@@ -1123,6 +1214,58 @@ Sensors::adc_poll(struct sensor_combined_s &raw)
 	}
 }
 
+void
+Sensors::combined_fill(struct sensor_combined_s &raw)
+{
+	/* store the time closest to all measurements */
+	raw.timestamp = hrt_absolute_time();
+
+	/* the age of the gyro sample is carried through to the outputs */
+	raw.sensor_timestamp = _gyro_report.timestamp;
+
+	raw.gyro_raw[0] = _gyro_report.x_raw;
+	raw.gyro_raw[1] = _gyro_report.y_raw;
+	raw.gyro_raw[2] = _gyro_report.z_raw;
+	raw.gyro_counter = _gyro_count;
+	raw.gyro_rad_s[0] = _gyro_report.x;
+	raw.gyro_rad_s[1] = _gyro_report.y;
+	raw.gyro_rad_s[2] = _gyro_report.z;
+
+	raw.accelerometer_raw[0] = _accel_report.x_raw;
+	raw.accelerometer_raw[1] = _accel_report.y_raw;
+	raw.accelerometer_raw[2] = _accel_report.z_raw;
+	raw.accelerometer_counter = _accel_count;
+	raw.accelerometer_m_s2[0] = _accel_report.x;
+	raw.accelerometer_m_s2[1] = _accel_report.y;
+	raw.accelerometer_m_s2[2] = _accel_report.z;
+	raw.accelerometer_mode = 0;
+	raw.accelerometer_range_m_s2 = 0.0f;
+
+	raw.magnetometer_raw[0] = _mag_report.x_raw;
+	raw.magnetometer_raw[1] = _mag_report.y_raw;
+	raw.magnetometer_raw[2] = _mag_report.z_raw;
+	raw.magnetometer_ga[0] = _mag_report.x;
+	raw.magnetometer_ga[1] = _mag_report.y;
+	raw.magnetometer_ga[2] = _mag_report.z;
+	raw.magnetometer_mode = 0;
+	raw.magnetometer_range_ga = 0.0f;
+	raw.magnetometer_cuttoff_freq_hz = 0.0f;
+	raw.magnetometer_counter = _mag_count;
+
+	raw.baro_pres_mbar = _barometer.pressure; // Pressure in mbar
+	raw.baro_alt_meter = _barometer.altitude; // Altitude in meters
+	raw.baro_temp_celcius = _barometer.temperature; // Temperature in degrees celcius
+
+	for (unsigned i = 0; i < (sizeof(raw.adc_voltage_v) / sizeof(raw.adc_voltage_v[0])); i++)
+		raw.adc_voltage_v[i] = _adc_voltage_v[i];
+
+	raw.mcu_temp_celcius = 0.0f;
+	raw.baro_counter = _baro_count;
+
+	raw.differential_pressure_pa = _diff_pres.differential_pressure_pa;
+	raw.differential_pressure_counter = _diff_pres_count;
+}
+
 void
 Sensors::ppm_poll()
 {
@@ -1347,7 +1490,9 @@ Sensors::task_main()
 	/*
 	 * do subscriptions
 	 */
-	_gyro_sub = orb_subscribe(ORB_ID(sensor_gyro));
+	for (unsigned i = 0; i < _gyro_max_count; i++)
+		_gyro_sub[i] = orb_subscribe_multi(ORB_ID(sensor_gyro), i);
+
 	_accel_sub = orb_subscribe(ORB_ID(sensor_accel));
 	_mag_sub = orb_subscribe(ORB_ID(sensor_mag));
 	_rc_sub = orb_subscribe(ORB_ID(input_rc));
@@ -1363,35 +1508,31 @@ Sensors::task_main()
 	/*
 	 * do advertisements
 	 */
-	struct sensor_combined_s raw;
-	memset(&raw, 0, sizeof(raw));
-	raw.timestamp = hrt_absolute_time();
-	raw.adc_voltage_v[0] = 0.0f;
-	raw.adc_voltage_v[1] = 0.0f;
-	raw.adc_voltage_v[2] = 0.0f;
-	raw.adc_voltage_v[3] = 0.0f;
-
 	memset(&_battery_status, 0, sizeof(_battery_status));
 	_battery_status.voltage_v = BAT_VOL_INITIAL;
 
 	/* get a set of initial values */
-	accel_poll(raw);
-	gyro_poll(raw);
-	mag_poll(raw);
-	baro_poll(raw);
-	diff_pres_poll(raw);
+	accel_poll();
+	gyro_poll();
+	mag_poll();
+	baro_poll();
+	diff_pres_poll();
 
 	parameter_update_poll(true /* forced */);
 
 	/* advertise the sensor_combined topic and make the initial publication */
+	struct sensor_combined_s raw;
+	combined_fill(raw);
 	_sensor_pub = orb_advertise(ORB_ID(sensor_combined), &raw);
 
 	/* wakeup source(s) */
-	struct pollfd fds[1];
+	struct pollfd fds[_gyro_max_count];
 
-	/* use the gyro to pace output - XXX BROKEN if we are using the L3GD20 */
-	fds[0].fd = _gyro_sub;
-	fds[0].events = POLLIN;
+	/* use the gyros to pace output; only updates from the primary are published */
+	for (unsigned i = 0; i < _gyro_max_count; i++) {
+		fds[i].fd = _gyro_sub[i];
+		fds[i].events = POLLIN;
+	}
 
 	while (!_task_should_exit) {
 
@@ -1416,23 +1557,32 @@ Sensors::task_main()
 		/* check parameters for updates */
 		parameter_update_poll();
 
-		/* store the time closest to all measurements (this is bogus, sensor timestamps should be propagated...) */
-		raw.timestamp = hrt_absolute_time();
-
 		/* copy most recent sensor data */
-		gyro_poll(raw);
-		accel_poll(raw);
-		mag_poll(raw);
-		baro_poll(raw);
+		bool gyro_updated = gyro_poll();
+		accel_poll();
+		mag_poll();
+		baro_poll();
 
 		/* check battery voltage */
-		adc_poll(raw);
+		adc_poll();
+
+		diff_pres_poll();
 
-		diff_pres_poll(raw);
+		/*
+		 * Inform other processes that new data is available to copy.
+		 *
+		 * The combined data is assembled directly in the topic's buffer rather
+		 * than copied in; while HIL is active the mavlink receiver publishes
+		 * instead, so this is the only publisher.
+		 */
+		if (_publishing && gyro_updated) {
+			struct sensor_combined_s *combined = (struct sensor_combined_s *)orb_publish_begin(ORB_ID(sensor_combined), _sensor_pub);
 
-		/* Inform other processes that new data is available to copy */
-		if (_publishing)
-			orb_publish(ORB_ID(sensor_combined), _sensor_pub, &raw);
+			if (combined != nullptr) {
+				combined_fill(*combined);
+				orb_publish_commit(ORB_ID(sensor_combined), _sensor_pub);
+			}
+		}
 
 		/* Look for new r/c input data */
 		ppm_poll();
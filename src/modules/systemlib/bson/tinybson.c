@@ -53,14 +53,84 @@
 #define CODER_CHECK(_c)		do { if (_c->dead) { debug("coder dead"); return -1; }} while(0)
 #define CODER_KILL(_c, _reason)	do { debug("killed: %s", _reason); _c->dead = true; return -1; } while(0)
 
+/**
+ * Make at least s bytes available in the file block buffer, s <= BSON_FILE_BUFSIZE.
+ */
+static int
+fill_fbuf(bson_decoder_t decoder, size_t s)
+{
+	unsigned avail = decoder->fbuflen - decoder->fbufpos;
+
+	if (avail >= s)
+		return 0;
+
+	/* move the unread tail to the front and top the block up */
+	memmove(decoder->fbuf, decoder->fbuf + decoder->fbufpos, avail);
+	decoder->fbufpos = 0;
+	decoder->fbuflen = avail;
+
+	while (decoder->fbuflen < s) {
+		size_t want = BSON_FILE_BUFSIZE - decoder->fbuflen;
+
+		/* don't read past the end of the document if we know where it is */
+		if ((decoder->fremain >= 0) && (want > (size_t)decoder->fremain))
+			want = decoder->fremain;
+
+		if (want == 0)
+			return -1;
+
+		ssize_t result = read(decoder->fd, decoder->fbuf + decoder->fbuflen, want);
+
+		if (result <= 0)
+			return -1;
+
+		decoder->fbuflen += result;
+
+		if (decoder->fremain >= 0)
+			decoder->fremain -= result;
+	}
+
+	return 0;
+}
+
 static int
 read_x(bson_decoder_t decoder, void *p, size_t s)
 {
 	CODER_CHECK(decoder);
 
-	if (decoder->fd > -1)
+	if ((decoder->fd > -1) && !decoder->fbuffered)
 		return (read(decoder->fd, p, s) == (int)s) ? 0 : -1;
 
+	if (decoder->fd > -1) {
+		if (s <= BSON_FILE_BUFSIZE) {
+			if (fill_fbuf(decoder, s))
+				return -1;
+
+			memcpy(p, decoder->fbuf + decoder->fbufpos, s);
+			decoder->fbufpos += s;
+			return 0;
+		}
+
+		/* large reads take what is buffered and fetch the rest directly */
+		unsigned avail = decoder->fbuflen - decoder->fbufpos;
+		size_t rest = s - avail;
+
+		memcpy(p, decoder->fbuf + decoder->fbufpos, avail);
+		decoder->fbufpos = 0;
+		decoder->fbuflen = 0;
+
+		if ((decoder->fremain >= 0) && (rest > (size_t)decoder->fremain))
+			CODER_KILL(decoder, "not enough data for read");
+
+		if (read(decoder->fd, (uint8_t *)p + avail, rest) != (int)rest)
+			return -1;
+
+		if (decoder->fremain >= 0)
+			decoder->fremain -= rest;
+
+		return 0;
+	}
+
 	if (decoder->buf != NULL) {
 		/* staged operations to avoid integer overflow for corrupt data */
 		if (s >= decoder->bufsize)
@@ -99,12 +169,16 @@ read_double(bson_decoder_t decoder, double *d)
 	return read_x(decoder, d, sizeof(*d));
 }
 
-int
-bson_decoder_init_file(bson_decoder_t decoder, int fd, bson_decoder_callback callback, void *private)
+static int
+decoder_init_file(bson_decoder_t decoder, int fd, bool buffered, bson_decoder_callback callback, void *private)
 {
-	int32_t	junk;
+	int32_t	len;
 
 	decoder->fd = fd;
+	decoder->fbuffered = false;
+	decoder->fbufpos = 0;
+	decoder->fbuflen = 0;
+	decoder->fremain = -1;
 	decoder->buf = NULL;
 	decoder->dead = false;
 	decoder->callback = callback;
@@ -113,14 +187,31 @@ bson_decoder_init_file(bson_decoder_t decoder, int fd, bson_decoder_callback cal
 	decoder->pending = 0;
 	decoder->node.type = BSON_UNDEFINED;
 
-	/* read and discard document size */
-	if (read_int32(decoder, &junk))
-		CODER_KILL(decoder, "failed discarding length");
+	/* read the document size directly, it bounds the buffered reads */
+	if (read_int32(decoder, &len))
+		CODER_KILL(decoder, "failed reading length");
+
+	decoder->fbuffered = buffered;
+
+	if (len > (int32_t)sizeof(len))
+		decoder->fremain = len - sizeof(len);
 
 	/* ready for decoding */
 	return 0;
 }
 
+int
+bson_decoder_init_file(bson_decoder_t decoder, int fd, bson_decoder_callback callback, void *private)
+{
+	return decoder_init_file(decoder, fd, true, callback, private);
+}
+
+int
+bson_decoder_init_file_unbuffered(bson_decoder_t decoder, int fd, bson_decoder_callback callback, void *private)
+{
+	return decoder_init_file(decoder, fd, false, callback, private);
+}
+
 int
 bson_decoder_init_buf(bson_decoder_t decoder, void *buf, unsigned bufsize, bson_decoder_callback callback, void *private)
 {
@@ -131,6 +222,7 @@ bson_decoder_init_buf(bson_decoder_t decoder, void *buf, unsigned bufsize, bson_
 		return -1;
 
 	decoder->fd = -1;
+	decoder->fbuffered = false;
 	decoder->buf = (uint8_t *)buf;
 	decoder->dead = false;
 	if (bufsize == 0) {
@@ -295,14 +387,73 @@ bson_decoder_data_pending(bson_decoder_t decoder)
 	return decoder->pending;
 }
 
+const void *
+bson_decoder_data_ptr(bson_decoder_t decoder)
+{
+	const uint8_t *p;
+
+	if (decoder->dead || (decoder->pending < 0))
+		return NULL;
+
+	if ((decoder->fd > -1) && decoder->fbuffered) {
+		if ((decoder->pending > BSON_FILE_BUFSIZE) || fill_fbuf(decoder, decoder->pending))
+			return NULL;
+
+		p = decoder->fbuf + decoder->fbufpos;
+		decoder->fbufpos += decoder->pending;
+
+	} else if ((decoder->fd < 0) && (decoder->buf != NULL)) {
+		if ((decoder->bufsize - decoder->bufpos) < (size_t)decoder->pending)
+			return NULL;
+
+		p = decoder->buf + decoder->bufpos;
+		decoder->bufpos += decoder->pending;
+
+	} else {
+		return NULL;
+	}
+
+	/* pending count is discharged */
+	decoder->pending = 0;
+	return p;
+}
+
+static int
+flush_fbuf(bson_encoder_t encoder)
+{
+	if (encoder->fbufpos > 0) {
+		if (write(encoder->fd, encoder->fbuf, encoder->fbufpos) != (int)encoder->fbufpos)
+			CODER_KILL(encoder, "write error flushing buffer");
+
+		encoder->fbufpos = 0;
+	}
+
+	return 0;
+}
+
 static int
 write_x(bson_encoder_t encoder, const void *p, size_t s)
 {
 	CODER_CHECK(encoder);
 
-	if (encoder->fd > -1)
+	if ((encoder->fd > -1) && !encoder->fbuffered)
 		return (write(encoder->fd, p, s) == (int)s) ? 0 : -1;
 
+	if (encoder->fd > -1) {
+		if ((encoder->fbufpos + s) > BSON_FILE_BUFSIZE) {
+			if (flush_fbuf(encoder))
+				return -1;
+
+			/* writes too big to stage go straight out */
+			if (s > BSON_FILE_BUFSIZE)
+				return (write(encoder->fd, p, s) == (int)s) ? 0 : -1;
+		}
+
+		memcpy(encoder->fbuf + encoder->fbufpos, p, s);
+		encoder->fbufpos += s;
+		return 0;
+	}
+
 	/* do we need to extend the buffer? */
 	while ((encoder->bufpos + s) > encoder->bufsize) {
 		if (!encoder->realloc_ok)
@@ -359,10 +510,12 @@ write_name(bson_encoder_t encoder, const char *name)
 	return write_x(encoder, name, len + 1);
 }
 
-int
-bson_encoder_init_file(bson_encoder_t encoder, int fd)
+static int
+encoder_init_file(bson_encoder_t encoder, int fd, bool buffered)
 {
 	encoder->fd = fd;
+	encoder->fbuffered = buffered;
+	encoder->fbufpos = 0;
 	encoder->buf = NULL;
 	encoder->dead = false;
 
@@ -372,10 +525,23 @@ bson_encoder_init_file(bson_encoder_t encoder, int fd)
 	return 0;
 }
 
+int
+bson_encoder_init_file(bson_encoder_t encoder, int fd)
+{
+	return encoder_init_file(encoder, fd, true);
+}
+
+int
+bson_encoder_init_file_unbuffered(bson_encoder_t encoder, int fd)
+{
+	return encoder_init_file(encoder, fd, false);
+}
+
 int
 bson_encoder_init_buf(bson_encoder_t encoder, void *buf, unsigned bufsize)
 {
 	encoder->fd = -1;
+	encoder->fbuffered = false;
 	encoder->buf = (uint8_t *)buf;
 	encoder->bufpos = 0;
 	encoder->dead = false;
@@ -401,6 +567,9 @@ bson_encoder_fini(bson_encoder_t encoder)
 	if (write_int8(encoder, BSON_EOO))
 		CODER_KILL(encoder, "write error on document terminator");
 
+	if ((encoder->fd > -1) && flush_fbuf(encoder))
+		return -1;
+
 	/* hack to fix up length for in-buffer documents */
 	if (encoder->buf != NULL) {
 		int32_t len = bson_encoder_buf_size(encoder);
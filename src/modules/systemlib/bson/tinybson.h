@@ -78,6 +78,14 @@ typedef enum bson_binary_subtype {
  */
 #define BSON_BUF_INCREMENT	128
 
+/**
+ * Size of the block buffer used when reading or writing a file.
+ *
+ * Nodes are staged here so that a document costs one read() or write()
+ * per block rather than several per node.
+ */
+#define BSON_FILE_BUFSIZE	128
+
 /**
  * Node structure passed to the callback.
  */
@@ -104,6 +112,11 @@ typedef int	(* bson_decoder_callback)(bson_decoder_t decoder, void *private, bso
 struct bson_decoder_s {
 	/* file reader state */
 	int			fd;
+	bool			fbuffered;
+	uint8_t			fbuf[BSON_FILE_BUFSIZE];
+	unsigned		fbufpos;
+	unsigned		fbuflen;
+	int32_t			fremain;	/**< document bytes not yet read, or -1 if unknown */
 
 	/* buffer reader state */
 	uint8_t			*buf;
@@ -121,6 +134,11 @@ struct bson_decoder_s {
 /**
  * Initialise the decoder to read from a file.
  *
+ * The file is read in blocks of BSON_FILE_BUFSIZE.  Reads stop at the end
+ * of the document if its header carries a length; documents written by
+ * the file encoder do not, and the file position may then be left up to
+ * a block past the end of the document.
+ *
  * @param decoder		Decoder state structure to be initialised.
  * @param fd			File to read BSON data from.
  * @param callback		Callback to be invoked by bson_decoder_next
@@ -129,6 +147,20 @@ struct bson_decoder_s {
  */
 __EXPORT int bson_decoder_init_file(bson_decoder_t decoder, int fd, bson_decoder_callback callback, void *private);
 
+/**
+ * Initialise the decoder to read from a file without buffering.
+ *
+ * Every field is read with its own read() call, leaving the file
+ * positioned exactly after the last node consumed.
+ *
+ * @param decoder		Decoder state structure to be initialised.
+ * @param fd			File to read BSON data from.
+ * @param callback		Callback to be invoked by bson_decoder_next
+ * @param private		Callback private data, stored in node.
+ * @return			Zero on success.
+ */
+__EXPORT int bson_decoder_init_file_unbuffered(bson_decoder_t decoder, int fd, bson_decoder_callback callback, void *private);
+
 /**
  * Initialise the decoder to read from a buffer in memory.
  *
@@ -166,12 +198,30 @@ __EXPORT int bson_decoder_copy_data(bson_decoder_t decoder, void *buf);
  */
 __EXPORT size_t bson_decoder_data_pending(bson_decoder_t decoder);
 
+/**
+ * Get a pointer to node data in place, without copying it.
+ *
+ * When decoding from a buffer the pointer is into that buffer.  When
+ * decoding from a buffered file it is into the decoder's block buffer and
+ * is only valid until the decoder is next called; data larger than
+ * BSON_FILE_BUFSIZE must be fetched with bson_decoder_copy_data instead.
+ * The pending count is discharged on success.
+ *
+ * @param decoder		Decoder state, must have been initialised with bson_decoder_init.
+ * @return			Pointer to bson_decoder_data_pending bytes of node data,
+ *				or NULL if the data cannot be referenced in place.
+ */
+__EXPORT const void *bson_decoder_data_ptr(bson_decoder_t decoder);
+
 /**
  * Encoder state structure.
  */
 typedef struct bson_encoder_s {
 	/* file writer state */
 	int		fd;
+	bool		fbuffered;
+	uint8_t		fbuf[BSON_FILE_BUFSIZE];
+	unsigned	fbufpos;
 
 	/* buffer writer state */
 	uint8_t		*buf;
@@ -186,12 +236,26 @@ typedef struct bson_encoder_s {
 /**
  * Initialze the encoder for writing to a file.
  *
+ * Output is written in blocks of BSON_FILE_BUFSIZE; the last block is
+ * only written by bson_encoder_fini.
+ *
  * @param encoder		Encoder state structure to be initialised.
  * @param fd			File to write to.
  * @return			Zero on success.
  */
 __EXPORT int bson_encoder_init_file(bson_encoder_t encoder, int fd);
 
+/**
+ * Initialze the encoder for writing to a file without buffering.
+ *
+ * Every field is written with its own write() call as it is appended.
+ *
+ * @param encoder		Encoder state structure to be initialised.
+ * @param fd			File to write to.
+ * @return			Zero on success.
+ */
+__EXPORT int bson_encoder_init_file_unbuffered(bson_encoder_t encoder, int fd);
+
 /**
  * Initialze the encoder for writing to a buffer.
  *
@@ -207,6 +271,8 @@ __EXPORT int bson_encoder_init_buf(bson_encoder_t encoder, void *buf, unsigned b
 /**
  * Finalise the encoded stream.
  *
+ * For a file encoder this writes out any buffered data.
+ *
  * @param encoder		The encoder to finalise.
  */
 __EXPORT int bson_encoder_fini(bson_encoder_t encoder);
@@ -38,6 +38,7 @@
 SRCS		 = err.c \
 		   hx_stream.c \
 		   perf_counter.c \
+		   trace.c \
 		   param/param.c \
 		   bson/tinybson.c \
 		   conversions.c \
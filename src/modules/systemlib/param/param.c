@@ -42,19 +42,24 @@
  */
 
 #include <debug.h>
+#include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <systemlib/err.h>
 #include <errno.h>
+#include <crc32.h>
+
+#include <nuttx/arch.h>
 
 #include <sys/stat.h>
 
 #include <drivers/drv_hrt.h>
 
 #include "systemlib/param/param.h"
-#include "systemlib/uthash/utarray.h"
 #include "systemlib/bson/tinybson.h"
 
 #include "uORB/uORB.h"
@@ -69,25 +74,49 @@
 /**
  * Array of static parameter info.
  */
+#ifdef __PX4_POSIX
+/* the host linker provides these for any section named like an identifier */
+extern const struct param_info_s __start___param[], __stop___param[];
+# define __param_start	__start___param[0]
+# define __param_end	__stop___param[0]
+#else
 extern char __param_start, __param_end;
+#endif
 static const struct param_info_s	*param_info_base = (struct param_info_s *) &__param_start;
 static const struct param_info_s	*param_info_limit = (struct param_info_s *) &__param_end;
 #define	param_info_count		((unsigned)(param_info_limit - param_info_base))
 
 /**
  * Storage for modified parameters.
+ *
+ * There is a slot for every parameter, indexed by handle, allocated by
+ * the first modification.  The bitmaps record which slots hold modified
+ * values, which of those have not been saved, and which parameters have
+ * changed since they were last written to the default file's journal.
  */
-struct param_wbuf_s {
-	param_t			param;
-	union param_value_u	val;
-	bool			unsaved;
-};
+static union param_value_u	*param_shadow;
+static uint32_t			*param_changed_map;
+static uint32_t			*param_unsaved_map;
+static uint32_t			*param_journal_map;
 
-/** flexible array holding modified parameter values */
-UT_array	*param_values;
+/**
+ * Change generations.
+ *
+ * The counter advances on every change, and each parameter records the
+ * generation of its latest change (zero if it has never changed).
+ */
+static volatile uint32_t	param_generation;
+static uint32_t			*param_change_generation;
 
-/** array info for the modified parameters array */
-const UT_icd	param_icd = {sizeof(struct param_wbuf_s), NULL, NULL, NULL};
+#define PARAM_MAP_WORDS		((param_info_count + 31) / 32)
+
+/**
+ * Parameter handles sorted by name, for param_find.
+ *
+ * The linker places parameters in link order, so the index is built
+ * by the first lookup.
+ */
+static uint16_t		*param_sorted;
 
 /** parameter update topic */
 ORB_DEFINE(parameter_update, struct parameter_update_s);
@@ -95,25 +124,84 @@ ORB_DEFINE(parameter_update, struct parameter_update_s);
 /** parameter update topic handle */
 static orb_advert_t param_topic = -1;
 
+/**
+ * Locking.
+ *
+ * Writers, and readers of structure values (which may be freed by a
+ * reset), are serialised by the store lock.
+ *
+ * Scalar values are read without locking under a seqlock, so that
+ * controllers reading their gains never block behind a parameter save.
+ * Writers publish changes to the slots and bitmaps with the sequence
+ * odd, and readers retry if the sequence moved during their read.  The
+ * update is made with interrupts disabled, so a reader can never
+ * preempt a writer part way through and spin waiting for it.
+ */
+static pthread_mutex_t		param_mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile pthread_t	param_lock_owner;
+static volatile bool		param_locked;
+static volatile unsigned	param_seq;
+
 /** lock the parameter store */
 static void
 param_lock(void)
 {
-	/* XXX */
+	pthread_mutex_lock(&param_mutex);
+	param_lock_owner = pthread_self();
+	param_locked = true;
 }
 
 /** unlock the parameter store */
 static void
 param_unlock(void)
 {
-	/* XXX */
+	param_locked = false;
+	pthread_mutex_unlock(&param_mutex);
 }
 
 /** assert that the parameter store is locked */
 static void
 param_assert_locked(void)
 {
-	/* XXX */
+	if (!param_locked || !pthread_equal(param_lock_owner, pthread_self()))
+		debug("parameter store not locked");
+}
+
+/**
+ * Full memory barrier, ordering the seqlock sequence accesses against
+ * the accesses to the values.
+ */
+static inline void
+param_barrier(void)
+{
+	__sync_synchronize();
+}
+
+/**
+ * Start publishing a change to the values.
+ *
+ * Only the stores that readers can observe belong between this and
+ * param_write_end; anything slow (allocation, I/O) must happen outside.
+ */
+static irqstate_t
+param_write_begin(void)
+{
+	param_assert_locked();
+
+	irqstate_t flags = irqsave();
+	param_seq++;
+	param_barrier();
+
+	return flags;
+}
+
+/** finish publishing a change to the values */
+static void
+param_write_end(irqstate_t flags)
+{
+	param_barrier();
+	param_seq++;
+	irqrestore(flags);
 }
 
 /**
@@ -128,55 +216,143 @@ handle_in_range(param_t param)
 	return (param < param_info_count);
 }
 
+static inline bool
+param_map_test(const uint32_t *map, param_t param)
+{
+	return (map[param / 32] & (1U << (param % 32))) != 0;
+}
+
+static inline void
+param_map_set(uint32_t *map, param_t param)
+{
+	map[param / 32] |= (1U << (param % 32));
+}
+
+static inline void
+param_map_clear(uint32_t *map, param_t param)
+{
+	map[param / 32] &= ~(1U << (param % 32));
+}
+
 /**
- * Compare two modifid parameter structures to determine ordering.
+ * Find the next parameter marked in a bitmap.
  *
- * This function is suitable for passing to qsort or bsearch.
+ * @param map			The bitmap to search.
+ * @param param			The first parameter to consider.
+ * @return			The parameter, or PARAM_INVALID if there are
+ *				no more.
+ */
+static param_t
+param_map_next(const uint32_t *map, param_t param)
+{
+	if (map == NULL)
+		return PARAM_INVALID;
+
+	while (handle_in_range(param)) {
+		uint32_t word = map[param / 32] >> (param % 32);
+
+		if (word != 0) {
+			param += __builtin_ctz(word);
+			return handle_in_range(param) ? param : PARAM_INVALID;
+		}
+
+		/* skip to the start of the next word */
+		param = (param | 31) + 1;
+	}
+
+	return PARAM_INVALID;
+}
+
+/**
+ * Allocate the storage for modified parameters if it doesn't exist yet.
+ *
+ * @return			Zero on success, nonzero if allocation failed.
  */
 static int
-param_compare_values(const void *a, const void *b)
+param_shadow_alloc(void)
 {
-	struct param_wbuf_s *pa = (struct param_wbuf_s *)a;
-	struct param_wbuf_s *pb = (struct param_wbuf_s *)b;
+	param_assert_locked();
 
-	if (pa->param < pb->param)
+	if (param_shadow != NULL)
+		return 0;
+
+	/* one allocation for the slots, their generations and the bitmaps */
+	void *buf = calloc(1, param_info_count * (sizeof(*param_shadow) + sizeof(uint32_t)) +
+			   3 * PARAM_MAP_WORDS * sizeof(uint32_t));
+
+	if (buf == NULL)
 		return -1;
 
-	if (pa->param > pb->param)
-		return 1;
+	/* lock-free readers test param_shadow before using the rest */
+	irqstate_t flags = param_write_begin();
+	param_change_generation = (uint32_t *)((union param_value_u *)buf + param_info_count);
+	param_changed_map = param_change_generation + param_info_count;
+	param_unsaved_map = param_changed_map + PARAM_MAP_WORDS;
+	param_journal_map = param_unsaved_map + PARAM_MAP_WORDS;
+	param_barrier();
+	param_shadow = (union param_value_u *)buf;
+	param_write_end(flags);
 
 	return 0;
 }
 
 /**
- * Locate the modified parameter structure for a parameter, if it exists.
+ * Record that a parameter has changed.
+ */
+static void
+param_mark_changed(param_t param)
+{
+	param_assert_locked();
+
+	param_change_generation[param] = ++param_generation;
+	param_map_set(param_journal_map, param);
+}
+
+/**
+ * Locate the modified value for a parameter, if it exists.
  *
  * @param param			The parameter being searched.
- * @return			The structure holding the modified value, or
- *				NULL if the parameter has not been modified.
+ * @return			The modified value, or NULL if the parameter
+ *				has not been modified.
  */
-static struct param_wbuf_s *
+static union param_value_u *
 param_find_changed(param_t param) {
-	struct param_wbuf_s	*s = NULL;
+	param_assert_locked();
 
+	if ((param_shadow != NULL) && handle_in_range(param) && param_map_test(param_changed_map, param))
+		return &param_shadow[param];
+
+	return NULL;
+}
+
+/**
+ * Return a parameter to its default value.
+ */
+static void
+param_reset_internal(param_t param)
+{
 	param_assert_locked();
 
-	if (param_values != NULL) {
-#if 0	/* utarray_find requires bsearch, not available */
-		struct param_wbuf_s key;
-		key.param = param;
-		s = utarray_find(param_values, &key, param_compare_values);
-#else
+	union param_value_u *v = param_find_changed(param);
 
-		while ((s = (struct param_wbuf_s *)utarray_next(param_values, s)) != NULL) {
-			if (s->param == param)
-				break;
-		}
+	if (v == NULL)
+		return;
 
-#endif
+	/* structure values live in their own allocation */
+	void *p = NULL;
+
+	if ((param_type(param) >= PARAM_TYPE_STRUCT) && (param_type(param) <= PARAM_TYPE_STRUCT_MAX)) {
+		p = v->p;
+		v->p = NULL;
 	}
 
-	return s;
+	irqstate_t flags = param_write_begin();
+	param_map_clear(param_changed_map, param);
+	param_map_clear(param_unsaved_map, param);
+	param_mark_changed(param);
+	param_write_end(flags);
+
+	free(p);
 }
 
 static void
@@ -196,12 +372,83 @@ param_notify_changes(void)
 	}
 }
 
+/**
+ * Compare two parameter handles by name.
+ *
+ * This function is suitable for passing to qsort.
+ */
+static int
+param_compare_names(const void *a, const void *b)
+{
+	return strcmp(param_info_base[*(const uint16_t *)a].name,
+		      param_info_base[*(const uint16_t *)b].name);
+}
+
+/**
+ * Build the sorted index of parameter names.
+ *
+ * @return			The index, or NULL if it could not be allocated.
+ */
+static uint16_t *
+param_build_index(void)
+{
+	param_assert_locked();
+
+	if (param_sorted == NULL) {
+		uint16_t *index = malloc(param_info_count * sizeof(*index));
+
+		if (index == NULL)
+			return NULL;
+
+		for (unsigned i = 0; i < param_info_count; i++)
+			index[i] = i;
+
+		qsort(index, param_info_count, sizeof(*index), param_compare_names);
+
+		/* lookups use the index without locking once it is published */
+		param_barrier();
+		param_sorted = index;
+	}
+
+	return param_sorted;
+}
+
 param_t
 param_find(const char *name)
 {
 	param_t param;
+	uint16_t *index = param_sorted;
+
+	if (index == NULL) {
+		param_lock();
+		index = param_build_index();
+		param_unlock();
+	}
+
+	if (index != NULL) {
+		/* binary search of the sorted names */
+		unsigned low = 0;
+		unsigned high = param_info_count;
+
+		while (low < high) {
+			unsigned mid = (low + high) / 2;
+			int cmp = strcmp(param_info_base[index[mid]].name, name);
+
+			if (cmp == 0)
+				return index[mid];
+
+			if (cmp < 0) {
+				low = mid + 1;
+
+			} else {
+				high = mid;
+			}
+		}
+
+		return PARAM_INVALID;
+	}
 
-	/* perform a linear search of the known parameters */
+	/* no memory for the index; perform a linear search of the known parameters */
 	for (param = 0; handle_in_range(param); param++) {
 		if (!strcmp(param_info_base[param].name, name))
 			return param;
@@ -244,21 +491,24 @@ param_name(param_t param)
 	return NULL;
 }
 
+/*
+ * The bitmaps are updated a word at a time, so single bits can be
+ * tested without locking.
+ */
 bool
 param_value_is_default(param_t param)
 {
-	return param_find_changed(param) ? false : true;
+	if ((param_shadow != NULL) && handle_in_range(param))
+		return !param_map_test(param_changed_map, param);
+
+	return true;
 }
 
 bool
 param_value_unsaved(param_t param)
 {
-	static struct param_wbuf_s *s;
-
-	s = param_find_changed(param);
-
-	if (s && s->unsaved)
-		return true;
+	if ((param_shadow != NULL) && handle_in_range(param))
+		return param_map_test(param_changed_map, param) && param_map_test(param_unsaved_map, param);
 
 	return false;
 }
@@ -272,23 +522,31 @@ param_type(param_t param)
 	return PARAM_TYPE_UNKNOWN;
 }
 
-size_t
-param_size(param_t param)
+/**
+ * Return the size of values of a parameter type.
+ */
+static size_t
+param_type_size(param_type_t type)
 {
-	if (handle_in_range(param)) {
-		switch (param_type(param)) {
-		case PARAM_TYPE_INT32:
-		case PARAM_TYPE_FLOAT:
-			return 4;
+	switch (type) {
+	case PARAM_TYPE_INT32:
+	case PARAM_TYPE_FLOAT:
+		return 4;
 
-		case PARAM_TYPE_STRUCT ... PARAM_TYPE_STRUCT_MAX:
-			/* decode structure size from type value */
-			return param_type(param) - PARAM_TYPE_STRUCT;
+	case PARAM_TYPE_STRUCT ... PARAM_TYPE_STRUCT_MAX:
+		/* decode structure size from type value */
+		return type - PARAM_TYPE_STRUCT;
 
-		default:
-			return 0;
-		}
+	default:
+		return 0;
 	}
+}
+
+size_t
+param_size(param_t param)
+{
+	if (handle_in_range(param))
+		return param_type_size(param_type(param));
 
 	return 0;
 }
@@ -312,12 +570,9 @@ param_get_value_ptr(param_t param)
 		const union param_value_u *v;
 
 		/* work out whether we're fetching the default or a written value */
-		struct param_wbuf_s *s = param_find_changed(param);
+		v = param_find_changed(param);
 
-		if (s != NULL) {
-			v = &s->val;
-
-		} else {
+		if (v == NULL) {
 			v = &param_info_base[param].val;
 		}
 
@@ -332,23 +587,62 @@ param_get_value_ptr(param_t param)
 	return result;
 }
 
+/**
+ * Read a scalar value under the seqlock.
+ */
+static void
+param_get_scalar(param_t param, void *val)
+{
+	unsigned seq;
+	union param_value_u v;
+
+	for (;;) {
+		seq = param_seq;
+
+		/* a write is in progress on another CPU; wait for it to finish */
+		if (seq & 1)
+			continue;
+
+		param_barrier();
+
+		if ((param_shadow != NULL) && param_map_test(param_changed_map, param)) {
+			v = param_shadow[param];
+
+		} else {
+			v = param_info_base[param].val;
+		}
+
+		param_barrier();
+
+		/* if no write overlapped the read, it is consistent */
+		if (seq == param_seq)
+			break;
+	}
+
+	memcpy(val, &v, param_size(param));
+}
+
 int
 param_get(param_t param, void *val)
 {
-	int result = -1;
-
-	param_lock();
+	if (!handle_in_range(param) || (val == NULL))
+		return -1;
 
-	const void *v = param_get_value_ptr(param);
+	switch (param_type(param)) {
+	case PARAM_TYPE_INT32:
+	case PARAM_TYPE_FLOAT:
+		param_get_scalar(param, val);
+		return 0;
 
-	if (val != NULL) {
-		memcpy(val, v, param_size(param));
-		result = 0;
+	default:
+		break;
 	}
 
+	param_lock();
+	memcpy(val, param_get_value_ptr(param), param_size(param));
 	param_unlock();
 
-	return result;
+	return 0;
 }
 
 static int
@@ -359,63 +653,62 @@ param_set_internal(param_t param, const void *val, bool mark_saved)
 
 	param_lock();
 
-	if (param_values == NULL)
-		utarray_new(param_values, &param_icd);
-
-	if (param_values == NULL) {
+	if (param_shadow_alloc()) {
 		debug("failed to allocate modified values array");
 		goto out;
 	}
 
 	if (handle_in_range(param)) {
 
-		struct param_wbuf_s *s = param_find_changed(param);
-
-		if (s == NULL) {
-
-			/* construct a new parameter */
-			struct param_wbuf_s buf = {
-				.param = param,
-				.val.p = NULL,
-				.unsaved = false
-			};
-
-			/* add it to the array and sort */
-			utarray_push_back(param_values, &buf);
-			utarray_sort(param_values, param_compare_values);
+		union param_value_u *s = &param_shadow[param];
+		irqstate_t flags;
 
-			/* find it after sorting */
-			s = param_find_changed(param);
-		}
-
-		/* update the changed value */
 		switch (param_type(param)) {
 		case PARAM_TYPE_INT32:
-			s->val.i = *(int32_t *)val;
-			break;
-
 		case PARAM_TYPE_FLOAT:
-			s->val.f = *(float *)val;
+			/* scalars are written under the seqlock, below */
 			break;
 
 		case PARAM_TYPE_STRUCT ... PARAM_TYPE_STRUCT_MAX:
-			if (s->val.p == NULL) {
-				s->val.p = malloc(param_size(param));
+			/* structure readers hold the lock, so this needn't be under the seqlock */
+			if (s->p == NULL) {
+				s->p = malloc(param_size(param));
 
-				if (s->val.p == NULL) {
+				if (s->p == NULL) {
 					debug("failed to allocate parameter storage");
 					goto out;
 				}
 			}
 
-			memcpy(s->val.p, val, param_size(param));
+			memcpy(s->p, val, param_size(param));
 			break;
 
 		default:
 			goto out;
 		}
 
-		s->unsaved = !mark_saved;
+		flags = param_write_begin();
+
+		/* update the changed value */
+		if (param_type(param) == PARAM_TYPE_INT32) {
+			s->i = *(int32_t *)val;
+
+		} else if (param_type(param) == PARAM_TYPE_FLOAT) {
+			s->f = *(float *)val;
+		}
+
+		param_map_set(param_changed_map, param);
+		param_mark_changed(param);
+
+		if (mark_saved) {
+			param_map_clear(param_unsaved_map, param);
+
+		} else {
+			param_map_set(param_unsaved_map, param);
+		}
+
+		param_write_end(flags);
+
 		params_changed = true;
 		result = 0;
 	}
@@ -439,28 +732,36 @@ param_set(param_t param, const void *val)
 	return param_set_internal(param, val, false);
 }
 
+uint32_t
+param_get_generation(void)
+{
+	return param_generation;
+}
+
+bool
+param_changed_since(param_t param, uint32_t generation)
+{
+	/* a single word, so it can be read without locking */
+	if ((param_shadow != NULL) && handle_in_range(param))
+		return (param_change_generation[param] > generation);
+
+	return false;
+}
+
 void
 param_reset(param_t param)
 {
-	struct param_wbuf_s *s = NULL;
+	bool changed;
 
 	param_lock();
 
-	if (handle_in_range(param)) {
-
-		/* look for a saved value */
-		s = param_find_changed(param);
-
-		/* if we found one, erase it */
-		if (s != NULL) {
-			int pos = utarray_eltidx(param_values, s);
-			utarray_erase(param_values, pos, 1);
-		}
-	}
+	/* if there is a modified value, erase it */
+	changed = (param_find_changed(param) != NULL);
+	param_reset_internal(param);
 
 	param_unlock();
 
-	if (s != NULL)
+	if (changed)
 		param_notify_changes();
 }
 
@@ -469,12 +770,11 @@ param_reset_all(void)
 {
 	param_lock();
 
-	if (param_values != NULL) {
-		utarray_free(param_values);
-	}
-
-	/* mark as reset / deleted */
-	param_values = NULL;
+	/* the storage is kept for reuse */
+	for (param_t param = param_map_next(param_changed_map, 0);
+	     param != PARAM_INVALID;
+	     param = param_map_next(param_changed_map, param + 1))
+		param_reset_internal(param);
 
 	param_unlock();
 
@@ -484,6 +784,65 @@ param_reset_all(void)
 static const char *param_default_file = "/eeprom/parameters";
 static char *param_user_file = NULL;
 
+/**
+ * Parameter journal.
+ *
+ * The default file is a journal: a header followed by records, each
+ * setting or resetting one parameter and protected by a CRC.  Saving
+ * appends a record for every parameter changed since it was last
+ * journaled, so saving a single change writes a few tens of bytes.
+ * Once the journal is more than twice the size of the live values it
+ * is compacted, by writing a fresh journal with one record for each
+ * modified parameter and renaming it over the old one.  Where rename
+ * isn't supported the journal is rewritten in place instead, with the
+ * fresh copy kept alongside until the rewrite is done.
+ *
+ * A record cut short by a power loss fails its CRC check and replay
+ * stops there, keeping the values from the records before it.
+ */
+#define PARAM_JOURNAL_MAGIC	0x4c4e4a50	/**< 'PJNL' */
+#define PARAM_JOURNAL_VERSION	1
+#define PARAM_JOURNAL_NAME_MAX	64		/**< longest name, including the terminator */
+#define PARAM_JOURNAL_SLACK	512		/**< bytes of superseded records always tolerated */
+
+struct param_journal_header_s {
+	uint32_t	magic;
+	uint32_t	version;
+};
+
+enum param_journal_op {
+	PARAM_JOURNAL_SET = 1,
+	PARAM_JOURNAL_RESET
+};
+
+/**
+ * Journal record header.
+ *
+ * Followed by the name (without terminator), the value (for a set) and
+ * the CRC-32 of everything from the start of the header.
+ */
+struct param_journal_record_s {
+	uint8_t		op;
+	uint8_t		name_len;
+	uint16_t	type;
+};
+
+struct param_journal_writer_s {
+	int		fd;
+	unsigned	count;		/**< bytes waiting in buf */
+	off_t		written;	/**< bytes written to fd */
+	uint8_t		buf[128];
+};
+
+/** offset of the end of the default file's journal, or zero if we may not append to it */
+static off_t		param_journal_end;
+
+/** set once rename is found not to work on the default file's file system */
+static bool		param_journal_no_rename;
+
+static int		param_import_internal(int fd, bool mark_saved, off_t *journal_end);
+static bool		param_journal_complete(const char *filename);
+
 int
 param_set_default_file(const char* filename)
 {
@@ -493,6 +852,9 @@ param_set_default_file(const char* filename)
 	}
 	if (filename)
 		param_user_file = strdup(filename);
+
+	/* the journal in the new file is not known to match our state */
+	param_journal_end = 0;
 	return 0;
 }
 
@@ -502,26 +864,425 @@ param_get_default_file(void)
 	return (param_user_file != NULL) ? param_user_file : param_default_file;
 }
 
-int
-param_save_default(void)
+static int
+param_journal_flush(struct param_journal_writer_s *w)
 {
-	/* delete the file in case it exists */
-	unlink(param_get_default_file());
+	if ((w->count > 0) && (write(w->fd, w->buf, w->count) != (ssize_t)w->count))
+		return -1;
 
-	/* create the file */
-	int fd = open(param_get_default_file(), O_WRONLY | O_CREAT | O_EXCL);
+	w->written += w->count;
+	w->count = 0;
+	return 0;
+}
 
-	if (fd < 0) {
-		warn("opening '%s' for writing failed", param_get_default_file());
+/**
+ * Buffer data for the journal, so that records go out in a few large
+ * writes rather than one per field.
+ */
+static int
+param_journal_put(struct param_journal_writer_s *w, const void *data, size_t len)
+{
+	const uint8_t *p = (const uint8_t *)data;
+
+	while (len > 0) {
+		if ((w->count == sizeof(w->buf)) && param_journal_flush(w))
+			return -1;
+
+		size_t n = sizeof(w->buf) - w->count;
+
+		if (n > len)
+			n = len;
+
+		memcpy(&w->buf[w->count], p, n);
+		w->count += n;
+		p += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/**
+ * Return the journal record size for a parameter's current value.
+ */
+static size_t
+param_journal_record_size(param_t param)
+{
+	size_t len = sizeof(struct param_journal_record_s) + strlen(param_name(param)) + sizeof(uint32_t);
+
+	if (param_find_changed(param) != NULL)
+		len += param_size(param);
+
+	return len;
+}
+
+/**
+ * Write a record for a parameter's current value: a set if it has been
+ * modified, otherwise a reset.
+ */
+static int
+param_journal_put_param(struct param_journal_writer_s *w, param_t param)
+{
+	struct param_journal_record_s record;
+	const char *name = param_name(param);
+	const void *value = NULL;
+	size_t name_len = strlen(name);
+	size_t value_len = 0;
+
+	param_assert_locked();
+
+	if (name_len >= PARAM_JOURNAL_NAME_MAX) {
+		debug("name too long to journal: '%s'", name);
+		return 0;
+	}
+
+	if (param_find_changed(param) != NULL) {
+		record.op = PARAM_JOURNAL_SET;
+		value = param_get_value_ptr(param);
+		value_len = param_size(param);
+
+	} else {
+		record.op = PARAM_JOURNAL_RESET;
+	}
+
+	record.name_len = name_len;
+	record.type = param_type(param);
+
+	uint32_t crc = crc32part((const uint8_t *)&record, sizeof(record), 0);
+	crc = crc32part((const uint8_t *)name, name_len, crc);
+	crc = crc32part((const uint8_t *)value, value_len, crc);
+
+	if (param_journal_put(w, &record, sizeof(record)) ||
+	    param_journal_put(w, name, name_len) ||
+	    param_journal_put(w, value, value_len) ||
+	    param_journal_put(w, &crc, sizeof(crc)))
 		return -1;
+
+	return 0;
+}
+
+/**
+ * Append records for the parameters changed since they were last journaled.
+ *
+ * @return			Zero on success, nonzero if the journal could not
+ *				be appended to and must be compacted instead.
+ */
+static int
+param_journal_append(const char *filename)
+{
+	struct param_journal_writer_s w = { .fd = -1 };
+	param_t param;
+
+	param_assert_locked();
+
+	/* nothing changed, nothing to write */
+	if (param_map_next(param_journal_map, 0) == PARAM_INVALID)
+		return 0;
+
+	w.fd = open(filename, O_WRONLY);
+
+	if (w.fd < 0)
+		return -1;
+
+	/* make sure nobody has rewritten the file behind our back */
+	if (lseek(w.fd, 0, SEEK_END) != param_journal_end)
+		goto fail;
+
+	for (param = param_map_next(param_journal_map, 0);
+	     param != PARAM_INVALID;
+	     param = param_map_next(param_journal_map, param + 1)) {
+		if (param_journal_put_param(&w, param))
+			goto fail;
 	}
 
-	int result = param_export(fd, false);
+	if (param_journal_flush(&w) || fsync(w.fd))
+		goto fail;
+
+	close(w.fd);
+
+	param_journal_end += w.written;
+	memset(param_journal_map, 0, PARAM_MAP_WORDS * sizeof(uint32_t));
+	return 0;
+
+fail:
+	/* a partial record may have been written; only compaction can remove it */
+	close(w.fd);
+	param_journal_end = 0;
+	return -1;
+}
+
+/**
+ * Write a fresh journal with a record for each modified parameter.
+ *
+ * @return			The size of the journal, or -1 on error.
+ */
+static off_t
+param_journal_write_file(const char *filename)
+{
+	struct param_journal_header_s header = {
+		.magic = PARAM_JOURNAL_MAGIC,
+		.version = PARAM_JOURNAL_VERSION
+	};
+	struct param_journal_writer_s w = { .fd = -1 };
+	param_t param;
+
+	param_assert_locked();
+
+	w.fd = open(filename, O_WRONLY | O_CREAT | O_EXCL, 0666);
+
+	if (w.fd < 0)
+		return -1;
+
+	if (param_journal_put(&w, &header, sizeof(header)))
+		goto fail;
+
+	for (param = param_map_next(param_changed_map, 0);
+	     param != PARAM_INVALID;
+	     param = param_map_next(param_changed_map, param + 1)) {
+		if (param_journal_put_param(&w, param))
+			goto fail;
+	}
+
+	if (param_journal_flush(&w) || fsync(w.fd))
+		goto fail;
+
+	close(w.fd);
+	return w.written;
+
+fail:
+	close(w.fd);
+	unlink(filename);
+	return -1;
+}
+
+/**
+ * Rewrite the journal in place, for file systems that can't rename.
+ *
+ * A complete copy is kept alongside until the rewrite has finished, so
+ * that an interrupted rewrite can be recovered by param_load_default.
+ *
+ * @param have_tmp		Whether tmpname already holds a complete journal.
+ * @return			The size of the journal, or -1 on error.
+ */
+static off_t
+param_journal_rewrite(const char *filename, const char *tmpname, bool have_tmp)
+{
+	off_t size;
+
+	if (!have_tmp) {
+		unlink(tmpname);
+
+		if (param_journal_write_file(tmpname) < 0)
+			return -1;
+	}
+
+	unlink(filename);
+	size = param_journal_write_file(filename);
+
+	if (size >= 0)
+		unlink(tmpname);
+
+	return size;
+}
+
+/**
+ * Replace the journal with a compacted one.
+ *
+ * The new journal is written alongside and renamed into place, so that
+ * the old one survives a failure part way through.  If the new journal
+ * can't be written the old one is left alone.
+ */
+static int
+param_journal_compact(const char *filename)
+{
+	char tmpname[strlen(filename) + 5];
+	off_t size = -1;
+
+	param_assert_locked();
+
+	param_journal_end = 0;
+	snprintf(tmpname, sizeof(tmpname), "%s.tmp", filename);
+
+	/* an earlier compaction was interrupted, and the copy alongside is the good one */
+	bool keep_tmp = param_journal_complete(tmpname) && !param_journal_complete(filename);
+
+	if (param_journal_no_rename || keep_tmp) {
+		size = param_journal_rewrite(filename, tmpname, keep_tmp);
+
+	} else {
+		unlink(tmpname);
+		size = param_journal_write_file(tmpname);
+
+		if (size < 0)
+			return -1;
+
+		int ret = rename(tmpname, filename);
+
+		/* NuttX won't rename over an existing file */
+		if ((ret != 0) && (errno == EEXIST) && (unlink(filename) == 0))
+			ret = rename(tmpname, filename);
+
+		if ((ret != 0) && (errno == ENOSYS)) {
+			/* e.g. NXFFS can't rename; rewrite the file in place from now on */
+			param_journal_no_rename = true;
+			size = param_journal_rewrite(filename, tmpname, true);
+
+		} else if (ret != 0) {
+			struct stat st;
+
+			/* keep the new journal if the old one has already gone */
+			if (stat(filename, &st) == 0)
+				unlink(tmpname);
+
+			size = -1;
+		}
+	}
+
+	if (size < 0)
+		return -1;
+
+	param_journal_end = size;
+
+	if (param_journal_map != NULL)
+		memset(param_journal_map, 0, PARAM_MAP_WORDS * sizeof(uint32_t));
+
+	return 0;
+}
+
+/**
+ * Replay the records of a journal whose header has been read.
+ *
+ * @param fd			The file, positioned after the header.
+ * @param apply			Whether to apply the records, or only check them.
+ * @param mark_saved		Whether to mark the values as saved.
+ * @return			The offset of the end of the last intact record.
+ */
+static off_t
+param_journal_replay(int fd, bool apply, bool mark_saved)
+{
+	off_t end = lseek(fd, 0, SEEK_CUR);
+
+	for (;;) {
+		struct param_journal_record_s record;
+		char name[PARAM_JOURNAL_NAME_MAX];
+		uint8_t small[4];
+		void *value = small;
+		size_t value_len = 0;
+		uint32_t crc;
+
+		if (read(fd, &record, sizeof(record)) != sizeof(record))
+			break;
+
+		if (record.op == PARAM_JOURNAL_SET) {
+			value_len = param_type_size(record.type);
+
+			if (value_len == 0)
+				break;
+
+		} else if (record.op != PARAM_JOURNAL_RESET) {
+			break;
+		}
+
+		if ((record.name_len == 0) || (record.name_len >= sizeof(name)) ||
+		    (read(fd, name, record.name_len) != record.name_len))
+			break;
+
+		name[record.name_len] = '\0';
+
+		if ((value_len > sizeof(small)) && ((value = malloc(value_len)) == NULL)) {
+			debug("failed allocating for '%s'", name);
+			break;
+		}
+
+		if ((read(fd, value, value_len) != (ssize_t)value_len) ||
+		    (read(fd, &crc, sizeof(crc)) != sizeof(crc)) ||
+		    (crc != crc32part((const uint8_t *)value, value_len,
+				      crc32part((const uint8_t *)name, record.name_len,
+						crc32part((const uint8_t *)&record, sizeof(record), 0))))) {
+			debug("journal ends with a damaged record");
+
+			if (value != small)
+				free(value);
+
+			break;
+		}
+
+		param_t param = apply ? param_find(name) : PARAM_INVALID;
+
+		if (!apply) {
+			/* just checking the record */
+
+		} else if (param == PARAM_INVALID) {
+			debug("ignoring unrecognised parameter '%s'", name);
+
+		} else if (record.op == PARAM_JOURNAL_RESET) {
+			param_reset(param);
+
+		} else if (param_type(param) != record.type) {
+			debug("unexpected type for '%s'", name);
+
+		} else if (param_set_internal(param, value, mark_saved)) {
+			debug("error setting value for '%s'", name);
+		}
+
+		if (value != small)
+			free(value);
+
+		end += sizeof(record) + record.name_len + value_len + sizeof(crc);
+	}
+
+	return end;
+}
+
+/**
+ * Check whether a file holds a journal that replays cleanly to its end.
+ */
+static bool
+param_journal_complete(const char *filename)
+{
+	struct param_journal_header_s header;
+	bool complete = false;
+	int fd = open(filename, O_RDONLY);
+
+	if (fd < 0)
+		return false;
+
+	if ((read(fd, &header, sizeof(header)) == sizeof(header)) &&
+	    (header.magic == PARAM_JOURNAL_MAGIC) && (header.version == PARAM_JOURNAL_VERSION))
+		complete = (param_journal_replay(fd, false, false) == lseek(fd, 0, SEEK_END));
+
 	close(fd);
+	return complete;
+}
+
+int
+param_save_default(void)
+{
+	const char *filename = param_get_default_file();
+	int result = -1;
+
+	param_lock();
+
+	/* append to the journal unless we can't, or it has grown too long */
+	if (param_journal_end > 0) {
+		off_t live = sizeof(struct param_journal_header_s);
+
+		for (param_t param = param_map_next(param_changed_map, 0);
+		     param != PARAM_INVALID;
+		     param = param_map_next(param_changed_map, param + 1))
+			live += param_journal_record_size(param);
+
+		if (param_journal_end <= 2 * live + PARAM_JOURNAL_SLACK)
+			result = param_journal_append(filename);
+	}
+
+	if (result != 0)
+		result = param_journal_compact(filename);
+
+	param_unlock();
 
 	if (result != 0) {
-		warn("error exporting parameters to '%s'", param_get_default_file());
-		unlink(param_get_default_file());
+		warn("error saving parameters to '%s'", filename);
 		return -2;
 	}
 
@@ -534,22 +1295,60 @@ param_save_default(void)
 int
 param_load_default(void)
 {
-	int fd = open(param_get_default_file(), O_RDONLY);
+	const char *filename = param_get_default_file();
+	char tmpname[strlen(filename) + 5];
+	bool from_tmp = false;
+
+	/*
+	 * If a compaction was interrupted the default file may be missing or
+	 * cut short, with the complete journal left alongside it.
+	 */
+	snprintf(tmpname, sizeof(tmpname), "%s.tmp", filename);
+
+	if (param_journal_complete(tmpname) && !param_journal_complete(filename)) {
+		warnx("recovering parameters from '%s'", tmpname);
+		from_tmp = true;
+	}
+
+	int fd = open(from_tmp ? tmpname : filename, O_RDONLY);
 
 	if (fd < 0) {
 		/* no parameter file is OK, otherwise this is an error */
 		if (errno != ENOENT) {
-			warn("open '%s' for reading failed", param_get_default_file());
+			warn("open '%s' for reading failed", filename);
 			return -1;
 		}
 		return 1;
 	}
 
-	int result = param_load(fd);
+	off_t journal_end;
+
+	param_reset_all();
+	int result = param_import_internal(fd, true, &journal_end);
+
+	param_lock();
+
+	/*
+	 * If the journal replayed cleanly to the end of the file our values
+	 * now match it, and later saves can append.  Otherwise the next save
+	 * compacts, writing a clean journal.
+	 */
+	if (!from_tmp && (result == 0) && (journal_end > 0) && (journal_end == lseek(fd, 0, SEEK_END))) {
+		param_journal_end = journal_end;
+
+		if (param_journal_map != NULL)
+			memset(param_journal_map, 0, PARAM_MAP_WORDS * sizeof(uint32_t));
+
+	} else {
+		param_journal_end = 0;
+	}
+
+	param_unlock();
+
 	close(fd);
 
 	if (result != 0) {
-		warn("error reading parameters from '%s'", param_get_default_file());
+		warn("error reading parameters from '%s'", filename);
 		return -2;
 	}
 
@@ -559,7 +1358,6 @@ param_load_default(void)
 int
 param_export(int fd, bool only_unsaved)
 {
-	struct param_wbuf_s *s = NULL;
 	struct bson_encoder_s encoder;
 	int	result = -1;
 
@@ -567,43 +1365,38 @@ param_export(int fd, bool only_unsaved)
 
 	bson_encoder_init_file(&encoder, fd);
 
-	/* no modified parameters -> we are done */
-	if (param_values == NULL) {
-		result = 0;
-		goto out;
-	}
+	/*
+	 * Walk the modified parameters, or if we are only saving values
+	 * changed since the last save, those that haven't been saved.
+	 */
+	uint32_t *map = only_unsaved ? param_unsaved_map : param_changed_map;
 
-	while ((s = (struct param_wbuf_s *)utarray_next(param_values, s)) != NULL) {
+	for (param_t param = param_map_next(map, 0);
+	     param != PARAM_INVALID;
+	     param = param_map_next(map, param + 1)) {
 
 		int32_t	i;
 		float	f;
 
-		/*
-		 * If we are only saving values changed since last save, and this
-		 * one hasn't, then skip it
-		 */
-		if (only_unsaved && !s->unsaved)
-			continue;
-
-		s->unsaved = false;
+		param_map_clear(param_unsaved_map, param);
 
 		/* append the appropriate BSON type object */
-		switch (param_type(s->param)) {
+		switch (param_type(param)) {
 		case PARAM_TYPE_INT32:
-			param_get(s->param, &i);
+			param_get(param, &i);
 
-			if (bson_encoder_append_int(&encoder, param_name(s->param), i)) {
-				debug("BSON append failed for '%s'", param_name(s->param));
+			if (bson_encoder_append_int(&encoder, param_name(param), i)) {
+				debug("BSON append failed for '%s'", param_name(param));
 				goto out;
 			}
 
 			break;
 
 		case PARAM_TYPE_FLOAT:
-			param_get(s->param, &f);
+			param_get(param, &f);
 
-			if (bson_encoder_append_double(&encoder, param_name(s->param), f)) {
-				debug("BSON append failed for '%s'", param_name(s->param));
+			if (bson_encoder_append_double(&encoder, param_name(param), f)) {
+				debug("BSON append failed for '%s'", param_name(param));
 				goto out;
 			}
 
@@ -611,11 +1404,11 @@ param_export(int fd, bool only_unsaved)
 
 		case PARAM_TYPE_STRUCT ... PARAM_TYPE_STRUCT_MAX:
 			if (bson_encoder_append_binary(&encoder,
-						       param_name(s->param),
+						       param_name(param),
 						       BSON_BIN_BINARY,
-						       param_size(s->param),
-						       param_get_value_ptr(s->param))) {
-				debug("BSON append failed for '%s'", param_name(s->param));
+						       param_size(param),
+						       param_get_value_ptr(param))) {
+				debug("BSON append failed for '%s'", param_name(param));
 				goto out;
 			}
 
@@ -647,7 +1440,8 @@ param_import_callback(bson_decoder_t decoder, void *private, bson_node_t node)
 {
 	float f;
 	int32_t i;
-	void *v, *tmp = NULL;
+	const void *v;
+	void *tmp = NULL;
 	int result = -1;
 	struct param_import_state *state = (struct param_import_state *)private;
 
@@ -707,6 +1501,12 @@ param_import_callback(bson_decoder_t decoder, void *private, bson_node_t node)
 			goto out;
 		}
 
+		/* use the data in place if the decoder has it to hand */
+		v = bson_decoder_data_ptr(decoder);
+
+		if (v != NULL)
+			break;
+
 		/* XXX check actual file data size? */
 		tmp = malloc(param_size(param));
 
@@ -750,11 +1550,38 @@ out:
 }
 
 static int
-param_import_internal(int fd, bool mark_saved)
+param_import_internal(int fd, bool mark_saved, off_t *journal_end)
 {
 	struct bson_decoder_s decoder;
+	struct param_journal_header_s header;
 	int result = -1;
 	struct param_import_state state;
+	ssize_t len;
+
+	if (journal_end != NULL)
+		*journal_end = 0;
+
+	/* journals are replayed; anything else should be BSON */
+	len = read(fd, &header, sizeof(header));
+
+	if ((len == sizeof(header)) && (header.magic == PARAM_JOURNAL_MAGIC)) {
+		if (header.version != PARAM_JOURNAL_VERSION) {
+			debug("unsupported journal version %u", (unsigned)header.version);
+			return -1;
+		}
+
+		off_t end = param_journal_replay(fd, true, mark_saved);
+
+		if (journal_end != NULL)
+			*journal_end = end;
+
+		return 0;
+	}
+
+	if ((len > 0) && (lseek(fd, -len, SEEK_CUR) < 0)) {
+		debug("failed to rewind parameter file");
+		goto out;
+	}
 
 	if (bson_decoder_init_file(&decoder, fd, param_import_callback, &state)) {
 		debug("decoder init failed");
@@ -779,14 +1606,14 @@ out:
 int
 param_import(int fd)
 {
-	return param_import_internal(fd, false);
+	return param_import_internal(fd, false, NULL);
 }
 
 int
 param_load(int fd)
 {
 	param_reset_all();
-	return param_import_internal(fd, true);
+	return param_import_internal(fd, true, NULL);
 }
 
 void
@@ -794,12 +1621,16 @@ param_foreach(void (*func)(void *arg, param_t param), void *arg, bool only_chang
 {
 	param_t	param;
 
-	for (param = 0; handle_in_range(param); param++) {
+	/* if requested, visit only the changed values */
+	if (only_changed) {
+		for (param = param_map_next(param_changed_map, 0);
+		     param != PARAM_INVALID;
+		     param = param_map_next(param_changed_map, param + 1))
+			func(arg, param);
 
-		/* if requested, skip unchanged values */
-		if (only_changed && (param_find_changed(param) == NULL))
-			continue;
+		return;
+	}
 
+	for (param = 0; handle_in_range(param); param++)
 		func(arg, param);
-	}
 }
@@ -171,6 +171,28 @@ __EXPORT int		param_get(param_t param, void *val);
  */
 __EXPORT int		param_set(param_t param, const void *val);
 
+/**
+ * Obtain the current parameter change generation.
+ *
+ * The generation advances each time any parameter is set or reset.  Keep
+ * the value returned here and later pass it to param_changed_since to find
+ * out which parameters need to be read again.
+ *
+ * @return		The current generation.
+ */
+__EXPORT uint32_t	param_get_generation(void);
+
+/**
+ * Test whether a parameter has changed since a given generation.
+ *
+ * @param param		A handle returned by param_find or passed by param_foreach.
+ * @param generation	A value previously returned by param_get_generation.
+ * @return		True if the parameter was set or reset after the
+ *			generation was obtained, false otherwise or if the
+ *			handle is invalid.
+ */
+__EXPORT bool		param_changed_since(param_t param, uint32_t generation);
+
 /**
  * Reset a parameter to its default value.
  *
@@ -201,6 +223,7 @@ __EXPORT int		param_export(int fd, bool only_unsaved);
  * Import parameters from a file, discarding any unrecognized parameters.
  *
  * This function merges the imported parameters with the current parameter set.
+ * The file may hold BSON, as written by param_export, or a journal.
  *
  * @param fd		File descriptor to import from.  (Currently expected to be a file.)
  * @return		Zero on success, nonzero if an error occurred during import.
@@ -255,7 +278,9 @@ __EXPORT const char*	param_get_default_file(void);
 /**
  * Save parameters to the default file.
  *
- * This function saves all parameters with non-default values.
+ * The default file is a journal.  Parameters changed since the last save
+ * are appended to it; when it has grown to more than twice the size of
+ * the non-default values it is rewritten with just those.
  *
  * @return		Zero on success.
  */
@@ -264,7 +289,11 @@ __EXPORT int 		param_save_default(void);
 /**
  * Load parameters from the default parameter file.
  *
- * @return		Zero on success.
+ * Replays the journal in the file, stopping at the first damaged record,
+ * or imports the file if it is an older BSON one.  Later saves append
+ * to a journal that replayed cleanly.
+ *
+ * @return		Zero on success, 1 if there is no parameter file.
  */
 __EXPORT int 		param_load_default(void);
 
@@ -280,10 +309,16 @@ __EXPORT int 		param_load_default(void);
  * be refactored to avoid the use of a union for param_value_u.
  */
 
+/*
+ * The section is walked as an array, so the compiler must not pad the
+ * definitions out to a larger alignment, as some hosts do.
+ */
+#define PARAM_ALIGN	aligned(__alignof__(struct param_info_s))
+
 /** define an int32 parameter */
 #define PARAM_DEFINE_INT32(_name, _default)		\
 	static const					\
-	__attribute__((used, section("__param")))	\
+	__attribute__((used, section("__param"), PARAM_ALIGN))	\
 	struct param_info_s __param__##_name = {	\
 		#_name,					\
 		PARAM_TYPE_INT32,			\
@@ -293,7 +328,7 @@ __EXPORT int 		param_load_default(void);
 /** define a float parameter */
 #define PARAM_DEFINE_FLOAT(_name, _default)		\
 	static const					\
-	__attribute__((used, section("__param")))	\
+	__attribute__((used, section("__param"), PARAM_ALIGN))	\
 	struct param_info_s __param__##_name = {	\
 		#_name,					\
 		PARAM_TYPE_FLOAT,			\
@@ -303,7 +338,7 @@ __EXPORT int 		param_load_default(void);
 /** define a parameter that points to a structure */
 #define PARAM_DEFINE_STRUCT(_name, _default)		\
 	static const					\
-	__attribute__((used, section("__param")))	\
+	__attribute__((used, section("__param"), PARAM_ALIGN))	\
 	struct param_info_s __param__##_name = {	\
 		#_name,					\
 		PARAM_TYPE_STRUCT + sizeof(_default),	\
@@ -39,10 +39,13 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/queue.h>
+#include <arch/irq.h>
 #include <drivers/drv_hrt.h>
 
 #include "perf_counter.h"
+#include "trace.h"
 
 /**
  * Header common to all counters.
@@ -51,6 +54,7 @@ struct perf_ctr_header {
 	sq_entry_t		link;	/**< list linkage */
 	enum perf_counter_type	type;	/**< counter type */
 	const char		*name;	/**< counter name */
+	uint16_t		id;	/**< unique counter ID, for export */
 };
 
 /**
@@ -87,11 +91,43 @@ struct perf_ctr_interval {
 
 };
 
+/**
+ * PC_HISTOGRAM counter.
+ *
+ * Elapsed times are counted in buckets: one per microsecond below
+ * PERF_HISTOGRAM_SUB, then PERF_HISTOGRAM_SUB per octave, so that
+ * a bucket is never wider than 1/PERF_HISTOGRAM_SUB of its lower bound.
+ * Times of 2^PERF_HISTOGRAM_MAX_BITS microseconds (16s) or more are
+ * counted as overflows, apart from the buckets.
+ */
+#define PERF_HISTOGRAM_SUB_BITS	3
+#define PERF_HISTOGRAM_SUB	(1 << PERF_HISTOGRAM_SUB_BITS)
+#define PERF_HISTOGRAM_MAX_BITS	24
+#define PERF_HISTOGRAM_BUCKETS	((PERF_HISTOGRAM_MAX_BITS - PERF_HISTOGRAM_SUB_BITS + 1) * PERF_HISTOGRAM_SUB)
+
+struct perf_ctr_histogram {
+	struct perf_ctr_header	hdr;
+	uint64_t		event_count;
+	uint64_t		time_start;
+	uint64_t		time_total;
+	uint64_t		time_least;
+	uint64_t		time_most;
+	uint32_t		buckets[PERF_HISTOGRAM_BUCKETS];
+	uint32_t		overflow;	/**< events too long for the buckets */
+};
+
 /**
  * List of all known counters.
+ *
+ * Counters are allocated and freed by many tasks while the exporter walks
+ * the list, so changes to it and walks of it are made with interrupts
+ * disabled; the walks are kept short.
  */
 static sq_queue_t	perf_counters;
 
+/** ID for the next counter allocated */
+static uint16_t		perf_next_id;
+
 
 perf_counter_t
 perf_alloc(enum perf_counter_type type, const char *name)
@@ -111,6 +147,10 @@ perf_alloc(enum perf_counter_type type, const char *name)
 		ctr = (perf_counter_t)calloc(sizeof(struct perf_ctr_interval), 1);
 		break;
 
+	case PC_HISTOGRAM:
+		ctr = (perf_counter_t)calloc(sizeof(struct perf_ctr_histogram), 1);
+		break;
+
 	default:
 		break;
 	}
@@ -118,7 +158,11 @@ perf_alloc(enum perf_counter_type type, const char *name)
 	if (ctr != NULL) {
 		ctr->type = type;
 		ctr->name = name;
+
+		irqstate_t flags = irqsave();
+		ctr->id = perf_next_id++;
 		sq_addfirst(&ctr->link, &perf_counters);
+		irqrestore(flags);
 	}
 
 	return ctr;
@@ -130,7 +174,10 @@ perf_free(perf_counter_t handle)
 	if (handle == NULL)
 		return;
 
+	irqstate_t flags = irqsave();
 	sq_rem(&handle->link, &perf_counters);
+	irqrestore(flags);
+
 	free(handle);
 }
 
@@ -143,12 +190,15 @@ perf_count(perf_counter_t handle)
 	switch (handle->type) {
 	case PC_COUNT:
 		((struct perf_ctr_count *)handle)->event_count++;
+		TRACE_INSTANT(TRACE_CAT_PERF, handle->id, hrt_absolute_time());
 		break;
 
 	case PC_INTERVAL: {
 		struct perf_ctr_interval *pci = (struct perf_ctr_interval *)handle;
 		hrt_abstime now = hrt_absolute_time();
 
+		TRACE_INSTANT(TRACE_CAT_PERF, handle->id, now);
+
 		switch (pci->event_count) {
 		case 0:
 			pci->time_first = now;
@@ -176,6 +226,35 @@ perf_count(perf_counter_t handle)
 	}
 }
 
+/**
+ * Find the histogram bucket for a time.
+ */
+static inline unsigned
+perf_histogram_bucket(hrt_abstime time)
+{
+	if (time < PERF_HISTOGRAM_SUB)
+		return time;
+
+	/* the top bit picks the octave, the bits below it the bucket within it */
+	unsigned shift = (31 - __builtin_clz((uint32_t)time)) - PERF_HISTOGRAM_SUB_BITS;
+
+	return (shift + 1) * PERF_HISTOGRAM_SUB + ((time >> shift) & (PERF_HISTOGRAM_SUB - 1));
+}
+
+/**
+ * Return the largest time that falls in a histogram bucket.
+ */
+static uint64_t
+perf_histogram_bucket_limit(unsigned bucket)
+{
+	if (bucket < PERF_HISTOGRAM_SUB)
+		return bucket;
+
+	unsigned shift = bucket / PERF_HISTOGRAM_SUB - 1;
+
+	return ((uint64_t)(PERF_HISTOGRAM_SUB + bucket % PERF_HISTOGRAM_SUB + 1) << shift) - 1;
+}
+
 void
 perf_begin(perf_counter_t handle)
 {
@@ -185,6 +264,12 @@ perf_begin(perf_counter_t handle)
 	switch (handle->type) {
 	case PC_ELAPSED:
 		((struct perf_ctr_elapsed *)handle)->time_start = hrt_absolute_time();
+		TRACE_BEGIN(TRACE_CAT_PERF, handle->id, ((struct perf_ctr_elapsed *)handle)->time_start);
+		break;
+
+	case PC_HISTOGRAM:
+		((struct perf_ctr_histogram *)handle)->time_start = hrt_absolute_time();
+		TRACE_BEGIN(TRACE_CAT_PERF, handle->id, ((struct perf_ctr_histogram *)handle)->time_start);
 		break;
 
 	default:
@@ -192,16 +277,15 @@ perf_begin(perf_counter_t handle)
 	}
 }
 
-void
-perf_end(perf_counter_t handle)
+/**
+ * Record an event of a given length in an elapsed or histogram counter.
+ */
+static void
+perf_add_elapsed(perf_counter_t handle, hrt_abstime elapsed)
 {
-	if (handle == NULL)
-		return;
-
 	switch (handle->type) {
 	case PC_ELAPSED: {
 			struct perf_ctr_elapsed *pce = (struct perf_ctr_elapsed *)handle;
-			hrt_abstime elapsed = hrt_absolute_time() - pce->time_start;
 
 			pce->event_count++;
 			pce->time_total += elapsed;
@@ -211,6 +295,30 @@ perf_end(perf_counter_t handle)
 
 			if (pce->time_most < elapsed)
 				pce->time_most = elapsed;
+
+			break;
+		}
+
+	case PC_HISTOGRAM: {
+			struct perf_ctr_histogram *pch = (struct perf_ctr_histogram *)handle;
+
+			pch->event_count++;
+			pch->time_total += elapsed;
+
+			if (elapsed >= (1 << PERF_HISTOGRAM_MAX_BITS)) {
+				pch->overflow++;
+
+			} else {
+				pch->buckets[perf_histogram_bucket(elapsed)]++;
+			}
+
+			if ((pch->time_least > elapsed) || (pch->time_least == 0))
+				pch->time_least = elapsed;
+
+			if (pch->time_most < elapsed)
+				pch->time_most = elapsed;
+
+			break;
 		}
 
 	default:
@@ -218,6 +326,96 @@ perf_end(perf_counter_t handle)
 	}
 }
 
+void
+perf_end(perf_counter_t handle)
+{
+	if (handle == NULL)
+		return;
+
+	switch (handle->type) {
+	case PC_ELAPSED: {
+			hrt_abstime now = hrt_absolute_time();
+
+			TRACE_END(TRACE_CAT_PERF, handle->id, now);
+			perf_add_elapsed(handle, now - ((struct perf_ctr_elapsed *)handle)->time_start);
+			break;
+		}
+
+	case PC_HISTOGRAM: {
+			hrt_abstime now = hrt_absolute_time();
+
+			TRACE_END(TRACE_CAT_PERF, handle->id, now);
+			perf_add_elapsed(handle, now - ((struct perf_ctr_histogram *)handle)->time_start);
+			break;
+		}
+
+	default:
+		break;
+	}
+}
+
+void
+perf_set_elapsed(perf_counter_t handle, uint64_t elapsed)
+{
+	if (handle == NULL)
+		return;
+
+	perf_add_elapsed(handle, elapsed);
+}
+
+/**
+ * Estimate several percentiles of a histogram in one pass over it.
+ *
+ * @param per_mille		The percentiles, in increasing order.
+ * @param result		The times in microseconds.
+ * @param n			The number of percentiles.
+ */
+static void
+perf_histogram_percentiles(struct perf_ctr_histogram *pch, const unsigned *per_mille, uint64_t *result, unsigned n)
+{
+	uint64_t seen = 0;
+	unsigned i = 0;
+
+	if (pch->event_count == 0) {
+		memset(result, 0, n * sizeof(*result));
+		return;
+	}
+
+	for (unsigned bucket = 0; (bucket < PERF_HISTOGRAM_BUCKETS) && (i < n); bucket++) {
+		seen += pch->buckets[bucket];
+
+		/* the number of events at or below the percentile, rounded up */
+		while ((i < n) && (seen > 0) && (seen * 1000 >= pch->event_count * per_mille[i])) {
+			/* nothing recorded was outside the observed range */
+			uint64_t limit = perf_histogram_bucket_limit(bucket);
+
+			if (limit > pch->time_most)
+				limit = pch->time_most;
+
+			if (limit < pch->time_least)
+				limit = pch->time_least;
+
+			result[i++] = limit;
+		}
+	}
+
+	/* the rest are among the overflows; the longest is all we know */
+	for (; i < n; i++)
+		result[i] = pch->time_most;
+}
+
+uint64_t
+perf_percentile(perf_counter_t handle, unsigned per_mille)
+{
+	uint64_t result;
+
+	if ((handle == NULL) || (handle->type != PC_HISTOGRAM))
+		return 0;
+
+	perf_histogram_percentiles((struct perf_ctr_histogram *)handle, &per_mille, &result, 1);
+	return result;
+}
+
 void
 perf_reset(perf_counter_t handle)
 {
@@ -249,6 +447,18 @@ perf_reset(perf_counter_t handle)
 		pci->time_most = 0;
 		break;
 	}
+
+	case PC_HISTOGRAM: {
+		struct perf_ctr_histogram *pch = (struct perf_ctr_histogram *)handle;
+		pch->event_count = 0;
+		pch->time_start = 0;
+		pch->time_total = 0;
+		pch->time_least = 0;
+		pch->time_most = 0;
+		memset(pch->buckets, 0, sizeof(pch->buckets));
+		pch->overflow = 0;
+		break;
+	}
 	}
 }
 
@@ -289,6 +499,24 @@ perf_print_counter(perf_counter_t handle)
 		break;
 	}
 
+	case PC_HISTOGRAM: {
+		struct perf_ctr_histogram *pch = (struct perf_ctr_histogram *)handle;
+
+		printf("%s: %llu events, %lluus elapsed, min %lluus max %lluus, p50 %lluus p90 %lluus p99 %lluus p99.9 %lluus, %u over %us\n",
+		       handle->name,
+		       pch->event_count,
+		       pch->time_total,
+		       pch->time_least,
+		       pch->time_most,
+		       perf_percentile(handle, 500),
+		       perf_percentile(handle, 900),
+		       perf_percentile(handle, 990),
+		       perf_percentile(handle, 999),
+		       pch->overflow,
+		       (1 << PERF_HISTOGRAM_MAX_BITS) / 1000000);
+		break;
+	}
+
 	default:
 		break;
 	}
@@ -305,13 +533,106 @@ perf_print_all(void)
 	}
 }
 
+int
+perf_snapshot(unsigned id, struct perf_snapshot_s *s)
+{
+	static const unsigned percentiles[] = { 500, 900, 990, 999 };
+	perf_counter_t handle = NULL;
+	irqstate_t flags = irqsave();
+
+	/* IDs are allocated in order, but the list is kept newest first */
+	for (perf_counter_t h = (perf_counter_t)sq_peek(&perf_counters);
+	     h != NULL;
+	     h = (perf_counter_t)sq_next(&h->link)) {
+		if ((h->id >= id) && ((handle == NULL) || (h->id < handle->id)))
+			handle = h;
+	}
+
+	if (handle == NULL) {
+		irqrestore(flags);
+		return -1;
+	}
+
+	memset(s, 0, sizeof(*s));
+	s->id = handle->id;
+	s->type = handle->type;
+	s->name = handle->name;
+
+	switch (handle->type) {
+	case PC_COUNT:
+		s->event_count = ((struct perf_ctr_count *)handle)->event_count;
+		break;
+
+	case PC_ELAPSED: {
+		struct perf_ctr_elapsed *pce = (struct perf_ctr_elapsed *)handle;
+
+		s->event_count = pce->event_count;
+		s->time_total = pce->time_total;
+		s->time_least = pce->time_least;
+		s->time_most = pce->time_most;
+		break;
+	}
+
+	case PC_INTERVAL: {
+		struct perf_ctr_interval *pci = (struct perf_ctr_interval *)handle;
+
+		s->event_count = pci->event_count;
+		s->time_total = pci->time_last - pci->time_first;
+		s->time_least = pci->time_least;
+		s->time_most = pci->time_most;
+		break;
+	}
+
+	case PC_HISTOGRAM: {
+		struct perf_ctr_histogram *pch = (struct perf_ctr_histogram *)handle;
+
+		s->event_count = pch->event_count;
+		s->time_total = pch->time_total;
+		s->time_least = pch->time_least;
+		s->time_most = pch->time_most;
+		perf_histogram_percentiles(pch, percentiles, s->percentile, 4);
+		s->overflow = pch->overflow;
+		break;
+	}
+
+	default:
+		break;
+	}
+
+	irqrestore(flags);
+	return s->id;
+}
+
+const char *
+perf_name(unsigned id)
+{
+	const char *name = NULL;
+	irqstate_t flags = irqsave();
+	perf_counter_t handle = (perf_counter_t)sq_peek(&perf_counters);
+
+	while (handle != NULL) {
+		if (handle->id == id) {
+			name = handle->name;
+			break;
+		}
+
+		handle = (perf_counter_t)sq_next(&handle->link);
+	}
+
+	irqrestore(flags);
+	return name;
+}
+
 void
 perf_reset_all(void)
 {
+	irqstate_t flags = irqsave();
 	perf_counter_t handle = (perf_counter_t)sq_peek(&perf_counters);
 
 	while (handle != NULL) {
 		perf_reset(handle);
 		handle = (perf_counter_t)sq_next(&handle->link);
 	}
+
+	irqrestore(flags);
 }
@@ -39,18 +39,36 @@
 #ifndef _SYSTEMLIB_PERF_COUNTER_H
 #define _SYSTEMLIB_PERF_COUNTER_H value
 
+#include <stdint.h>
+
 /**
  * Counter types.
  */
 enum perf_counter_type {
 	PC_COUNT,		/**< count the number of times an event occurs */
 	PC_ELAPSED,		/**< measure the time elapsed performing an event */
-	PC_INTERVAL		/**< measure the interval between instances of an event */
+	PC_INTERVAL,		/**< measure the interval between instances of an event */
+	PC_HISTOGRAM		/**< measure the distribution of the time elapsed performing an event */
 };
 
 struct perf_ctr_header;
 typedef struct perf_ctr_header	*perf_counter_t;
 
+/**
+ * Snapshot of a counter, for export.
+ */
+struct perf_snapshot_s {
+	uint64_t		event_count;	/**< number of events counted */
+	uint64_t		time_total;	/**< total time in events, or from the first to the last interval */
+	uint64_t		time_least;	/**< shortest event or interval */
+	uint64_t		time_most;	/**< longest event or interval */
+	uint64_t		percentile[4];	/**< p50, p90, p99 and p99.9 event times for PC_HISTOGRAM */
+	uint32_t		overflow;	/**< PC_HISTOGRAM events too long to bucket */
+	unsigned		id;		/**< unique counter ID */
+	enum perf_counter_type	type;		/**< counter type */
+	const char		*name;		/**< counter name */
+};
+
 __BEGIN_DECLS
 
 /**
@@ -97,6 +115,31 @@ __EXPORT extern void		perf_begin(perf_counter_t handle);
  */
 __EXPORT extern void		perf_end(perf_counter_t handle);
 
+/**
+ * Record an event whose length was measured elsewhere.
+ *
+ * This call only affects counters that take begin/end events; PC_ELAPSED
+ * and PC_HISTOGRAM.
+ *
+ * @param handle		The handle returned from perf_alloc.
+ * @param elapsed		The length of the event in microseconds.
+ */
+__EXPORT extern void		perf_set_elapsed(perf_counter_t handle, uint64_t elapsed);
+
+/**
+ * Estimate a percentile of the times recorded by a PC_HISTOGRAM counter.
+ *
+ * Times are recorded in buckets eight to an octave, so the estimate is
+ * the upper bound of a bucket and may be up to 12.5% high.
+ *
+ * @param handle		The handle returned from perf_alloc.
+ * @param per_mille		The percentile in tenths of a percent, e.g. 999
+ *				for the 99.9th percentile.
+ * @return			The time in microseconds, or zero if the counter
+ *				is not a histogram or has recorded no events.
+ */
+__EXPORT extern uint64_t	perf_percentile(perf_counter_t handle, unsigned per_mille);
+
 /**
  * Reset a performance event.
  *
@@ -123,6 +166,28 @@ __EXPORT extern void		perf_print_all(void);
  */
 __EXPORT extern void		perf_reset_all(void);
 
+/**
+ * Find the name of a counter.
+ *
+ * @param id			The counter's ID, as exported.
+ * @return			The counter name, or NULL if there is no
+ *				counter with the ID.
+ */
+__EXPORT extern const char	*perf_name(unsigned id);
+
+/**
+ * Take a snapshot of a counter.
+ *
+ * Counters are found by ID, so that a caller walking them a few at a time
+ * neither skips nor repeats any as counters are allocated and freed.
+ *
+ * @param id			Snapshot the counter with the lowest ID at or
+ *				above this one.
+ * @param s			The snapshot.
+ * @return			The ID of the counter, or -1 if there is none.
+ */
+__EXPORT extern int		perf_snapshot(unsigned id, struct perf_snapshot_s *s);
+
 __END_DECLS
 
 #endif
@@ -0,0 +1,436 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file trace.c
+ *
+ * Event tracing for the hot paths.
+ *
+ * Each task records into a ring of its own, found by hashing its ID.  A
+ * slot is reserved with an atomic increment of the ring head, so an
+ * interrupt handler recording into the ring of the task it interrupted
+ * does not need a lock either.  Old events are overwritten.
+ */
+
+#ifdef __PX4_POSIX
+/* for pthread_getname_np(), must come before any system header */
+# define _GNU_SOURCE
+#endif
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef __PX4_POSIX
+# include <pthread.h>
+#else
+# include <nuttx/sched.h>
+extern FAR struct _TCB *sched_gettcb(pid_t pid);
+#endif
+
+#include <uORB/topic_list.h>
+
+#include "perf_counter.h"
+#include "trace.h"
+
+#ifdef PX4_TRACE
+
+#define TRACE_TASK_NAME_LEN	24
+
+struct trace_ring {
+	volatile uintptr_t	owner;		/**< ID of the recording task; zero if free */
+	volatile unsigned	head;		/**< events reserved, free-running */
+	char			name[TRACE_TASK_NAME_LEN];
+	struct trace_event	*events;
+};
+
+volatile bool			trace_enabled = false;
+
+static struct trace_ring	trace_rings[TRACE_TASKS];
+static struct trace_event	*trace_buffer;
+static unsigned			trace_events;		/**< events per ring */
+static volatile unsigned	trace_lost;		/**< events from tasks without a ring */
+
+#define TRACE_TOPIC_NAME(_name)	#_name,
+
+static const char *const trace_topic_names[] = {
+	ORB_TOPICS(TRACE_TOPIC_NAME)
+};
+
+/**
+ * Return an ID for the calling task; never zero.
+ */
+static inline uintptr_t
+trace_self(void)
+{
+#ifdef __PX4_POSIX
+	return (uintptr_t)pthread_self();
+#else
+	return (uintptr_t)getpid() + 1;
+#endif
+}
+
+static void
+trace_name_task(struct trace_ring *ring, unsigned index)
+{
+#if defined(__PX4_POSIX)
+
+	if (pthread_getname_np(pthread_self(), ring->name, sizeof(ring->name)) == 0)
+		return;
+
+#elif CONFIG_TASK_NAME_SIZE > 0
+	FAR struct _TCB *tcb = sched_gettcb(getpid());
+
+	if (tcb != NULL) {
+		strncpy(ring->name, tcb->name, sizeof(ring->name) - 1);
+		return;
+	}
+
+#endif
+	snprintf(ring->name, sizeof(ring->name), "task %u", index);
+}
+
+void
+trace_record(uint8_t type, uint8_t category, uint16_t id, uint64_t timestamp)
+{
+	uintptr_t self = trace_self();
+	unsigned index = (self ^ (self >> 8) ^ (self >> 16)) % TRACE_TASKS;
+	struct trace_ring *ring = NULL;
+
+	for (unsigned probes = 0; probes < TRACE_TASKS; probes++) {
+		struct trace_ring *r = &trace_rings[index];
+
+		if (r->owner == self) {
+			ring = r;
+			break;
+		}
+
+		if ((r->owner == 0) && __sync_bool_compare_and_swap(&r->owner, 0, self)) {
+			trace_name_task(r, index);
+			ring = r;
+			break;
+		}
+
+		index = (index + 1) % TRACE_TASKS;
+	}
+
+	if (ring == NULL) {
+		__sync_fetch_and_add(&trace_lost, 1);
+		return;
+	}
+
+	struct trace_event *e = &ring->events[__sync_fetch_and_add(&ring->head, 1) & (trace_events - 1)];
+
+	e->timestamp = timestamp;
+	e->id = id;
+	e->type = type;
+	e->category = category;
+}
+
+int
+trace_start(unsigned events)
+{
+	trace_enabled = false;
+
+	if (trace_buffer == NULL) {
+		trace_events = 1;
+
+		while (trace_events < ((events > 0) ? events : TRACE_EVENTS_DEFAULT))
+			trace_events <<= 1;
+
+		trace_buffer = (struct trace_event *)calloc(TRACE_TASKS * trace_events, sizeof(struct trace_event));
+
+		if (trace_buffer == NULL)
+			return -ENOMEM;
+
+		for (unsigned i = 0; i < TRACE_TASKS; i++)
+			trace_rings[i].events = &trace_buffer[i * trace_events];
+
+	} else {
+		/* let records that saw the tracer enabled finish */
+		usleep(10000);
+	}
+
+	for (unsigned i = 0; i < TRACE_TASKS; i++) {
+		trace_rings[i].head = 0;
+		trace_rings[i].name[0] = '\0';
+		trace_rings[i].owner = 0;
+	}
+
+	trace_lost = 0;
+	__sync_synchronize();
+	trace_enabled = true;
+
+	return OK;
+}
+
+void
+trace_stop(void)
+{
+	trace_enabled = false;
+}
+
+static int
+trace_write(int fd, const void *buf, size_t len)
+{
+	if (write(fd, buf, len) != (ssize_t)len)
+		return -errno;
+
+	return OK;
+}
+
+static int
+trace_write_record(int fd, uint8_t type, uint8_t category, uint16_t id, const void *payload, uint32_t len)
+{
+	struct trace_file_record record;
+	int ret;
+
+	memset(&record, 0, sizeof(record));
+	record.type = type;
+	record.category = category;
+	record.id = id;
+	record.len = len;
+
+	ret = trace_write(fd, &record, sizeof(record));
+
+	if ((ret == OK) && (len > 0))
+		ret = trace_write(fd, payload, len);
+
+	return ret;
+}
+
+/**
+ * Write the events of a ring, oldest first.
+ */
+static int
+trace_write_ring(int fd, unsigned index)
+{
+	struct trace_ring *ring = &trace_rings[index];
+	unsigned head = ring->head;
+	unsigned count = (head < trace_events) ? head : trace_events;
+	unsigned first = (head - count) & (trace_events - 1);
+	unsigned before_wrap = trace_events - first;
+	int ret;
+
+	if (before_wrap > count)
+		before_wrap = count;
+
+	ret = trace_write_record(fd, TRACE_RECORD_TASK, 0, index, ring->name, strlen(ring->name));
+
+	if (ret == OK)
+		ret = trace_write_record(fd, TRACE_RECORD_EVENTS, 0, index, &ring->events[first],
+					 before_wrap * sizeof(struct trace_event));
+
+	/* a ring that has wrapped is written as two EVENTS records, in order */
+	if ((ret == OK) && (count > before_wrap)) {
+		ret = trace_write_record(fd, TRACE_RECORD_EVENTS, 0, index, &ring->events[0],
+					 (count - before_wrap) * sizeof(struct trace_event));
+	}
+
+	return ret;
+}
+
+/**
+ * Return the i'th recorded event, in no particular order, or NULL after
+ * the last.
+ */
+static struct trace_event *
+trace_event_at(unsigned i)
+{
+	for (unsigned r = 0; r < TRACE_TASKS; r++) {
+		unsigned count;
+
+		if (trace_rings[r].owner == 0)
+			continue;
+
+		count = (trace_rings[r].head < trace_events) ? trace_rings[r].head : trace_events;
+
+		if (i < count)
+			return &trace_rings[r].events[i];
+
+		i -= count;
+	}
+
+	return NULL;
+}
+
+/**
+ * Return the category whose names an event's ID refers to.
+ */
+static uint8_t
+trace_name_category(const struct trace_event *e)
+{
+	/* ORB_COPY shares the topic IDs, so one set of names serves both */
+	return (e->category == TRACE_CAT_ORB_COPY) ? TRACE_CAT_ORB_PUBLISH : e->category;
+}
+
+/**
+ * Write a NAME record for every ID of a category found in the events.
+ */
+static int
+trace_write_names(int fd, uint8_t category)
+{
+	struct trace_event *e;
+	unsigned max_id = 0;
+	bool any = false;
+	uint8_t *named;
+	int ret = OK;
+
+	for (unsigned i = 0; (e = trace_event_at(i)) != NULL; i++) {
+		if ((trace_name_category(e) == category) && (e->id >= max_id)) {
+			max_id = e->id;
+			any = true;
+		}
+	}
+
+	if (!any)
+		return OK;
+
+	named = (uint8_t *)calloc(max_id / 8 + 1, 1);
+
+	if (named == NULL)
+		return -ENOMEM;
+
+	for (unsigned i = 0; ((e = trace_event_at(i)) != NULL) && (ret == OK); i++) {
+		const char *name = NULL;
+
+		if ((trace_name_category(e) != category) || (named[e->id / 8] & (1 << (e->id % 8))))
+			continue;
+
+		if (category == TRACE_CAT_PERF) {
+			name = perf_name(e->id);
+
+		} else if (e->id < sizeof(trace_topic_names) / sizeof(trace_topic_names[0])) {
+			name = trace_topic_names[e->id];
+		}
+
+		named[e->id / 8] |= 1 << (e->id % 8);
+
+		if (name != NULL)
+			ret = trace_write_record(fd, TRACE_RECORD_NAME, category, e->id, name, strlen(name));
+	}
+
+	free(named);
+	return ret;
+}
+
+int
+trace_dump(const char *path)
+{
+	struct trace_file_header header;
+	int fd;
+	int ret;
+
+	if (trace_buffer == NULL)
+		return -ENODATA;
+
+	trace_stop();
+
+	/* let records that saw the tracer enabled finish */
+	usleep(10000);
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+	if (fd < 0)
+		return -errno;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_FILE_VERSION;
+	header.event_size = sizeof(struct trace_event);
+
+	ret = trace_write(fd, &header, sizeof(header));
+
+	for (unsigned i = 0; (i < TRACE_TASKS) && (ret == OK); i++)
+		if (trace_rings[i].owner != 0)
+			ret = trace_write_ring(fd, i);
+
+	if (ret == OK)
+		ret = trace_write_names(fd, TRACE_CAT_PERF);
+
+	if (ret == OK)
+		ret = trace_write_names(fd, TRACE_CAT_ORB_PUBLISH);
+
+	close(fd);
+	return ret;
+}
+
+void
+trace_status(void)
+{
+	if (trace_buffer == NULL) {
+		printf("trace: not started\n");
+		return;
+	}
+
+	printf("trace: %s, %u events per task, %u events lost\n",
+	       trace_enabled ? "running" : "stopped", trace_events, trace_lost);
+
+	for (unsigned i = 0; i < TRACE_TASKS; i++)
+		if (trace_rings[i].owner != 0)
+			printf("  %-24s %u events\n", trace_rings[i].name, trace_rings[i].head);
+}
+
+#else /* !PX4_TRACE */
+
+int
+trace_start(unsigned events)
+{
+	return -ENOSYS;
+}
+
+void
+trace_stop(void)
+{
+}
+
+int
+trace_dump(const char *path)
+{
+	return -ENOSYS;
+}
+
+void
+trace_status(void)
+{
+	printf("trace: not compiled in; build with -DPX4_TRACE\n");
+}
+
+#endif /* PX4_TRACE */
@@ -0,0 +1,186 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file trace.h
+ *
+ * Event tracing for the hot paths.
+ *
+ * Performance counters and uORB record begin, end and instant events into
+ * a ring per task, so that the interleaving of work across tasks can be
+ * seen afterwards.  Tools/trace_to_chrome.py converts a dump into the
+ * Chrome trace-event format.
+ *
+ * Tracing is only compiled in when PX4_TRACE is defined (e.g. make
+ * EXTRADEFINES=-DPX4_TRACE); otherwise the TRACE_* macros generate no
+ * code.  When compiled in, a disabled tracer costs a load and a branch
+ * per event.
+ */
+
+#ifndef _SYSTEMLIB_TRACE_H
+#define _SYSTEMLIB_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRACE_FILE_MAGIC	"PX4trace"	/**< not NUL terminated */
+#define TRACE_FILE_VERSION	1
+
+/** Number of tasks that can be traced at once */
+#define TRACE_TASKS		16
+
+/** Default events held per task; a power of two */
+#define TRACE_EVENTS_DEFAULT	64
+
+enum trace_event_type {
+	TRACE_TYPE_BEGIN = 1,
+	TRACE_TYPE_END = 2,
+	TRACE_TYPE_INSTANT = 3
+};
+
+/**
+ * What an event's ID refers to.
+ */
+enum trace_category {
+	TRACE_CAT_PERF = 1,		/**< ID is a performance counter ID */
+	TRACE_CAT_ORB_PUBLISH = 2,	/**< ID is a uORB topic ID */
+	TRACE_CAT_ORB_COPY = 3		/**< ID is a uORB topic ID */
+};
+
+struct trace_event {
+	uint64_t	timestamp;
+	uint16_t	id;
+	uint8_t		type;		/**< enum trace_event_type */
+	uint8_t		category;	/**< enum trace_category */
+	uint32_t	reserved;
+};
+
+/*
+ * A dump is a header followed by records.  TASK records name a task,
+ * NAME records name an ID within a category, and EVENTS records carry a
+ * task's events, oldest first.
+ */
+struct trace_file_header {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	event_size;	/**< sizeof(struct trace_event) */
+};
+
+enum trace_record_type {
+	TRACE_RECORD_TASK = 1,		/**< payload is the task name */
+	TRACE_RECORD_NAME = 2,		/**< payload is the name of an ID */
+	TRACE_RECORD_EVENTS = 3		/**< payload is an array of events */
+};
+
+struct trace_file_record {
+	uint8_t		type;		/**< enum trace_record_type */
+	uint8_t		category;	/**< NAME: enum trace_category */
+	uint16_t	id;		/**< TASK, EVENTS: task index; NAME: the ID */
+	uint32_t	len;		/**< payload bytes following */
+};
+
+__BEGIN_DECLS
+
+#ifdef PX4_TRACE
+
+__EXPORT extern volatile bool trace_enabled;
+
+/**
+ * Record an event for the calling task.
+ *
+ * Use the TRACE_* macros rather than calling this directly.
+ */
+__EXPORT extern void	trace_record(uint8_t type, uint8_t category, uint16_t id, uint64_t timestamp);
+
+# define TRACE_EVENT(_type, _category, _id, _timestamp)				\
+	do {									\
+		if (trace_enabled)						\
+			trace_record((_type), (_category), (_id), (_timestamp));	\
+	} while (0)
+
+#else
+
+# define TRACE_EVENT(_type, _category, _id, _timestamp)	do { } while (0)
+
+#endif
+
+/**
+ * Record the start of a span; the timestamp is only evaluated when tracing.
+ */
+#define TRACE_BEGIN(_category, _id, _timestamp)		TRACE_EVENT(TRACE_TYPE_BEGIN, _category, _id, _timestamp)
+
+/**
+ * Record the end of the span most recently begun by the calling task.
+ */
+#define TRACE_END(_category, _id, _timestamp)		TRACE_EVENT(TRACE_TYPE_END, _category, _id, _timestamp)
+
+/**
+ * Record a point event.
+ */
+#define TRACE_INSTANT(_category, _id, _timestamp)	TRACE_EVENT(TRACE_TYPE_INSTANT, _category, _id, _timestamp)
+
+/**
+ * Start tracing, discarding anything already traced.
+ *
+ * The rings are allocated by the first start and kept from then on,
+ * since a task may be recording at any time.
+ *
+ * @param events		Events held per task, rounded up to a power
+ *				of two; zero for the default.  Ignored after
+ *				the first start.
+ * @return			OK, or a negative errno.
+ */
+__EXPORT extern int	trace_start(unsigned events);
+
+/**
+ * Stop tracing, keeping what has been traced.
+ */
+__EXPORT extern void	trace_stop(void);
+
+/**
+ * Stop tracing and write what has been traced to a file.
+ *
+ * @param path			The file to create.
+ * @return			OK, or a negative errno.
+ */
+__EXPORT extern int	trace_dump(const char *path);
+
+/**
+ * Print the state of the tracer.
+ */
+__EXPORT extern void	trace_status(void);
+
+__END_DECLS
+
+#endif /* _SYSTEMLIB_TRACE_H */
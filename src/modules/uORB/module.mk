@@ -41,4 +41,7 @@ MODULE_COMMAND		= uorb
 MODULE_STACKSIZE	= 4096
 
 SRCS			= uORB.cpp \
-			  objects_common.cpp
+			  objects_common.cpp \
+			  timer_wheel.cpp \
+			  recorder.cpp \
+			  topic_list.cpp
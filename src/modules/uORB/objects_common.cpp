@@ -72,13 +72,13 @@ ORB_DEFINE(sensor_combined, struct sensor_combined_s);
 ORB_DEFINE(vehicle_gps_position, struct vehicle_gps_position_s);
 
 #include "topics/home_position.h"
-ORB_DEFINE(home_position, struct home_position_s);
+ORB_DEFINE_FIELDS(home_position, struct home_position_s, HOME_POSITION_FIELDS);
 
 #include "topics/vehicle_status.h"
 ORB_DEFINE(vehicle_status, struct vehicle_status_s);
 
 #include "topics/battery_status.h"
-ORB_DEFINE(battery_status, struct battery_status_s);
+ORB_DEFINE_FIELDS(battery_status, struct battery_status_s, BATTERY_STATUS_FIELDS);
 
 #include "topics/vehicle_global_position.h"
 ORB_DEFINE(vehicle_global_position, struct vehicle_global_position_s);
@@ -102,7 +102,7 @@ ORB_DEFINE(vehicle_command, struct vehicle_command_s);
 ORB_DEFINE(vehicle_local_position_setpoint, struct vehicle_local_position_setpoint_s);
 
 #include "topics/vehicle_bodyframe_speed_setpoint.h"
-ORB_DEFINE(vehicle_bodyframe_speed_setpoint, struct vehicle_bodyframe_speed_setpoint_s);
+ORB_DEFINE_FIELDS(vehicle_bodyframe_speed_setpoint, struct vehicle_bodyframe_speed_setpoint_s, VEHICLE_BODYFRAME_SPEED_SETPOINT_FIELDS);
 
 #include "topics/vehicle_global_position_setpoint.h"
 ORB_DEFINE(vehicle_global_position_setpoint, struct vehicle_global_position_setpoint_s);
@@ -117,7 +117,7 @@ ORB_DEFINE(mission, struct mission_s);
 ORB_DEFINE(vehicle_attitude_setpoint, struct vehicle_attitude_setpoint_s);
 
 #include "topics/manual_control_setpoint.h"
-ORB_DEFINE(manual_control_setpoint, struct manual_control_setpoint_s);
+ORB_DEFINE_FIELDS(manual_control_setpoint, struct manual_control_setpoint_s, MANUAL_CONTROL_SETPOINT_FIELDS);
 
 #include "topics/offboard_control_setpoint.h"
 ORB_DEFINE(offboard_control_setpoint, struct offboard_control_setpoint_s);
@@ -146,7 +146,7 @@ ORB_DEFINE(actuator_controls_0, struct actuator_controls_s);
 ORB_DEFINE(actuator_controls_1, struct actuator_controls_s);
 ORB_DEFINE(actuator_controls_2, struct actuator_controls_s);
 ORB_DEFINE(actuator_controls_3, struct actuator_controls_s);
-ORB_DEFINE(actuator_armed, struct actuator_armed_s);
+ORB_DEFINE_FIELDS(actuator_armed, struct actuator_armed_s, ACTUATOR_ARMED_FIELDS);
 
 /* actuator controls, as set by actuators / mixers after limiting */
 #include "topics/actuator_controls_effective.h"
@@ -162,13 +162,71 @@ ORB_DEFINE(actuator_outputs_2, struct actuator_outputs_s);
 ORB_DEFINE(actuator_outputs_3, struct actuator_outputs_s);
 
 #include "topics/telemetry_status.h"
-ORB_DEFINE(telemetry_status, struct telemetry_status_s);
+ORB_DEFINE_FIELDS(telemetry_status, struct telemetry_status_s, TELEMETRY_STATUS_FIELDS);
 
 #include "topics/debug_key_value.h"
-ORB_DEFINE(debug_key_value, struct debug_key_value_s);
+ORB_DEFINE_FIELDS(debug_key_value, struct debug_key_value_s, DEBUG_KEY_VALUE_FIELDS);
 
 #include "topics/navigation_capabilities.h"
-ORB_DEFINE(navigation_capabilities, struct navigation_capabilities_s);
+ORB_DEFINE_FIELDS(navigation_capabilities, struct navigation_capabilities_s, NAVIGATION_CAPABILITIES_FIELDS);
 
 #include "topics/esc_status.h"
 ORB_DEFINE(esc_status, struct esc_status_s);
+
+/*
+ * Table of the topics defined above, for tools that need to walk them.
+ */
+extern const struct orb_metadata *const orb_common_topics[];
+const struct orb_metadata *const orb_common_topics[] = {
+	ORB_ID(sensor_mag),
+	ORB_ID(sensor_accel),
+	ORB_ID(sensor_gyro),
+	ORB_ID(sensor_baro),
+	ORB_ID(sensor_range_finder),
+	ORB_ID(output_pwm),
+	ORB_ID(input_rc),
+	ORB_ID(vehicle_attitude),
+	ORB_ID(sensor_combined),
+	ORB_ID(vehicle_gps_position),
+	ORB_ID(home_position),
+	ORB_ID(vehicle_status),
+	ORB_ID(battery_status),
+	ORB_ID(vehicle_global_position),
+	ORB_ID(vehicle_local_position),
+	ORB_ID(vehicle_vicon_position),
+	ORB_ID(vehicle_rates_setpoint),
+	ORB_ID(rc_channels),
+	ORB_ID(vehicle_command),
+	ORB_ID(vehicle_local_position_setpoint),
+	ORB_ID(vehicle_bodyframe_speed_setpoint),
+	ORB_ID(vehicle_global_position_setpoint),
+	ORB_ID(vehicle_global_position_set_triplet),
+	ORB_ID(mission),
+	ORB_ID(vehicle_attitude_setpoint),
+	ORB_ID(manual_control_setpoint),
+	ORB_ID(offboard_control_setpoint),
+	ORB_ID(optical_flow),
+	ORB_ID(filtered_bottom_flow),
+	ORB_ID(omnidirectional_flow),
+	ORB_ID(airspeed),
+	ORB_ID(differential_pressure),
+	ORB_ID(subsystem_info),
+	ORB_ID(actuator_controls_0),
+	ORB_ID(actuator_controls_1),
+	ORB_ID(actuator_controls_2),
+	ORB_ID(actuator_controls_3),
+	ORB_ID(actuator_armed),
+	ORB_ID(actuator_controls_effective_0),
+	ORB_ID(actuator_controls_effective_1),
+	ORB_ID(actuator_controls_effective_2),
+	ORB_ID(actuator_controls_effective_3),
+	ORB_ID(actuator_outputs_0),
+	ORB_ID(actuator_outputs_1),
+	ORB_ID(actuator_outputs_2),
+	ORB_ID(actuator_outputs_3),
+	ORB_ID(telemetry_status),
+	ORB_ID(debug_key_value),
+	ORB_ID(navigation_capabilities),
+	ORB_ID(esc_status),
+	nullptr
+};
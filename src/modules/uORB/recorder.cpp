@@ -0,0 +1,432 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file recorder.cpp
+ *
+ * Recording and replay of uORB publications.
+ */
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+
+#include <arch/irq.h>
+
+#include <drivers/drv_orb_dev.h>
+
+#include "recorder.h"
+
+/* oddly, ERROR is not defined for c++ */
+#ifdef ERROR
+# undef ERROR
+#endif
+static const int ERROR = -1;
+
+Recorder *orb_recorder;
+
+namespace
+{
+
+/* how often the recorder thread writes out what is queued */
+const unsigned recorder_period = 10000;
+
+/* longest replay waits for a subscriber in lockstep mode before giving up on it */
+const hrt_abstime replay_lockstep_timeout = 20000;
+
+/* most topics and largest object a replay can handle */
+const unsigned replay_max_topics = 256;
+const unsigned replay_max_size = 1024;
+
+}
+
+Recorder::Recorder(unsigned buffer_size) :
+	_buffer(new uint8_t[buffer_size]),
+	_size(buffer_size),
+	_head(0),
+	_tail(0),
+	_fd(-1),
+	_running(false),
+	_records(0),
+	_dropped(0),
+	_written(0)
+{
+	memset(_announced, 0, sizeof(_announced));
+}
+
+Recorder::~Recorder()
+{
+	if (_running)
+		stop();
+
+	delete[] _buffer;
+}
+
+int
+Recorder::start(const char *path)
+{
+	struct orb_record_header header;
+	pthread_attr_t attr;
+	int ret;
+
+	if (_buffer == nullptr)
+		return -ENOMEM;
+
+	_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+	if (_fd < 0)
+		return -errno;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, ORB_RECORD_MAGIC, sizeof(header.magic));
+	header.version = ORB_RECORD_VERSION;
+
+	if (write(_fd, &header, sizeof(header)) != sizeof(header)) {
+		ret = -errno;
+		close(_fd);
+		_fd = -1;
+		return ret;
+	}
+
+	_written = sizeof(header);
+	_running = true;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, 2048);
+	ret = pthread_create(&_thread, &attr, thread_main, this);
+	pthread_attr_destroy(&attr);
+
+	if (ret != 0) {
+		_running = false;
+		close(_fd);
+		_fd = -1;
+		return -ret;
+	}
+
+	return OK;
+}
+
+void
+Recorder::stop()
+{
+	if (!_running)
+		return;
+
+	_running = false;
+	pthread_join(_thread, nullptr);
+
+	/* pick up anything queued after the thread's last pass */
+	drain();
+
+	close(_fd);
+	_fd = -1;
+}
+
+void
+Recorder::publication(const struct orb_metadata *meta, unsigned instance, const void *data, hrt_abstime timestamp)
+{
+	struct orb_record_item item;
+
+	if (meta->o_id >= ORB_TOPIC_COUNT)
+		return;
+
+	memset(&item, 0, sizeof(item));
+	item.id = meta->o_id;
+	item.instance = instance;
+
+	/* introduce the topic the first time it is seen */
+	if (!_announced[meta->o_id]) {
+		item.type = ORB_RECORD_TOPIC;
+		item.len = strlen(meta->o_name);
+
+		if (!queue(&item, meta->o_name)) {
+			_dropped++;
+			return;
+		}
+
+		_announced[meta->o_id] = true;
+	}
+
+	item.type = ORB_RECORD_DATA;
+	item.len = meta->o_size;
+	item.timestamp = timestamp;
+
+	if (queue(&item, data)) {
+		_records++;
+
+	} else {
+		_dropped++;
+	}
+}
+
+bool
+Recorder::queue(const struct orb_record_item *item, const void *payload)
+{
+	unsigned len = sizeof(*item) + item->len;
+
+	if ((_size - (_head - _tail)) < len)
+		return false;
+
+	copy_in(item, sizeof(*item));
+	copy_in(payload, item->len);
+
+	return true;
+}
+
+void
+Recorder::copy_in(const void *src, unsigned len)
+{
+	unsigned offset = _head % _size;
+	unsigned first = (len < (_size - offset)) ? len : (_size - offset);
+
+	memcpy(_buffer + offset, src, first);
+	memcpy(_buffer, (const uint8_t *)src + first, len - first);
+
+	_head += len;
+}
+
+void
+Recorder::drain()
+{
+	irqstate_t flags = irqsave();
+	unsigned head = _head;
+	irqrestore(flags);
+
+	while (_tail != head) {
+		unsigned offset = _tail % _size;
+		unsigned len = head - _tail;
+
+		/* write up to the end of the buffer, then from the start */
+		if (len > (_size - offset))
+			len = _size - offset;
+
+		ssize_t ret = write(_fd, _buffer + offset, len);
+
+		if (ret <= 0)
+			break;
+
+		_written += ret;
+
+		flags = irqsave();
+		_tail += ret;
+		irqrestore(flags);
+	}
+}
+
+void *
+Recorder::thread_main(void *arg)
+{
+	Recorder *r = (Recorder *)arg;
+
+	while (r->_running) {
+		r->drain();
+		usleep(recorder_period);
+	}
+
+	return nullptr;
+}
+
+namespace
+{
+
+/**
+ * Real time in microseconds, even while hrt_absolute_time() is virtual.
+ */
+hrt_abstime
+real_time()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts_to_abstime(&ts);
+}
+
+struct replay_topic {
+	const struct orb_metadata *meta;
+	orb_advert_t	advert[ORB_MULTI_MAX_INSTANCES];
+};
+
+}
+
+int
+orb_replay(const char *path, bool lockstep)
+{
+	struct orb_record_header header;
+	struct orb_record_item item;
+	struct replay_topic *topics;
+	uint8_t *payload;
+	unsigned publications = 0, skipped = 0, stalls = 0;
+	hrt_abstime first = 0, last = 0;
+	int ret = ERROR;
+
+	FILE *fp = fopen(path, "rb");
+
+	if (fp == nullptr) {
+		fprintf(stderr, "[uorb] can't open %s: %d\n", path, errno);
+		return ERROR;
+	}
+
+	topics = new replay_topic[replay_max_topics];
+	payload = new uint8_t[replay_max_size];
+
+	if ((topics == nullptr) || (payload == nullptr)) {
+		fprintf(stderr, "[uorb] no memory\n");
+		goto out;
+	}
+
+	memset(topics, 0, replay_max_topics * sizeof(*topics));
+
+	if ((fread(&header, sizeof(header), 1, fp) != 1) ||
+	    (memcmp(header.magic, ORB_RECORD_MAGIC, sizeof(header.magic)) != 0) ||
+	    (header.version != ORB_RECORD_VERSION)) {
+		fprintf(stderr, "[uorb] %s is not a recording\n", path);
+		goto out;
+	}
+
+	{
+		hrt_abstime start = real_time();
+
+		while (fread(&item, sizeof(item), 1, fp) == 1) {
+			if ((item.len > replay_max_size) ||
+			    (item.len > 0 && fread(payload, item.len, 1, fp) != 1)) {
+				fprintf(stderr, "[uorb] truncated record\n");
+				break;
+			}
+
+			if ((item.id >= replay_max_topics) || (item.instance >= ORB_MULTI_MAX_INSTANCES)) {
+				skipped++;
+				continue;
+			}
+
+			struct replay_topic *topic = &topics[item.id];
+
+			if (item.type == ORB_RECORD_TOPIC) {
+				char name[64];
+				unsigned len = (item.len < sizeof(name)) ? item.len : sizeof(name) - 1;
+
+				memcpy(name, payload, len);
+				name[len] = '\0';
+
+				topic->meta = orb_find_topic(name);
+
+				if (topic->meta == nullptr)
+					fprintf(stderr, "[uorb] skipping unknown topic %s\n", name);
+
+				continue;
+			}
+
+			/* skip topics this build doesn't know, or whose layout has changed */
+			if ((item.type != ORB_RECORD_DATA) ||
+			    (topic->meta == nullptr) ||
+			    (topic->meta->o_size != item.len)) {
+				skipped++;
+				continue;
+			}
+
+			if (first == 0)
+				first = item.timestamp;
+
+			last = item.timestamp;
+
+#ifdef __PX4_POSIX
+			hrt_set_virtual_time(item.timestamp);
+#else
+			/* keep to the recorded schedule, so subscribers see the recorded rates */
+			hrt_abstime due = start + ((item.timestamp > first) ? item.timestamp - first : 0);
+			hrt_abstime now = real_time();
+
+			if (due > now)
+				usleep(due - now);
+#endif
+
+			orb_advert_t *advert = &topic->advert[item.instance];
+
+			if (*advert == 0) {
+				*advert = orb_advertise_instance(topic->meta, payload, item.instance);
+
+				if (*advert == ERROR) {
+					fprintf(stderr, "[uorb] can't advertise %s\n", topic->meta->o_name);
+					*advert = 0;
+					skipped++;
+					continue;
+				}
+
+			} else {
+				orb_publish(topic->meta, *advert, payload);
+			}
+
+			publications++;
+
+			if (lockstep) {
+				hrt_abstime wait_start = real_time();
+
+				while (orb_lagging_subscribers(*advert) != 0) {
+					if ((real_time() - wait_start) > replay_lockstep_timeout) {
+						stalls++;
+						break;
+					}
+
+					sched_yield();
+				}
+			}
+		}
+
+		hrt_abstime elapsed = real_time() - start;
+
+		printf("replayed %u publications, %llums of data in %llums\n",
+		       publications, (last - first) / 1000, elapsed / 1000);
+
+		if (skipped > 0)
+			printf("skipped %u records\n", skipped);
+
+		if (stalls > 0)
+			printf("gave up waiting for subscribers %u times\n", stalls);
+
+		ret = OK;
+	}
+
+out:
+	fclose(fp);
+	delete[] topics;
+	delete[] payload;
+
+	return ret;
+}
@@ -0,0 +1,187 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file recorder.h
+ *
+ * Recording of every uORB publication to a file, and replay of the file
+ * through uORB.
+ *
+ * A recording is a header followed by records.  Each topic is introduced
+ * by a TOPIC record carrying its name; DATA records carry the publication
+ * time and the published object.  IDs are only meaningful within one
+ * recording, so a recording can be replayed by a different build.
+ */
+
+#ifndef _UORB_RECORDER_H
+#define _UORB_RECORDER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include <drivers/drv_hrt.h>
+
+#include "uORB.h"
+
+#define ORB_RECORD_MAGIC	"uORBrec"	/**< including the terminating NUL */
+#define ORB_RECORD_VERSION	1
+
+struct orb_record_header {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	reserved;
+};
+
+enum orb_record_type {
+	ORB_RECORD_TOPIC = 1,		/**< payload is the topic name */
+	ORB_RECORD_DATA = 2		/**< payload is the object */
+};
+
+struct orb_record_item {
+	uint64_t	timestamp;	/**< publication time; zero for TOPIC */
+	uint16_t	id;		/**< topic ID within the recording */
+	uint16_t	len;		/**< payload bytes following */
+	uint8_t		type;		/**< enum orb_record_type */
+	uint8_t		instance;	/**< multi-instance index */
+	uint8_t		reserved[2];
+};
+
+/**
+ * Writes publications to a recording.
+ *
+ * Publications are queued in a ring buffer from the publishing context,
+ * which may be an interrupt, and written out by a thread.  Publications
+ * that don't fit in the buffer are dropped and counted.
+ */
+class Recorder
+{
+public:
+	/**
+	 * @param buffer_size	Bytes of publications that can be queued.
+	 */
+	Recorder(unsigned buffer_size);
+	~Recorder();
+
+	/**
+	 * Create the recording and start writing it.
+	 *
+	 * @return		OK, or a negative errno.
+	 */
+	int			start(const char *path);
+
+	/**
+	 * Stop writing; what is queued is written before the file is closed.
+	 */
+	void			stop();
+
+	/**
+	 * Queue a publication.
+	 *
+	 * Must be called with interrupts disabled.
+	 */
+	void			publication(const struct orb_metadata *meta, unsigned instance,
+					    const void *data, hrt_abstime timestamp);
+
+	unsigned		records() { return _records; }
+	unsigned		dropped() { return _dropped; }
+	uint64_t		written() { return _written; }
+
+private:
+	uint8_t			*_buffer;
+	unsigned		_size;
+	volatile unsigned	_head;		/**< bytes queued, free-running */
+	volatile unsigned	_tail;		/**< bytes written, free-running */
+
+	int			_fd;
+	pthread_t		_thread;
+	volatile bool		_running;
+
+	bool			_announced[ORB_TOPIC_COUNT]; /**< TOPIC record queued */
+
+	unsigned		_records;
+	unsigned		_dropped;
+	uint64_t		_written;
+
+	/**
+	 * Queue one record; the whole record is queued or none of it.
+	 */
+	bool			queue(const struct orb_record_item *item, const void *payload);
+	void			copy_in(const void *src, unsigned len);
+
+	/**
+	 * Write out what is queued.
+	 */
+	void			drain();
+
+	static void		*thread_main(void *arg);
+};
+
+/**
+ * The active recorder, or nullptr; only changed with interrupts disabled.
+ */
+extern Recorder *orb_recorder;
+
+/**
+ * Replay a recording.
+ *
+ * On the POSIX host the clock is switched to virtual time, which follows
+ * the recording, so the replay runs as fast as the subscribers allow while
+ * subscribers see the recorded times.  On the target the clock can't be
+ * moved, so each publication is instead delayed to keep the recorded
+ * spacing from the first one, and the replay runs in real time.
+ *
+ * @param path		The recording.
+ * @param lockstep	If true, after each publication wait until every
+ *			subscriber to the topic has copied it.
+ * @return		OK, or ERROR if the recording could not be read.
+ */
+int	orb_replay(const char *path, bool lockstep);
+
+/*
+ * Support from uORB.cpp.
+ */
+
+/**
+ * Advertise a given instance of a topic.
+ */
+orb_advert_t	orb_advertise_instance(const struct orb_metadata *meta, const void *data, unsigned instance);
+
+/**
+ * Count subscribers that have not yet copied the latest publication.
+ *
+ * Rate-limited subscribers are not counted.
+ */
+unsigned	orb_lagging_subscribers(orb_advert_t handle);
+
+#endif /* _UORB_RECORDER_H */
@@ -0,0 +1,216 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file timer_wheel.cpp
+ *
+ * Hierarchical timer wheel driven by a single HRT callout.
+ */
+
+#include <nuttx/config.h>
+#include <nuttx/arch.h>
+
+#include <string.h>
+
+#include "timer_wheel.h"
+
+TimerWheel::TimerWheel(hrt_abstime tick, Expired expired, void *arg) :
+	_tick(tick),
+	_epoch(0),
+	_now(0),
+	_count(0),
+	_running(false),
+	_expired(expired),
+	_arg(arg)
+{
+	memset(&_call, 0, sizeof(_call));
+	memset(_inner, 0, sizeof(_inner));
+	memset(_outer, 0, sizeof(_outer));
+}
+
+TimerWheel::~TimerWheel()
+{
+	hrt_cancel(&_call);
+}
+
+void
+TimerWheel::arm(Entry *entry, hrt_abstime delay)
+{
+	irqstate_t flags = irqsave();
+
+	if (armed(entry))
+		remove(entry);
+
+	/* the wheel stands still while it is empty; start it turning again */
+	if (!_running) {
+		if (_epoch == 0)
+			_epoch = hrt_absolute_time();
+
+		_now = clock_tick();
+		hrt_call_every(&_call, _tick, _tick, &TimerWheel::tick_trampoline, this);
+		_running = true;
+	}
+
+	/* round up so that the timer never expires early */
+	unsigned expiry = (hrt_absolute_time() + delay - _epoch + _tick - 1) / _tick;
+
+	if ((int)(expiry - _now) <= 0)
+		expiry = _now + 1;
+
+	entry->expiry = expiry;
+	insert(entry);
+	_count++;
+
+	irqrestore(flags);
+}
+
+void
+TimerWheel::cancel(Entry *entry)
+{
+	irqstate_t flags = irqsave();
+
+	/* if this empties the wheel, it stops on the next tick */
+	if (armed(entry)) {
+		remove(entry);
+		_count--;
+	}
+
+	irqrestore(flags);
+}
+
+void
+TimerWheel::insert(Entry *entry)
+{
+	unsigned delta = entry->expiry - _now;
+	Entry **slot;
+
+	if (delta < _inner_slots) {
+		slot = &_inner[entry->expiry & (_inner_slots - 1)];
+
+	} else if (delta < (_inner_slots << _outer_bits)) {
+		slot = &_outer[(entry->expiry >> _inner_bits) & (_outer_slots - 1)];
+
+	} else {
+		/* beyond the outer wheel; park in its last slot and re-sort from there */
+		slot = &_outer[((_now >> _inner_bits) - 1) & (_outer_slots - 1)];
+	}
+
+	entry->next = *slot;
+
+	if (entry->next != nullptr)
+		entry->next->pprev = &entry->next;
+
+	entry->pprev = slot;
+	*slot = entry;
+}
+
+void
+TimerWheel::remove(Entry *entry)
+{
+	*entry->pprev = entry->next;
+
+	if (entry->next != nullptr)
+		entry->next->pprev = entry->pprev;
+
+	entry->next = nullptr;
+	entry->pprev = nullptr;
+}
+
+void
+TimerWheel::step(Entry **expired)
+{
+	_now++;
+
+	/* at the start of each turn of the inner wheel, refill it from the outer */
+	if ((_now & (_inner_slots - 1)) == 0) {
+		Entry *cascade = _outer[(_now >> _inner_bits) & (_outer_slots - 1)];
+
+		_outer[(_now >> _inner_bits) & (_outer_slots - 1)] = nullptr;
+
+		while (cascade != nullptr) {
+			Entry *entry = cascade;
+
+			cascade = entry->next;
+			entry->pprev = nullptr;
+
+			/* anything overdue expires on this tick */
+			if ((int)(entry->expiry - _now) < 0)
+				entry->expiry = _now;
+
+			insert(entry);
+		}
+	}
+
+	Entry **slot = &_inner[_now & (_inner_slots - 1)];
+
+	while (*slot != nullptr) {
+		Entry *entry = *slot;
+
+		remove(entry);
+		_count--;
+
+		entry->next = *expired;
+		*expired = entry;
+	}
+}
+
+void
+TimerWheel::tick()
+{
+	Entry *expired = nullptr;
+	unsigned now = clock_tick();
+
+	while ((int)(now - _now) > 0)
+		step(&expired);
+
+	if (expired != nullptr)
+		_expired(expired, _arg);
+
+	/*
+	 * Stop once nothing is armed.  This is only done here, after the
+	 * handler has had the chance to re-arm, because the HRT does not
+	 * allow a periodic call to be restarted from its own callout.
+	 */
+	if (_count == 0) {
+		hrt_cancel(&_call);
+		_running = false;
+	}
+}
+
+void
+TimerWheel::tick_trampoline(void *arg)
+{
+	TimerWheel *wheel = (TimerWheel *)arg;
+
+	wheel->tick();
+}
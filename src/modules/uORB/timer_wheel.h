@@ -0,0 +1,164 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file timer_wheel.h
+ *
+ * Hierarchical timer wheel driven by a single HRT callout.
+ *
+ * Many short timers can be armed and cancelled in constant time, and
+ * all timers that expire on a tick are handed back in one batch.
+ */
+
+#ifndef _UORB_TIMER_WHEEL_H
+#define _UORB_TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <drivers/drv_hrt.h>
+
+class TimerWheel
+{
+public:
+	/**
+	 * A timer; embed one in the object that is to be timed.
+	 *
+	 * Must be zeroed before first use.
+	 */
+	struct Entry {
+		Entry		*next;		/**< link in the slot, or the expired batch */
+		Entry		**pprev;	/**< link pointing at this entry while armed */
+		unsigned	expiry;		/**< tick on which the timer expires */
+		void		*arg;		/**< owner's data, not used by the wheel */
+	};
+
+	/**
+	 * Handler for expired timers.
+	 *
+	 * Called in the HRT callout context with the timers that expired on
+	 * one or more ticks, linked through Entry::next.  Each timer has
+	 * already been disarmed, and may be re-armed by the handler.
+	 */
+	typedef void	(*Expired)(Entry *expired, void *arg);
+
+	/**
+	 * @param tick		Tick length; timers expire within one tick
+	 *			after their deadline.
+	 * @param expired	Handler for expired timers.
+	 * @param arg		Passed to the handler.
+	 */
+	TimerWheel(hrt_abstime tick, Expired expired, void *arg);
+	~TimerWheel();
+
+	/**
+	 * Arm, or re-arm, a timer.
+	 *
+	 * Safe to call from interrupt context.
+	 *
+	 * @param entry		The timer.
+	 * @param delay		Time from now until it expires.
+	 */
+	void		arm(Entry *entry, hrt_abstime delay);
+
+	/**
+	 * Disarm a timer if it is armed.
+	 *
+	 * Safe to call from interrupt context.
+	 */
+	void		cancel(Entry *entry);
+
+	/**
+	 * Test whether a timer is armed.
+	 */
+	static bool	armed(const Entry *entry) { return entry->pprev != nullptr; }
+
+	/**
+	 * Number of timers currently armed.
+	 */
+	unsigned	count() const { return _count; }
+
+private:
+	/* the inner wheel covers _inner_slots ticks at one tick per slot */
+	static const unsigned	_inner_bits = 7;
+	static const unsigned	_inner_slots = 1 << _inner_bits;
+
+	/* the outer wheel covers _outer_slots turns of the inner wheel */
+	static const unsigned	_outer_bits = 6;
+	static const unsigned	_outer_slots = 1 << _outer_bits;
+
+	hrt_abstime		_tick;		/**< tick length */
+	hrt_abstime		_epoch;		/**< time of tick zero */
+	unsigned		_now;		/**< last tick processed */
+	unsigned		_count;		/**< timers armed */
+	bool			_running;	/**< true while the HRT call is ticking the wheel */
+	Expired			_expired;	/**< handler for expired timers */
+	void			*_arg;		/**< handler argument */
+	struct hrt_call		_call;		/**< ticks the wheel while timers are armed */
+
+	Entry			*_inner[_inner_slots];
+	Entry			*_outer[_outer_slots];
+
+	/**
+	 * Current tick according to the clock.
+	 */
+	unsigned		clock_tick() { return (hrt_absolute_time() - _epoch) / _tick; }
+
+	/**
+	 * Put an armed entry into the slot for its expiry.
+	 *
+	 * Must be called with interrupts disabled.
+	 */
+	void			insert(Entry *entry);
+
+	/**
+	 * Take an entry out of its slot.
+	 *
+	 * Must be called with interrupts disabled.
+	 */
+	void			remove(Entry *entry);
+
+	/**
+	 * Advance one tick, moving expired entries onto the expired list.
+	 */
+	void			step(Entry **expired);
+
+	/**
+	 * Catch up with the clock and deliver expired timers.
+	 */
+	void			tick();
+
+	static void		tick_trampoline(void *arg);
+};
+
+#endif /* _UORB_TIMER_WHEEL_H */
@@ -0,0 +1,57 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file topic_list.cpp
+ *
+ * Table of the metadata of every topic in topic_list.h, by topic ID.
+ *
+ * Topics are defined all over the tree, and a build need not include all
+ * of them, so the metadata is referenced weakly; a topic that is not
+ * linked in has a NULL entry.  Nothing else may be declared in this file,
+ * as a strong declaration of the metadata would make the reference strong.
+ */
+
+#include <nuttx/config.h>
+
+#include "uORB.h"
+
+#define ORB_TOPIC_WEAK(_name)	extern "C" const struct orb_metadata __orb_##_name __attribute__((weak));
+#define ORB_TOPIC_META(_name)	&__orb_##_name,
+
+ORB_TOPICS(ORB_TOPIC_WEAK)
+
+extern const struct orb_metadata *const orb_topics[ORB_TOPIC_COUNT];
+const struct orb_metadata *const orb_topics[ORB_TOPIC_COUNT] = {
+	ORB_TOPICS(ORB_TOPIC_META)
+};
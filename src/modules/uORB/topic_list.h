@@ -0,0 +1,124 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file topic_list.h
+ *
+ * The list of every topic known to the ORB.
+ *
+ * Each ORB_DEFINE() takes the ID named here for its topic, so a topic
+ * that is defined but not listed will not compile.  The ID indexes the
+ * ORB's table of nodes, so that a topic is found without a path lookup.
+ */
+
+#ifndef _UORB_TOPIC_LIST_H
+#define _UORB_TOPIC_LIST_H
+
+/**
+ * Apply _X to the name of every topic.
+ *
+ * Keep the topics grouped by where they are defined.
+ */
+#define ORB_TOPICS(_X)					\
+	/* objects_common.cpp */			\
+	_X(sensor_mag)					\
+	_X(sensor_accel)				\
+	_X(sensor_gyro)					\
+	_X(sensor_baro)					\
+	_X(sensor_range_finder)				\
+	_X(output_pwm)					\
+	_X(input_rc)					\
+	_X(vehicle_attitude)				\
+	_X(sensor_combined)				\
+	_X(vehicle_gps_position)			\
+	_X(home_position)				\
+	_X(vehicle_status)				\
+	_X(battery_status)				\
+	_X(vehicle_global_position)			\
+	_X(vehicle_local_position)			\
+	_X(vehicle_vicon_position)			\
+	_X(vehicle_rates_setpoint)			\
+	_X(rc_channels)					\
+	_X(vehicle_command)				\
+	_X(vehicle_local_position_setpoint)		\
+	_X(vehicle_bodyframe_speed_setpoint)		\
+	_X(vehicle_global_position_setpoint)		\
+	_X(vehicle_global_position_set_triplet)		\
+	_X(mission)					\
+	_X(vehicle_attitude_setpoint)			\
+	_X(manual_control_setpoint)			\
+	_X(offboard_control_setpoint)			\
+	_X(optical_flow)				\
+	_X(filtered_bottom_flow)			\
+	_X(omnidirectional_flow)			\
+	_X(airspeed)					\
+	_X(differential_pressure)			\
+	_X(subsystem_info)				\
+	_X(actuator_controls_0)				\
+	_X(actuator_controls_1)				\
+	_X(actuator_controls_2)				\
+	_X(actuator_controls_3)				\
+	_X(actuator_armed)				\
+	_X(actuator_controls_effective_0)		\
+	_X(actuator_controls_effective_1)		\
+	_X(actuator_controls_effective_2)		\
+	_X(actuator_controls_effective_3)		\
+	_X(actuator_outputs_0)				\
+	_X(actuator_outputs_1)				\
+	_X(actuator_outputs_2)				\
+	_X(actuator_outputs_3)				\
+	_X(telemetry_status)				\
+	_X(debug_key_value)				\
+	_X(navigation_capabilities)			\
+	_X(esc_status)					\
+	/* systemlib/param/param.c */			\
+	_X(parameter_update)				\
+	/* systemcmds/perf/perf_export.c */		\
+	_X(perf_counter)				\
+	/* uORB.cpp self-test and benchmarks */		\
+	_X(orb_test)					\
+	_X(orb_test_queue)				\
+	_X(orb_test_multi)				\
+	_X(orb_bench)
+
+#define ORB_TOPIC_ENUM(_name)	ORB_TOPIC_##_name,
+
+/**
+ * Topic IDs.
+ */
+enum orb_topic_id {
+	ORB_TOPICS(ORB_TOPIC_ENUM)
+	ORB_TOPIC_COUNT
+};
+
+#endif /* _UORB_TOPIC_LIST_H */
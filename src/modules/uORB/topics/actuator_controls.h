@@ -55,6 +55,8 @@
 struct actuator_controls_s {
 	uint64_t timestamp;
 	float	control[NUM_ACTUATOR_CONTROLS];
+	/* after the controls, which are copied as they are to actuator_controls_effective */
+	uint64_t sensor_timestamp;	/**< time of the gyro sample the controls are based on */
 };
 
 /* actuator control sets; this list can be expanded as more controllers emerge */
@@ -73,6 +75,14 @@ struct actuator_armed_s {
 	bool	lockdown;	/**< Set to true if actuators are forced to being disabled (due to emergency or HIL) */
 };
 
+/**
+ * Fields of struct actuator_armed_s, for ORB_DEFINE_FIELDS.
+ */
+#define ACTUATOR_ARMED_FIELDS(_F, _s)			\
+	_F(_s, armed, bool)				\
+	_F(_s, ready_to_arm, bool)			\
+	_F(_s, lockdown, bool)
+
 ORB_DECLARE(actuator_armed);
 
 #endif
\ No newline at end of file
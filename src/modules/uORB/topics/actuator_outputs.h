@@ -54,6 +54,7 @@
 
 struct actuator_outputs_s {
 	uint64_t timestamp;				/**< output timestamp in us since system boot */
+	uint64_t sensor_timestamp;			/**< time of the gyro sample the outputs are based on */
 	float	output[NUM_ACTUATOR_OUTPUTS];		/**< output data, in natural output units */
 	int noutputs;					/**< valid outputs */
 };
@@ -58,6 +58,15 @@ struct battery_status_s {
 	float		discharged_mah;		/**< Discharged amount in mAh, filtered, -1 if unknown	 */
 };
 
+/**
+ * Fields of struct battery_status_s, for ORB_DEFINE_FIELDS.
+ */
+#define BATTERY_STATUS_FIELDS(_F, _s)			\
+	_F(_s, timestamp, uint64_t)			\
+	_F(_s, voltage_v, float)			\
+	_F(_s, current_a, float)			\
+	_F(_s, discharged_mah, float)
+
 /**
  * @}
  */
@@ -65,6 +65,14 @@ struct debug_key_value_s {
 
 };
 
+/**
+ * Fields of struct debug_key_value_s, for ORB_DEFINE_FIELDS.
+ */
+#define DEBUG_KEY_VALUE_FIELDS(_F, _s)			\
+	_F(_s, timestamp_ms, uint32_t)			\
+	_F(_s, key, char)				\
+	_F(_s, value, float)
+
 /**
  * @}
  */
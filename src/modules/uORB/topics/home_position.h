@@ -67,6 +67,20 @@ struct home_position_s
 	float p_variance_m;               /**< position accuracy estimate m */
 };
 
+/**
+ * Fields of struct home_position_s, for ORB_DEFINE_FIELDS.
+ */
+#define HOME_POSITION_FIELDS(_F, _s)			\
+	_F(_s, timestamp, uint64_t)			\
+	_F(_s, time_gps_usec, uint64_t)			\
+	_F(_s, lat, int32_t)				\
+	_F(_s, lon, int32_t)				\
+	_F(_s, alt, int32_t)				\
+	_F(_s, eph_m, float)				\
+	_F(_s, epv_m, float)				\
+	_F(_s, s_variance_m_s, float)			\
+	_F(_s, p_variance_m, float)
+
 /**
  * @}
  */
@@ -78,6 +78,28 @@ struct manual_control_setpoint_s {
 
 }; /**< manual control inputs */
 
+/**
+ * Fields of struct manual_control_setpoint_s, for ORB_DEFINE_FIELDS.
+ */
+#define MANUAL_CONTROL_SETPOINT_FIELDS(_F, _s)		\
+	_F(_s, timestamp, uint64_t)			\
+	_F(_s, roll, float)				\
+	_F(_s, pitch, float)				\
+	_F(_s, yaw, float)				\
+	_F(_s, throttle, float)				\
+	_F(_s, manual_override_switch, float)		\
+	_F(_s, auto_mode_switch, float)			\
+	_F(_s, manual_mode_switch, float)		\
+	_F(_s, manual_sas_switch, float)		\
+	_F(_s, return_to_launch_switch, float)		\
+	_F(_s, auto_offboard_input_switch, float)	\
+	_F(_s, flaps, float)				\
+	_F(_s, aux1, float)				\
+	_F(_s, aux2, float)				\
+	_F(_s, aux3, float)				\
+	_F(_s, aux4, float)				\
+	_F(_s, aux5, float)
+
 /**
  * @}
  */
@@ -55,6 +55,12 @@ struct navigation_capabilities_s {
     float turn_distance;    /**< the optimal distance to a waypoint to switch to the next */
 };
 
+/**
+ * Fields of struct navigation_capabilities_s, for ORB_DEFINE_FIELDS.
+ */
+#define NAVIGATION_CAPABILITIES_FIELDS(_F, _s)		\
+	_F(_s, turn_distance, float)
+
 /**
  * @}
  */
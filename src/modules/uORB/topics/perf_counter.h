@@ -0,0 +1,87 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file perf_counter.h
+ * Snapshot of a performance counter.
+ *
+ * The exporter publishes one snapshot per counter, in batches, on a
+ * queued topic; subscribers should drain the queue.
+ */
+
+#ifndef TOPIC_PERF_COUNTER_H
+#define TOPIC_PERF_COUNTER_H
+
+#include <stdint.h>
+#include "../uORB.h"
+
+/** longest counter name carried, including the terminator */
+#define PERF_COUNTER_NAME_LEN	48
+
+/** publications kept for subscribers */
+#define PERF_COUNTER_QUEUE_SIZE	16
+
+struct perf_counter_s {
+	/** time the snapshot was taken */
+	uint64_t	timestamp;
+
+	/** number of events counted */
+	uint64_t	event_count;
+
+	/** total time in events (PC_ELAPSED, PC_HISTOGRAM) or from the first to the last event (PC_INTERVAL), in microseconds */
+	uint64_t	time_total;
+
+	/** shortest and longest event or interval, in microseconds */
+	uint32_t	time_least;
+	uint32_t	time_most;
+
+	/** 50th, 90th, 99th and 99.9th percentile event times for PC_HISTOGRAM, in microseconds */
+	uint32_t	percentile[4];
+
+	/** PC_HISTOGRAM events too long for its buckets (16s or more); the percentiles can't see into them */
+	uint32_t	overflow;
+
+	/** identifies the counter; unique for as long as the system runs */
+	uint16_t	id;
+
+	/** counter type, an enum perf_counter_type */
+	uint8_t		type;
+
+	/** counter name, possibly truncated */
+	char		name[PERF_COUNTER_NAME_LEN];
+};
+
+ORB_DECLARE(perf_counter);
+
+#endif
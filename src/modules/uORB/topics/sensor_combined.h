@@ -78,6 +78,7 @@ struct sensor_combined_s {
 	/* NOTE: Ordering of fields optimized to align to 32 bit / 4 bytes Change with consideration only   */
 
 	uint64_t timestamp;			/**< Timestamp in microseconds since boot         */
+	uint64_t sensor_timestamp;		/**< Time the primary gyro sample was taken       */
 
 	int16_t	gyro_raw[3];			/**< Raw sensor values of angular velocity        */
 	uint16_t gyro_counter;			/**< Number of raw measurments taken              */
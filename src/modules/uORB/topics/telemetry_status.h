@@ -52,7 +52,7 @@ enum TELEMETRY_STATUS_RADIO_TYPE {
 
 struct telemetry_status_s {
 	uint64_t timestamp;
-    enum TELEMETRY_STATUS_RADIO_TYPE type;  /**< type of the radio hardware     */
+	uint8_t type;               /**< type of the radio hardware, enum TELEMETRY_STATUS_RADIO_TYPE */
 	unsigned rssi;              /**< local signal strength                      */
     unsigned remote_rssi;       /**< remote signal strength                     */
     unsigned rxerrors;          /**< receive errors                             */
@@ -62,6 +62,20 @@ struct telemetry_status_s {
     uint8_t txbuf;              /**< how full the tx buffer is as a percentage  */
 };
 
+/**
+ * Fields of struct telemetry_status_s, for ORB_DEFINE_FIELDS.
+ */
+#define TELEMETRY_STATUS_FIELDS(_F, _s)			\
+	_F(_s, timestamp, uint64_t)			\
+	_F(_s, type, uint8_t)				\
+	_F(_s, rssi, uint32_t)				\
+	_F(_s, remote_rssi, uint32_t)			\
+	_F(_s, rxerrors, uint32_t)			\
+	_F(_s, fixed, uint32_t)				\
+	_F(_s, noise, uint8_t)				\
+	_F(_s, remote_noise, uint8_t)			\
+	_F(_s, txbuf, uint8_t)
+
 ORB_DECLARE(telemetry_status);
 
 #endif /* TOPIC_TELEMETRY_STATUS_H */
\ No newline at end of file
@@ -58,6 +58,7 @@
 struct vehicle_attitude_s {
 
 	uint64_t timestamp;	/**< in microseconds since system start          */
+	uint64_t sensor_timestamp; /**< time of the gyro sample the estimate is based on */
 
 	/* This is similar to the mavlink message ATTITUDE, but for onboard use */
 
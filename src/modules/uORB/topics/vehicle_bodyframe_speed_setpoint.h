@@ -59,6 +59,16 @@ struct vehicle_bodyframe_speed_setpoint_s
 	float yaw_sp;	/**< in radian		-PI +PI		*/
 }; /**< Speed in bodyframe to go to */
 
+/**
+ * Fields of struct vehicle_bodyframe_speed_setpoint_s, for ORB_DEFINE_FIELDS.
+ */
+#define VEHICLE_BODYFRAME_SPEED_SETPOINT_FIELDS(_F, _s)	\
+	_F(_s, timestamp, uint64_t)			\
+	_F(_s, vx, float)				\
+	_F(_s, vy, float)				\
+	_F(_s, thrust_sp, float)			\
+	_F(_s, yaw_sp, float)
+
 /**
  * @}
  */
@@ -49,8 +49,10 @@
 #include <poll.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <math.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include <nuttx/arch.h>
 #include <nuttx/wqueue.h>
@@ -60,7 +62,12 @@
 
 #include <drivers/drv_orb_dev.h>
 
+#include <systemlib/perf_counter.h>
+#include <systemlib/trace.h>
+
 #include "uORB.h"
+#include "timer_wheel.h"
+#include "recorder.h"
 
 /**
  * Utility functions.
@@ -82,13 +89,24 @@ enum Flavor {
 };
 
 int
-node_mkpath(char *buf, Flavor f, const struct orb_metadata *meta)
+node_mkpath(char *buf, Flavor f, const struct orb_metadata *meta, unsigned instance)
 {
 	unsigned len;
 
-	len = snprintf(buf, orb_maxpath, "/%s/%s",
-		       (f == PUBSUB) ? "obj" : "param",
-		       meta->o_name);
+	if (instance >= ORB_MULTI_MAX_INSTANCES)
+		return -EINVAL;
+
+	/* instance 0 keeps the plain name, so single-instance users are unaffected */
+	if (instance == 0) {
+		len = snprintf(buf, orb_maxpath, "/%s/%s",
+			       (f == PUBSUB) ? "obj" : "param",
+			       meta->o_name);
+
+	} else {
+		len = snprintf(buf, orb_maxpath, "/%s/%s%u",
+			       (f == PUBSUB) ? "obj" : "param",
+			       meta->o_name, instance);
+	}
 
 	if (len >= orb_maxpath)
 		return -ENAMETOOLONG;
@@ -96,6 +114,56 @@ node_mkpath(char *buf, Flavor f, const struct orb_metadata *meta)
 	return OK;
 }
 
+#define ORB_TOPIC_PATH(_name)	"/obj/" #_name,
+
+/**
+ * Paths to the instance 0 nodes, by topic ID.
+ */
+const char *const node_paths[ORB_TOPIC_COUNT] = {
+	ORB_TOPICS(ORB_TOPIC_PATH)
+};
+
+/**
+ * Find the path to a node.
+ *
+ * Instance 0 publish/subscribe paths come from node_paths; anything else
+ * is built in buf.
+ *
+ * @return		The path, or nullptr with errno set on error.
+ */
+const char *
+node_path(char *buf, Flavor f, const struct orb_metadata *meta, unsigned instance)
+{
+	int ret;
+
+	if (meta->o_id >= ORB_TOPIC_COUNT) {
+		errno = ENOENT;
+		return nullptr;
+	}
+
+	if ((f == PUBSUB) && (instance == 0))
+		return node_paths[meta->o_id];
+
+	ret = node_mkpath(buf, f, meta, instance);
+
+	if (ret != OK) {
+		errno = -ret;
+		return nullptr;
+	}
+
+	return buf;
+}
+
+/**
+ * Full memory barrier, ordering the seqlock sequence accesses against
+ * the accesses to the object data.
+ */
+inline void
+orb_barrier()
+{
+	__sync_synchronize();
+}
+
 }
 
 /**
@@ -104,7 +172,40 @@ node_mkpath(char *buf, Flavor f, const struct orb_metadata *meta)
 class ORBDevNode : public device::CDev
 {
 public:
-	ORBDevNode(const struct orb_metadata *meta, const char *name, const char *path);
+	struct SubscriberData {
+		SubscriberData	*next;		/**< link in the node's list of subscribers */
+		unsigned	generation;	/**< last generation the subscriber has seen */
+		unsigned	update_interval; /**< if nonzero minimum interval between updates */
+		TimerWheel::Entry update_timer;	/**< running while a rate-limited subscriber must not see updates */
+		void		*poll_priv;	/**< saved copy of fds->f_priv while poll is active */
+		bool		update_reported; /**< true if we have reported the update via poll/check */
+		pid_t		pid;		/**< task that opened the subscription */
+		unsigned	lost;		/**< updates overwritten before this subscriber copied them */
+	};
+
+	/**
+	 * Usage statistics for one subscriber.
+	 */
+	struct SubscriberStats {
+		pid_t		pid;		/**< task that opened the subscription */
+		unsigned	update_interval; /**< minimum interval between updates, or zero */
+		unsigned	lost;		/**< updates overwritten before the subscriber copied them */
+	};
+
+	/**
+	 * Usage statistics for a node.
+	 */
+	struct Stats {
+		unsigned	instance;	/**< multi-instance index */
+		unsigned	subscribers;	/**< open subscriptions */
+		unsigned	publications;	/**< objects published */
+		unsigned	copies;		/**< reads and peeks by subscribers */
+		uint64_t	bytes_copied;	/**< bytes read out by subscribers */
+		unsigned	lost;		/**< updates overwritten before a subscriber copied them */
+		hrt_abstime	latency_max;	/**< longest publish-to-copy time seen */
+	};
+
+	ORBDevNode(const struct orb_metadata *meta, const char *name, const char *path, unsigned instance);
 	~ORBDevNode();
 
 	virtual int		open(struct file *filp);
@@ -115,24 +216,127 @@ public:
 
 	static ssize_t		publish(const orb_metadata *meta, orb_advert_t handle, const void *data);
 
+	/**
+	 * Borrow the spare slot for the publisher to fill in place.
+	 *
+	 * @return		The slot, or nullptr with errno set on error.
+	 */
+	static void		*publish_begin(const orb_metadata *meta, orb_advert_t handle);
+
+	/**
+	 * Publish the slot returned by publish_begin.
+	 *
+	 * @return		OK, or ERROR with errno set on error.
+	 */
+	static int		publish_commit(const orb_metadata *meta, orb_advert_t handle);
+
+	/**
+	 * Consume the object on behalf of a subscriber without copying it.
+	 *
+	 * @param sd		The subscriber doing the read.
+	 * @return		Pointer to the object, or nullptr if the object
+	 *			has not been written yet.
+	 */
+	const void		*peek_subscriber(SubscriberData *sd);
+
+	/**
+	 * Read the object on behalf of a subscriber.
+	 *
+	 * This implements read() for file handles, and is called directly
+	 * for direct-call subscriptions.
+	 *
+	 * @param sd		The subscriber doing the read.
+	 * @param buffer	As for read().
+	 * @param buflen	As for read().
+	 * @return		As for read().
+	 */
+	ssize_t			read_subscriber(SubscriberData *sd, char *buffer, size_t buflen);
+
+	/**
+	 * Check whether a topic appears updated to a subscriber.
+	 *
+	 * @param sd		The subscriber for whom to check.
+	 * @return		True if the topic should appear updated to the subscriber
+	 */
+	bool			appears_updated(SubscriberData *sd);
+
+	/**
+	 * Fetch a snapshot of the usage statistics.
+	 *
+	 * The counters are updated without locking, so they are approximate
+	 * while the node is busy.
+	 */
+	void			stats(Stats *s);
+
+	/**
+	 * Fetch the usage statistics of the node's subscribers.
+	 *
+	 * @param subs		Array to fill in.
+	 * @param max		Number of entries in subs.
+	 * @return		The number of subscribers, which may exceed max.
+	 */
+	unsigned		subscriber_stats(SubscriberStats *subs, unsigned max);
+
+	const struct orb_metadata *meta() { return _meta; }
+
+	/**
+	 * True once the object has been written.
+	 */
+	bool			published() { return _last_update != 0; }
+
+	/**
+	 * Count subscribers that have not copied the latest object.
+	 *
+	 * Rate-limited subscribers are not counted.
+	 */
+	unsigned		lagging();
+
+	/**
+	 * The next node created by the master, or nullptr.
+	 */
+	ORBDevNode		*next() { return _next; }
+
+	/**
+	 * Handle expired rate-limit timers.
+	 *
+	 * Performs the deferred update once for each node that has one or more
+	 * subscribers whose interval has expired.
+	 *
+	 * @param expired	The expired timers, whose arg is the node.
+	 * @param arg		Unused.
+	 */
+	static void		rate_limit_expired(TimerWheel::Entry *expired, void *arg);
+
 protected:
 	virtual pollevent_t	poll_state(struct file *filp);
-	virtual void		poll_notify_one(struct pollfd *fds, pollevent_t events);
+	virtual void		poll_notify_one(px4_pollfd_struct_t *fds, pollevent_t events);
 
 private:
-	struct SubscriberData {
-		unsigned	generation;	/**< last generation the subscriber has seen */
-		unsigned	update_interval; /**< if nonzero minimum interval between updates */
-		struct hrt_call	update_call;	/**< deferred wakeup call if update_period is nonzero */
-		void		*poll_priv;	/**< saved copy of fds->f_priv while poll is active */
-		bool		update_reported; /**< true if we have reported the update via poll/check */
-	};
-
 	const struct orb_metadata *_meta;	/**< object metadata information */
 	uint8_t			*_data;		/**< allocated object buffer */
+	hrt_abstime		*_published;	/**< publication time of the object in each slot */
+	unsigned		_queue_size;	/**< number of objects retained for subscribers */
+	unsigned		_slots;		/**< number of objects in _data, a power of two greater than _queue_size */
 	hrt_abstime		_last_update;	/**< time the object was last updated */
 	volatile unsigned 	_generation;	/**< object generation count */
+	volatile unsigned	_seq;		/**< seqlock sequence, odd while a write is in progress */
 	pid_t			_publisher;	/**< if nonzero, current publisher */
+	bool			_claimed;	/**< if true, a multi-instance advertiser owns this instance */
+	unsigned		_instance;	/**< multi-instance index */
+	ORBDevNode		*_next;		/**< link in the master's list of nodes */
+	SubscriberData		*_subscribers;	/**< open subscriptions, protected by lock() */
+
+	/* statistics */
+	unsigned		_subscriber_count; /**< open subscriptions */
+	unsigned		_copies;	/**< reads and peeks by subscribers */
+	uint64_t		_bytes_copied;	/**< bytes read out by subscribers */
+	unsigned		_lost;		/**< updates overwritten before a subscriber copied them, in total */
+	hrt_abstime		_latency_max;	/**< longest publish-to-copy time seen */
+
+	ORBDevNode		*_deferred_next; /**< link in a batch of deferred updates */
+	bool			_deferred_pending; /**< true while in a batch */
+
+	friend class ORBDevMaster;
 
 	SubscriberData		*filp_to_sd(struct file *filp) {
 		SubscriberData *sd = (SubscriberData *)(filp->f_priv);
@@ -140,33 +344,109 @@ private:
 	}
 
 	/**
-	 * Perform a deferred update for a rate-limited subscriber.
+	 * Find the queue slot holding an object.
+	 *
+	 * @param generation	The object generation count before the object
+	 *			was written.
 	 */
-	void			update_deferred();
+	uint8_t			*slot(unsigned generation) {
+		return _data + (generation & (_slots - 1)) * _meta->o_size;
+	}
 
 	/**
-	 * Bridge from hrt_call to update_deferred
+	 * Make the object in slot(_generation) visible to subscribers.
 	 *
-	 * void *arg		ORBDevNode pointer for which the deferred update is performed.
+	 * Must be called with interrupts disabled.
 	 */
-	static void		update_deferred_trampoline(void *arg);
+	void			advance_generation();
 
 	/**
-	 * Check whether a topic appears updated to a subscriber.
+	 * Copy objects out without blocking the writer.
 	 *
-	 * @param sd		The subscriber for whom to check.
-	 * @return		True if the topic should appear updated to the subscriber
+	 * Copies the oldest objects that the subscriber has not yet seen and
+	 * that are still queued, or the most recent object if there are none.
+	 * The copy is retried until it has been made without a write
+	 * overlapping it.
+	 *
+	 * @param buffer	Buffer to copy the objects into, or nullptr if
+	 *			only the generation is wanted.
+	 * @param generation	The last generation the subscriber has seen.
+	 * @param count		On entry, the number of objects that will fit
+	 *			in the buffer; on return, the number copied.
+	 * @param published	On return, the publication time of the oldest
+	 *			object copied.
+	 * @return		The generation the subscriber has now seen.
 	 */
-	bool			appears_updated(SubscriberData *sd);
+	unsigned		read_consistent(void *buffer, unsigned generation, unsigned *count, hrt_abstime *published);
+
+	/**
+	 * Account for a subscriber read in the statistics.
+	 *
+	 * @param sd		The subscriber that read.
+	 * @param previous	The generation the subscriber had seen before the read.
+	 * @param count		The number of objects returned.
+	 * @param bytes		The number of bytes copied out.
+	 * @param published	The publication time of the oldest object returned.
+	 */
+	void			account_copy(SubscriberData *sd, unsigned previous, unsigned count, size_t bytes,
+					     hrt_abstime published);
+
+	/**
+	 * Perform a deferred update for a rate-limited subscriber.
+	 */
+	void			update_deferred();
+
+};
+
+namespace
+{
+
+/*
+ * Rate-limit timers for every subscriber share one wheel; created by
+ * 'uorb start'.
+ */
+TimerWheel		*rate_limit_wheel;
+
+/* rate-limit timer resolution; intervals are set in milliseconds */
+const hrt_abstime	rate_limit_tick = 1000;
+
+}
+
+/**
+ * Direct-call subscription handle.
+ *
+ * Refers straight to the node and to the subscriber state belonging to
+ * the file descriptor opened for the subscription, so that copy and check
+ * are plain calls while the descriptor remains usable with poll().
+ */
+struct orb_subscription {
+	ORBDevNode			*node;	/**< the subscribed node */
+	ORBDevNode::SubscriberData	*sd;	/**< subscriber state owned by fd */
+	int				fd;	/**< subscription file descriptor */
 };
 
-ORBDevNode::ORBDevNode(const struct orb_metadata *meta, const char *name, const char *path) :
+ORBDevNode::ORBDevNode(const struct orb_metadata *meta, const char *name, const char *path, unsigned instance) :
 	CDev(name, path),
 	_meta(meta),
 	_data(nullptr),
+	_published(nullptr),
+	_queue_size(1),
+	_slots(2),
 	_last_update(0),
 	_generation(0),
-	_publisher(0)
+	_seq(0),
+	_publisher(0),
+	_claimed(false),
+	_instance(instance),
+	_next(nullptr),
+	_subscribers(nullptr),
+	_subscriber_count(0),
+	_copies(0),
+	_bytes_copied(0),
+	_lost(0),
+	_latency_max(0),
+	_deferred_next(nullptr),
+	_deferred_pending(false)
 {
 	// enable debug() calls
 	_debug_enabled = true;
@@ -176,6 +456,9 @@ ORBDevNode::~ORBDevNode()
 {
 	if (_data != nullptr)
 		delete[] _data;
+
+	if (_published != nullptr)
+		delete[] _published;
 }
 
 int
@@ -221,6 +504,8 @@ ORBDevNode::open(struct file *filp)
 			return -ENOMEM;
 
 		memset(sd, 0, sizeof(*sd));
+		sd->update_timer.arg = (void *)this;
+		sd->pid = getpid();
 
 		/* default to no pending update */
 		sd->generation = _generation;
@@ -229,8 +514,16 @@ ORBDevNode::open(struct file *filp)
 
 		ret = CDev::open(filp);
 
-		if (ret != OK)
-			free(sd);
+		if (ret != OK) {
+			delete sd;
+
+		} else {
+			lock();
+			sd->next = _subscribers;
+			_subscribers = sd;
+			_subscriber_count++;
+			unlock();
+		}
 
 		return ret;
 	}
@@ -242,15 +535,34 @@ ORBDevNode::open(struct file *filp)
 int
 ORBDevNode::close(struct file *filp)
 {
-	/* is this the publisher closing? */
-	if (getpid() == _publisher) {
+	/*
+	 * Is this the publisher closing?  Judge by how the file was opened;
+	 * subscribers may share the publisher's pid.
+	 */
+	if (filp->f_oflags == O_WRONLY) {
 		_publisher = 0;
 
 	} else {
 		SubscriberData *sd = filp_to_sd(filp);
 
-		if (sd != nullptr)
+		if (sd != nullptr) {
+			/* a rate-limited subscriber may still have its interval timer running */
+			rate_limit_wheel->cancel(&sd->update_timer);
+
+			lock();
+
+			for (SubscriberData **p = &_subscribers; *p != nullptr; p = &(*p)->next) {
+				if (*p == sd) {
+					*p = sd->next;
+					break;
+				}
+			}
+
+			_subscriber_count--;
+			unlock();
+
 			delete sd;
+		}
 	}
 
 	return CDev::close(filp);
@@ -259,27 +571,30 @@ ORBDevNode::close(struct file *filp)
 ssize_t
 ORBDevNode::read(struct file *filp, char *buffer, size_t buflen)
 {
-	SubscriberData *sd = (SubscriberData *)filp_to_sd(filp);
+	return read_subscriber(filp_to_sd(filp), buffer, buflen);
+}
 
+ssize_t
+ORBDevNode::read_subscriber(SubscriberData *sd, char *buffer, size_t buflen)
+{
 	/* if the object has not been written yet, return zero */
 	if (_data == nullptr)
 		return 0;
 
-	/* if the caller's buffer is the wrong size, that's an error */
-	if (buflen != _meta->o_size)
+	/* if the caller's buffer is not a whole number of objects, that's an error */
+	if ((buflen < _meta->o_size) || ((buflen % _meta->o_size) != 0))
 		return -EIO;
 
+	unsigned count = buflen / _meta->o_size;
+	unsigned previous = sd->generation;
+	hrt_abstime published;
+
 	/*
-	 * Perform an atomic copy & state update
+	 * Copy the data out and track the last generation that the file has seen.
+	 * If the caller doesn't want the data, don't give it to them.
 	 */
-	irqstate_t flags = irqsave();
-
-	/* if the caller doesn't want the data, don't give it to them */
-	if (nullptr != buffer)
-		memcpy(buffer, _data, _meta->o_size);
-
-	/* track the last generation that the file has seen */
-	sd->generation = _generation;
+	sd->generation = read_consistent(buffer, sd->generation, &count, &published);
+	account_copy(sd, previous, count, (buffer != nullptr) ? count * _meta->o_size : 0, published);
 
 	/*
 	 * Clear the flag that indicates that an update has been reported, as
@@ -287,9 +602,150 @@ ORBDevNode::read(struct file *filp, char *buffer, size_t buflen)
 	 */
 	sd->update_reported = false;
 
-	irqrestore(flags);
+	return count * _meta->o_size;
+}
 
-	return _meta->o_size;
+const void *
+ORBDevNode::peek_subscriber(SubscriberData *sd)
+{
+	unsigned count = 1;
+	unsigned previous = sd->generation;
+	hrt_abstime published;
+
+	/* if the object has not been written yet, there is nothing to see */
+	if (_data == nullptr)
+		return nullptr;
+
+	sd->generation = read_consistent(nullptr, sd->generation, &count, &published);
+	sd->update_reported = false;
+	account_copy(sd, previous, count, 0, published);
+
+	return slot(sd->generation - 1);
+}
+
+unsigned
+ORBDevNode::read_consistent(void *buffer, unsigned generation, unsigned *count, hrt_abstime *published)
+{
+	unsigned seq, first, n;
+
+	for (;;) {
+		seq = _seq;
+
+		/* a write is in progress on another CPU; wait for it to finish */
+		if (seq & 1)
+			continue;
+
+		orb_barrier();
+
+		unsigned current = _generation;
+
+		/* skip anything that has already been overwritten */
+		first = generation;
+
+		if ((current - first) > _queue_size)
+			first = current - _queue_size;
+
+		n = current - first;
+
+		/* nothing new, so hand back the most recent object again */
+		if (n == 0) {
+			first = current - 1;
+			n = 1;
+		}
+
+		if (n > *count)
+			n = *count;
+
+		if (nullptr != buffer) {
+			for (unsigned i = 0; i < n; i++)
+				memcpy((uint8_t *)buffer + i * _meta->o_size, slot(first + i), _meta->o_size);
+		}
+
+		*published = _published[first & (_slots - 1)];
+
+		orb_barrier();
+
+		/* if no write overlapped the copy, it is consistent */
+		if (seq == _seq)
+			break;
+	}
+
+	*count = n;
+	return first + n;
+}
+
+void
+ORBDevNode::account_copy(SubscriberData *sd, unsigned previous, unsigned count, size_t bytes,
+			 hrt_abstime published)
+{
+	_copies++;
+	_bytes_copied += bytes;
+
+	/* nothing new; the subscriber was handed the latest object again */
+	if (sd->generation == previous)
+		return;
+
+	/* anything the subscriber moved past without copying was overwritten */
+	unsigned lost = (sd->generation - previous) - count;
+
+	sd->lost += lost;
+	_lost += lost;
+
+	/* the oldest object copied has waited longest */
+	hrt_abstime now = hrt_absolute_time();
+
+	if ((now > published) && ((now - published) > _latency_max))
+		_latency_max = now - published;
+}
+
+unsigned
+ORBDevNode::lagging()
+{
+	unsigned count = 0;
+
+	lock();
+
+	for (SubscriberData *sd = _subscribers; sd != nullptr; sd = sd->next)
+		if ((sd->update_interval == 0) && (sd->generation != _generation))
+			count++;
+
+	unlock();
+
+	return count;
+}
+
+void
+ORBDevNode::stats(Stats *s)
+{
+	s->instance = _instance;
+	s->subscribers = _subscriber_count;
+	s->publications = _generation;
+	s->copies = _copies;
+	s->bytes_copied = _bytes_copied;
+	s->lost = _lost;
+	s->latency_max = _latency_max;
+}
+
+unsigned
+ORBDevNode::subscriber_stats(SubscriberStats *subs, unsigned max)
+{
+	unsigned count = 0;
+
+	lock();
+
+	for (SubscriberData *sd = _subscribers; sd != nullptr; sd = sd->next) {
+		if (count < max) {
+			subs[count].pid = sd->pid;
+			subs[count].update_interval = sd->update_interval;
+			subs[count].lost = sd->lost;
+		}
+
+		count++;
+	}
+
+	unlock();
+
+	return count;
 }
 
 ssize_t
@@ -310,8 +766,12 @@ ORBDevNode::write(struct file *filp, const char *buffer, size_t buflen)
 			lock();
 
 			/* re-check size */
-			if (nullptr == _data)
-				_data = new uint8_t[_meta->o_size];
+			if (nullptr == _data) {
+				_published = new hrt_abstime[_slots];
+
+				if (nullptr != _published)
+					_data = new uint8_t[_meta->o_size * _slots];
+			}
 
 			unlock();
 		}
@@ -325,21 +785,45 @@ ORBDevNode::write(struct file *filp, const char *buffer, size_t buflen)
 	if (_meta->o_size != buflen)
 		return -EIO;
 
-	/* Perform an atomic copy. */
+	/*
+	 * Copy into the spare slot, which no subscriber can be reading, then
+	 * publish it under the seqlock.
+	 *
+	 * Readers never block; they retry if the sequence moves during their copy.
+	 * Writers may come from interrupt context, so they are serialised against
+	 * each other by disabling interrupts. This also guarantees that a reader
+	 * on this CPU can never observe a write in progress and spin waiting for
+	 * a writer that it has preempted.
+	 */
 	irqstate_t flags = irqsave();
-	memcpy(_data, buffer, _meta->o_size);
+	memcpy(slot(_generation), buffer, _meta->o_size);
+	advance_generation();
 	irqrestore(flags);
 
-	/* update the timestamp and generation count */
-	_last_update = hrt_absolute_time();
-	_generation++;
-
 	/* notify any poll waiters */
 	poll_notify(POLLIN);
 
 	return _meta->o_size;
 }
 
+void
+ORBDevNode::advance_generation()
+{
+	_seq++;
+	orb_barrier();
+
+	/* update the timestamps and generation count */
+	_last_update = hrt_absolute_time();
+	_published[_generation & (_slots - 1)] = _last_update;
+	_generation++;
+
+	orb_barrier();
+	_seq++;
+
+	if (orb_recorder != nullptr)
+		orb_recorder->publication(_meta, _instance, slot(_generation - 1), _last_update);
+}
+
 int
 ORBDevNode::ioctl(struct file *filp, int cmd, unsigned long arg)
 {
@@ -362,26 +846,79 @@ ORBDevNode::ioctl(struct file *filp, int cmd, unsigned long arg)
 		*(uintptr_t *)arg = (uintptr_t)this;
 		return OK;
 
-	default:
-		/* give it to the superclass */
-		return CDev::ioctl(filp, cmd, arg);
-	}
-}
+	case ORBIOCCLAIM: {
+			int ret = OK;
 
-ssize_t
-ORBDevNode::publish(const orb_metadata *meta, orb_advert_t handle, const void *data)
-{
-	ORBDevNode *devnode = (ORBDevNode *)handle;
-	int ret;
+			lock();
 
-	/* this is a bit risky, since we are trusting the handle in order to deref it */
-	if (devnode->_meta != meta) {
+			/* an instance that has been published to already belongs to someone */
+			if (_claimed || (_data != nullptr)) {
+				ret = -EBUSY;
+
+			} else {
+				_claimed = true;
+			}
+
+			unlock();
+			return ret;
+		}
+
+	case ORBIOCGSUBSCRIBER:
+		((struct orb_subscription *)arg)->node = this;
+		((struct orb_subscription *)arg)->sd = sd;
+		return OK;
+
+	case ORBIOCSETQUEUESIZE: {
+			int ret = OK;
+			unsigned slots = 2;
+
+			if ((arg < 1) || (arg > ORB_MAX_QUEUE_SIZE))
+				return -EINVAL;
+
+			/*
+			 * Keep at least one slot spare for the publisher to write into, and
+			 * a power of two so that slots stay in step across generation wrap.
+			 */
+			while (slots <= arg)
+				slots <<= 1;
+
+			lock();
+
+			/* the queue cannot be resized once the object has been allocated */
+			if ((_data != nullptr) && (arg != _queue_size)) {
+				ret = -EBUSY;
+
+			} else {
+				_queue_size = arg;
+				_slots = slots;
+			}
+
+			unlock();
+			return ret;
+		}
+
+	default:
+		/* give it to the superclass */
+		return CDev::ioctl(filp, cmd, arg);
+	}
+}
+
+ssize_t
+ORBDevNode::publish(const orb_metadata *meta, orb_advert_t handle, const void *data)
+{
+	ORBDevNode *devnode = (ORBDevNode *)handle;
+	int ret;
+
+	/* this is a bit risky, since we are trusting the handle in order to deref it */
+	if (devnode->_meta != meta) {
 		errno = EINVAL;
 		return ERROR;
 	}
 
 	/* call the devnode write method with no file pointer */
+	TRACE_BEGIN(TRACE_CAT_ORB_PUBLISH, meta->o_id, hrt_absolute_time());
 	ret = devnode->write(nullptr, (const char *)data, meta->o_size);
+	TRACE_END(TRACE_CAT_ORB_PUBLISH, meta->o_id, hrt_absolute_time());
 
 	if (ret < 0)
 		return ERROR;
@@ -394,6 +931,56 @@ ORBDevNode::publish(const orb_metadata *meta, orb_advert_t handle, const void *d
 	return OK;
 }
 
+void *
+ORBDevNode::publish_begin(const orb_metadata *meta, orb_advert_t handle)
+{
+	ORBDevNode *devnode = (ORBDevNode *)handle;
+
+	/* this is a bit risky, since we are trusting the handle in order to deref it */
+	if (devnode->_meta != meta) {
+		errno = EINVAL;
+		return nullptr;
+	}
+
+	/* the object is allocated by the first write; without it there is no slot to hand out */
+	if (devnode->_data == nullptr) {
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	/* no subscriber will look at the spare slot until it is committed */
+	return devnode->slot(devnode->_generation);
+}
+
+int
+ORBDevNode::publish_commit(const orb_metadata *meta, orb_advert_t handle)
+{
+	ORBDevNode *devnode = (ORBDevNode *)handle;
+
+	/* this is a bit risky, since we are trusting the handle in order to deref it */
+	if (devnode->_meta != meta) {
+		errno = EINVAL;
+		return ERROR;
+	}
+
+	/* nothing can have been handed out by publish_begin */
+	if (devnode->_data == nullptr) {
+		errno = ENOMEM;
+		return ERROR;
+	}
+
+	irqstate_t flags = irqsave();
+	devnode->advance_generation();
+	irqrestore(flags);
+
+	TRACE_INSTANT(TRACE_CAT_ORB_PUBLISH, meta->o_id, hrt_absolute_time());
+
+	/* notify any poll waiters */
+	devnode->poll_notify(POLLIN);
+
+	return OK;
+}
+
 pollevent_t
 ORBDevNode::poll_state(struct file *filp)
 {
@@ -409,7 +996,7 @@ ORBDevNode::poll_state(struct file *filp)
 }
 
 void
-ORBDevNode::poll_notify_one(struct pollfd *fds, pollevent_t events)
+ORBDevNode::poll_notify_one(px4_pollfd_struct_t *fds, pollevent_t events)
 {
 	SubscriberData *sd = filp_to_sd((struct file *)fds->priv);
 
@@ -426,15 +1013,20 @@ ORBDevNode::appears_updated(SubscriberData *sd)
 	/* assume it doesn't look updated */
 	bool ret = false;
 
+	/* check if this topic has been published yet, if not bail out */
+	if (_data == nullptr)
+		return false;
+
+	/*
+	 * Handle non-rate-limited subscribers; comparing the generation counts
+	 * is a single read of each and needs no locking.
+	 */
+	if (sd->update_interval == 0)
+		return sd->generation != _generation;
+
 	/* avoid racing between interrupt and non-interrupt context calls */
 	irqstate_t state = irqsave();
 
-	/* check if this topic has been published yet, if not bail out */
-	if (_data == nullptr) {
-		ret = false;
-		goto out;
-	}
-
 	/*
 	 * If the subscriber's generation count matches the update generation
 	 * count, there has been no update from their perspective; if they
@@ -442,14 +1034,6 @@ ORBDevNode::appears_updated(SubscriberData *sd)
 	 */
 	while (sd->generation != _generation) {
 
-		/*
-		 * Handle non-rate-limited subscribers.
-		 */
-		if (sd->update_interval == 0) {
-			ret = true;
-			break;
-		}
-
 		/*
 		 * If we have previously told the subscriber that there is data,
 		 * and they have not yet collected it, continue to tell them
@@ -469,7 +1053,7 @@ ORBDevNode::appears_updated(SubscriberData *sd)
 		 * must have collected the update we reported, otherwise
 		 * update_reported would still be true.
 		 */
-		if (!hrt_called(&sd->update_call))
+		if (TimerWheel::armed(&sd->update_timer))
 			break;
 
 		/*
@@ -477,10 +1061,7 @@ ORBDevNode::appears_updated(SubscriberData *sd)
 		 * until the interval has passed once more by restarting the interval
 		 * timer and thereby re-scheduling a poll notification at that time.
 		 */
-		hrt_call_after(&sd->update_call,
-			       sd->update_interval,
-			       &ORBDevNode::update_deferred_trampoline,
-			       (void *)this);
+		rate_limit_wheel->arm(&sd->update_timer, sd->update_interval);
 
 		/*
 		 * Remember that we have told the subscriber that there is data.
@@ -491,7 +1072,6 @@ ORBDevNode::appears_updated(SubscriberData *sd)
 		break;
 	}
 
-out:
 	irqrestore(state);
 
 	/* consider it updated */
@@ -509,11 +1089,32 @@ ORBDevNode::update_deferred()
 }
 
 void
-ORBDevNode::update_deferred_trampoline(void *arg)
+ORBDevNode::rate_limit_expired(TimerWheel::Entry *expired, void *arg)
 {
-	ORBDevNode *node = (ORBDevNode *)arg;
+	ORBDevNode *nodes = nullptr;
+
+	/* collect each node with an expired subscriber once */
+	for (TimerWheel::Entry *entry = expired; entry != nullptr; entry = entry->next) {
+		ORBDevNode *node = (ORBDevNode *)entry->arg;
+
+		if (!node->_deferred_pending) {
+			node->_deferred_pending = true;
+			node->_deferred_next = nodes;
+			nodes = node;
+		}
+	}
 
-	node->update_deferred();
+	/*
+	 * One notification per node wakes every subscriber whose interval
+	 * has expired; this may re-arm timers, so the expired list is done with.
+	 */
+	while (nodes != nullptr) {
+		ORBDevNode *node = nodes;
+
+		nodes = node->_deferred_next;
+		node->_deferred_pending = false;
+		node->update_deferred();
+	}
 }
 
 /**
@@ -529,18 +1130,49 @@ public:
 	~ORBDevMaster();
 
 	virtual int		ioctl(struct file *filp, int cmd, unsigned long arg);
+
+	/**
+	 * Create the node for a topic instance.
+	 *
+	 * @return		OK, -EEXIST if the node already exists, or
+	 *			another negative errno on failure.
+	 */
+	int			advertise(const struct orb_metadata *meta, unsigned instance);
+
+	/**
+	 * Find the node for a topic instance.
+	 *
+	 * @return		The node, or nullptr if it has not been created.
+	 */
+	ORBDevNode		*node(const struct orb_metadata *meta, unsigned instance) {
+		if ((meta->o_id >= ORB_TOPIC_COUNT) || (instance >= ORB_MULTI_MAX_INSTANCES))
+			return nullptr;
+
+		return _node_table[meta->o_id][instance];
+	}
+
+	/**
+	 * The most recently created node; follow ORBDevNode::next() for the rest.
+	 */
+	ORBDevNode		*first_node() { return _nodes; }
 private:
 	Flavor			_flavor;
+	ORBDevNode		*_nodes;	/**< nodes created, newest first */
+
+	/** nodes created, by topic ID and instance */
+	ORBDevNode		*_node_table[ORB_TOPIC_COUNT][ORB_MULTI_MAX_INSTANCES];
 };
 
 ORBDevMaster::ORBDevMaster(Flavor f) :
 	CDev((f == PUBSUB) ? "obj_master" : "param_master",
 	     (f == PUBSUB) ? TOPIC_MASTER_DEVICE_PATH : PARAM_MASTER_DEVICE_PATH),
-	_flavor(f)
+	_flavor(f),
+	_nodes(nullptr)
 {
 	// enable debug() calls
 	_debug_enabled = true;
 
+	memset(_node_table, 0, sizeof(_node_table));
 }
 
 ORBDevMaster::~ORBDevMaster()
@@ -548,47 +1180,69 @@ ORBDevMaster::~ORBDevMaster()
 }
 
 int
-ORBDevMaster::ioctl(struct file *filp, int cmd, unsigned long arg)
+ORBDevMaster::advertise(const struct orb_metadata *meta, unsigned instance)
 {
+	char buf[orb_maxpath];
+	const char *nodepath;
+	ORBDevNode *node;
 	int ret;
 
-	switch (cmd) {
-	case ORBIOCADVERTISE: {
-			const struct orb_metadata *meta = (const struct orb_metadata *)arg;
-			const char *objname;
-			char nodepath[orb_maxpath];
-			ORBDevNode *node;
+	/* find the path to the node - this also checks the topic and instance */
+	nodepath = node_path(buf, _flavor, meta, instance);
 
-			/* construct a path to the node - this also checks the node name */
-			ret = node_mkpath(nodepath, _flavor, meta);
+	if (nodepath == nullptr)
+		return -errno;
 
-			if (ret != OK)
-				return ret;
+	/* driver wants a permanent copy of the path; the common one already is */
+	if (nodepath == buf) {
+		nodepath = strdup(buf);
+
+		if (nodepath == nullptr)
+			return -ENOMEM;
+	}
 
-			/* driver wants a permanent copy of the node name, so make one here */
-			objname = strdup(meta->o_name);
+	/* construct the new node; the topic name is permanent, so no copy is needed */
+	node = new ORBDevNode(meta, meta->o_name, nodepath, instance);
 
-			if (objname == nullptr)
-				return -ENOMEM;
+	/* initialise the node - this may fail if e.g. a node with this name already exists */
+	if (node != nullptr)
+		ret = node->init();
 
-			/* construct the new node */
-			node = new ORBDevNode(meta, objname, nodepath);
+	/* if we didn't get a device, that's bad */
+	if (node == nullptr)
+		ret = -ENOMEM;
 
-			/* initialise the node - this may fail if e.g. a node with this name already exists */
-			if (node != nullptr)
-				ret = node->init();
+	/* if init failed, discard the node and its path */
+	if (ret != OK) {
+		delete node;
 
-			/* if we didn't get a device, that's bad */
-			if (node == nullptr)
-				return -ENOMEM;
+		if (nodepath != node_paths[meta->o_id])
+			free((void *)nodepath);
 
-			/* if init failed, discard the node and its name */
-			if (ret != OK) {
-				delete node;
-				free((void *)objname);
-			}
+	} else {
+		/* nodes are never removed, so the list and table can be read without locking */
+		lock();
+		node->_next = _nodes;
+		orb_barrier();
+		_nodes = node;
 
-			return ret;
+		if (_flavor == PUBSUB)
+			_node_table[meta->o_id][instance] = node;
+
+		unlock();
+	}
+
+	return ret;
+}
+
+int
+ORBDevMaster::ioctl(struct file *filp, int cmd, unsigned long arg)
+{
+	switch (cmd) {
+	case ORBIOCADVERTISE: {
+			const struct orb_advertdata *adv = (const struct orb_advertdata *)arg;
+
+			return advertise(adv->meta, adv->instance);
 		}
 
 	default:
@@ -598,6 +1252,12 @@ ORBDevMaster::ioctl(struct file *filp, int cmd, unsigned long arg)
 }
 
 
+/* the topics defined in objects_common.cpp */
+extern const struct orb_metadata *const orb_common_topics[];
+
+/* every topic linked in, by ID, from topic_list.cpp */
+extern const struct orb_metadata *const orb_topics[ORB_TOPIC_COUNT];
+
 /**
  * Local functions in support of the shell command.
  */
@@ -611,7 +1271,18 @@ struct orb_test {
 	int val;
 };
 
+} // namespace
+
+/* outside the namespace, so that the topic table in topic_list.cpp can see them */
+ORB_DECLARE(orb_test);
+ORB_DECLARE(orb_test_queue);
+ORB_DECLARE(orb_test_multi);
 ORB_DEFINE(orb_test, struct orb_test);
+ORB_DEFINE(orb_test_queue, struct orb_test);
+ORB_DEFINE(orb_test_multi, struct orb_test);
+
+namespace
+{
 
 int
 test_fail(const char *fmt, ...)
@@ -643,20 +1314,144 @@ test_note(const char *fmt, ...)
 
 ORB_DECLARE(sensor_combined);
 
+#include "topics/battery_status.h"
+
+/**
+ * Size of one element of a field.
+ */
+unsigned
+test_field_size(uint8_t type)
+{
+	switch (type) {
+	case ORB_FIELD_TYPE_int8_t:
+	case ORB_FIELD_TYPE_uint8_t:
+	case ORB_FIELD_TYPE_bool:
+	case ORB_FIELD_TYPE_char:
+		return 1;
+
+	case ORB_FIELD_TYPE_int16_t:
+	case ORB_FIELD_TYPE_uint16_t:
+		return 2;
+
+	case ORB_FIELD_TYPE_int32_t:
+	case ORB_FIELD_TYPE_uint32_t:
+	case ORB_FIELD_TYPE_float:
+		return 4;
+
+	case ORB_FIELD_TYPE_int64_t:
+	case ORB_FIELD_TYPE_uint64_t:
+	case ORB_FIELD_TYPE_double:
+		return 8;
+
+	default:
+		return 0;
+	}
+}
+
+/**
+ * Check that the fields described for a topic cover its structure.
+ *
+ * Fields must not overlap, and the only gaps allowed are the padding
+ * that aligns a field, or the end of the structure, to at most 8 bytes.
+ * A member left out of the list leaves a larger gap.
+ */
+int
+test_fields_cover(const struct orb_metadata *meta)
+{
+	unsigned end = 0;
+
+	for (unsigned covered = 0; covered < meta->o_nfields; covered++) {
+		const struct orb_field *next = nullptr;
+
+		/* the field with the lowest offset not yet seen */
+		for (unsigned i = 0; i < meta->o_nfields; i++) {
+			const struct orb_field *f = &meta->o_fields[i];
+
+			if ((f->offset >= end) && ((next == nullptr) || (f->offset < next->offset)))
+				next = f;
+		}
+
+		if (next == nullptr)
+			return test_fail("%s: fields overlap", meta->o_name);
+
+		unsigned size = test_field_size(next->type);
+
+		if ((size == 0) || (next->count == 0))
+			return test_fail("%s.%s: bad type %u or count %u", meta->o_name, next->name, next->type, next->count);
+
+		if (next->offset - end >= ((size < 8) ? size : 8))
+			return test_fail("%s: %u bytes before %s not described", meta->o_name, next->offset - end, next->name);
+
+		end = next->offset + size * next->count;
+	}
+
+	if ((end > meta->o_size) || (meta->o_size - end >= 8))
+		return test_fail("%s: %u of %u bytes described", meta->o_name, end, meta->o_size);
+
+	return OK;
+}
+
+/**
+ * Check the field layout recorded for a topic against its structure.
+ */
+int
+test_fields()
+{
+	const struct orb_metadata *meta = ORB_ID(battery_status);
+
+	if ((meta->o_fields == nullptr) || (meta->o_nfields != 4))
+		return test_fail("battery_status has %u fields, expected 4", meta->o_nfields);
+
+	const struct orb_field &ts = meta->o_fields[0];
+	const struct orb_field &v = meta->o_fields[1];
+
+	if (strcmp(ts.name, "timestamp") || (ts.offset != offsetof(struct battery_status_s, timestamp)) ||
+	    (ts.type != ORB_FIELD_TYPE_uint64_t) || (ts.count != 1))
+		return test_fail("battery_status.timestamp described wrongly");
+
+	if (strcmp(v.name, "voltage_v") || (v.offset != offsetof(struct battery_status_s, voltage_v)) ||
+	    (v.type != ORB_FIELD_TYPE_float) || (v.count != 1))
+		return test_fail("battery_status.voltage_v described wrongly");
+
+	if ((ORB_ID(orb_test))->o_fields != nullptr)
+		return test_fail("orb_test should not be described");
+
+	unsigned described = 0;
+
+	for (unsigned i = 0; i < ORB_TOPIC_COUNT; i++) {
+		if ((orb_topics[i] == nullptr) || (orb_topics[i]->o_fields == nullptr))
+			continue;
+
+		if (test_fields_cover(orb_topics[i]) != OK)
+			return ERROR;
+
+		described++;
+	}
+
+	if (described == 0)
+		return test_fail("no described topics linked in");
+
+	return test_note("field layout ok, %u topics described", described);
+}
+
 int
 test()
 {
 	struct orb_test t, u;
-	int pfd, sfd;
+	orb_advert_t pfd;
+	int sfd;
 	bool updated;
 
+	if (test_fields() != OK)
+		return ERROR;
+
 	t.val = 0;
 	pfd = orb_advertise(ORB_ID(orb_test), &t);
 
 	if (pfd < 0)
 		return test_fail("advertise failed: %d", errno);
 
-	test_note("publish handle 0x%08x", pfd);
+	test_note("publish handle %p", (void *)pfd);
 	sfd = orb_subscribe(ORB_ID(orb_test));
 
 	if (sfd < 0)
@@ -696,91 +1491,1128 @@ test()
 		return test_fail("copy(2) mismatch: %d expected %d", u.val, t.val);
 
 	orb_unsubscribe(sfd);
-	close(pfd);
 
-#if 0
-	/* this is a hacky test that exploits the sensors app to test rate-limiting */
+	orb_sub_t sub = orb_subscribe_direct(ORB_ID(orb_test));
 
-	sfd = orb_subscribe(ORB_ID(sensor_combined));
+	if (sub == nullptr)
+		return test_fail("subscribe direct failed: %d", errno);
 
-	hrt_abstime start, end;
-	unsigned count;
+	if (OK != orb_check_direct(sub, &updated))
+		return test_fail("check direct(1) failed");
 
-	start = hrt_absolute_time();
-	count = 0;
+	if (updated)
+		return test_fail("spurious direct updated flag(1)");
 
-	do {
-		orb_check(sfd, &updated);
+	t.val = 3;
 
-		if (updated) {
-			orb_copy(ORB_ID(sensor_combined), sfd, nullptr);
-			count++;
-		}
-	} while (count < 100);
+	if (OK != orb_publish(ORB_ID(orb_test), pfd, &t))
+		return test_fail("publish failed");
 
-	end = hrt_absolute_time();
-	test_note("full-speed, 100 updates in %llu", end - start);
+	if (OK != orb_check_direct(sub, &updated))
+		return test_fail("check direct(2) failed");
 
-	orb_set_interval(sfd, 10);
+	if (!updated)
+		return test_fail("missing direct updated flag");
 
-	start = hrt_absolute_time();
-	count = 0;
+	if (OK != orb_copy_direct(ORB_ID(orb_test), sub, &u))
+		return test_fail("copy direct failed: %d", errno);
 
-	do {
-		orb_check(sfd, &updated);
+	if (u.val != t.val)
+		return test_fail("copy direct mismatch: %d expected %d", u.val, t.val);
 
-		if (updated) {
-			orb_copy(ORB_ID(sensor_combined), sfd, nullptr);
-			count++;
-		}
-	} while (count < 100);
+	if (OK != orb_check(orb_sub_fd(sub), &updated))
+		return test_fail("check direct(3) failed");
 
-	end = hrt_absolute_time();
-	test_note("100Hz, 100 updates in %llu", end - start);
+	if (updated)
+		return test_fail("spurious direct updated flag(2)");
 
-	orb_unsubscribe(sfd);
-#endif
+	struct orb_test *slot = (struct orb_test *)orb_publish_begin(ORB_ID(orb_test), pfd);
 
-	return test_note("PASS");
-}
+	if (slot == nullptr)
+		return test_fail("publish begin failed: %d", errno);
 
-int
-info()
-{
-	return OK;
-}
+	slot->val = 4;
 
+	if (OK != orb_publish_commit(ORB_ID(orb_test), pfd))
+		return test_fail("publish commit failed: %d", errno);
 
-} // namespace
+	const struct orb_test *peek;
 
-/*
- * uORB server 'main'.
- */
-extern "C" { __EXPORT int uorb_main(int argc, char *argv[]); }
+	if (OK != orb_peek(sub, (const void **)&peek))
+		return test_fail("peek failed: %d", errno);
 
-int
-uorb_main(int argc, char *argv[])
-{
-	/*
-	 * Start/load the driver.
-	 *
-	 * XXX it would be nice to have a wrapper for this...
-	 */
-	if (!strcmp(argv[1], "start")) {
+	if (peek->val != slot->val)
+		return test_fail("peek mismatch: %d expected %d", peek->val, slot->val);
 
-		if (g_dev != nullptr) {
-			fprintf(stderr, "[uorb] already loaded\n");
-			/* user wanted to start uorb, its already running, no error */
-			return 0;
-		}
+	orb_unsubscribe_direct(sub);
 
-		/* create the driver */
-		g_dev = new ORBDevMaster(PUBSUB);
+	struct orb_test q[4];
+	int n;
 
-		if (g_dev == nullptr) {
-			fprintf(stderr, "[uorb] driver alloc failed\n");
-			return -ENOMEM;
-		}
+	t.val = 0;
+	pfd = orb_advertise_queue(ORB_ID(orb_test_queue), &t, 4);
+
+	if (pfd < 0)
+		return test_fail("advertise queue failed: %d", errno);
+
+	sfd = orb_subscribe(ORB_ID(orb_test_queue));
+
+	if (sfd < 0)
+		return test_fail("subscribe queue failed: %d", errno);
+
+	for (t.val = 1; t.val <= 3; t.val++)
+		if (OK != orb_publish(ORB_ID(orb_test_queue), pfd, &t))
+			return test_fail("publish queue failed");
+
+	n = orb_copy_queued(ORB_ID(orb_test_queue), sfd, &q[0], 4);
+
+	if (n != 3)
+		return test_fail("copy queue(1) returned %d expected 3", n);
+
+	for (int i = 0; i < n; i++)
+		if (q[i].val != i + 1)
+			return test_fail("copy queue(1) mismatch: %d expected %d", q[i].val, i + 1);
+
+	/* overrun the queue; only the four most recent should be kept */
+	for (t.val = 4; t.val <= 9; t.val++)
+		if (OK != orb_publish(ORB_ID(orb_test_queue), pfd, &t))
+			return test_fail("publish queue failed");
+
+	n = orb_copy_queued(ORB_ID(orb_test_queue), sfd, &q[0], 4);
+
+	if (n != 4)
+		return test_fail("copy queue(2) returned %d expected 4", n);
+
+	for (int i = 0; i < n; i++)
+		if (q[i].val != i + 6)
+			return test_fail("copy queue(2) mismatch: %d expected %d", q[i].val, i + 6);
+
+	/* 4 and 5 were overwritten before this subscriber copied them */
+	ORBDevNode::SubscriberStats subs[1];
+
+	if ((((ORBDevNode *)pfd)->subscriber_stats(subs, 1) != 1) || (subs[0].lost != 2))
+		return test_fail("queue subscriber lost %u expected 2", subs[0].lost);
+
+	if (OK != orb_check(sfd, &updated))
+		return test_fail("check queue failed");
+
+	if (updated)
+		return test_fail("spurious queue updated flag");
+
+	orb_unsubscribe(sfd);
+
+	int instance0, instance1;
+	orb_advert_t pfd0, pfd1;
+	unsigned instances;
+
+	t.val = 10;
+	pfd0 = orb_advertise_multi(ORB_ID(orb_test_multi), &t, &instance0);
+
+	t.val = 11;
+	pfd1 = orb_advertise_multi(ORB_ID(orb_test_multi), &t, &instance1);
+
+	if ((pfd0 < 0) || (pfd1 < 0))
+		return test_fail("advertise multi failed: %d", errno);
+
+	if (instance1 != instance0 + 1)
+		return test_fail("advertise multi instances %d, %d not consecutive", instance0, instance1);
+
+	sfd = orb_subscribe_multi(ORB_ID(orb_test_multi), instance1);
+
+	if (sfd < 0)
+		return test_fail("subscribe multi failed: %d", errno);
+
+	if (OK != orb_copy(ORB_ID(orb_test_multi), sfd, &u))
+		return test_fail("copy multi failed: %d", errno);
+
+	if (u.val != 11)
+		return test_fail("copy multi mismatch: %d expected 11", u.val);
+
+	orb_unsubscribe(sfd);
+
+	if (OK != orb_group_count(ORB_ID(orb_test_multi), &instances))
+		return test_fail("group count failed: %d", errno);
+
+	if (instances != (unsigned)instance1 + 1)
+		return test_fail("group count %u expected %d", instances, instance1 + 1);
+
+	/* a rate-limited subscriber sees at most one update per interval */
+	t.val = 20;
+	pfd = orb_advertise(ORB_ID(orb_test), &t);
+
+	if (pfd < 0)
+		return test_fail("advertise interval failed: %d", errno);
+
+	sfd = orb_subscribe(ORB_ID(orb_test));
+
+	if (sfd < 0)
+		return test_fail("subscribe interval failed: %d", errno);
+
+	if (OK != orb_set_interval(sfd, 50))
+		return test_fail("set interval failed: %d", errno);
+
+	if ((OK != orb_publish(ORB_ID(orb_test), pfd, &t)) ||
+	    (OK != orb_check(sfd, &updated)) || !updated)
+		return test_fail("missing interval updated flag");
+
+	if (OK != orb_copy(ORB_ID(orb_test), sfd, &u))
+		return test_fail("copy interval failed: %d", errno);
+
+	t.val = 21;
+
+	if ((OK != orb_publish(ORB_ID(orb_test), pfd, &t)) ||
+	    (OK != orb_check(sfd, &updated)) || updated)
+		return test_fail("interval not respected");
+
+	usleep(100000);
+
+	if ((OK != orb_check(sfd, &updated)) || !updated)
+		return test_fail("missing updated flag after interval");
+
+	orb_unsubscribe(sfd);
+
+#if 0
+	/* this is a hacky test that exploits the sensors app to test rate-limiting */
+
+	sfd = orb_subscribe(ORB_ID(sensor_combined));
+
+	hrt_abstime start, end;
+	unsigned count;
+
+	start = hrt_absolute_time();
+	count = 0;
+
+	do {
+		orb_check(sfd, &updated);
+
+		if (updated) {
+			orb_copy(ORB_ID(sensor_combined), sfd, nullptr);
+			count++;
+		}
+	} while (count < 100);
+
+	end = hrt_absolute_time();
+	test_note("full-speed, 100 updates in %llu", end - start);
+
+	orb_set_interval(sfd, 10);
+
+	start = hrt_absolute_time();
+	count = 0;
+
+	do {
+		orb_check(sfd, &updated);
+
+		if (updated) {
+			orb_copy(ORB_ID(sensor_combined), sfd, nullptr);
+			count++;
+		}
+	} while (count < 100);
+
+	end = hrt_absolute_time();
+	test_note("100Hz, 100 updates in %llu", end - start);
+
+	orb_unsubscribe(sfd);
+#endif
+
+	return test_note("PASS");
+}
+
+#ifdef __PX4_POSIX
+# define REPLAY_TEST_PATH	"/tmp/uorb_replay_test.rec"
+#else
+# define REPLAY_TEST_PATH	"/fs/microsd/uorb_replay_test.rec"
+#endif
+
+const int replay_test_count = 100;
+
+void *
+replay_test_reader_main(void *arg)
+{
+	int *received = (int *)arg;
+	struct orb_test t;
+	px4_pollfd_struct_t fds;
+
+	fds.fd = orb_subscribe(ORB_ID(orb_test));
+	fds.events = POLLIN;
+
+	if (fds.fd < 0)
+		return nullptr;
+
+	/* the replay waits for each update to be copied, so none may be missed */
+	while (px4_poll(&fds, 1, 1000) > 0) {
+		orb_copy(ORB_ID(orb_test), fds.fd, &t);
+
+		if (t.val != *received)
+			break;
+
+		if (++(*received) > replay_test_count)
+			break;
+	}
+
+	orb_unsubscribe(fds.fd);
+	return nullptr;
+}
+
+/**
+ * Check whether a topic has an instance 0 node.
+ */
+bool
+test_node_exists(const struct orb_metadata *meta)
+{
+	for (ORBDevNode *node = g_dev->first_node(); node != nullptr; node = node->next())
+		if (node->meta() == meta)
+			return true;
+
+	return false;
+}
+
+/**
+ * Replay a recording of a topic that has no node yet, as when a recording
+ * is replayed into a freshly started system.
+ */
+int
+test_replay_new_node(hrt_abstime start)
+{
+	const struct orb_metadata *meta = ORB_ID(orb_test_multi);
+	struct orb_record_header header;
+	struct orb_record_item item;
+	struct orb_test t;
+
+	if (test_node_exists(meta))
+		return test_fail("%s already has a node", meta->o_name);
+
+	FILE *fp = fopen(REPLAY_TEST_PATH, "wb");
+
+	if (fp == nullptr)
+		return test_fail("can't create %s: %d", REPLAY_TEST_PATH, errno);
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, ORB_RECORD_MAGIC, sizeof(header.magic));
+	header.version = ORB_RECORD_VERSION;
+	fwrite(&header, sizeof(header), 1, fp);
+
+	memset(&item, 0, sizeof(item));
+	item.type = ORB_RECORD_TOPIC;
+	item.len = strlen(meta->o_name);
+	fwrite(&item, sizeof(item), 1, fp);
+	fwrite(meta->o_name, item.len, 1, fp);
+
+	for (t.val = 1; t.val <= 3; t.val++) {
+		item.type = ORB_RECORD_DATA;
+		item.len = sizeof(t);
+		item.timestamp = start + t.val * 1000;
+		fwrite(&item, sizeof(item), 1, fp);
+		fwrite(&t, sizeof(t), 1, fp);
+	}
+
+	fclose(fp);
+
+	int ret = orb_replay(REPLAY_TEST_PATH, false);
+	unlink(REPLAY_TEST_PATH);
+
+	if (ret != OK)
+		return test_fail("replay of %s failed", meta->o_name);
+
+	if (!test_node_exists(meta))
+		return test_fail("replay didn't create %s", meta->o_name);
+
+	int sfd = orb_subscribe(meta);
+
+	if ((sfd < 0) || (OK != orb_copy(meta, sfd, &t)) || (t.val != 3))
+		return test_fail("replayed %s holds %d, expected 3", meta->o_name, t.val);
+
+	orb_unsubscribe(sfd);
+	return test_note("PASS");
+}
+
+/**
+ * Record some publications and replay them in lockstep.
+ *
+ * On the host this leaves the clock in virtual time, so it runs as a
+ * separate command.
+ */
+int
+test_replay()
+{
+	struct orb_test t;
+	orb_advert_t pfd;
+	hrt_abstime last_update;
+	pthread_t reader;
+	int received = 0;
+	int sfd, ret;
+
+	Recorder *recorder = new Recorder(4096);
+
+	if (recorder == nullptr)
+		return test_fail("recorder alloc failed");
+
+	ret = recorder->start(REPLAY_TEST_PATH);
+
+	if (ret != OK) {
+		delete recorder;
+		return test_fail("record start failed: %d", ret);
+	}
+
+	irqstate_t flags = irqsave();
+	orb_recorder = recorder;
+	irqrestore(flags);
+
+	t.val = 0;
+	pfd = orb_advertise(ORB_ID(orb_test), &t);
+
+	if (pfd < 0)
+		return test_fail("advertise failed: %d", errno);
+
+	for (t.val = 1; t.val <= replay_test_count; t.val++) {
+		orb_publish(ORB_ID(orb_test), pfd, &t);
+		usleep(1000);
+	}
+
+	flags = irqsave();
+	orb_recorder = nullptr;
+	irqrestore(flags);
+
+	recorder->stop();
+	test_note("recorded %u, dropped %u, %llu bytes", recorder->records(), recorder->dropped(),
+		  recorder->written());
+
+	if ((recorder->records() != (unsigned)replay_test_count + 1) || (recorder->dropped() != 0)) {
+		delete recorder;
+		return test_fail("recorded wrong number of publications");
+	}
+
+	delete recorder;
+
+	/* note the time of the last publication */
+	sfd = orb_subscribe(ORB_ID(orb_test));
+	orb_stat(sfd, &last_update);
+	orb_unsubscribe(sfd);
+
+	if (pthread_create(&reader, nullptr, replay_test_reader_main, &received) != 0)
+		return test_fail("reader start failed");
+
+	/* give the reader time to subscribe */
+	usleep(100000);
+
+	if (OK != orb_replay(REPLAY_TEST_PATH, true))
+		return test_fail("replay failed");
+
+	pthread_join(reader, nullptr);
+	unlink(REPLAY_TEST_PATH);
+
+	if (received != replay_test_count + 1)
+		return test_fail("reader saw %d of %d publications in order", received, replay_test_count + 1);
+
+#ifdef __PX4_POSIX
+
+	/* the clock stops at the last publication replayed */
+	if (hrt_absolute_time() != last_update)
+		return test_fail("virtual time %llu, expected %llu", hrt_absolute_time(), last_update);
+
+#endif
+
+	return test_replay_new_node(last_update);
+}
+
+/*
+ * Benchmark object, sized like the larger sensor topics.
+ */
+struct orb_bench {
+	uint64_t	timestamp;
+	uint8_t		payload[248];
+};
+
+} // namespace
+
+ORB_DECLARE(orb_bench);
+ORB_DEFINE(orb_bench, struct orb_bench);
+
+namespace
+{
+
+/* poll() can only track a limited number of waiters per node */
+const unsigned bench_max_readers = 8;
+const unsigned bench_iterations = 10000;
+const unsigned bench_publications = 2000;
+
+#define ORB_MAX_BENCH_TOPICS	64
+
+volatile bool bench_done;
+
+struct bench_reader {
+	pthread_t	thread;
+	unsigned	copies;
+	hrt_abstime	copy_max;
+	hrt_abstime	latency_max;
+};
+
+void *
+bench_reader_main(void *arg)
+{
+	struct bench_reader *r = (struct bench_reader *)arg;
+	struct orb_bench b;
+	px4_pollfd_struct_t fds;
+
+	fds.fd = orb_subscribe(ORB_ID(orb_bench));
+	fds.events = POLLIN;
+
+	if (fds.fd < 0)
+		return nullptr;
+
+	while (!bench_done) {
+		if (px4_poll(&fds, 1, 100) <= 0)
+			continue;
+
+		hrt_abstime start = hrt_absolute_time();
+		orb_copy(ORB_ID(orb_bench), fds.fd, &b);
+		hrt_abstime end = hrt_absolute_time();
+
+		if ((end - start) > r->copy_max)
+			r->copy_max = end - start;
+
+		if ((end - b.timestamp) > r->latency_max)
+			r->latency_max = end - b.timestamp;
+
+		r->copies++;
+	}
+
+	orb_unsubscribe(fds.fd);
+	return nullptr;
+}
+
+/**
+ * Measure publish/copy throughput, then the worst-case copy time and
+ * publish-to-copy latency seen by a number of concurrent readers.
+ */
+int
+bench(unsigned readers)
+{
+	struct orb_bench b;
+	struct bench_reader r[bench_max_readers];
+	perf_counter_t pub_perf, copy_perf;
+	orb_advert_t pub;
+	int sfd;
+
+	if (readers > bench_max_readers)
+		readers = bench_max_readers;
+
+	memset(&b, 0, sizeof(b));
+	memset(&r, 0, sizeof(r));
+
+	pub = orb_advertise(ORB_ID(orb_bench), &b);
+
+	if (pub < 0)
+		return test_fail("advertise failed: %d", errno);
+
+	sfd = orb_subscribe(ORB_ID(orb_bench));
+
+	if (sfd < 0)
+		return test_fail("subscribe failed: %d", errno);
+
+	pub_perf = perf_alloc(PC_ELAPSED, "uorb_bench_publish");
+	copy_perf = perf_alloc(PC_ELAPSED, "uorb_bench_copy");
+
+	/* uncontended throughput */
+	hrt_abstime start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < bench_iterations; i++) {
+		perf_begin(pub_perf);
+		orb_publish(ORB_ID(orb_bench), pub, &b);
+		perf_end(pub_perf);
+
+		perf_begin(copy_perf);
+		orb_copy(ORB_ID(orb_bench), sfd, &b);
+		perf_end(copy_perf);
+	}
+
+	hrt_abstime elapsed = hrt_absolute_time() - start;
+	test_note("%u publish/copy pairs of %u bytes in %lluus",
+		  bench_iterations, sizeof(b), elapsed);
+	perf_print_counter(pub_perf);
+	perf_print_counter(copy_perf);
+	perf_reset(pub_perf);
+	orb_unsubscribe(sfd);
+
+	/* contended latency */
+	bench_done = false;
+
+	for (unsigned i = 0; i < readers; i++) {
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+		pthread_attr_setstacksize(&attr, 2048);
+
+		if (pthread_create(&r[i].thread, &attr, bench_reader_main, &r[i]) != 0) {
+			pthread_attr_destroy(&attr);
+			readers = i;
+			break;
+		}
+
+		pthread_attr_destroy(&attr);
+	}
+
+	for (unsigned i = 0; i < bench_publications; i++) {
+		b.timestamp = hrt_absolute_time();
+		perf_begin(pub_perf);
+		orb_publish(ORB_ID(orb_bench), pub, &b);
+		perf_end(pub_perf);
+		usleep(1000);
+	}
+
+	bench_done = true;
+
+	for (unsigned i = 0; i < readers; i++) {
+		pthread_join(r[i].thread, nullptr);
+		test_note("reader %u: %u copies, max copy %lluus, max latency %lluus",
+			  i, r[i].copies, r[i].copy_max, r[i].latency_max);
+	}
+
+	test_note("%u publications with %u readers", bench_publications, readers);
+	perf_print_counter(pub_perf);
+
+	perf_free(pub_perf);
+	perf_free(copy_perf);
+
+	return test_note("PASS");
+}
+
+void
+bench_noop(void *arg)
+{
+}
+
+void
+bench_expired(TimerWheel::Entry *expired, void *arg)
+{
+}
+
+/**
+ * Compare the cost of arming rate-limit timers on the HRT callout list
+ * with the timer wheel, then run a number of rate-limited subscribers
+ * against a 1kHz publisher.
+ */
+int
+bench_interval(unsigned subscribers)
+{
+	const unsigned rounds = 10;
+	const unsigned duration = 1000;	/* ms */
+
+	struct hrt_call *calls = new struct hrt_call[subscribers];
+	TimerWheel::Entry *entries = new TimerWheel::Entry[subscribers];
+	TimerWheel *wheel = new TimerWheel(rate_limit_tick, bench_expired, nullptr);
+	int *sfd = new int[subscribers];
+
+	if ((calls == nullptr) || (entries == nullptr) || (wheel == nullptr) || (sfd == nullptr)) {
+		delete[] calls;
+		delete[] entries;
+		delete wheel;
+		delete[] sfd;
+		return test_fail("alloc failed");
+	}
+
+	memset(calls, 0, subscribers * sizeof(calls[0]));
+	memset(entries, 0, subscribers * sizeof(entries[0]));
+
+	/* re-arm every timer a few times, with intervals of 10-100ms as a mix of subscribers would */
+	hrt_abstime start = hrt_absolute_time();
+
+	for (unsigned r = 0; r < rounds; r++)
+		for (unsigned i = 0; i < subscribers; i++)
+			hrt_call_after(&calls[i], 10000 * (1 + i % 10), bench_noop, nullptr);
+
+	hrt_abstime hrt_time = hrt_absolute_time() - start;
+
+	for (unsigned i = 0; i < subscribers; i++)
+		hrt_cancel(&calls[i]);
+
+	start = hrt_absolute_time();
+
+	for (unsigned r = 0; r < rounds; r++)
+		for (unsigned i = 0; i < subscribers; i++)
+			wheel->arm(&entries[i], 10000 * (1 + i % 10));
+
+	hrt_abstime wheel_time = hrt_absolute_time() - start;
+
+	for (unsigned i = 0; i < subscribers; i++)
+		wheel->cancel(&entries[i]);
+
+	test_note("%u timers: hrt arm %lluns, wheel arm %lluns",
+		  subscribers,
+		  hrt_time * 1000 / (rounds * subscribers),
+		  wheel_time * 1000 / (rounds * subscribers));
+
+	delete[] calls;
+	delete[] entries;
+	delete wheel;
+
+	/* end to end */
+	struct orb_bench b;
+	orb_advert_t pub;
+	unsigned opened = 0;
+	unsigned updates = 0;
+	unsigned expected = 0;
+
+	memset(&b, 0, sizeof(b));
+	pub = orb_advertise(ORB_ID(orb_bench), &b);
+
+	if (pub < 0) {
+		delete[] sfd;
+		return test_fail("advertise failed: %d", errno);
+	}
+
+	for (; opened < subscribers; opened++) {
+		sfd[opened] = orb_subscribe(ORB_ID(orb_bench));
+
+		if (sfd[opened] < 0)
+			break;
+
+		orb_set_interval(sfd[opened], 10 * (1 + opened % 10));
+		expected += duration / (10 * (1 + opened % 10));
+	}
+
+	if (opened < subscribers)
+		test_note("only %u subscriptions could be opened", opened);
+
+	perf_counter_t check_perf = perf_alloc(PC_ELAPSED, "uorb_bench_check");
+
+	for (unsigned t = 0; t < duration; t++) {
+		b.timestamp = hrt_absolute_time();
+		orb_publish(ORB_ID(orb_bench), pub, &b);
+
+		perf_begin(check_perf);
+
+		for (unsigned i = 0; i < opened; i++) {
+			bool updated;
+
+			orb_check(sfd[i], &updated);
+
+			if (updated) {
+				orb_copy(ORB_ID(orb_bench), sfd[i], &b);
+				updates++;
+			}
+		}
+
+		perf_end(check_perf);
+		usleep(1000);
+	}
+
+	test_note("%u rate-limited subscribers saw %u updates, about %u expected",
+		  opened, updates, expected);
+	perf_print_counter(check_perf);
+	perf_free(check_perf);
+
+	for (unsigned i = 0; i < opened; i++)
+		orb_unsubscribe(sfd[i]);
+
+	delete[] sfd;
+
+	return test_note("PASS");
+}
+
+/**
+ * Time subscribing to every common topic, as modules do at boot.
+ *
+ * The first pass creates any nodes that don't exist yet, so it is only
+ * representative of boot when run first.
+ */
+int
+bench_subscribe()
+{
+	const unsigned rounds = 100;
+	unsigned topics = 0;
+	int fds[ORB_MAX_BENCH_TOPICS];
+
+	hrt_abstime start = hrt_absolute_time();
+
+	for (; (orb_common_topics[topics] != nullptr) && (topics < ORB_MAX_BENCH_TOPICS); topics++)
+		fds[topics] = orb_subscribe(orb_common_topics[topics]);
+
+	hrt_abstime first_time = hrt_absolute_time() - start;
+
+	for (unsigned i = 0; i < topics; i++)
+		if (fds[i] >= 0)
+			orb_unsubscribe(fds[i]);
+
+	start = hrt_absolute_time();
+
+	for (unsigned r = 0; r < rounds; r++)
+		for (unsigned i = 0; i < topics; i++)
+			orb_unsubscribe(orb_subscribe(orb_common_topics[i]));
+
+	hrt_abstime later_time = hrt_absolute_time() - start;
+
+	test_note("%u topics: first pass %lluus, then %lluns per subscribe/unsubscribe",
+		  topics, first_time, later_time * 1000 / (rounds * topics));
+
+	return test_note("PASS");
+}
+
+/**
+ * Compare the cost of orb_copy through a file descriptor with
+ * orb_copy_direct, for every common topic that has been published.
+ */
+int
+bench_copy()
+{
+	test_note("topic                            size   fd ns  direct ns");
+
+	for (unsigned i = 0; orb_common_topics[i] != nullptr; i++) {
+		const struct orb_metadata *meta = orb_common_topics[i];
+		uint8_t *buf = new uint8_t[meta->o_size];
+		int fd = orb_subscribe(meta);
+		orb_sub_t sub = orb_subscribe_direct(meta);
+
+		/* topics that have not been published can't be copied */
+		if ((buf != nullptr) && (fd >= 0) && (sub != nullptr) &&
+		    (OK == orb_copy(meta, fd, buf))) {
+
+			hrt_abstime start = hrt_absolute_time();
+
+			for (unsigned j = 0; j < bench_iterations; j++)
+				orb_copy(meta, fd, buf);
+
+			hrt_abstime fd_time = hrt_absolute_time() - start;
+
+			start = hrt_absolute_time();
+
+			for (unsigned j = 0; j < bench_iterations; j++)
+				orb_copy_direct(meta, sub, buf);
+
+			hrt_abstime direct_time = hrt_absolute_time() - start;
+
+			test_note("%-32s %4u %7llu %10llu", meta->o_name, meta->o_size,
+				  fd_time * 1000 / bench_iterations,
+				  direct_time * 1000 / bench_iterations);
+		}
+
+		if (sub != nullptr)
+			orb_unsubscribe_direct(sub);
+
+		if (fd >= 0)
+			orb_unsubscribe(fd);
+
+		delete[] buf;
+	}
+
+	return OK;
+}
+
+/* default recorder buffer; must absorb the publications made while the file is written */
+#ifdef __PX4_POSIX
+const unsigned record_buffer_size = 262144;
+#else
+const unsigned record_buffer_size = 16384;
+#endif
+
+/**
+ * Start recording every publication to a file.
+ */
+int
+record_start(const char *path, unsigned buffer_size)
+{
+	if (orb_recorder != nullptr) {
+		fprintf(stderr, "[uorb] already recording\n");
+		return -EBUSY;
+	}
+
+	Recorder *recorder = new Recorder(buffer_size);
+
+	if (recorder == nullptr)
+		return -ENOMEM;
+
+	int ret = recorder->start(path);
+
+	if (ret != OK) {
+		fprintf(stderr, "[uorb] can't record to %s: %d\n", path, ret);
+		delete recorder;
+		return ret;
+	}
+
+	irqstate_t flags = irqsave();
+	orb_recorder = recorder;
+	irqrestore(flags);
+
+	return OK;
+}
+
+/**
+ * Stop recording and report what was recorded.
+ */
+int
+record_stop()
+{
+	irqstate_t flags = irqsave();
+	Recorder *recorder = orb_recorder;
+	orb_recorder = nullptr;
+	irqrestore(flags);
+
+	if (recorder == nullptr) {
+		fprintf(stderr, "[uorb] not recording\n");
+		return ERROR;
+	}
+
+	recorder->stop();
+	printf("recorded %u publications, %llu bytes, %u dropped\n",
+	       recorder->records(), recorder->written(), recorder->dropped());
+
+	delete recorder;
+	return OK;
+}
+
+/**
+ * Print the usage statistics of every node.
+ */
+int
+info()
+{
+	if (g_dev == nullptr) {
+		fprintf(stderr, "[uorb] not started\n");
+		return -ENOENT;
+	}
+
+	printf("%-24s %4s %4s %8s %8s %10s %6s %8s\n",
+	       "TOPIC", "INST", "SUBS", "PUBS", "COPIES", "BYTES", "LOST", "LAT(us)");
+
+	for (ORBDevNode *node = g_dev->first_node(); node != nullptr; node = node->next()) {
+		ORBDevNode::Stats s;
+
+		node->stats(&s);
+		printf("%-24s %4u %4u %8u %8u %10llu %6u %8llu\n",
+		       node->meta()->o_name, s.instance, s.subscribers, s.publications,
+		       s.copies, s.bytes_copied, s.lost, s.latency_max);
+
+		/* and below it, each subscriber's share of the lost updates */
+		ORBDevNode::SubscriberStats subs[8];
+		unsigned n = node->subscriber_stats(subs, sizeof(subs) / sizeof(subs[0]));
+
+		for (unsigned i = 0; (i < n) && (i < sizeof(subs) / sizeof(subs[0])); i++)
+			printf("  pid %-6d interval %6uus %32s %6u\n",
+			       (int)subs[i].pid, subs[i].update_interval, "", subs[i].lost);
+
+		if (n > sizeof(subs) / sizeof(subs[0]))
+			printf("  %u more subscribers\n", n - (unsigned)(sizeof(subs) / sizeof(subs[0])));
+	}
+
+	return OK;
+}
+
+/* clear to end of line */
+#define CL "\033[K"
+
+struct top_entry {
+	ORBDevNode		*node;
+	ORBDevNode::Stats	stats;		/**< at the end of the interval */
+	unsigned		pub_rate;	/**< publications per second */
+	unsigned		copy_rate;	/**< copies per second */
+	unsigned		byte_rate;	/**< bytes copied per second */
+	unsigned		lost_rate;	/**< lost updates per second */
+};
+
+int
+top_compare(const void *a, const void *b)
+{
+	const struct top_entry *ea = (const struct top_entry *)a;
+	const struct top_entry *eb = (const struct top_entry *)b;
+
+	/* busiest publishers first */
+	if (ea->pub_rate != eb->pub_rate)
+		return (ea->pub_rate > eb->pub_rate) ? -1 : 1;
+
+	if (ea->byte_rate != eb->byte_rate)
+		return (ea->byte_rate > eb->byte_rate) ? -1 : 1;
+
+	return 0;
+}
+
+/**
+ * Gather the statistics of every node, and their rates of change since
+ * the previous pass.
+ *
+ * @param last		Entries from the previous pass (may be nullptr).
+ * @param last_count	Number of entries in last.
+ * @param count		Returns the number of entries.
+ * @param interval	Time since the previous pass.
+ * @return		Newly allocated entries, or nullptr.
+ */
+struct top_entry *
+top_sample(const struct top_entry *last, unsigned last_count, unsigned *count, hrt_abstime interval)
+{
+	unsigned n = 0;
+
+	for (ORBDevNode *node = g_dev->first_node(); node != nullptr; node = node->next())
+		n++;
+
+	struct top_entry *entries = new struct top_entry[n];
+
+	if (entries == nullptr)
+		return nullptr;
+
+	/* only walk as many as we counted; more may have been created since */
+	ORBDevNode *node = g_dev->first_node();
+
+	for (unsigned i = 0; i < n; i++, node = node->next()) {
+		struct top_entry *e = &entries[i];
+		ORBDevNode::Stats prev;
+
+		e->node = node;
+		node->stats(&e->stats);
+
+		/* a node that is new since the last pass started from nothing */
+		memset(&prev, 0, sizeof(prev));
+
+		for (unsigned j = 0; j < last_count; j++) {
+			if (last[j].node == node) {
+				prev = last[j].stats;
+				break;
+			}
+		}
+
+		if (interval == 0)
+			interval = 1;
+
+		e->pub_rate = (uint64_t)(e->stats.publications - prev.publications) * 1000000 / interval;
+		e->copy_rate = (uint64_t)(e->stats.copies - prev.copies) * 1000000 / interval;
+		e->byte_rate = (e->stats.bytes_copied - prev.bytes_copied) * 1000000 / interval;
+		e->lost_rate = (uint64_t)(e->stats.lost - prev.lost) * 1000000 / interval;
+	}
+
+	*count = n;
+	return entries;
+}
+
+/**
+ * Continuously display per-topic rates, busiest first, until a key is
+ * pressed or the requested number of updates has been shown.
+ *
+ * @param updates	Number of updates to show, or zero to run until
+ *			interrupted.
+ */
+int
+top(unsigned updates)
+{
+	struct top_entry *entries;
+	unsigned count;
+	hrt_abstime last_time = hrt_absolute_time();
+
+	if (g_dev == nullptr) {
+		fprintf(stderr, "[uorb] not started\n");
+		return -ENOENT;
+	}
+
+	entries = top_sample(nullptr, 0, &count, 0);
+
+	if (entries == nullptr)
+		return -ENOMEM;
+
+	/* open console directly to grab CTRL-C */
+	int console = open("/dev/console", O_NONBLOCK | O_RDONLY | O_NOCTTY);
+
+	/* clear screen */
+	printf("\033[2J");
+
+	for (unsigned update = 0; (updates == 0) || (update < updates); update++) {
+		bool quit = false;
+
+		/* wait 200 ms for user input five times ~ 1s */
+		for (int k = 0; k < 5; k++) {
+			char c;
+
+			if ((console >= 0) && (read(console, &c, 1) == 1)) {
+				switch (c) {
+				case 0x03: // ctrl-c
+				case 0x1b: // esc
+				case 'c':
+				case 'q':
+					quit = true;
+					break;
+				}
+			}
+
+			if (quit)
+				break;
+
+			usleep(200000);
+		}
+
+		if (quit)
+			break;
+
+		hrt_abstime now = hrt_absolute_time();
+		unsigned last_count = count;
+		struct top_entry *last = entries;
+
+		entries = top_sample(last, last_count, &count, now - last_time);
+		delete[] last;
+		last_time = now;
+
+		if (entries == nullptr)
+			break;
+
+		qsort(entries, count, sizeof(entries[0]), top_compare);
+
+		/* move cursor home */
+		printf("\033[H");
+		printf(CL "%u topics\n\n", count);
+		printf(CL "%-24s %4s %4s %7s %7s %9s %6s %8s\n",
+		       "TOPIC", "INST", "SUBS", "PUB/s", "COPY/s", "BYTES/s", "LOST/s", "LAT(us)");
+
+		for (unsigned i = 0; i < count; i++) {
+			struct top_entry *e = &entries[i];
+
+			printf(CL "%-24s %4u %4u %7u %7u %9u %6u %8llu\n",
+			       e->node->meta()->o_name, e->stats.instance, e->stats.subscribers,
+			       e->pub_rate, e->copy_rate, e->byte_rate, e->lost_rate,
+			       e->stats.latency_max);
+		}
+	}
+
+	delete[] entries;
+
+	if (console >= 0)
+		close(console);
+
+	return OK;
+}
+
+
+} // namespace
+
+/*
+ * uORB server 'main'.
+ */
+extern "C" { __EXPORT int uorb_main(int argc, char *argv[]); }
+
+int
+uorb_main(int argc, char *argv[])
+{
+	/*
+	 * Start/load the driver.
+	 *
+	 * XXX it would be nice to have a wrapper for this...
+	 */
+	if (!strcmp(argv[1], "start")) {
+
+		if (g_dev != nullptr) {
+			fprintf(stderr, "[uorb] already loaded\n");
+			/* user wanted to start uorb, its already running, no error */
+			return 0;
+		}
+
+		/* the rate-limit timers are needed as soon as there are subscribers */
+		if (rate_limit_wheel == nullptr)
+			rate_limit_wheel = new TimerWheel(rate_limit_tick, &ORBDevNode::rate_limit_expired, nullptr);
+
+		if (rate_limit_wheel == nullptr) {
+			fprintf(stderr, "[uorb] timer alloc failed\n");
+			return -ENOMEM;
+		}
+
+		/* create the driver */
+		g_dev = new ORBDevMaster(PUBSUB);
+
+		if (g_dev == nullptr) {
+			fprintf(stderr, "[uorb] driver alloc failed\n");
+			return -ENOMEM;
+		}
 
 		if (OK != g_dev->init()) {
 			fprintf(stderr, "[uorb] driver init failed\n");
@@ -796,71 +2628,77 @@ uorb_main(int argc, char *argv[])
 	/*
 	 * Test the driver/device.
 	 */
-	if (!strcmp(argv[1], "test"))
+	if (!strcmp(argv[1], "test")) {
+		if ((argc > 2) && !strcmp(argv[2], "replay"))
+			return test_replay();
+
 		return test();
+	}
 
 	/*
-	 * Print driver information.
+	 * Benchmark the driver/device.
 	 */
-	if (!strcmp(argv[1], "status"))
-		return info();
-
-	fprintf(stderr, "unrecognised command, try 'start', 'test' or 'status'\n");
-	return -EINVAL;
-}
+	if (!strcmp(argv[1], "bench")) {
+		if ((argc > 2) && !strcmp(argv[2], "copy"))
+			return bench_copy();
 
-/*
- * Library functions.
- */
-namespace
-{
+		if ((argc > 2) && !strcmp(argv[2], "subscribe"))
+			return bench_subscribe();
 
-void debug(const char *fmt, ...)
-{
-	va_list ap;
+		if ((argc > 2) && !strcmp(argv[2], "interval"))
+			return bench_interval((argc > 3) ? strtoul(argv[3], nullptr, 0) : 128);
 
-	va_start(ap, fmt);
-	vfprintf(stderr, fmt, ap);
-	va_end(ap);
-	fprintf(stderr, "\n");
-	fflush(stderr);
-	usleep(100000);
-}
+		return bench((argc > 2) ? strtoul(argv[2], nullptr, 0) : 4);
+	}
 
-/**
- * Advertise a node; don't consider it an error if the node has
- * already been advertised.
- *
- * @todo verify that the existing node is the same as the one
- *       we tried to advertise.
- */
-int
-node_advertise(const struct orb_metadata *meta)
-{
-	int fd = -1;
-	int ret = ERROR;
+	/*
+	 * Record publications to a file.
+	 */
+	if (!strcmp(argv[1], "record")) {
+		if ((argc > 3) && !strcmp(argv[2], "start"))
+			return record_start(argv[3], (argc > 4) ? strtoul(argv[4], nullptr, 0) : record_buffer_size);
 
-	/* open the control device */
-	fd = open(TOPIC_MASTER_DEVICE_PATH, 0);
+		if ((argc > 2) && !strcmp(argv[2], "stop"))
+			return record_stop();
 
-	if (fd < 0)
-		goto out;
+		fprintf(stderr, "usage: uorb record start <file> [buffer bytes] | uorb record stop\n");
+		return -EINVAL;
+	}
 
-	/* advertise the object */
-	ret = ioctl(fd, ORBIOCADVERTISE, (unsigned long)(uintptr_t)meta);
+	/*
+	 * Replay a recording.
+	 */
+	if (!strcmp(argv[1], "replay")) {
+		if (argc < 3) {
+			fprintf(stderr, "usage: uorb replay <file> [-l]\n");
+			return -EINVAL;
+		}
 
-	/* it's OK if it already exists */
-	if ((OK != ret) && (EEXIST == errno))
-		ret = OK;
+		return orb_replay(argv[2], (argc > 3) && !strcmp(argv[3], "-l"));
+	}
 
-out:
+	/*
+	 * Print driver information.
+	 */
+	if (!strcmp(argv[1], "status"))
+		return info();
 
-	if (fd >= 0)
-		close(fd);
+	/*
+	 * Display per-topic rates.
+	 */
+	if (!strcmp(argv[1], "top"))
+		return top((argc > 2) ? strtoul(argv[2], nullptr, 0) : 0);
 
-	return ret;
+	fprintf(stderr, "unrecognised command, try 'start', 'test', 'bench', 'record', 'replay', 'status' or 'top'\n");
+	return -EINVAL;
 }
 
+/*
+ * Library functions.
+ */
+namespace
+{
+
 /**
  * Common implementation for orb_advertise and orb_subscribe.
  *
@@ -868,9 +2706,10 @@ out:
  * advertisers.
  */
 int
-node_open(Flavor f, const struct orb_metadata *meta, const void *data, bool advertiser)
+node_open(Flavor f, const struct orb_metadata *meta, const void *data, bool advertiser, unsigned instance)
 {
-	char path[orb_maxpath];
+	char buf[orb_maxpath];
+	const char *path;
 	int fd, ret;
 
 	/*
@@ -891,29 +2730,31 @@ node_open(Flavor f, const struct orb_metadata *meta, const void *data, bool adve
 	}
 
 	/*
-	 * Generate the path to the node and try to open it.
+	 * Find the path to the node.
 	 */
-	ret = node_mkpath(path, f, meta);
+	path = node_path(buf, f, meta, instance);
 
-	if (ret != OK) {
-		errno = -ret;
+	if (path == nullptr)
 		return ERROR;
-	}
-
-	/* open the path as either the advertiser or the subscriber */
-	fd = open(path, (advertiser) ? O_WRONLY : O_RDONLY);
 
-	/* we may need to advertise the node... */
-	if (fd < 0) {
+	if (g_dev == nullptr) {
+		errno = EIO;
+		return ERROR;
+	}
 
-		/* try to create the node */
-		ret = node_advertise(meta);
+	/* create the node if need be; it's OK if somebody beats us to it */
+	if (g_dev->node(meta, instance) == nullptr) {
+		ret = g_dev->advertise(meta, instance);
 
-		/* on success, try the open again */
-		if (ret == OK)
-			fd = open(path, (advertiser) ? O_WRONLY : O_RDONLY);
+		if ((ret != OK) && (ret != -EEXIST)) {
+			errno = EIO;
+			return ERROR;
+		}
 	}
 
+	/* open the path as either the advertiser or the subscriber */
+	fd = px4_open(path, (advertiser) ? O_WRONLY : O_RDONLY);
+
 	if (fd < 0) {
 		errno = EIO;
 		return ERROR;
@@ -923,22 +2764,59 @@ node_open(Flavor f, const struct orb_metadata *meta, const void *data, bool adve
 	return fd;
 }
 
-} // namespace
-
+/**
+ * Common implementation for the orb_advertise variants.
+ *
+ * If instance is not nullptr, the lowest instance of the topic that nobody
+ * has advertised yet is claimed and its index returned in *instance,
+ * otherwise fixed_instance is used.
+ */
 orb_advert_t
-orb_advertise(const struct orb_metadata *meta, const void *data)
+node_advertise_publish(const struct orb_metadata *meta, const void *data, unsigned queue_size, int *instance,
+		       unsigned fixed_instance = 0)
 {
-	int result, fd;
+	int result, fd = ERROR;
 	orb_advert_t advertiser;
 
 	/* open the node as an advertiser */
-	fd = node_open(PUBSUB, meta, data, true);
+	if (instance == nullptr) {
+		fd = node_open(PUBSUB, meta, data, true, fixed_instance);
+
+	} else {
+		for (unsigned i = 0; i < ORB_MULTI_MAX_INSTANCES; i++) {
+			fd = node_open(PUBSUB, meta, data, true, i);
+			if (fd == ERROR)
+				return ERROR;
+
+			/* take this instance unless somebody else already has */
+			if (OK == px4_ioctl(fd, ORBIOCCLAIM, 0)) {
+				*instance = i;
+				break;
+			}
+
+			px4_close(fd);
+			fd = ERROR;
+		}
+
+		if (fd == ERROR)
+			errno = EBUSY;
+	}
+
 	if (fd == ERROR)
 		return ERROR;
 
+	/* size the queue before the initial publication allocates it */
+	if (queue_size != 1) {
+		result = px4_ioctl(fd, ORBIOCSETQUEUESIZE, queue_size);
+		if (result == ERROR) {
+			px4_close(fd);
+			return ERROR;
+		}
+	}
+
 	/* get the advertiser handle and close the node */
-	result = ioctl(fd, ORBIOCGADVERTISER, (unsigned long)&advertiser);
-	close(fd);
+	result = px4_ioctl(fd, ORBIOCGADVERTISER, (unsigned long)&advertiser);
+	px4_close(fd);
 	if (result == ERROR)
 		return ERROR;
 
@@ -950,16 +2828,91 @@ orb_advertise(const struct orb_metadata *meta, const void *data)
 	return advertiser;
 }
 
+} // namespace
+
+orb_advert_t
+orb_advertise(const struct orb_metadata *meta, const void *data)
+{
+	return node_advertise_publish(meta, data, 1, nullptr);
+}
+
+orb_advert_t
+orb_advertise_queue(const struct orb_metadata *meta, const void *data, unsigned queue_size)
+{
+	return node_advertise_publish(meta, data, queue_size, nullptr);
+}
+
+orb_advert_t
+orb_advertise_multi(const struct orb_metadata *meta, const void *data, int *instance)
+{
+	return node_advertise_publish(meta, data, 1, instance);
+}
+
+orb_advert_t
+orb_advertise_instance(const struct orb_metadata *meta, const void *data, unsigned instance)
+{
+	return node_advertise_publish(meta, data, 1, nullptr, instance);
+}
+
+unsigned
+orb_lagging_subscribers(orb_advert_t handle)
+{
+	return ((ORBDevNode *)handle)->lagging();
+}
+
+const struct orb_metadata *
+orb_find_topic(const char *name)
+{
+	for (unsigned i = 0; i < ORB_TOPIC_COUNT; i++)
+		if ((orb_topics[i] != nullptr) && !strcmp(orb_topics[i]->o_name, name))
+			return orb_topics[i];
+
+	return nullptr;
+}
+
 int
 orb_subscribe(const struct orb_metadata *meta)
 {
-	return node_open(PUBSUB, meta, nullptr, false);
+	return node_open(PUBSUB, meta, nullptr, false, 0);
+}
+
+int
+orb_subscribe_multi(const struct orb_metadata *meta, unsigned instance)
+{
+	return node_open(PUBSUB, meta, nullptr, false, instance);
+}
+
+int
+orb_group_count(const struct orb_metadata *meta, unsigned *instance_count)
+{
+	unsigned instances = 0;
+
+	if ((nullptr == meta) || (meta->o_id >= ORB_TOPIC_COUNT)) {
+		errno = ENOENT;
+		return ERROR;
+	}
+
+	if (g_dev == nullptr) {
+		errno = EIO;
+		return ERROR;
+	}
+
+	/* look at existing nodes only; subscribing would create them */
+	for (unsigned i = 0; i < ORB_MULTI_MAX_INSTANCES; i++) {
+		ORBDevNode *node = g_dev->node(meta, i);
+
+		if ((node != nullptr) && node->published())
+			instances++;
+	}
+
+	*instance_count = instances;
+	return OK;
 }
 
 int
 orb_unsubscribe(int handle)
 {
-	return close(handle);
+	return px4_close(handle);
 }
 
 int
@@ -968,12 +2921,26 @@ orb_publish(const struct orb_metadata *meta, orb_advert_t handle, const void *da
 	return ORBDevNode::publish(meta, handle, data);
 }
 
+void *
+orb_publish_begin(const struct orb_metadata *meta, orb_advert_t handle)
+{
+	return ORBDevNode::publish_begin(meta, handle);
+}
+
+int
+orb_publish_commit(const struct orb_metadata *meta, orb_advert_t handle)
+{
+	return ORBDevNode::publish_commit(meta, handle);
+}
+
 int
 orb_copy(const struct orb_metadata *meta, int handle, void *buffer)
 {
 	int ret;
 
-	ret = read(handle, buffer, meta->o_size);
+	TRACE_BEGIN(TRACE_CAT_ORB_COPY, meta->o_id, hrt_absolute_time());
+	ret = px4_read(handle, buffer, meta->o_size);
+	TRACE_END(TRACE_CAT_ORB_COPY, meta->o_id, hrt_absolute_time());
 
 	if (ret < 0)
 		return ERROR;
@@ -986,21 +2953,128 @@ orb_copy(const struct orb_metadata *meta, int handle, void *buffer)
 	return OK;
 }
 
+int
+orb_copy_queued(const struct orb_metadata *meta, int handle, void *buffer, unsigned count)
+{
+	int ret;
+
+	TRACE_BEGIN(TRACE_CAT_ORB_COPY, meta->o_id, hrt_absolute_time());
+	ret = px4_read(handle, buffer, meta->o_size * count);
+	TRACE_END(TRACE_CAT_ORB_COPY, meta->o_id, hrt_absolute_time());
+
+	if (ret < 0)
+		return ERROR;
+
+	if ((ret == 0) || ((ret % meta->o_size) != 0)) {
+		errno = EIO;
+		return ERROR;
+	}
+
+	return ret / meta->o_size;
+}
+
+orb_sub_t
+orb_subscribe_direct(const struct orb_metadata *meta)
+{
+	struct orb_subscription *sub;
+	int fd;
+
+	fd = orb_subscribe(meta);
+
+	if (fd == ERROR)
+		return nullptr;
+
+	sub = new orb_subscription;
+
+	if (sub == nullptr) {
+		px4_close(fd);
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	/* find the node and our subscriber state behind the descriptor */
+	if (OK != px4_ioctl(fd, ORBIOCGSUBSCRIBER, (unsigned long)(uintptr_t)sub)) {
+		px4_close(fd);
+		delete sub;
+		return nullptr;
+	}
+
+	sub->fd = fd;
+	return sub;
+}
+
+int
+orb_unsubscribe_direct(orb_sub_t handle)
+{
+	int ret = px4_close(handle->fd);
+
+	delete handle;
+	return ret;
+}
+
+int
+orb_sub_fd(orb_sub_t handle)
+{
+	return handle->fd;
+}
+
+int
+orb_copy_direct(const struct orb_metadata *meta, orb_sub_t handle, void *buffer)
+{
+	ssize_t ret;
+
+	TRACE_BEGIN(TRACE_CAT_ORB_COPY, meta->o_id, hrt_absolute_time());
+	ret = handle->node->read_subscriber(handle->sd, (char *)buffer, meta->o_size);
+	TRACE_END(TRACE_CAT_ORB_COPY, meta->o_id, hrt_absolute_time());
+
+	if (ret < 0) {
+		errno = -ret;
+		return ERROR;
+	}
+
+	if (ret != (ssize_t)meta->o_size) {
+		errno = EIO;
+		return ERROR;
+	}
+
+	return OK;
+}
+
+int
+orb_peek(orb_sub_t handle, const void **data)
+{
+	*data = handle->node->peek_subscriber(handle->sd);
+
+	if (*data == nullptr) {
+		errno = EIO;
+		return ERROR;
+	}
+
+	return OK;
+}
+
+int
+orb_check_direct(orb_sub_t handle, bool *updated)
+{
+	*updated = handle->node->appears_updated(handle->sd);
+	return OK;
+}
+
 int
 orb_check(int handle, bool *updated)
 {
-	return ioctl(handle, ORBIOCUPDATED, (unsigned long)(uintptr_t)updated);
+	return px4_ioctl(handle, ORBIOCUPDATED, (unsigned long)(uintptr_t)updated);
 }
 
 int
 orb_stat(int handle, uint64_t *time)
 {
-	return ioctl(handle, ORBIOCLASTUPDATE, (unsigned long)(uintptr_t)time);
+	return px4_ioctl(handle, ORBIOCLASTUPDATE, (unsigned long)(uintptr_t)time);
 }
 
 int
 orb_set_interval(int handle, unsigned interval)
 {
-	return ioctl(handle, ORBIOCSETINTERVAL, interval * 1000);
+	return px4_ioctl(handle, ORBIOCSETINTERVAL, interval * 1000);
 }
 
@@ -40,18 +40,55 @@
  */
 
 #include <sys/types.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
 // Hack until everything is using this header
 #include <systemlib/visibility.h>
 
+#include "topic_list.h"
+
+/**
+ * Types of the fields of a topic.
+ *
+ * The names follow the C types so that ORB_FIELD can derive them; the
+ * values are recorded in logs and must not change.
+ */
+enum orb_field_type {
+	ORB_FIELD_TYPE_int8_t = 0,
+	ORB_FIELD_TYPE_uint8_t = 1,
+	ORB_FIELD_TYPE_int16_t = 2,
+	ORB_FIELD_TYPE_uint16_t = 3,
+	ORB_FIELD_TYPE_int32_t = 4,
+	ORB_FIELD_TYPE_uint32_t = 5,
+	ORB_FIELD_TYPE_int64_t = 6,
+	ORB_FIELD_TYPE_uint64_t = 7,
+	ORB_FIELD_TYPE_float = 8,
+	ORB_FIELD_TYPE_double = 9,
+	ORB_FIELD_TYPE_bool = 10,
+	ORB_FIELD_TYPE_char = 11
+};
+
+/**
+ * Layout of one field of a topic.
+ */
+struct orb_field {
+	const char *name;		/**< member name */
+	uint16_t offset;		/**< offset in the topic structure */
+	uint8_t type;			/**< enum orb_field_type */
+	uint8_t count;			/**< number of elements, 1 unless an array */
+};
+
 /**
  * Object metadata.
  */
 struct orb_metadata {
 	const char *o_name;		/**< unique object name */
 	const size_t o_size;		/**< object size */
+	const unsigned o_id;		/**< enum orb_topic_id */
+	const struct orb_field *o_fields;	/**< field layout, or NULL if not described */
+	const unsigned o_nfields;	/**< number of entries in o_fields */
 };
 
 typedef const struct orb_metadata *orb_id_t;
@@ -93,7 +130,7 @@ typedef const struct orb_metadata *orb_id_t;
  * copies are accessing the right data.
  *
  * Note that there must be no more than one instance of this macro
- * for each topic.
+ * for each topic, and the topic must be listed in topic_list.h.
  *
  * @param _name		The name of the topic.
  * @param _struct	The structure the topic provides.
@@ -101,7 +138,56 @@ typedef const struct orb_metadata *orb_id_t;
 #define ORB_DEFINE(_name, _struct)			\
 	const struct orb_metadata __orb_##_name = {	\
 		#_name,					\
-		sizeof(_struct)				\
+		sizeof(_struct),			\
+		ORB_TOPIC_##_name,			\
+		0,					\
+		0					\
+	}; struct hack
+
+/**
+ * Describe one field of a topic structure.
+ *
+ * Used in the field lists given to ORB_DEFINE_FIELDS, which take the
+ * form
+ *
+ *	#define FOO_FIELDS(_F, _s)	\
+ *		_F(_s, timestamp, uint64_t)	\
+ *		_F(_s, values, float)
+ *
+ * Arrays are given with their element type.
+ *
+ * @param _struct	The structure the topic provides.
+ * @param _field	The member.
+ * @param _type		The member's C type, one of those in enum orb_field_type.
+ */
+#define ORB_FIELD(_struct, _field, _type)				\
+	{								\
+		#_field,						\
+		offsetof(_struct, _field),				\
+		ORB_FIELD_TYPE_##_type,					\
+		sizeof(((_struct *)0)->_field) / sizeof(_type)		\
+	},
+
+/**
+ * Define the uORB metadata for a topic, with its field layout.
+ *
+ * Like ORB_DEFINE, but also records the layout of the topic structure
+ * so that tools such as the logger can handle the topic generically.
+ *
+ * @param _name		The name of the topic.
+ * @param _struct	The structure the topic provides.
+ * @param _fields	The field list macro for the structure.
+ */
+#define ORB_DEFINE_FIELDS(_name, _struct, _fields)			\
+	static const struct orb_field __orb_fields_##_name[] = {	\
+		_fields(ORB_FIELD, _struct)				\
+	};								\
+	const struct orb_metadata __orb_##_name = {			\
+		#_name,							\
+		sizeof(_struct),					\
+		ORB_TOPIC_##_name,					\
+		__orb_fields_##_name,					\
+		sizeof(__orb_fields_##_name) / sizeof(__orb_fields_##_name[0])	\
 	}; struct hack
 
 __BEGIN_DECLS
@@ -140,6 +226,59 @@ typedef intptr_t	orb_advert_t;
  */
 extern orb_advert_t orb_advertise(const struct orb_metadata *meta, const void *data) __EXPORT;
 
+/**
+ * Advertise as the publisher of a queued topic.
+ *
+ * This behaves like orb_advertise, except that the topic keeps the most
+ * recent queue_size publications rather than only the latest one. Each
+ * subscriber consumes the queue independently: orb_copy returns the oldest
+ * publication that the subscriber has not yet seen, and orb_copy_queued
+ * can drain several at once. A subscriber only misses publications if it
+ * falls more than queue_size behind the publisher.
+ *
+ * The queue is sized by the first publication of the topic; a queue_size
+ * of 1 is equivalent to orb_advertise.
+ *
+ * @param meta		The uORB metadata (usually from the ORB_ID() macro)
+ *			for the topic.
+ * @param data		A pointer to the initial data to be published.
+ * @param queue_size	The number of publications to keep. This may not
+ *			exceed ORB_MAX_QUEUE_SIZE.
+ * @return		ERROR on error, otherwise returns a handle
+ *			that can be used to publish to the topic.
+ *			If the topic has already been published with a different
+ *			queue size, this function will return -1 and set errno
+ *			to EBUSY.
+ */
+extern orb_advert_t orb_advertise_queue(const struct orb_metadata *meta, const void *data,
+					unsigned queue_size) __EXPORT;
+
+/**
+ * Advertise as the publisher of one instance of a multi-instance topic.
+ *
+ * Some topics, such as those published by sensor drivers, can have several
+ * independent publishers at once, e.g. one for each of several redundant
+ * sensors. Each publisher advertises its own instance of the topic, which
+ * behaves as a separate topic, and subscribers choose which instance they
+ * want with orb_subscribe_multi.
+ *
+ * This claims the lowest-numbered instance that has not yet been advertised.
+ * Instance 0 is the same topic seen by orb_subscribe, so a single publisher
+ * using this call is indistinguishable from one using orb_advertise.
+ *
+ * @param meta		The uORB metadata (usually from the ORB_ID() macro)
+ *			for the topic.
+ * @param data		A pointer to the initial data to be published.
+ * @param instance	Returns the instance that was claimed.
+ * @return		ERROR on error, otherwise returns a handle
+ *			that can be used to publish to the topic instance.
+ *			If all ORB_MULTI_MAX_INSTANCES instances have been
+ *			advertised already, this function will return -1 and
+ *			set errno to EBUSY.
+ */
+extern orb_advert_t orb_advertise_multi(const struct orb_metadata *meta, const void *data,
+					int *instance) __EXPORT;
+
 /**
  * Publish new data to a topic.
  *
@@ -155,6 +294,37 @@ extern orb_advert_t orb_advertise(const struct orb_metadata *meta, const void *d
  */
 extern int	orb_publish(const struct orb_metadata *meta, orb_advert_t handle, const void *data) __EXPORT;
 
+/**
+ * Begin a publication in place.
+ *
+ * Returns a pointer to the buffer that the next publication to the topic
+ * will be made from. The caller fills in the whole object (the buffer holds
+ * stale data from an earlier publication) and then calls orb_publish_commit,
+ * which publishes it without copying.
+ *
+ * Unlike orb_publish, this must only be used when there is a single
+ * publisher to the topic, and it must not be used from interrupt context.
+ *
+ * @param meta		The uORB metadata (usually from the ORB_ID() macro)
+ *			for the topic.
+ * @param handle	The handle returned from orb_advertise.
+ * @return		A pointer to the object to fill in, or NULL with errno
+ *			set accordingly.
+ */
+extern void	*orb_publish_begin(const struct orb_metadata *meta, orb_advert_t handle) __EXPORT;
+
+/**
+ * Complete a publication started with orb_publish_begin.
+ *
+ * Subscribers are notified as for orb_publish.
+ *
+ * @param meta		The uORB metadata (usually from the ORB_ID() macro)
+ *			for the topic.
+ * @param handle	The handle returned from orb_advertise.
+ * @return		OK on success, ERROR otherwise with errno set accordingly.
+ */
+extern int	orb_publish_commit(const struct orb_metadata *meta, orb_advert_t handle) __EXPORT;
+
 /**
  * Subscribe to a topic.
  *
@@ -183,6 +353,36 @@ extern int	orb_publish(const struct orb_metadata *meta, orb_advert_t handle, con
  */
 extern int	orb_subscribe(const struct orb_metadata *meta) __EXPORT;
 
+/**
+ * Subscribe to one instance of a multi-instance topic.
+ *
+ * Subscription behaves as for orb_subscribe; in particular it will succeed
+ * even if the instance has not been advertised yet.
+ *
+ * @param meta		The uORB metadata (usually from the ORB_ID() macro)
+ *			for the topic.
+ * @param instance	The instance to subscribe to, less than
+ *			ORB_MULTI_MAX_INSTANCES. Instance 0 is the topic
+ *			returned by orb_subscribe.
+ * @return		ERROR on error, otherwise returns a handle
+ *			that can be used to read and update the topic.
+ */
+extern int	orb_subscribe_multi(const struct orb_metadata *meta, unsigned instance) __EXPORT;
+
+/**
+ * Count the published instances of a multi-instance topic.
+ *
+ * Instances are claimed lowest first, so these are normally instances
+ * 0 to instance_count - 1.
+ *
+ * @param meta		The uORB metadata (usually from the ORB_ID() macro)
+ *			for the topic.
+ * @param instance_count Returns the number of instances that have been
+ *			published to.
+ * @return		OK on success, ERROR otherwise with errno set accordingly.
+ */
+extern int	orb_group_count(const struct orb_metadata *meta, unsigned *instance_count) __EXPORT;
+
 /**
  * Unsubscribe from a topic.
  *
@@ -209,6 +409,26 @@ extern int	orb_unsubscribe(int handle) __EXPORT;
  */
 extern int	orb_copy(const struct orb_metadata *meta, int handle, void *buffer) __EXPORT;
 
+/**
+ * Fetch several publications from a queued topic.
+ *
+ * Copies up to count of the oldest publications that the subscriber has
+ * not yet seen, in the order in which they were published. If there are
+ * none, the most recent publication is copied, as for orb_copy.
+ *
+ * On topics that are not queued this is equivalent to orb_copy.
+ *
+ * @param meta		The uORB metadata (usually from the ORB_ID() macro)
+ *			for the topic.
+ * @param handle	A handle returned from orb_subscribe.
+ * @param buffer	Pointer to an array of count objects receiving the
+ *			data, or NULL if the caller only wants to consume them.
+ * @param count		The maximum number of publications to copy.
+ * @return		The number of publications copied, or ERROR with errno
+ *			set accordingly.
+ */
+extern int	orb_copy_queued(const struct orb_metadata *meta, int handle, void *buffer, unsigned count) __EXPORT;
+
 /**
  * Check whether a topic has been published to since the last orb_copy.
  *
@@ -259,6 +479,110 @@ extern int	orb_stat(int handle, uint64_t *time) __EXPORT;
  */
 extern int	orb_set_interval(int handle, unsigned interval) __EXPORT;
 
+/**
+ * Find a topic's metadata by name.
+ *
+ * Looks at every topic in topic_list.h that is linked into the build,
+ * whether or not it has a node yet.
+ *
+ * @param name		The topic name, e.g. "sensor_combined".
+ * @return		The metadata, or NULL if the topic is not known.
+ */
+extern const struct orb_metadata *orb_find_topic(const char *name) __EXPORT;
+
+/**
+ * ORB direct-call subscription handle.
+ *
+ * A direct-call subscription refers straight to the topic node, so that
+ * orb_copy_direct and orb_check_direct are plain function calls rather
+ * than read() and ioctl() calls through the VFS. It is backed by an
+ * ordinary subscription file descriptor, which may still be passed to
+ * poll(), orb_stat and orb_set_interval, and which shares the update
+ * state with the direct calls.
+ *
+ * Direct-call handles belong to the task that created them and must not
+ * be shared with other tasks.
+ */
+typedef struct orb_subscription *orb_sub_t;
+
+/**
+ * Subscribe to a topic using a direct-call handle.
+ *
+ * Subscription behaves as for orb_subscribe.
+ *
+ * @param meta		The uORB metadata (usually from the ORB_ID() macro)
+ *			for the topic.
+ * @return		NULL on error with errno set accordingly, otherwise a
+ *			direct-call subscription handle.
+ */
+extern orb_sub_t orb_subscribe_direct(const struct orb_metadata *meta) __EXPORT;
+
+/**
+ * Unsubscribe a direct-call handle.
+ *
+ * This also closes the file descriptor backing the handle.
+ *
+ * @param handle	A handle returned from orb_subscribe_direct.
+ * @return		OK on success, ERROR otherwise with errno set accordingly.
+ */
+extern int	orb_unsubscribe_direct(orb_sub_t handle) __EXPORT;
+
+/**
+ * Fetch the file descriptor backing a direct-call handle.
+ *
+ * @param handle	A handle returned from orb_subscribe_direct.
+ * @return		A file descriptor usable with poll() and the other
+ *			orb_ calls that take a subscription handle.
+ */
+extern int	orb_sub_fd(orb_sub_t handle) __EXPORT;
+
+/**
+ * Fetch data from a topic using a direct-call handle.
+ *
+ * Semantics are as for orb_copy.
+ *
+ * @param meta		The uORB metadata (usually from the ORB_ID() macro)
+ *			for the topic.
+ * @param handle	A handle returned from orb_subscribe_direct.
+ * @param buffer	Pointer to the buffer receiving the data, or NULL
+ *			if the caller wants to clear the updated flag without
+ *			using the data.
+ * @return		OK on success, ERROR otherwise with errno set accordingly.
+ */
+extern int	orb_copy_direct(const struct orb_metadata *meta, orb_sub_t handle, void *buffer) __EXPORT;
+
+/**
+ * Fetch data from a topic without copying it, using a direct-call handle.
+ *
+ * Like orb_copy_direct, this resets the updated flag for the handle and
+ * consumes one publication from a queued topic, but it returns a pointer
+ * to the topic's own copy of the data instead of copying it out.
+ *
+ * The data will not change until the topic has been published to again;
+ * after that it may be overwritten at any time, so the caller must be
+ * finished with it before the next publication is due, and must never
+ * write to it.
+ *
+ * @param handle	A handle returned from orb_subscribe_direct.
+ * @param data		Set to point at the data.
+ * @return		OK on success, ERROR otherwise with errno set accordingly.
+ */
+extern int	orb_peek(orb_sub_t handle, const void **data) __EXPORT;
+
+/**
+ * Check whether a topic has been published to since the last copy, using
+ * a direct-call handle.
+ *
+ * Semantics are as for orb_check.
+ *
+ * @param handle	A handle returned from orb_subscribe_direct.
+ * @param updated	Set to true if the topic has been updated since the
+ *			last time it was copied using this handle.
+ * @return		OK if the check was successful, ERROR otherwise with
+ *			errno set accordingly.
+ */
+extern int	orb_check_direct(orb_sub_t handle, bool *updated) __EXPORT;
+
 __END_DECLS
 
 #endif /* _UORB_UORB_H */
@@ -0,0 +1,401 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file hrt.c
+ *
+ * High-resolution timer callouts and timekeeping for POSIX hosts.
+ *
+ * Time comes from the monotonic clock.  Callouts are run by a dedicated
+ * thread with the interrupt lock held, so they are serialised against
+ * irqsave() sections just as the timer interrupt is on the target.
+ *
+ * In virtual time (see hrt_set_virtual_time) the clock only moves when
+ * it is set, and due callouts are run by the thread that sets it.
+ */
+
+#include <nuttx/config.h>
+#include <nuttx/arch.h>
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include <queue.h>
+#include <errno.h>
+#include <string.h>
+
+#include <drivers/drv_hrt.h>
+
+#include "posix.h"
+
+/*
+ * Longest the callout thread sleeps without re-checking the queue.
+ */
+#define HRT_INTERVAL_MAX	50000
+
+/*
+ * Queue of callout entries.
+ */
+static struct sq_queue_s	callout_queue;
+
+/* signalled when the head of the callout queue changes */
+static pthread_cond_t		callout_cond;
+
+static pthread_t		callout_thread;
+static bool			hrt_running;
+
+/* if true, time is virtual_now rather than the monotonic clock */
+static volatile bool		virtual_time;
+static volatile hrt_abstime	virtual_now;
+
+static void		hrt_call_internal(struct hrt_call *entry,
+		hrt_abstime deadline,
+		hrt_abstime interval,
+		hrt_callout callout,
+		void *arg);
+static void		hrt_call_enter(struct hrt_call *entry);
+static void		hrt_call_reschedule(void);
+static void		hrt_call_invoke(void);
+static void		*hrt_thread_main(void *arg);
+
+/*
+ * Fetch a never-wrapping absolute time value in microseconds from
+ * some arbitrary epoch.
+ */
+hrt_abstime
+hrt_absolute_time(void)
+{
+	struct timespec ts;
+
+	if (virtual_time)
+		return virtual_now;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts_to_abstime(&ts);
+}
+
+/*
+ * Switch to virtual time and advance it.
+ */
+void
+hrt_set_virtual_time(hrt_abstime now)
+{
+	irqstate_t flags = irqsave();
+
+	if (!virtual_time || (now > virtual_now)) {
+		virtual_now = now;
+		virtual_time = true;
+	}
+
+	/* stand in for the timer interrupt */
+	bool was_interrupt = up_interrupt_context();
+	posix_interrupt_context(true);
+	hrt_call_invoke();
+	posix_interrupt_context(was_interrupt);
+
+	irqrestore(flags);
+}
+
+/*
+ * Convert a timespec to absolute time
+ */
+hrt_abstime
+ts_to_abstime(struct timespec *ts)
+{
+	hrt_abstime	result;
+
+	result = (hrt_abstime)(ts->tv_sec) * 1000000;
+	result += ts->tv_nsec / 1000;
+
+	return result;
+}
+
+/*
+ * Convert absolute time to a timespec.
+ */
+void
+abstime_to_ts(struct timespec *ts, hrt_abstime abstime)
+{
+	ts->tv_sec = abstime / 1000000;
+	abstime -= ts->tv_sec * 1000000;
+	ts->tv_nsec = abstime * 1000;
+}
+
+/*
+ * Compare a time value with the current time.
+ */
+hrt_abstime
+hrt_elapsed_time(const volatile hrt_abstime *then)
+{
+	irqstate_t flags = irqsave();
+
+	hrt_abstime delta = hrt_absolute_time() - *then;
+
+	irqrestore(flags);
+
+	return delta;
+}
+
+/*
+ * Store the absolute time in an interrupt-safe fashion
+ */
+hrt_abstime
+hrt_store_absolute_time(volatile hrt_abstime *now)
+{
+	irqstate_t flags = irqsave();
+
+	hrt_abstime ts = hrt_absolute_time();
+	*now = ts;
+
+	irqrestore(flags);
+
+	return ts;
+}
+
+/*
+ * Initalise the high-resolution timing module and start the callout thread.
+ */
+void
+hrt_init(void)
+{
+	pthread_condattr_t attr;
+
+	if (hrt_running)
+		return;
+
+	sq_init(&callout_queue);
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&callout_cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	if (pthread_create(&callout_thread, NULL, hrt_thread_main, NULL) == 0)
+		hrt_running = true;
+}
+
+/*
+ * Call callout(arg) after interval has elapsed.
+ */
+void
+hrt_call_after(struct hrt_call *entry, hrt_abstime delay, hrt_callout callout, void *arg)
+{
+	hrt_call_internal(entry,
+			  hrt_absolute_time() + delay,
+			  0,
+			  callout,
+			  arg);
+}
+
+/*
+ * Call callout(arg) at calltime.
+ */
+void
+hrt_call_at(struct hrt_call *entry, hrt_abstime calltime, hrt_callout callout, void *arg)
+{
+	hrt_call_internal(entry, calltime, 0, callout, arg);
+}
+
+/*
+ * Call callout(arg) every period.
+ */
+void
+hrt_call_every(struct hrt_call *entry, hrt_abstime delay, hrt_abstime interval, hrt_callout callout, void *arg)
+{
+	hrt_call_internal(entry,
+			  hrt_absolute_time() + delay,
+			  interval,
+			  callout,
+			  arg);
+}
+
+static void
+hrt_call_internal(struct hrt_call *entry, hrt_abstime deadline, hrt_abstime interval, hrt_callout callout, void *arg)
+{
+	irqstate_t flags = irqsave();
+
+	/* if the entry is currently queued, remove it */
+	if (entry->deadline != 0)
+		sq_rem(&entry->link, &callout_queue);
+
+	entry->deadline = deadline;
+	entry->period = interval;
+	entry->callout = callout;
+	entry->arg = arg;
+
+	hrt_call_enter(entry);
+
+	irqrestore(flags);
+}
+
+/*
+ * If this returns true, the call has been invoked and removed from the callout list.
+ *
+ * Always returns false for repeating callouts.
+ */
+bool
+hrt_called(struct hrt_call *entry)
+{
+	return (entry->deadline == 0);
+}
+
+/*
+ * Remove the entry from the callout list.
+ */
+void
+hrt_cancel(struct hrt_call *entry)
+{
+	irqstate_t flags = irqsave();
+
+	sq_rem(&entry->link, &callout_queue);
+	entry->deadline = 0;
+
+	/* if this is a periodic call being removed by the callout, prevent it from
+	 * being re-entered when the callout returns.
+	 */
+	entry->period = 0;
+
+	irqrestore(flags);
+}
+
+static void
+hrt_call_enter(struct hrt_call *entry)
+{
+	struct hrt_call	*call, *next;
+
+	call = (struct hrt_call *)sq_peek(&callout_queue);
+
+	if ((call == NULL) || (entry->deadline < call->deadline)) {
+		sq_addfirst(&entry->link, &callout_queue);
+		/* we changed the next deadline, wake the callout thread */
+		hrt_call_reschedule();
+
+	} else {
+		do {
+			next = (struct hrt_call *)sq_next(&call->link);
+
+			if ((next == NULL) || (entry->deadline < next->deadline)) {
+				sq_addafter(&call->link, &entry->link, &callout_queue);
+				break;
+			}
+		} while ((call = next) != NULL);
+	}
+}
+
+static void
+hrt_call_invoke(void)
+{
+	struct hrt_call	*call;
+	hrt_abstime deadline;
+
+	while (true) {
+		/* get the current time */
+		hrt_abstime now = hrt_absolute_time();
+
+		call = (struct hrt_call *)sq_peek(&callout_queue);
+
+		if (call == NULL)
+			break;
+
+		if (call->deadline > now)
+			break;
+
+		sq_rem(&call->link, &callout_queue);
+
+		/* save the intended deadline for periodic calls */
+		deadline = call->deadline;
+
+		/* zero the deadline, as the call has occurred */
+		call->deadline = 0;
+
+		/* invoke the callout (if there is one) */
+		if (call->callout)
+			call->callout(call->arg);
+
+		/* if the callout has a non-zero period, it has to be re-entered */
+		if (call->period != 0) {
+			call->deadline = deadline + call->period;
+			hrt_call_enter(call);
+		}
+	}
+}
+
+/*
+ * Wake the callout thread to re-evaluate its deadline.
+ *
+ * This routine must be called with the interrupt lock held.
+ */
+static void
+hrt_call_reschedule()
+{
+	pthread_cond_signal(&callout_cond);
+}
+
+/*
+ * The callout thread stands in for the timer interrupt; it holds the
+ * interrupt lock except while sleeping until the next deadline.
+ */
+static void *
+hrt_thread_main(void *arg)
+{
+	irqsave();
+	posix_interrupt_context(true);
+
+	for (;;) {
+		/* in virtual time, callouts are run by hrt_set_virtual_time */
+		if (virtual_time) {
+			pthread_cond_wait(&callout_cond, &posix_irq_lock);
+			continue;
+		}
+
+		hrt_call_invoke();
+
+		hrt_abstime now = hrt_absolute_time();
+		hrt_abstime deadline = now + HRT_INTERVAL_MAX;
+		struct hrt_call	*next = (struct hrt_call *)sq_peek(&callout_queue);
+
+		if ((next != NULL) && (next->deadline < deadline))
+			deadline = next->deadline;
+
+		if (deadline > now) {
+			struct timespec ts;
+
+			abstime_to_ts(&ts, deadline);
+			pthread_cond_timedwait(&callout_cond, &posix_irq_lock, &ts);
+		}
+	}
+
+	return NULL;
+}
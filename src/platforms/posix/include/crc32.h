@@ -0,0 +1,68 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file crc32.h
+ *
+ * Host stand-in for the NuttX CRC-32 routines.
+ */
+
+#ifndef _POSIX_CRC32_H
+#define _POSIX_CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+__BEGIN_DECLS
+
+/**
+ * Continue a CRC-32 over another block of data.
+ *
+ * As in NuttX, the value is neither pre- nor post-inverted.
+ *
+ * @param src		The data.
+ * @param len		The number of bytes of data.
+ * @param crc32val	The CRC of the preceding data, or zero to start.
+ * @return		The CRC including the new data.
+ */
+__EXPORT uint32_t	crc32part(const uint8_t *src, size_t len, uint32_t crc32val);
+
+/**
+ * Compute the CRC-32 of a block of data.
+ */
+__EXPORT uint32_t	crc32(const uint8_t *src, size_t len);
+
+__END_DECLS
+
+#endif /* _POSIX_CRC32_H */
@@ -0,0 +1,68 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file arch.h
+ *
+ * Host stand-in for the NuttX architecture interface.
+ */
+
+#ifndef _POSIX_NUTTX_ARCH_H
+#define _POSIX_NUTTX_ARCH_H
+
+#include <stdbool.h>
+#include <errno.h>
+
+#include <arch/irq.h>
+
+typedef int (*xcpt_t)(int irq, void *context);
+
+__BEGIN_DECLS
+
+/**
+ * Test whether the caller is running in "interrupt" context.
+ *
+ * On the host this is true only for high-resolution timer callouts.
+ */
+__EXPORT bool		up_interrupt_context(void);
+
+/*
+ * Devices on the host have no interrupts to attach.
+ */
+static inline void	up_enable_irq(int irq) {}
+static inline void	up_disable_irq(int irq) {}
+static inline int	irq_attach(int irq, xcpt_t isr) { return -ENOSYS; }
+
+__END_DECLS
+
+#endif /* _POSIX_NUTTX_ARCH_H */
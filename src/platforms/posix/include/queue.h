@@ -0,0 +1,71 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file queue.h
+ *
+ * Host implementation of the NuttX singly-linked queues.
+ */
+
+#ifndef _POSIX_QUEUE_H
+#define _POSIX_QUEUE_H
+
+#include <stddef.h>
+
+struct sq_entry_s {
+	struct sq_entry_s	*flink;
+};
+typedef struct sq_entry_s sq_entry_t;
+
+struct sq_queue_s {
+	sq_entry_t		*head;
+	sq_entry_t		*tail;
+};
+typedef struct sq_queue_s sq_queue_t;
+
+#define sq_init(q)		do { (q)->head = NULL; (q)->tail = NULL; } while (0)
+#define sq_next(p)		((p)->flink)
+#define sq_peek(q)		((q)->head)
+#define sq_empty(q)		((q)->head == NULL)
+
+__BEGIN_DECLS
+
+__EXPORT void	sq_addfirst(sq_entry_t *node, sq_queue_t *queue);
+__EXPORT void	sq_addlast(sq_entry_t *node, sq_queue_t *queue);
+__EXPORT void	sq_addafter(sq_entry_t *prev, sq_entry_t *node, sq_queue_t *queue);
+__EXPORT void	sq_rem(sq_entry_t *node, sq_queue_t *queue);
+__EXPORT sq_entry_t *sq_remfirst(sq_queue_t *queue);
+
+__END_DECLS
+
+#endif /* _POSIX_QUEUE_H */
@@ -0,0 +1,92 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file irq.c
+ *
+ * Host emulation of interrupt masking and interrupt context.
+ */
+
+#include <nuttx/config.h>
+#include <nuttx/arch.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "posix.h"
+
+pthread_mutex_t posix_irq_lock;
+
+static __thread bool in_interrupt;
+
+/*
+ * The lock must be recursive, as callouts and notifiers nest irqsave()
+ * sections.  Set it up before anything can run.
+ */
+static void irq_init(void) __attribute__((constructor));
+
+static void
+irq_init(void)
+{
+	pthread_mutexattr_t attr;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&posix_irq_lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+irqstate_t
+irqsave(void)
+{
+	pthread_mutex_lock(&posix_irq_lock);
+	return 0;
+}
+
+void
+irqrestore(irqstate_t flags)
+{
+	pthread_mutex_unlock(&posix_irq_lock);
+}
+
+bool
+up_interrupt_context(void)
+{
+	return in_interrupt;
+}
+
+void
+posix_interrupt_context(bool enter)
+{
+	in_interrupt = enter;
+}
@@ -0,0 +1,178 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file main.cpp
+ *
+ * Host program that runs PX4 shell commands against an in-process uORB.
+ *
+ * Usage: px4_posix <command> [args...]
+ *
+ * With no arguments, commands are read one per line from stdin.
+ */
+
+#include <nuttx/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <drivers/drv_hrt.h>
+
+extern "C" {
+	int uorb_main(int argc, char *argv[]);
+	int test_param(int argc, char *argv[]);
+	int test_perf(int argc, char *argv[]);
+	int test_bson(int argc, char *argv[]);
+	int test_logbuffer(int argc, char *argv[]);
+	int test_sensor_select(int argc, char *argv[]);
+	int trace_main(int argc, char *argv[]);
+}
+
+namespace
+{
+
+/* longest command line accepted on stdin */
+const unsigned max_line = 256;
+const unsigned max_args = 16;
+
+struct builtin {
+	const char	*name;
+	int		(*main)(int argc, char *argv[]);
+};
+
+/*
+ * The tests from systemcmds/tests that can run on the host.
+ */
+const struct builtin tests[] = {
+	{"param",	test_param},
+	{"perf",	test_perf},
+	{"bson",	test_bson},
+	{"logbuffer",	test_logbuffer},
+	{"sensor_select", test_sensor_select},
+	{nullptr,	nullptr}
+};
+
+int
+tests_main(int argc, char *argv[])
+{
+	if (argc > 1)
+		for (unsigned i = 0; tests[i].name != nullptr; i++)
+			if (!strcmp(tests[i].name, argv[1]))
+				return tests[i].main(argc - 1, argv + 1);
+
+	fprintf(stderr, "usage: tests <test>; host tests are:");
+
+	for (unsigned i = 0; tests[i].name != nullptr; i++)
+		fprintf(stderr, " %s", tests[i].name);
+
+	fprintf(stderr, "\n");
+	return ERROR;
+}
+
+const struct builtin builtins[] = {
+	{"uorb",	uorb_main},
+	{"tests",	tests_main},
+	{"trace",	trace_main},
+	{nullptr,	nullptr}
+};
+
+int
+run(int argc, char *argv[])
+{
+	for (unsigned i = 0; builtins[i].name != nullptr; i++)
+		if (!strcmp(builtins[i].name, argv[0]))
+			return builtins[i].main(argc, argv);
+
+	fprintf(stderr, "%s: command not found\n", argv[0]);
+	return ERROR;
+}
+
+int
+shell()
+{
+	char line[max_line];
+	int ret = OK;
+
+	for (;;) {
+		char *argv[max_args + 1];
+		int argc = 0;
+
+		if (isatty(STDIN_FILENO)) {
+			printf("px4> ");
+			fflush(stdout);
+		}
+
+		if (fgets(line, sizeof(line), stdin) == nullptr)
+			break;
+
+		for (char *tok = strtok(line, " \t\r\n");
+		     (tok != nullptr) && (argc < (int)max_args);
+		     tok = strtok(nullptr, " \t\r\n"))
+			argv[argc++] = tok;
+
+		argv[argc] = nullptr;
+
+		/* skip blank lines and comments */
+		if ((argc == 0) || (argv[0][0] == '#'))
+			continue;
+
+		if (run(argc, argv) != OK)
+			ret = ERROR;
+	}
+
+	return ret;
+}
+
+} // namespace
+
+int
+main(int argc, char *argv[])
+{
+	char start_name[] = "uorb";
+	char start_cmd[] = "start";
+	char *start_argv[] = {start_name, start_cmd, nullptr};
+
+	/* keep output in order when stdout is not a terminal */
+	setvbuf(stdout, nullptr, _IOLBF, 0);
+
+	hrt_init();
+
+	if (uorb_main(2, start_argv) != OK)
+		return 1;
+
+	int ret = (argc > 1) ? run(argc - 1, &argv[1]) : shell();
+
+	return (ret == OK) ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file queue.c
+ *
+ * Host implementation of the NuttX singly-linked queues.
+ */
+
+#include <nuttx/config.h>
+
+#include <queue.h>
+
+void
+sq_addfirst(sq_entry_t *node, sq_queue_t *queue)
+{
+	node->flink = queue->head;
+
+	if (queue->head == NULL)
+		queue->tail = node;
+
+	queue->head = node;
+}
+
+void
+sq_addlast(sq_entry_t *node, sq_queue_t *queue)
+{
+	node->flink = NULL;
+
+	if (queue->head == NULL) {
+		queue->head = node;
+
+	} else {
+		queue->tail->flink = node;
+	}
+
+	queue->tail = node;
+}
+
+void
+sq_addafter(sq_entry_t *prev, sq_entry_t *node, sq_queue_t *queue)
+{
+	if (queue->head == NULL || queue->tail == prev) {
+		sq_addlast(node, queue);
+
+	} else {
+		node->flink = prev->flink;
+		prev->flink = node;
+	}
+}
+
+void
+sq_rem(sq_entry_t *node, sq_queue_t *queue)
+{
+	if (queue->head == NULL || node == NULL)
+		return;
+
+	if (node == queue->head) {
+		queue->head = node->flink;
+
+		if (queue->head == NULL)
+			queue->tail = NULL;
+
+	} else {
+		sq_entry_t *prev;
+
+		/* not being in the queue is not an error */
+		for (prev = queue->head; prev != NULL && prev->flink != node; prev = prev->flink)
+			;
+
+		if (prev == NULL)
+			return;
+
+		prev->flink = node->flink;
+
+		if (queue->tail == node)
+			queue->tail = prev;
+	}
+
+	node->flink = NULL;
+}
+
+sq_entry_t *
+sq_remfirst(sq_queue_t *queue)
+{
+	sq_entry_t *node = queue->head;
+
+	if (node != NULL)
+		sq_rem(node, queue);
+
+	return node;
+}
@@ -0,0 +1,358 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file vfs.cpp
+ *
+ * In-process stand-in for the NuttX VFS on POSIX hosts.
+ *
+ * Drivers registered with register_driver() are kept in a private table,
+ * and the px4_* file operations dispatch to them through a private file
+ * descriptor table.  These descriptors are unrelated to the host's own.
+ */
+
+#include <nuttx/config.h>
+#include <nuttx/fs/fs.h>
+#include <arch/irq.h>
+
+#include <drivers/device/vfs.h>
+#include <drivers/drv_hrt.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+
+namespace
+{
+
+/* maximum number of registered drivers */
+const unsigned max_inodes = 256;
+
+/* maximum number of simultaneously open files */
+const unsigned max_files = CONFIG_NFILE_DESCRIPTORS;
+
+struct inode	*inodes[max_inodes];
+struct file	*files[max_files];
+
+/* protects the driver and file tables */
+pthread_mutex_t	vfs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+struct inode *
+inode_find(const char *path)
+{
+	for (unsigned i = 0; i < max_inodes; i++)
+		if ((inodes[i] != nullptr) && !strcmp(inodes[i]->i_name, path))
+			return inodes[i];
+
+	return nullptr;
+}
+
+struct file *
+file_get(int fd)
+{
+	struct file *filp = nullptr;
+
+	pthread_mutex_lock(&vfs_lock);
+
+	if ((fd >= 0) && ((unsigned)fd < max_files))
+		filp = files[fd];
+
+	pthread_mutex_unlock(&vfs_lock);
+
+	return filp;
+}
+
+/**
+ * Convert a driver return value to the POSIX convention.
+ */
+int
+vfs_result(int ret)
+{
+	if (ret < 0) {
+		errno = -ret;
+		return ERROR;
+	}
+
+	return ret;
+}
+
+} // namespace
+
+int
+register_driver(const char *path, const struct file_operations *fops, mode_t mode, void *priv)
+{
+	int ret = -ENOMEM;
+
+	pthread_mutex_lock(&vfs_lock);
+
+	if (inode_find(path) != nullptr) {
+		ret = -EEXIST;
+
+	} else {
+		for (unsigned i = 0; i < max_inodes; i++) {
+			if (inodes[i] == nullptr) {
+				struct inode *node = new struct inode;
+
+				node->i_ops = fops;
+				node->i_private = priv;
+				node->i_name = strdup(path);
+
+				inodes[i] = node;
+				ret = OK;
+				break;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&vfs_lock);
+
+	return ret;
+}
+
+int
+unregister_driver(const char *path)
+{
+	int ret = -ENOENT;
+
+	pthread_mutex_lock(&vfs_lock);
+
+	for (unsigned i = 0; i < max_inodes; i++) {
+		if ((inodes[i] != nullptr) && !strcmp(inodes[i]->i_name, path)) {
+			free(inodes[i]->i_name);
+			delete inodes[i];
+			inodes[i] = nullptr;
+			ret = OK;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&vfs_lock);
+
+	return ret;
+}
+
+int
+px4_open(const char *path, int flags, ...)
+{
+	struct inode *node;
+	struct file *filp;
+	int fd = -1;
+
+	pthread_mutex_lock(&vfs_lock);
+
+	node = inode_find(path);
+
+	if (node != nullptr) {
+		for (unsigned i = 0; i < max_files; i++) {
+			if (files[i] == nullptr) {
+				fd = i;
+				break;
+			}
+		}
+	}
+
+	if (fd < 0) {
+		pthread_mutex_unlock(&vfs_lock);
+		errno = (node == nullptr) ? ENOENT : ENFILE;
+		return ERROR;
+	}
+
+	filp = new struct file;
+	filp->f_oflags = flags;
+	filp->f_priv = nullptr;
+	filp->f_inode = node;
+
+	/* reserve the descriptor while the driver decides */
+	files[fd] = filp;
+
+	pthread_mutex_unlock(&vfs_lock);
+
+	int ret = OK;
+
+	if (node->i_ops->open != nullptr)
+		ret = node->i_ops->open(filp);
+
+	if (ret < 0) {
+		pthread_mutex_lock(&vfs_lock);
+		files[fd] = nullptr;
+		pthread_mutex_unlock(&vfs_lock);
+
+		delete filp;
+		return vfs_result(ret);
+	}
+
+	return fd;
+}
+
+int
+px4_close(int fd)
+{
+	struct file *filp = file_get(fd);
+	int ret = OK;
+
+	if (filp == nullptr) {
+		errno = EBADF;
+		return ERROR;
+	}
+
+	if (filp->f_inode->i_ops->close != nullptr)
+		ret = filp->f_inode->i_ops->close(filp);
+
+	pthread_mutex_lock(&vfs_lock);
+	files[fd] = nullptr;
+	pthread_mutex_unlock(&vfs_lock);
+
+	delete filp;
+
+	return vfs_result(ret);
+}
+
+ssize_t
+px4_read(int fd, void *buffer, size_t buflen)
+{
+	struct file *filp = file_get(fd);
+
+	if (filp == nullptr) {
+		errno = EBADF;
+		return ERROR;
+	}
+
+	if (filp->f_inode->i_ops->read == nullptr) {
+		errno = ENOSYS;
+		return ERROR;
+	}
+
+	return vfs_result(filp->f_inode->i_ops->read(filp, (char *)buffer, buflen));
+}
+
+ssize_t
+px4_write(int fd, const void *buffer, size_t buflen)
+{
+	struct file *filp = file_get(fd);
+
+	if (filp == nullptr) {
+		errno = EBADF;
+		return ERROR;
+	}
+
+	if (filp->f_inode->i_ops->write == nullptr) {
+		errno = ENOSYS;
+		return ERROR;
+	}
+
+	return vfs_result(filp->f_inode->i_ops->write(filp, (const char *)buffer, buflen));
+}
+
+int
+px4_ioctl(int fd, int cmd, unsigned long arg)
+{
+	struct file *filp = file_get(fd);
+
+	if (filp == nullptr) {
+		errno = EBADF;
+		return ERROR;
+	}
+
+	if (filp->f_inode->i_ops->ioctl == nullptr) {
+		errno = ENOTTY;
+		return ERROR;
+	}
+
+	return vfs_result(filp->f_inode->i_ops->ioctl(filp, cmd, arg));
+}
+
+int
+px4_poll(px4_pollfd_struct_t *fds, nfds_t nfds, int timeout)
+{
+	sem_t sem;
+	int count = 0;
+
+	sem_init(&sem, 0, 0);
+
+	/*
+	 * Set up the waiters; any driver with an event already pending
+	 * posts the semaphore straight away.
+	 */
+	for (nfds_t i = 0; i < nfds; i++) {
+		struct file *filp = file_get(fds[i].fd);
+
+		fds[i].sem = &sem;
+		fds[i].revents = 0;
+		fds[i].priv = nullptr;
+
+		if ((filp == nullptr) || (filp->f_inode->i_ops->poll == nullptr)) {
+			fds[i].revents = POLLNVAL;
+			sem_post(&sem);
+
+		} else if (filp->f_inode->i_ops->poll(filp, &fds[i], true) != OK) {
+			fds[i].revents = POLLERR;
+			sem_post(&sem);
+		}
+	}
+
+	/* wait for a notification or the timeout */
+	if (timeout < 0) {
+		while ((sem_wait(&sem) != 0) && (errno == EINTR))
+			;
+
+	} else if (timeout > 0) {
+		struct timespec ts;
+
+		clock_gettime(CLOCK_REALTIME, &ts);
+		abstime_to_ts(&ts, ts_to_abstime(&ts) + (hrt_abstime)timeout * 1000);
+
+		while ((sem_timedwait(&sem, &ts) != 0) && (errno == EINTR))
+			;
+	}
+
+	/* tear down the waiters and count the descriptors with events */
+	for (nfds_t i = 0; i < nfds; i++) {
+		struct file *filp = file_get(fds[i].fd);
+
+		if ((filp != nullptr) && (filp->f_inode->i_ops->poll != nullptr) &&
+		    !(fds[i].revents & (POLLNVAL | POLLERR)))
+			filp->f_inode->i_ops->poll(filp, &fds[i], false);
+
+		if (fds[i].revents != 0)
+			count++;
+	}
+
+	sem_destroy(&sem);
+
+	return count;
+}
@@ -157,6 +157,19 @@ do_save(const char* param_file_name)
 static void
 do_load(const char* param_file_name)
 {
+	/* load the default file so that later saves can append to its journal */
+	if (!strcmp(param_file_name, param_get_default_file())) {
+		int result = param_load_default();
+
+		if (result < 0)
+			errx(1, "error importing from '%s'", param_file_name);
+
+		if (result > 0)
+			warnx("no parameter file '%s'", param_file_name);
+
+		exit(0);
+	}
+
 	int fd = open(param_file_name, O_RDONLY);
 
 	if (fd < 0)
@@ -36,6 +36,7 @@
 #
 
 MODULE_COMMAND	 = perf
-SRCS		 = perf.c
+SRCS		 = perf.c \
+		   perf_export.c
 
 MAXOPTIMIZATION	 = -Os
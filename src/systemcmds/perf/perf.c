@@ -39,19 +39,87 @@
 #include <nuttx/config.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
 #include <string.h>
+#include <nuttx/wqueue.h>
+#include <nuttx/clock.h>
 
 #include "systemlib/perf_counter.h"
+#include "perf_export.h"
 
 
 /****************************************************************************
  * Definitions
  ****************************************************************************/
 
+/* counters published per batch; must fit the perf_counter topic queue */
+#define PERF_EXPORT_BATCH		8
+
+/* delay between batches of one pass, giving subscribers time to drain */
+#define PERF_EXPORT_BATCH_DELAY		USEC2TICK(10000)
+
+/* default interval between passes in milliseconds */
+#define PERF_EXPORT_INTERVAL_DEFAULT	1000
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
 
+static struct work_s	perf_export_work;
+static bool		perf_export_running = false;
+static unsigned		perf_export_interval;
+static unsigned		perf_export_next;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void
+perf_export_cycle(void *arg)
+{
+	if (!perf_export_running)
+		return;
+
+	perf_export_next = perf_export(perf_export_next, PERF_EXPORT_BATCH);
+
+	/* continue the pass shortly, or wait for the next one */
+	work_queue(LPWORK, &perf_export_work, perf_export_cycle, NULL,
+		   (perf_export_next != 0) ? PERF_EXPORT_BATCH_DELAY : USEC2TICK(perf_export_interval * 1000));
+}
+
+static int
+perf_export_command(int argc, char *argv[])
+{
+	if ((argc > 2) && !strcmp(argv[2], "stop")) {
+		if (perf_export_running) {
+			perf_export_running = false;
+			work_cancel(LPWORK, &perf_export_work);
+		}
+
+		return 0;
+	}
+
+	perf_export_interval = PERF_EXPORT_INTERVAL_DEFAULT;
+
+	if (argc > 2) {
+		perf_export_interval = strtoul(argv[2], NULL, 10);
+
+		if (perf_export_interval == 0) {
+			printf("perf export: bad interval '%s'\n", argv[2]);
+			return -1;
+		}
+	}
+
+	if (!perf_export_running) {
+		perf_export_running = true;
+		perf_export_next = 0;
+		work_queue(LPWORK, &perf_export_work, perf_export_cycle, NULL, 0);
+	}
+
+	return 0;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -69,7 +137,10 @@ int perf_main(int argc, char *argv[])
 			perf_reset_all();
 			return 0;
 		}
-		printf("Usage: perf <reset>\n");
+		if (strcmp(argv[1], "export") == 0) {
+			return perf_export_command(argc, argv);
+		}
+		printf("Usage: perf [reset | export [<interval ms> | stop]]\n");
 		return -1;
 	}
 
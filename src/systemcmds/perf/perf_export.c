@@ -0,0 +1,103 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file perf_export.c
+ * Export of performance counters on the perf_counter topic.
+ *
+ * This lives outside systemlib, which is also built into the IO firmware
+ * where there is no uORB.
+ */
+
+#include <nuttx/config.h>
+#include <string.h>
+#include <drivers/drv_hrt.h>
+
+#include <uORB/uORB.h>
+#include <uORB/topics/perf_counter.h>
+
+#include "systemlib/perf_counter.h"
+#include "perf_export.h"
+
+/** performance counter topic */
+ORB_DEFINE(perf_counter, struct perf_counter_s);
+
+/** performance counter topic handle */
+static orb_advert_t	perf_export_pub = -1;
+
+static uint32_t
+perf_clamp32(uint64_t time)
+{
+	return (time > UINT32_MAX) ? UINT32_MAX : time;
+}
+
+unsigned
+perf_export(unsigned start, unsigned max)
+{
+	struct perf_snapshot_s snapshot;
+	struct perf_counter_s s;
+	hrt_abstime now = hrt_absolute_time();
+	int id = perf_snapshot(start, &snapshot);
+
+	for (; (id >= 0) && (max > 0); max--) {
+		memset(&s, 0, sizeof(s));
+		s.timestamp = now;
+		s.event_count = snapshot.event_count;
+		s.time_total = snapshot.time_total;
+		s.time_least = perf_clamp32(snapshot.time_least);
+		s.time_most = perf_clamp32(snapshot.time_most);
+
+		for (unsigned i = 0; i < sizeof(s.percentile) / sizeof(s.percentile[0]); i++)
+			s.percentile[i] = perf_clamp32(snapshot.percentile[i]);
+
+		s.overflow = snapshot.overflow;
+		s.id = snapshot.id;
+		s.type = snapshot.type;
+		strncpy(s.name, snapshot.name, sizeof(s.name) - 1);
+
+		/*
+		 * If we don't have a handle to our topic, create one now; otherwise
+		 * just publish.
+		 */
+		if (perf_export_pub == -1) {
+			perf_export_pub = orb_advertise_queue(ORB_ID(perf_counter), &s, PERF_COUNTER_QUEUE_SIZE);
+
+		} else {
+			orb_publish(ORB_ID(perf_counter), perf_export_pub, &s);
+		}
+
+		id = perf_snapshot(id + 1, &snapshot);
+	}
+
+	return (id >= 0) ? (unsigned)id : 0;
+}
@@ -131,6 +131,17 @@ int preflight_check_main(int argc, char *argv[])
 		goto system_eval;
 	}
 
+	/* a second gyro is optional, but must pass if it is there */
+	close(fd);
+	fd = open(GYRO1_DEVICE_PATH, 0);
+
+	if (fd >= 0 && ioctl(fd, GYROIOCSELFTEST, 0) != OK) {
+		warnx("gyro 1 self test failed");
+		mavlink_log_critical(mavlink_fd, "SENSOR FAIL: GYRO CHECK/CAL");
+		system_ok = false;
+		goto system_eval;
+	}
+
 	/* ---- BARO ---- */
 
 	close(fd);
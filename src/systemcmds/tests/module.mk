@@ -24,5 +24,8 @@ SRCS			 = test_adc.c \
 			   test_uart_loopback.c \
 			   test_uart_send.c \
 			   tests_file.c \
+			   tests_logbuffer.c \
 			   tests_main.c \
-			   tests_param.c
+			   tests_param.c \
+			   tests_perf.c \
+			   tests_sensor_select.c
@@ -40,12 +40,27 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
 
+#include <drivers/drv_hrt.h>
 #include <systemlib/err.h>
 #include <systemlib/bson/tinybson.h>
 
 #include "tests.h"
 
+#ifdef __PX4_POSIX
+# define TEST_BSON_FILE		"/tmp/test_bson"
+# define TEST_BSON_FILE2	"/tmp/test_bson2"
+#else
+# define TEST_BSON_FILE		"/fs/microsd/test_bson"
+# define TEST_BSON_FILE2	"/fs/microsd/test_bson2"
+#endif
+
+/* size of the benchmark documents, roughly a full parameter set */
+#define TEST_BSON_NODES		1000
+
 static const bool sample_bool = true;
 static const int32_t sample_small_int = 123;
 static const int64_t sample_big_int = (int64_t)INT_MAX + 123LL;
@@ -215,6 +230,288 @@ decode(bson_decoder_t decoder)
 	} while (result > 0);
 }
 
+/*
+ * Benchmark documents: ints, doubles and every tenth node a small blob,
+ * named and valued by their index.
+ */
+static void
+encode_nodes(bson_encoder_t encoder)
+{
+	char name[BSON_MAXNAME];
+	uint8_t blob[16];
+
+	for (unsigned i = 0; i < TEST_BSON_NODES; i++) {
+		int result;
+
+		snprintf(name, sizeof(name), "NODE_%u", i);
+
+		if ((i % 10) == 0) {
+			memset(blob, i & 0xff, sizeof(blob));
+			result = bson_encoder_append_binary(encoder, name, BSON_BIN_BINARY, sizeof(blob), blob);
+
+		} else if (i & 1) {
+			result = bson_encoder_append_double(encoder, name, i + 0.5);
+
+		} else {
+			result = bson_encoder_append_int(encoder, name, i);
+		}
+
+		if (result != 0)
+			errx(1, "FAIL: encoder: append %s failed", name);
+	}
+
+	if (bson_encoder_fini(encoder) != 0)
+		errx(1, "FAIL: encoder: fini failed");
+}
+
+struct node_check {
+	unsigned	count;
+	bool		in_place;
+};
+
+static int
+node_callback(bson_decoder_t decoder, void *private, bson_node_t node)
+{
+	struct node_check *check = (struct node_check *)private;
+	unsigned i = check->count;
+	char name[BSON_MAXNAME];
+	uint8_t blob[16];
+	const void *data = blob;
+
+	if (node->type == BSON_EOO)
+		return 0;
+
+	snprintf(name, sizeof(name), "NODE_%u", i);
+
+	if (strcmp(node->name, name))
+		errx(1, "FAIL: decoder: node '%s', expected '%s'", node->name, name);
+
+	if ((i % 10) == 0) {
+		if ((node->type != BSON_BINDATA) || (bson_decoder_data_pending(decoder) != sizeof(blob)))
+			errx(1, "FAIL: decoder: %s not a %u byte blob", name, sizeof(blob));
+
+		if (check->in_place) {
+			data = bson_decoder_data_ptr(decoder);
+
+			if (data == NULL)
+				errx(1, "FAIL: decoder: %s data not available in place", name);
+
+		} else if (bson_decoder_copy_data(decoder, blob)) {
+			errx(1, "FAIL: decoder: %s copy failed", name);
+		}
+
+		for (unsigned j = 0; j < sizeof(blob); j++)
+			if (((const uint8_t *)data)[j] != (i & 0xff))
+				errx(1, "FAIL: decoder: %s data mismatch", name);
+
+	} else if (i & 1) {
+		if ((node->type != BSON_DOUBLE) || (node->d != i + 0.5))
+			errx(1, "FAIL: decoder: %s bad double", name);
+
+	} else {
+		if ((node->type != BSON_INT32) || (node->i != i))
+			errx(1, "FAIL: decoder: %s bad int", name);
+	}
+
+	check->count++;
+	return 1;
+}
+
+static void
+decode_nodes(bson_decoder_t decoder, bool in_place)
+{
+	struct node_check check = { 0, in_place };
+	int result;
+
+	decoder->private = &check;
+
+	do {
+		result = bson_decoder_next(decoder);
+	} while (result > 0);
+
+	if (result != 0)
+		errx(1, "FAIL: decoder: error after %u nodes", check.count);
+
+	if (check.count != TEST_BSON_NODES)
+		errx(1, "FAIL: decoder: %u nodes, expected %u", check.count, TEST_BSON_NODES);
+}
+
+/**
+ * Write the benchmark document to a file, buffered or not.
+ */
+static hrt_abstime
+bench_encode_file(const char *path, bool buffered)
+{
+	struct bson_encoder_s encoder;
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+	if (fd < 0)
+		err(1, "FAIL: open %s", path);
+
+	hrt_abstime start = hrt_absolute_time();
+
+	if (buffered) {
+		bson_encoder_init_file(&encoder, fd);
+
+	} else {
+		bson_encoder_init_file_unbuffered(&encoder, fd);
+	}
+
+	encode_nodes(&encoder);
+
+	hrt_abstime elapsed = hrt_absolute_time() - start;
+	close(fd);
+
+	return elapsed;
+}
+
+/**
+ * Read the benchmark document back from a file, buffered or not.
+ */
+static hrt_abstime
+bench_decode_file(const char *path, bool buffered)
+{
+	struct bson_decoder_s decoder;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		err(1, "FAIL: open %s", path);
+
+	hrt_abstime start = hrt_absolute_time();
+	int result;
+
+	if (buffered) {
+		result = bson_decoder_init_file(&decoder, fd, node_callback, NULL);
+
+	} else {
+		result = bson_decoder_init_file_unbuffered(&decoder, fd, node_callback, NULL);
+	}
+
+	if (result != 0)
+		errx(1, "FAIL: decoder init on %s", path);
+
+	/* blobs are taken in place from the block buffer when there is one */
+	decode_nodes(&decoder, buffered);
+
+	hrt_abstime elapsed = hrt_absolute_time() - start;
+	close(fd);
+
+	return elapsed;
+}
+
+/**
+ * Read a whole file into memory and decode it in place.
+ */
+static hrt_abstime
+bench_decode_mem(const char *path)
+{
+	struct bson_decoder_s decoder;
+	uint8_t *buf;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		err(1, "FAIL: open %s", path);
+
+	hrt_abstime start = hrt_absolute_time();
+
+	off_t len = lseek(fd, 0, SEEK_END);
+	buf = malloc(len);
+
+	if ((len <= 0) || (buf == NULL) || (lseek(fd, 0, SEEK_SET) != 0) || (read(fd, buf, len) != len))
+		errx(1, "FAIL: reading %s", path);
+
+	if (bson_decoder_init_buf(&decoder, buf, len, node_callback, NULL))
+		errx(1, "FAIL: decoder init on buffer");
+
+	decode_nodes(&decoder, true);
+
+	hrt_abstime elapsed = hrt_absolute_time() - start;
+	free(buf);
+	close(fd);
+
+	return elapsed;
+}
+
+static void
+compare_files(const char *path1, const char *path2)
+{
+	int fd1 = open(path1, O_RDONLY);
+	int fd2 = open(path2, O_RDONLY);
+	uint8_t b1[64], b2[64];
+	ssize_t n1, n2;
+
+	if ((fd1 < 0) || (fd2 < 0))
+		errx(1, "FAIL: opening %s and %s", path1, path2);
+
+	do {
+		n1 = read(fd1, b1, sizeof(b1));
+		n2 = read(fd2, b2, sizeof(b2));
+
+		if ((n1 != n2) || ((n1 > 0) && memcmp(b1, b2, n1)))
+			errx(1, "FAIL: buffered and unbuffered output differ");
+	} while (n1 > 0);
+
+	close(fd1);
+	close(fd2);
+}
+
+/**
+ * Round-trip the sample document through a file; its data node is larger
+ * than the block buffer.
+ */
+static void
+test_bson_file(void)
+{
+	struct bson_encoder_s encoder;
+	struct bson_decoder_s decoder;
+	int fd = open(TEST_BSON_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+	if (fd < 0)
+		err(1, "FAIL: open %s", TEST_BSON_FILE);
+
+	if (bson_encoder_init_file(&encoder, fd))
+		errx(1, "FAIL: bson_encoder_init_file");
+
+	encode(&encoder);
+	close(fd);
+
+	fd = open(TEST_BSON_FILE, O_RDONLY);
+
+	if (fd < 0)
+		err(1, "FAIL: open %s", TEST_BSON_FILE);
+
+	if (bson_decoder_init_file(&decoder, fd, decode_callback, NULL))
+		errx(1, "FAIL: bson_decoder_init_file");
+
+	decode(&decoder);
+	close(fd);
+	unlink(TEST_BSON_FILE);
+}
+
+/**
+ * Compare the buffered and unbuffered file paths on a large document.
+ */
+static void
+test_bson_bench(void)
+{
+	hrt_abstime enc_unbuffered = bench_encode_file(TEST_BSON_FILE, false);
+	hrt_abstime enc_buffered = bench_encode_file(TEST_BSON_FILE2, true);
+
+	compare_files(TEST_BSON_FILE, TEST_BSON_FILE2);
+
+	hrt_abstime dec_unbuffered = bench_decode_file(TEST_BSON_FILE, false);
+	hrt_abstime dec_buffered = bench_decode_file(TEST_BSON_FILE, true);
+	hrt_abstime dec_mem = bench_decode_mem(TEST_BSON_FILE);
+
+	warnx("%u nodes: encode %lluus unbuffered, %lluus buffered", TEST_BSON_NODES,
+	      enc_unbuffered, enc_buffered);
+	warnx("%u nodes: decode %lluus unbuffered, %lluus buffered, %lluus in memory", TEST_BSON_NODES,
+	      dec_unbuffered, dec_buffered, dec_mem);
+
+	unlink(TEST_BSON_FILE);
+	unlink(TEST_BSON_FILE2);
+}
+
 int
 test_bson(int argc, char *argv[])
 {
@@ -240,5 +537,9 @@ test_bson(int argc, char *argv[])
 	decode(&decoder);
 	free(buf);
 
+	test_bson_file();
+	test_bson_bench();
+
+	warnx("PASS");
 	return OK;
-}
\ No newline at end of file
+}
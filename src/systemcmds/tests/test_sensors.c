@@ -88,7 +88,7 @@ struct {
 	int	(* test)(int argc, char *argv[]);
 } sensors[] = {
 	{"accel",	"/dev/accel",	accel},
-	{"gyro",	"/dev/gyro",	gyro},
+	{"gyro",	GYRO_DEVICE_PATH,	gyro},
 	{"mag",		"/dev/mag",	mag},
 	{"baro",	"/dev/baro",	baro},
 	{NULL, NULL, NULL}
@@ -164,7 +164,7 @@ gyro(int argc, char *argv[])
 	struct gyro_report buf;
 	int		ret;
 
-	fd = open("/dev/gyro", O_RDONLY);
+	fd = open(GYRO_DEVICE_PATH, O_RDONLY);
 
 	if (fd < 0) {
 		printf("\tGYRO: open fail, run <l3gd20 start> or <mpu6000 start> first.\n");
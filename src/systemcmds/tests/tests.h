@@ -96,7 +96,10 @@ extern int	test_uart_console(int argc, char *argv[]);
 extern int	test_hott_telemetry(int argc, char *argv[]);
 extern int	test_jig_voltages(int argc, char *argv[]);
 extern int	test_param(int argc, char *argv[]);
+extern int	test_perf(int argc, char *argv[]);
 extern int	test_bson(int argc, char *argv[]);
+extern int	test_logbuffer(int argc, char *argv[]);
+extern int	test_sensor_select(int argc, char *argv[]);
 extern int	test_file(int argc, char *argv[]);
 
 #endif /* __APPS_PX4_TESTS_H */
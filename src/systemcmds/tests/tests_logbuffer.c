@@ -0,0 +1,531 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file tests_logbuffer.c
+ *
+ * Tests and benchmarks for the sdlog2 log buffer and writer.
+ *
+ * A producer thread writes numbered messages in batches, as the sdlog2
+ * poll loop does, while a consumer drains the ring in chunks and stalls
+ * now and then like an SD card.  Delivered messages must arrive intact
+ * and in order; the throughput, the messages dropped and the time the
+ * producer spends on a batch are reported.  The same run with a mutex around the ring, as
+ * sdlog2 used to take, gives the comparison.
+ *
+ * The block writer writes a log to a scratch file through a shim that
+ * sleeps for each call, each byte and each sync like a slow card, and is
+ * compared by wall-clock time with the previous policy of writing
+ * whatever the ring holds.
+ */
+
+#include <nuttx/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "systemlib/err.h"
+
+#include <drivers/drv_hrt.h>
+#include <modules/sdlog2/logbuffer.h>
+#include <modules/sdlog2/logwriter.h>
+
+#include "systemlib/perf_counter.h"
+#include "tests.h"
+
+/* the sdlog2 defaults */
+#define TEST_LB_SIZE		8192
+#define TEST_LB_WATERMARK	512
+#define TEST_LB_CHUNK		512
+
+/*
+ * The producer offers about 1 MB/s, so a stall of the consumer fills
+ * about a quarter of the ring; messages should only be dropped if the
+ * consumer falls behind for longer.
+ */
+#define TEST_LB_MSG_SIZE	64
+#define TEST_LB_MESSAGES	20000
+#define TEST_LB_BATCH		8	/**< messages per producer cycle */
+#define TEST_LB_CYCLE_US	500	/**< producer sleep between batches */
+#define TEST_LB_STALL_EVERY	32	/**< consumer chunks between stalls */
+#define TEST_LB_STALL_US	2000	/**< length of a consumer stall */
+
+struct test_lb_msg {
+	uint32_t	seq;
+	uint8_t		fill[TEST_LB_MSG_SIZE - sizeof(uint32_t)];
+};
+
+static struct logbuffer_s test_lb;
+static pthread_mutex_t test_lb_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool test_lb_locked;
+static volatile bool test_lb_done;
+
+static unsigned test_lb_delivered;
+static uint64_t test_lb_bytes;
+
+static void
+test_lb_lock(void)
+{
+	if (test_lb_locked)
+		pthread_mutex_lock(&test_lb_mutex);
+}
+
+static void
+test_lb_unlock(void)
+{
+	if (test_lb_locked)
+		pthread_mutex_unlock(&test_lb_mutex);
+}
+
+/**
+ * Reassemble messages from the ring and check their sequence.
+ */
+static void
+test_lb_consume(const uint8_t *data, int len)
+{
+	static struct test_lb_msg msg;
+	static unsigned have;
+	static uint32_t last_seq;
+
+	while (len > 0) {
+		unsigned n = sizeof(msg) - have;
+
+		if (n > (unsigned)len)
+			n = len;
+
+		memcpy((uint8_t *)&msg + have, data, n);
+		have += n;
+		data += n;
+		len -= n;
+
+		if (have < sizeof(msg))
+			break;
+
+		have = 0;
+
+		if ((test_lb_delivered > 0) && (msg.seq <= last_seq))
+			errx(1, "FAIL: message %u after %u", msg.seq, last_seq);
+
+		for (unsigned i = 0; i < sizeof(msg.fill); i++)
+			if (msg.fill[i] != (uint8_t)(msg.seq + i))
+				errx(1, "FAIL: message %u corrupt", msg.seq);
+
+		last_seq = msg.seq;
+		test_lb_delivered++;
+	}
+}
+
+/**
+ * Drain the ring like the sdlog2 writer thread.
+ */
+static void *
+test_lb_writer(void *arg)
+{
+	unsigned chunks = 0;
+	void *read_ptr;
+	bool is_part = false;
+	bool should_wait = false;
+	int n = 0;
+
+	for (;;) {
+		test_lb_lock();
+
+		if (n > 0)
+			logbuffer_mark_read(&test_lb, n);
+
+		test_lb_unlock();
+
+		if (should_wait && !test_lb_done)
+			logbuffer_wait(&test_lb);
+
+		test_lb_lock();
+		int available = logbuffer_get_ptr(&test_lb, &read_ptr, &is_part);
+		test_lb_unlock();
+
+		if (available > 0) {
+			n = (available > TEST_LB_CHUNK) ? TEST_LB_CHUNK : available;
+
+			test_lb_consume(read_ptr, n);
+			test_lb_bytes += n;
+
+			if ((++chunks % TEST_LB_STALL_EVERY) == 0)
+				usleep(TEST_LB_STALL_US);
+
+			should_wait = (n == available) && !is_part;
+
+		} else {
+			n = 0;
+
+			if (test_lb_done)
+				break;
+
+			should_wait = true;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+test_lb_run(bool locked)
+{
+	struct test_lb_msg msg;
+	pthread_t writer;
+	unsigned dropped = 0;
+	perf_counter_t latency = perf_alloc(PC_HISTOGRAM, locked ? "logbuffer locked batch" : "logbuffer batch");
+
+	if (latency == NULL)
+		errx(1, "FAIL: counter alloc");
+
+	if (logbuffer_init(&test_lb, TEST_LB_SIZE, TEST_LB_WATERMARK) != OK)
+		errx(1, "FAIL: logbuffer_init");
+
+	test_lb_locked = locked;
+	test_lb_done = false;
+	test_lb_delivered = 0;
+	test_lb_bytes = 0;
+
+	if (pthread_create(&writer, NULL, test_lb_writer, NULL) != 0)
+		errx(1, "FAIL: creating writer thread");
+
+	hrt_abstime start = hrt_absolute_time();
+
+	for (unsigned seq = 0; seq < TEST_LB_MESSAGES;) {
+		perf_begin(latency);
+		test_lb_lock();
+
+		for (unsigned i = 0; (i < TEST_LB_BATCH) && (seq < TEST_LB_MESSAGES); i++, seq++) {
+			msg.seq = seq;
+
+			for (unsigned j = 0; j < sizeof(msg.fill); j++)
+				msg.fill[j] = seq + j;
+
+			if (!logbuffer_write(&test_lb, &msg, sizeof(msg)))
+				dropped++;
+		}
+
+		test_lb_unlock();
+		perf_end(latency);
+
+		usleep(TEST_LB_CYCLE_US);
+	}
+
+	test_lb_done = true;
+	logbuffer_wakeup(&test_lb);
+	pthread_join(writer, NULL);
+
+	hrt_abstime elapsed = hrt_absolute_time() - start;
+
+	if (test_lb_delivered + dropped != TEST_LB_MESSAGES)
+		errx(1, "FAIL: %u delivered and %u dropped of %u", test_lb_delivered, dropped, TEST_LB_MESSAGES);
+
+	/* a saturated ring would measure the drop path rather than the writes */
+	if (dropped > TEST_LB_MESSAGES / 100)
+		errx(1, "FAIL: %u of %u dropped, the ring saturated", dropped, TEST_LB_MESSAGES);
+
+	warnx("%s: %u.%03u MB/s, %u of %u dropped, batch p50 %lluus p99 %lluus p99.9 %lluus",
+	      locked ? "locked" : "lock-free",
+	      (unsigned)(test_lb_bytes / elapsed), (unsigned)((test_lb_bytes * 1000 / elapsed) % 1000),
+	      dropped, TEST_LB_MESSAGES,
+	      perf_percentile(latency, 500), perf_percentile(latency, 990), perf_percentile(latency, 999));
+
+	logbuffer_free(&test_lb);
+	perf_free(latency);
+}
+
+#ifdef __PX4_POSIX
+# define TEST_SD_FILE		"/tmp/test_logwriter"
+#else
+# define TEST_SD_FILE		"/fs/microsd/test_logwriter"
+#endif
+
+/* time the shim adds to each operation, like a slow card */
+#define TEST_SD_CALL_US		100	/**< per write */
+#define TEST_SD_BYTE_NS		50	/**< per byte written */
+#define TEST_SD_SYNC_US		3000	/**< per sync */
+#define TEST_SD_STALL_US	1000	/**< operations this long are stalls */
+
+#define TEST_SD_LOG_BYTES	(1024 * 1024)
+
+static struct {
+	uint64_t	elapsed;	/**< wall-clock time for the whole log */
+	uint64_t	worst;		/**< longest operation */
+	unsigned	writes;
+	unsigned	syncs;
+	unsigned	stalls;
+} test_sd;
+
+/**
+ * Byte n of the log stream.
+ */
+static uint8_t
+test_sd_pattern(uint64_t n)
+{
+	return (uint8_t)(n ^ (n >> 8) ^ (n >> 16));
+}
+
+static void
+test_sd_account(hrt_abstime start)
+{
+	hrt_abstime elapsed = hrt_absolute_time() - start;
+
+	if (elapsed > test_sd.worst)
+		test_sd.worst = elapsed;
+
+	if (elapsed >= TEST_SD_STALL_US)
+		test_sd.stalls++;
+}
+
+static ssize_t
+test_sd_write(int fd, const void *buf, size_t count)
+{
+	hrt_abstime start = hrt_absolute_time();
+	ssize_t result = write(fd, buf, count);
+
+	usleep(TEST_SD_CALL_US + count * TEST_SD_BYTE_NS / 1000);
+
+	test_sd.writes++;
+	test_sd_account(start);
+	return result;
+}
+
+static int
+test_sd_sync(int fd)
+{
+	hrt_abstime start = hrt_absolute_time();
+	int result = fsync(fd);
+
+	usleep(TEST_SD_SYNC_US);
+
+	test_sd.syncs++;
+	test_sd_account(start);
+	return result;
+}
+
+/**
+ * Read the log back and check that it holds the stream, in order.
+ */
+static void
+test_sd_verify(int fd, uint64_t produced)
+{
+	uint8_t buf[512];
+	uint64_t offset = 0;
+	ssize_t n;
+
+	if (lseek(fd, 0, SEEK_SET) != 0)
+		err(1, "FAIL: rewinding the log");
+
+	while ((n = read(fd, buf, sizeof(buf))) > 0) {
+		for (ssize_t i = 0; i < n; i++, offset++)
+			if (buf[i] != test_sd_pattern(offset))
+				errx(1, "FAIL: log byte %llu corrupt", offset);
+	}
+
+	if (offset != produced)
+		errx(1, "FAIL: wrote %llu of %llu bytes", offset, produced);
+}
+
+/**
+ * Queue messages of assorted sizes until the writer would be woken.
+ */
+static void
+test_sd_produce(uint64_t *produced, uint32_t *seed)
+{
+	uint8_t msg[100];
+
+	while (logbuffer_count(&test_lb) <= TEST_LB_WATERMARK) {
+		*seed = *seed * 1103515245 + 12345;
+		int size = 20 + (*seed >> 16) % (sizeof(msg) - 20);
+
+		for (int i = 0; i < size; i++)
+			msg[i] = test_sd_pattern(*produced + i);
+
+		if (!logbuffer_write(&test_lb, msg, size))
+			errx(1, "FAIL: log buffer overflow");
+
+		*produced += size;
+	}
+}
+
+/**
+ * The previous writer: whatever the ring holds, up to 512 bytes at a
+ * time, and a sync every ten writes.
+ */
+static void
+test_sd_legacy_drain(int fd, unsigned *poll_count)
+{
+	for (;;) {
+		void *ptr;
+		bool is_part = false;
+		int available = logbuffer_get_ptr(&test_lb, &ptr, &is_part);
+
+		if (available == 0)
+			return;
+
+		int n = (available > 512) ? 512 : available;
+
+		if (test_sd_write(fd, ptr, n) != n)
+			err(1, "FAIL: writing the log");
+
+		logbuffer_mark_read(&test_lb, n);
+
+		if (++(*poll_count) == 10) {
+			test_sd_sync(fd);
+			*poll_count = 0;
+		}
+
+		if ((n == available) && !is_part)
+			return;
+	}
+}
+
+static void
+test_sd_run(bool blocks)
+{
+	struct logwriter_s w;
+	uint64_t produced = 0;
+	uint32_t seed = 1;
+	unsigned poll_count = 0;
+
+	memset(&test_sd, 0, sizeof(test_sd));
+
+	if (logbuffer_init(&test_lb, TEST_LB_SIZE, TEST_LB_WATERMARK) != OK)
+		errx(1, "FAIL: logbuffer_init");
+
+	int fd = open(TEST_SD_FILE, O_RDWR | O_CREAT | O_TRUNC, 0666);
+
+	if (fd < 0)
+		err(1, "FAIL: creating '%s'", TEST_SD_FILE);
+
+	logwriter_init(&w, fd);
+	w.write = test_sd_write;
+	w.sync = test_sd_sync;
+
+	hrt_abstime start = hrt_absolute_time();
+
+	while (produced < TEST_SD_LOG_BYTES) {
+		test_sd_produce(&produced, &seed);
+
+		if (blocks) {
+			int n;
+
+			while ((n = logwriter_drain(&w, &test_lb)) > 0) {
+			}
+
+			if (n < 0)
+				errx(1, "FAIL: logwriter_drain");
+
+		} else {
+			test_sd_legacy_drain(fd, &poll_count);
+		}
+	}
+
+	if (blocks) {
+		if (logwriter_flush(&w, &test_lb) != OK)
+			errx(1, "FAIL: logwriter_flush");
+
+	} else {
+		test_sd_legacy_drain(fd, &poll_count);
+		test_sd_sync(fd);
+	}
+
+	test_sd.elapsed = hrt_absolute_time() - start;
+	test_sd_verify(fd, produced);
+	close(fd);
+	unlink(TEST_SD_FILE);
+
+	warnx("%s: %u KiB/s, %u writes, %u syncs, %u stalls >= %uus, worst %lluus",
+	      blocks ? "block writer" : "previous writer",
+	      (unsigned)(produced * 1000000 / 1024 / test_sd.elapsed),
+	      test_sd.writes, test_sd.syncs, test_sd.stalls, TEST_SD_STALL_US, test_sd.worst);
+
+	logbuffer_free(&test_lb);
+}
+
+/*
+ * With the producer far ahead of a stalled consumer, ordinary messages stop
+ * at the reserve while critical ones still fit in it.
+ */
+static void
+test_lb_reserve(void)
+{
+	struct test_lb_msg msg;
+	unsigned normal = 0;
+	unsigned critical = 0;
+
+	if (logbuffer_init(&test_lb, TEST_LB_SIZE, TEST_LB_WATERMARK) != OK)
+		errx(1, "FAIL: logbuffer_init");
+
+	logbuffer_set_reserve(&test_lb, TEST_LB_SIZE / 8);
+	memset(&msg, 0, sizeof(msg));
+
+	while (logbuffer_write(&test_lb, &msg, sizeof(msg)))
+		normal++;
+
+	if (TEST_LB_SIZE - 1 - logbuffer_count(&test_lb) < TEST_LB_SIZE / 8)
+		errx(1, "FAIL: ordinary messages used the reserve");
+
+	while (logbuffer_write_critical(&test_lb, &msg, sizeof(msg)))
+		critical++;
+
+	if (critical != (TEST_LB_SIZE / 8) / sizeof(msg))
+		errx(1, "FAIL: %u critical messages fit in the reserve", critical);
+
+	warnx("reserve: %u ordinary then %u critical messages", normal, critical);
+
+	logbuffer_free(&test_lb);
+}
+
+int
+test_logbuffer(int argc, char *argv[])
+{
+	test_lb_reserve();
+
+	test_lb_run(false);
+	test_lb_run(true);
+
+	test_sd_run(false);
+	uint64_t legacy_elapsed = test_sd.elapsed;
+
+	test_sd_run(true);
+
+	if (test_sd.elapsed >= legacy_elapsed)
+		errx(1, "FAIL: block writer no faster than the previous writer");
+
+	warnx("PASS");
+	return OK;
+}
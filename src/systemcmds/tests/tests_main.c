@@ -53,8 +53,6 @@
 
 #include <nuttx/spi.h>
 
-#include <systemlib/perf_counter.h>
-
 #include "tests.h"
 
 /****************************************************************************
@@ -71,7 +69,6 @@
 
 static int test_help(int argc, char *argv[]);
 static int test_all(int argc, char *argv[]);
-static int test_perf(int argc, char *argv[]);
 static int test_jig(int argc, char *argv[]);
 
 /****************************************************************************
@@ -109,6 +106,8 @@ const struct {
 	{"jig",			test_jig,	OPT_NOJIGTEST | OPT_NOALLTEST},
 	{"param",		test_param,	0},
 	{"bson",		test_bson,	0},
+	{"logbuffer",		test_logbuffer,	OPT_NOJIGTEST},
+	{"sensor_select",	test_sensor_select,	OPT_NOJIGTEST},
 	{"file",		test_file,	0},
 	{"help",		test_help,	OPT_NOALLTEST | OPT_NOHELP | OPT_NOJIGTEST},
 	{NULL,			NULL, 		0}
@@ -210,38 +209,6 @@ test_all(int argc, char *argv[])
 	return 0;
 }
 
-static int
-test_perf(int argc, char *argv[])
-{
-	perf_counter_t	cc, ec;
-
-	cc = perf_alloc(PC_COUNT, "test_count");
-	ec = perf_alloc(PC_ELAPSED, "test_elapsed");
-
-	if ((cc == NULL) || (ec == NULL)) {
-		printf("perf: counter alloc failed\n");
-		return 1;
-	}
-
-	perf_begin(ec);
-	perf_count(cc);
-	perf_count(cc);
-	perf_count(cc);
-	perf_count(cc);
-	printf("perf: expect count of 4\n");
-	perf_print_counter(cc);
-	perf_end(ec);
-	printf("perf: expect count of 1\n");
-	perf_print_counter(ec);
-	printf("perf: expect at least two counters\n");
-	perf_print_all();
-
-	perf_free(cc);
-	perf_free(ec);
-
-	return OK;
-}
-
 int test_jig(int argc, char *argv[])
 {
 	unsigned	i;
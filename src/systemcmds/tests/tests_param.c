@@ -38,13 +38,356 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
 #include "systemlib/err.h"
 
+#include <drivers/drv_hrt.h>
+
 #include "systemlib/param/param.h"
 #include "tests.h"
 
 PARAM_DEFINE_INT32(test, 0x12345678);
 
+/**
+ * Time looking up every parameter by name, as modules do at boot.
+ */
+static void
+test_param_find_bench(void)
+{
+	unsigned count = param_count();
+	hrt_abstime start, first, indexed, linear;
+
+	/* the first pass includes building the index */
+	start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < count; i++)
+		if (param_find(param_name(param_for_index(i))) != param_for_index(i))
+			errx(1, "param_find returned the wrong handle for %s", param_name(param_for_index(i)));
+
+	first = hrt_absolute_time() - start;
+
+	start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < count; i++)
+		param_find(param_name(param_for_index(i)));
+
+	indexed = hrt_absolute_time() - start;
+
+	/* the linear scan param_find used to do */
+	start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < count; i++) {
+		const char *name = param_name(param_for_index(i));
+
+		for (unsigned j = 0; j < count; j++)
+			if (!strcmp(param_name(param_for_index(j)), name))
+				break;
+	}
+
+	linear = hrt_absolute_time() - start;
+
+	warnx("%u params: find all %lluus (first pass %lluus), linear scan %lluus",
+	      count, indexed, first, linear);
+}
+
+static void
+test_param_count_changed(void *arg, param_t param)
+{
+	(*(unsigned *)arg)++;
+}
+
+/**
+ * Time reading a parameter, as controllers do for every gain.
+ */
+static void
+test_param_get_bench(param_t p)
+{
+	const unsigned iterations = 10000;
+	int32_t val;
+
+	hrt_abstime start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < iterations; i++)
+		param_get(p, &val);
+
+	hrt_abstime elapsed = hrt_absolute_time() - start;
+
+	warnx("param_get of a modified value: %lluns", elapsed * 1000 / iterations);
+}
+
+#ifdef __PX4_POSIX
+# define TEST_PARAM_JOURNAL	"/tmp/test_param_journal"
+#else
+# define TEST_PARAM_JOURNAL	"/fs/microsd/test_param_journal"
+#endif
+
+static off_t
+test_param_file_size(void)
+{
+	struct stat st;
+
+	if (stat(TEST_PARAM_JOURNAL, &st) != 0)
+		err(1, "stat '%s'", TEST_PARAM_JOURNAL);
+
+	return st.st_size;
+}
+
+static void
+test_param_set_check(param_t p, int32_t val)
+{
+	if (param_set(p, &val) != 0)
+		errx(1, "failed to write test parameter");
+}
+
+static void
+test_param_load_check(param_t p, int32_t expected)
+{
+	int32_t val;
+
+	param_reset_all();
+
+	if (param_load_default() != 0)
+		errx(1, "failed to load the journal");
+
+	if ((param_get(p, &val) != 0) || (val != expected))
+		errx(1, "journal replayed %d, expected %d", (int)val, (int)expected);
+}
+
+/**
+ * Save to and replay the parameter journal in a scratch file.
+ */
+static void
+test_param_journal(param_t p)
+{
+	char *saved_default = strdup(param_get_default_file());
+	hrt_abstime start, append_time, compact_time;
+	off_t size, append_size, compact_size;
+
+	unlink(TEST_PARAM_JOURNAL);
+	unlink(TEST_PARAM_JOURNAL ".tmp");
+	param_set_default_file(TEST_PARAM_JOURNAL);
+
+	/* the first save writes a fresh journal */
+	test_param_set_check(p, 1);
+	start = hrt_absolute_time();
+	if (param_save_default() != 0)
+		errx(1, "failed to write the journal");
+	compact_time = hrt_absolute_time() - start;
+	compact_size = test_param_file_size();
+
+	/* later ones append a record for each change */
+	test_param_set_check(p, 2);
+	start = hrt_absolute_time();
+	if (param_save_default() != 0)
+		errx(1, "failed to append to the journal");
+	append_time = hrt_absolute_time() - start;
+	append_size = test_param_file_size() - compact_size;
+
+	if (append_size != (off_t)(4 + strlen("test") + 4 + 4))
+		errx(1, "appended %d bytes for one parameter", (int)append_size);
+
+	size = test_param_file_size();
+	if ((param_save_default() != 0) || (test_param_file_size() != size))
+		errx(1, "saving without changes wrote to the journal");
+
+	param_reset(p);
+	if (param_save_default() != 0)
+		errx(1, "failed to journal a reset");
+	test_param_load_check(p, 0x12345678);
+
+	test_param_set_check(p, 3);
+	if (param_save_default() != 0)
+		errx(1, "failed to append after replay");
+	test_param_load_check(p, 3);
+
+	/* a record cut short by a power loss is ignored, and compacted away */
+	size = test_param_file_size();
+	int fd = open(TEST_PARAM_JOURNAL, O_WRONLY | O_APPEND);
+	if ((fd < 0) || (write(fd, "\x01\x04\x00\x00te", 6) != 6))
+		err(1, "failed to damage the journal");
+	close(fd);
+
+	test_param_load_check(p, 3);
+	test_param_set_check(p, 4);
+	if (param_save_default() != 0)
+		errx(1, "failed to save after a damaged record");
+	if (test_param_file_size() >= size)
+		errx(1, "damaged journal not compacted");
+	test_param_load_check(p, 4);
+
+	/* a compaction that can't write its new journal leaves the old one alone */
+	size = test_param_file_size();
+	if (mkdir(TEST_PARAM_JOURNAL ".tmp", 0777) != 0)
+		err(1, "mkdir '%s'", TEST_PARAM_JOURNAL ".tmp");
+	test_param_set_check(p, 5);
+	param_set_default_file(TEST_PARAM_JOURNAL);
+	if (param_save_default() == 0)
+		errx(1, "compaction succeeded without its new journal");
+	rmdir(TEST_PARAM_JOURNAL ".tmp");
+	if (test_param_file_size() != size)
+		errx(1, "failed compaction changed the journal");
+	test_param_load_check(p, 4);
+
+	/* an interrupted compaction is recovered from the copy alongside */
+	test_param_set_check(p, 6);
+	if (param_save_default() != 0)
+		errx(1, "failed to save before interrupting");
+	char buf[1024];
+	int in = open(TEST_PARAM_JOURNAL, O_RDONLY);
+	int out = open(TEST_PARAM_JOURNAL ".tmp", O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	ssize_t len = (in < 0) ? -1 : read(in, buf, sizeof(buf));
+	if ((out < 0) || (len <= 0) || (write(out, buf, len) != len))
+		err(1, "failed to copy the journal");
+	close(in);
+	close(out);
+	close(open(TEST_PARAM_JOURNAL, O_WRONLY | O_TRUNC));
+
+	test_param_load_check(p, 6);
+	test_param_set_check(p, 7);
+	if (param_save_default() != 0)
+		errx(1, "failed to save after recovery");
+	struct stat st;
+	if (stat(TEST_PARAM_JOURNAL ".tmp", &st) == 0)
+		errx(1, "copy of the journal left behind after recovery");
+	test_param_load_check(p, 7);
+
+	/* repeated saves must not grow the journal without bound */
+	for (int32_t i = 0; i < 200; i++) {
+		test_param_set_check(p, i);
+		if (param_save_default() != 0)
+			errx(1, "failed to save change %d", (int)i);
+	}
+
+	size = test_param_file_size();
+	if (size > compact_size + 1024)
+		errx(1, "journal grew to %d bytes", (int)size);
+	test_param_load_check(p, 199);
+
+	warnx("journal save of one parameter: %d bytes %lluus, rewrite of %d bytes %lluus",
+	      (int)append_size, append_time, (int)compact_size, compact_time);
+
+	unlink(TEST_PARAM_JOURNAL);
+	param_set_default_file(saved_default);
+	free(saved_default);
+	param_reset(p);
+}
+
+#define TEST_PARAM_WRITERS	2
+#define TEST_PARAM_READERS	2
+#define TEST_PARAM_WRITES	20000
+
+/*
+ * Values written by the stress test carry their index in both halves,
+ * the bottom one inverted, so that a torn read is recognisable.
+ */
+#define TEST_PARAM_PATTERN(_i)	((int32_t)(((uint32_t)(_i) << 16) | (~(uint32_t)(_i) & 0xffff)))
+
+struct test_param_stress_s {
+	param_t		param;
+	volatile bool	done;
+	unsigned	reads[TEST_PARAM_READERS];
+	unsigned	bad_reads;
+};
+
+static void *
+test_param_stress_writer(void *arg)
+{
+	struct test_param_stress_s *st = (struct test_param_stress_s *)arg;
+
+	for (unsigned i = 0; i < TEST_PARAM_WRITES; i++) {
+		int32_t val = TEST_PARAM_PATTERN(i);
+
+		param_set(st->param, &val);
+	}
+
+	return NULL;
+}
+
+static void *
+test_param_stress_reader(void *arg)
+{
+	struct test_param_stress_s *st = (struct test_param_stress_s *)arg;
+	static volatile unsigned next_reader;
+	unsigned reader = __sync_fetch_and_add(&next_reader, 1) % TEST_PARAM_READERS;
+	unsigned reads = 0;
+
+	while (!st->done) {
+		int32_t val;
+
+		if ((param_get(st->param, &val) != 0) ||
+		    ((val != 0x12345678) && (val != TEST_PARAM_PATTERN((uint32_t)val >> 16))))
+			__sync_fetch_and_add(&st->bad_reads, 1);
+
+		/* the lock-free queries must keep working alongside */
+		param_value_is_default(st->param);
+		param_changed_since(st->param, 0);
+		reads++;
+	}
+
+	st->reads[reader] = reads;
+	return NULL;
+}
+
+/**
+ * Hammer one parameter with writes from several threads while others
+ * read it, checking that no read is torn and no write is lost.
+ */
+static void
+test_param_stress(param_t p)
+{
+	struct test_param_stress_s st = { .param = p };
+	pthread_t writers[TEST_PARAM_WRITERS];
+	pthread_t readers[TEST_PARAM_READERS];
+
+	param_reset(p);
+	uint32_t generation = param_get_generation();
+	hrt_abstime start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < TEST_PARAM_READERS; i++)
+		if (pthread_create(&readers[i], NULL, test_param_stress_reader, &st) != 0)
+			errx(1, "failed to start reader %u", i);
+
+	for (unsigned i = 0; i < TEST_PARAM_WRITERS; i++)
+		if (pthread_create(&writers[i], NULL, test_param_stress_writer, &st) != 0)
+			errx(1, "failed to start writer %u", i);
+
+	for (unsigned i = 0; i < TEST_PARAM_WRITERS; i++)
+		pthread_join(writers[i], NULL);
+
+	st.done = true;
+
+	for (unsigned i = 0; i < TEST_PARAM_READERS; i++)
+		pthread_join(readers[i], NULL);
+
+	hrt_abstime elapsed = hrt_absolute_time() - start;
+
+	if (st.bad_reads != 0)
+		errx(1, "%u torn or failed reads", st.bad_reads);
+
+	/* every write must have advanced the generation exactly once */
+	unsigned writes = param_get_generation() - generation;
+	if (writes != TEST_PARAM_WRITERS * TEST_PARAM_WRITES)
+		errx(1, "%u writes recorded, expected %u", writes, TEST_PARAM_WRITERS * TEST_PARAM_WRITES);
+
+	int32_t val;
+	if ((param_get(p, &val) != 0) || (val != TEST_PARAM_PATTERN(TEST_PARAM_WRITES - 1)))
+		errx(1, "final value %x, expected the last write", (unsigned)val);
+
+	unsigned reads = 0;
+	for (unsigned i = 0; i < TEST_PARAM_READERS; i++)
+		reads += st.reads[i];
+
+	warnx("%u writes and %u reads from %u+%u threads in %llums",
+	      writes, reads, TEST_PARAM_WRITERS, TEST_PARAM_READERS, elapsed / 1000);
+
+	param_reset(p);
+}
+
 int
 test_param(int argc, char *argv[])
 {
@@ -54,24 +397,69 @@ test_param(int argc, char *argv[])
 	if (p == PARAM_INVALID)
 		errx(1, "test parameter not found");
 
+	if (param_find("test_no_such_param") != PARAM_INVALID)
+		errx(1, "found a parameter that does not exist");
+
+	test_param_find_bench();
+
 	param_type_t t = param_type(p);
 	if (t != PARAM_TYPE_INT32)
 		errx(1, "test parameter type mismatch (got %u)", (unsigned)t);
 
+	/* start from the default, in case the test has run before */
+	param_reset(p);
+
+	unsigned changed = 0;
+	param_foreach(test_param_count_changed, &changed, true);
+
 	int32_t	val;
 	if (param_get(p, &val) != 0)
 		errx(1, "failed to read test parameter");
 	if (val != 0x12345678)
 		errx(1, "parameter value mismatch");
 
+	uint32_t generation = param_get_generation();
+
 	val = 0xa5a5a5a5;
 	if (param_set(p, &val) != 0)
 		errx(1, "failed to write test parameter");
+
+	if (!param_changed_since(p, generation))
+		errx(1, "written parameter not reported as changed");
+
+	for (unsigned i = 0; i < param_count(); i++)
+		if ((param_for_index(i) != p) && param_changed_since(param_for_index(i), generation))
+			errx(1, "unwritten parameter %s reported as changed", param_name(param_for_index(i)));
+
+	generation = param_get_generation();
 	if (param_get(p, &val) != 0)
 		errx(1, "failed to re-read test parameter");
 	if ((uint32_t)val != 0xa5a5a5a5)
 		errx(1, "parameter value mismatch after write");
 
+	if (param_value_is_default(p) || !param_value_unsaved(p))
+		errx(1, "written parameter not marked as changed and unsaved");
+
+	unsigned now_changed = 0;
+	param_foreach(test_param_count_changed, &now_changed, true);
+	if (now_changed != changed + 1)
+		errx(1, "changed parameter count %u, expected %u", now_changed, changed + 1);
+
+	test_param_get_bench(p);
+
+	param_reset(p);
+	if (param_get(p, &val) != 0)
+		errx(1, "failed to read reset parameter");
+	if (val != 0x12345678)
+		errx(1, "parameter value mismatch after reset");
+	if (!param_value_is_default(p))
+		errx(1, "reset parameter not marked as default");
+	if (!param_changed_since(p, generation))
+		errx(1, "reset parameter not reported as changed");
+
+	test_param_journal(p);
+	test_param_stress(p);
+
 	warnx("parameter test PASS");
 
 	return 0;
@@ -0,0 +1,493 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file tests_perf.c
+ *
+ * Tests related to the performance counters.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "systemlib/err.h"
+
+#include <drivers/drv_hrt.h>
+#include <uORB/uORB.h>
+#include <uORB/topics/perf_counter.h>
+
+#include "systemlib/perf_counter.h"
+#include "systemcmds/perf/perf_export.h"
+#include "systemlib/trace.h"
+#include "tests.h"
+
+#ifdef __PX4_POSIX
+# define TEST_PERF_TRACE_FILE	"/tmp/test_perf_trace"
+#else
+# define TEST_PERF_TRACE_FILE	"/fs/microsd/test_perf_trace"
+#endif
+
+/**
+ * Record one event of a given length in a histogram counter.
+ */
+static void
+test_perf_event(perf_counter_t hc, hrt_abstime elapsed)
+{
+#ifdef __PX4_POSIX
+	/* virtual time makes the recorded times exact */
+	static hrt_abstime now = 1000000;
+
+	hrt_set_virtual_time(now);
+	perf_begin(hc);
+	now += elapsed;
+	hrt_set_virtual_time(now);
+	perf_end(hc);
+#else
+	hrt_abstime start = hrt_absolute_time();
+
+	perf_begin(hc);
+
+	while ((hrt_absolute_time() - start) < elapsed)
+		;
+
+	perf_end(hc);
+#endif
+}
+
+static void
+test_perf_check_percentile(perf_counter_t hc, unsigned per_mille, uint64_t expected)
+{
+	uint64_t p = perf_percentile(hc, per_mille);
+
+	/* buckets are at most an eighth of their lower bound wide */
+	if ((p < expected) || (p > expected + expected / 8 + 1))
+		errx(1, "percentile %u.%u is %lluus, expected %lluus",
+		     per_mille / 10, per_mille % 10, p, expected);
+}
+
+/**
+ * Time a begin/end pair of a counter.
+ */
+static void
+test_perf_bench(enum perf_counter_type type, const char *name)
+{
+	const unsigned iterations = 100000;
+	perf_counter_t c = perf_alloc(type, name);
+
+	if (c == NULL)
+		errx(1, "counter alloc failed");
+
+	hrt_abstime start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < iterations; i++) {
+		perf_begin(c);
+		perf_end(c);
+	}
+
+	hrt_abstime elapsed = hrt_absolute_time() - start;
+
+	warnx("%s begin/end: %lluns", name, elapsed * 1000 / iterations);
+	perf_free(c);
+}
+
+/**
+ * Export all counters and check the snapshot of a histogram counter.
+ */
+static void
+test_perf_export(perf_counter_t hc, const char *name)
+{
+	struct perf_counter_s s;
+	bool found = false;
+	bool found_late = false;
+	bool updated;
+	unsigned next = 0;
+	unsigned seen = 0;
+	int last_id = -1;
+	perf_counter_t extra[20];
+	perf_counter_t late = NULL;
+
+	/* enough counters that a pass takes several batches */
+	for (unsigned i = 0; i < sizeof(extra) / sizeof(extra[0]); i++)
+		extra[i] = perf_alloc(PC_COUNT, "test_export");
+
+	int sub = orb_subscribe(ORB_ID(perf_counter));
+
+	if (sub < 0)
+		errx(1, "perf_counter subscribe failed");
+
+	/* a full pass, in batches that fit the topic queue */
+	do {
+		next = perf_export(next, 8);
+
+		/* counters coming and going part way through must not upset the pass */
+		if (late == NULL) {
+			late = perf_alloc(PC_COUNT, "test_export_late");
+			perf_free(extra[0]);
+			extra[0] = NULL;
+		}
+
+		orb_check(sub, &updated);
+
+		while (updated) {
+			orb_copy(ORB_ID(perf_counter), sub, &s);
+			seen++;
+
+			if ((int)s.id <= last_id)
+				errx(1, "counter %u exported after %d", s.id, last_id);
+
+			last_id = s.id;
+
+			if (!strcmp(s.name, "test_export_late"))
+				found_late = true;
+
+			if (!strcmp(s.name, name)) {
+				if (found)
+					errx(1, "'%s' exported twice in one pass", name);
+
+				found = true;
+
+				if ((s.type != PC_HISTOGRAM) || (s.event_count != 1000))
+					errx(1, "'%s' exported type %u count %llu", name, s.type, s.event_count);
+
+				if ((s.percentile[0] != perf_percentile(hc, 500)) ||
+				    (s.percentile[1] != perf_percentile(hc, 900)) ||
+				    (s.percentile[2] != perf_percentile(hc, 990)) ||
+				    (s.percentile[3] != perf_percentile(hc, 999)))
+					errx(1, "'%s' exported wrong percentiles", name);
+
+				if ((s.time_least != 100) || (s.time_most != 20000))
+					errx(1, "'%s' exported min %u max %u", name, s.time_least, s.time_most);
+			}
+
+			orb_check(sub, &updated);
+		}
+	} while (next != 0);
+
+	if (!found)
+		errx(1, "'%s' not exported", name);
+
+	if (!found_late)
+		errx(1, "counter allocated during the pass not exported");
+
+	if (seen < sizeof(extra) / sizeof(extra[0]) + 1)
+		errx(1, "only %u counters exported", seen);
+
+	warnx("exported %u counters", seen);
+	orb_unsubscribe(sub);
+	perf_free(late);
+
+	for (unsigned i = 0; i < sizeof(extra) / sizeof(extra[0]); i++)
+		perf_free(extra[i]);
+}
+
+static volatile bool test_perf_churning;
+
+/**
+ * Allocate and free counters, as modules starting and stopping do.
+ */
+static void *
+test_perf_churn(void *arg)
+{
+	volatile unsigned *cycles = (volatile unsigned *)arg;
+
+	/* not so many that the 16-bit counter IDs wrap */
+	while (test_perf_churning && (*cycles < 5000)) {
+		perf_counter_t c = perf_alloc(PC_HISTOGRAM, "test_churn");
+
+		perf_set_elapsed(c, 100);
+		perf_free(c);
+		(*cycles)++;
+	}
+
+	return NULL;
+}
+
+/**
+ * Take snapshots of all counters while another thread allocates and frees them.
+ */
+static void
+test_perf_snapshot_churn(void)
+{
+	struct perf_snapshot_s s;
+	pthread_t churn;
+	volatile unsigned cycles = 0;
+	unsigned passes;
+
+	test_perf_churning = true;
+
+	if (pthread_create(&churn, NULL, test_perf_churn, (void *)&cycles) != 0)
+		errx(1, "creating churn thread");
+
+	for (passes = 0; (passes < 2000) || (cycles < 2000); passes++) {
+		for (int id = perf_snapshot(0, &s); id >= 0; id = perf_snapshot(id + 1, &s)) {
+			if ((s.name == NULL) || (s.type > PC_HISTOGRAM))
+				errx(1, "snapshot of counter %d is corrupt", id);
+		}
+	}
+
+	test_perf_churning = false;
+	pthread_join(churn, NULL);
+
+	warnx("%u snapshot passes over %u counters allocated and freed", passes, cycles);
+}
+
+/**
+ * Find the ID a trace dump gives a name.
+ */
+static int
+test_perf_trace_id(const uint8_t *buf, size_t len, uint8_t category, const char *name)
+{
+	size_t offset = sizeof(struct trace_file_header);
+
+	while (offset + sizeof(struct trace_file_record) <= len) {
+		const struct trace_file_record *r = (const struct trace_file_record *)(buf + offset);
+		const char *payload = (const char *)(r + 1);
+
+		if ((r->type == TRACE_RECORD_NAME) && (r->category == category) &&
+		    (r->len == strlen(name)) && !memcmp(payload, name, r->len))
+			return r->id;
+
+		offset += sizeof(*r) + r->len;
+	}
+
+	return -1;
+}
+
+/**
+ * Count the events of a type for an ID in a trace dump.
+ */
+static unsigned
+test_perf_trace_count(const uint8_t *buf, size_t len, uint8_t category, int id, uint8_t type)
+{
+	size_t offset = sizeof(struct trace_file_header);
+	unsigned count = 0;
+
+	while (offset + sizeof(struct trace_file_record) <= len) {
+		const struct trace_file_record *r = (const struct trace_file_record *)(buf + offset);
+
+		if (r->type == TRACE_RECORD_EVENTS) {
+			const struct trace_event *e = (const struct trace_event *)(r + 1);
+
+			for (unsigned i = 0; i < r->len / sizeof(*e); i++)
+				if ((e[i].category == category) && (e[i].id == id) && (e[i].type == type))
+					count++;
+		}
+
+		offset += sizeof(*r) + r->len;
+	}
+
+	return count;
+}
+
+/**
+ * Trace a counter and a publication, and check the dump.
+ */
+static void
+test_perf_trace(perf_counter_t ec)
+{
+	struct perf_counter_s snapshot;
+	uint8_t buf[16384];
+	size_t len;
+	int ret;
+	int id;
+
+	ret = trace_start(0);
+
+	if (ret == -ENOSYS) {
+		warnx("tracing not compiled in, skipped");
+		return;
+	}
+
+	if (ret != OK)
+		errx(1, "trace start failed: %d", ret);
+
+	int sub = orb_subscribe(ORB_ID(perf_counter));
+
+	perf_begin(ec);
+	perf_end(ec);
+	perf_begin(ec);
+	perf_end(ec);
+	perf_export(0, 1);
+	orb_copy(ORB_ID(perf_counter), sub, &snapshot);
+	orb_unsubscribe(sub);
+
+	ret = trace_dump(TEST_PERF_TRACE_FILE);
+
+	if (ret != OK)
+		errx(1, "trace dump failed: %d", ret);
+
+	FILE *fp = fopen(TEST_PERF_TRACE_FILE, "rb");
+
+	if (fp == NULL)
+		errx(1, "can't open '%s'", TEST_PERF_TRACE_FILE);
+
+	len = fread(buf, 1, sizeof(buf), fp);
+	fclose(fp);
+
+	if ((len < sizeof(struct trace_file_header)) ||
+	    memcmp(((struct trace_file_header *)buf)->magic, TRACE_FILE_MAGIC, 8))
+		errx(1, "bad trace dump header");
+
+	id = test_perf_trace_id(buf, len, TRACE_CAT_PERF, "test_elapsed");
+
+	if (id < 0)
+		errx(1, "no name for the traced counter");
+
+	if ((test_perf_trace_count(buf, len, TRACE_CAT_PERF, id, TRACE_TYPE_BEGIN) != 2) ||
+	    (test_perf_trace_count(buf, len, TRACE_CAT_PERF, id, TRACE_TYPE_END) != 2))
+		errx(1, "expected two traced spans of the counter");
+
+	id = test_perf_trace_id(buf, len, TRACE_CAT_ORB_PUBLISH, "perf_counter");
+
+	if ((id != (int)(ORB_ID(perf_counter))->o_id) ||
+	    (test_perf_trace_count(buf, len, TRACE_CAT_ORB_PUBLISH, id, TRACE_TYPE_BEGIN) != 1) ||
+	    (test_perf_trace_count(buf, len, TRACE_CAT_ORB_COPY, id, TRACE_TYPE_END) != 1))
+		errx(1, "expected a traced publication and copy");
+
+	warnx("trace dump of %u bytes in %s", (unsigned)len, TEST_PERF_TRACE_FILE);
+}
+
+int
+test_perf(int argc, char *argv[])
+{
+	perf_counter_t	cc, ec, hc;
+
+	cc = perf_alloc(PC_COUNT, "test_count");
+	ec = perf_alloc(PC_ELAPSED, "test_elapsed");
+	hc = perf_alloc(PC_HISTOGRAM, "test_histogram");
+
+	if ((cc == NULL) || (ec == NULL) || (hc == NULL)) {
+		printf("perf: counter alloc failed\n");
+		return 1;
+	}
+
+	perf_begin(ec);
+	perf_count(cc);
+	perf_count(cc);
+	perf_count(cc);
+	perf_count(cc);
+	printf("perf: expect count of 4\n");
+	perf_print_counter(cc);
+	perf_end(ec);
+	printf("perf: expect count of 1\n");
+	perf_print_counter(ec);
+
+	/* before any virtual time, so that the clock runs */
+	test_perf_bench(PC_ELAPSED, "elapsed");
+	test_perf_bench(PC_HISTOGRAM, "histogram");
+
+	if (trace_start(0) == OK) {
+		test_perf_bench(PC_HISTOGRAM, "traced histogram");
+		trace_stop();
+	}
+
+	if (perf_percentile(hc, 500) != 0)
+		errx(1, "empty histogram has a percentile");
+
+	/* a loop that usually takes 100us, with a tail */
+	for (unsigned i = 0; i < 900; i++)
+		test_perf_event(hc, 100);
+
+	for (unsigned i = 0; i < 90; i++)
+		test_perf_event(hc, 1000);
+
+	for (unsigned i = 0; i < 9; i++)
+		test_perf_event(hc, 5000);
+
+	test_perf_event(hc, 20000);
+
+	test_perf_check_percentile(hc, 500, 100);
+	test_perf_check_percentile(hc, 900, 100);
+	test_perf_check_percentile(hc, 990, 1000);
+	test_perf_check_percentile(hc, 999, 5000);
+	test_perf_check_percentile(hc, 1000, 20000);
+
+	printf("perf: expect p50 of 100us, p99 of 1000us and p99.9 of 5000us\n");
+	perf_print_counter(hc);
+
+	test_perf_export(hc, "test_histogram");
+	test_perf_snapshot_churn();
+
+	perf_reset(hc);
+	if (perf_percentile(hc, 500) != 0)
+		errx(1, "reset histogram has a percentile");
+
+	/* times measured elsewhere, as by the latency monitor */
+	for (unsigned i = 0; i < 99; i++)
+		perf_set_elapsed(hc, 2000);
+
+	perf_set_elapsed(hc, 8000);
+
+	test_perf_check_percentile(hc, 500, 2000);
+	test_perf_check_percentile(hc, 1000, 8000);
+
+	printf("perf: expect 100 events, p50 of 2000us and max of 8000us\n");
+	perf_print_counter(hc);
+	perf_reset(hc);
+
+	/* times too long to bucket are counted apart, and still set the tail */
+	for (unsigned i = 0; i < 99; i++)
+		perf_set_elapsed(hc, 2000);
+
+	perf_set_elapsed(hc, 20000000);
+
+	test_perf_check_percentile(hc, 990, 2000);
+	test_perf_check_percentile(hc, 999, 20000000);
+
+	struct perf_snapshot_s snapshot;
+	int id = perf_snapshot(0, &snapshot);
+
+	while ((id >= 0) && strcmp(snapshot.name, "test_histogram"))
+		id = perf_snapshot(id + 1, &snapshot);
+
+	if ((id < 0) || (snapshot.overflow != 1))
+		errx(1, "histogram overflow not reported");
+
+	printf("perf: expect 1 over 16s\n");
+	perf_print_counter(hc);
+	perf_reset(hc);
+
+	printf("perf: expect at least three counters\n");
+	perf_print_all();
+
+	test_perf_trace(ec);
+
+	perf_free(cc);
+	perf_free(ec);
+	perf_free(hc);
+
+	return OK;
+}
@@ -0,0 +1,169 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file tests_sensor_select.c
+ *
+ * Tests the choice of the primary gyro by the sensors app.
+ *
+ * Two gyros publish instances of sensor_gyro, which are read and counted
+ * as sensors does, in simulated time.  The faster gyro must become the
+ * primary; when it stops publishing the other must take over within two
+ * selection intervals, and when it comes back no faster than the new
+ * primary it must not take over again.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "systemlib/err.h"
+
+#include <drivers/drv_gyro.h>
+#include <uORB/uORB.h>
+#include <modules/sensors/sensor_select.h>
+
+#include "tests.h"
+
+#define TEST_SS_GYROS		2
+#define TEST_SS_INTERVAL	1000000		/**< selection interval, as in sensors */
+#define TEST_SS_STEP		2000		/**< simulated time between samples */
+
+static orb_advert_t test_ss_pub[TEST_SS_GYROS];
+static int test_ss_sub[TEST_SS_GYROS];
+static struct sensor_select_s test_ss;
+static uint64_t test_ss_now;
+
+/**
+ * Run the gyros for a while and report when the primary changed.
+ *
+ * @param divider	Each gyro publishes every divider[i] steps, or not
+ *			at all if 0.
+ * @param duration	Simulated time to run for.
+ * @return		Simulated time from the start to the last change of
+ *			primary, or 0 if it did not change.
+ */
+static uint64_t
+test_ss_run(const unsigned divider[TEST_SS_GYROS], uint64_t duration)
+{
+	uint64_t start = test_ss_now;
+	uint64_t changed = 0;
+	unsigned step = 0;
+
+	while (test_ss_now - start < duration) {
+		test_ss_now += TEST_SS_STEP;
+		step++;
+
+		for (unsigned i = 0; i < TEST_SS_GYROS; i++) {
+			if ((divider[i] != 0) && (step % divider[i] == 0)) {
+				struct gyro_report report;
+
+				memset(&report, 0, sizeof(report));
+				report.timestamp = test_ss_now;
+				report.x = (float)i;
+				orb_publish(ORB_ID(sensor_gyro), test_ss_pub[i], &report);
+			}
+		}
+
+		for (unsigned i = 0; i < TEST_SS_GYROS; i++) {
+			bool updated;
+			orb_check(test_ss_sub[i], &updated);
+
+			if (updated) {
+				orb_copy(ORB_ID(sensor_gyro), test_ss_sub[i], NULL);
+				sensor_select_update(&test_ss, i);
+			}
+		}
+
+		if (sensor_select_check(&test_ss, test_ss_now))
+			changed = test_ss_now - start;
+	}
+
+	return changed;
+}
+
+int
+test_sensor_select(int argc, char *argv[])
+{
+	struct gyro_report report;
+
+	memset(&report, 0, sizeof(report));
+
+	for (unsigned i = 0; i < TEST_SS_GYROS; i++) {
+		int instance;
+
+		test_ss_pub[i] = orb_advertise_multi(ORB_ID(sensor_gyro), &report, &instance);
+
+		if (test_ss_pub[i] < 0)
+			err(1, "FAIL: advertise gyro %u", i);
+
+		test_ss_sub[i] = orb_subscribe_multi(ORB_ID(sensor_gyro), instance);
+
+		if (test_ss_sub[i] < 0)
+			err(1, "FAIL: subscribe gyro %u", i);
+
+		/* the advertisement is not a sample */
+		orb_copy(ORB_ID(sensor_gyro), test_ss_sub[i], NULL);
+	}
+
+	sensor_select_init(&test_ss, TEST_SS_GYROS, TEST_SS_INTERVAL);
+	test_ss_now = 0;
+
+	/* gyro 1 is faster, so it takes over at the first selection */
+	const unsigned both[TEST_SS_GYROS] = {2, 1};
+
+	if (test_ss_run(both, 3 * TEST_SS_INTERVAL) == 0 || test_ss.primary != 1)
+		errx(1, "FAIL: primary %u, expected the faster gyro 1", test_ss.primary);
+
+	/* gyro 1 fails; gyro 0 must take over within two intervals */
+	const unsigned failed[TEST_SS_GYROS] = {2, 0};
+	uint64_t failover = test_ss_run(failed, 3 * TEST_SS_INTERVAL);
+
+	if (test_ss.primary != 0)
+		errx(1, "FAIL: primary %u after gyro 1 failed", test_ss.primary);
+
+	if (failover == 0 || failover > 2 * TEST_SS_INTERVAL + TEST_SS_STEP)
+		errx(1, "FAIL: failover after %lluus", (unsigned long long)failover);
+
+	/* gyro 1 recovers at the same rate; the primary must stay put */
+	const unsigned recovered[TEST_SS_GYROS] = {2, 2};
+
+	if (test_ss_run(recovered, 3 * TEST_SS_INTERVAL) != 0 || test_ss.primary != 0)
+		errx(1, "FAIL: primary moved to %u with equal gyros", test_ss.primary);
+
+	for (unsigned i = 0; i < TEST_SS_GYROS; i++)
+		orb_unsubscribe(test_ss_sub[i]);
+
+	warnx("failover after %llums", (unsigned long long)(failover / 1000));
+	warnx("PASS");
+	return OK;
+}
@@ -0,0 +1,114 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2013 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file trace.c
+ *
+ * Control of the hot-path event tracer.
+ *
+ * The tracer is only present in builds with PX4_TRACE defined.  Convert
+ * a dump for chrome://tracing with Tools/trace_to_chrome.py.
+ */
+
+#include <nuttx/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <systemlib/err.h>
+#include <systemlib/trace.h>
+
+__EXPORT int trace_main(int argc, char *argv[]);
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: trace start [<events per task>]\n"
+		"       trace stop\n"
+		"       trace dump <file>\n"
+		"       trace status\n");
+}
+
+int
+trace_main(int argc, char *argv[])
+{
+	int ret;
+
+	if (argc < 2) {
+		usage();
+		return 1;
+	}
+
+	if (!strcmp(argv[1], "start")) {
+		ret = trace_start((argc > 2) ? strtoul(argv[2], NULL, 10) : 0);
+
+		if (ret != OK) {
+			warnx("start failed: %s", strerror(-ret));
+			return 1;
+		}
+
+		return 0;
+	}
+
+	if (!strcmp(argv[1], "stop")) {
+		trace_stop();
+		return 0;
+	}
+
+	if (!strcmp(argv[1], "dump")) {
+		if (argc < 3) {
+			usage();
+			return 1;
+		}
+
+		ret = trace_dump(argv[2]);
+
+		if (ret != OK) {
+			warnx("dump to '%s' failed: %s", argv[2], strerror(-ret));
+			return 1;
+		}
+
+		warnx("dumped to '%s'", argv[2]);
+		return 0;
+	}
+
+	if (!strcmp(argv[1], "status")) {
+		trace_status();
+		return 0;
+	}
+
+	usage();
+	return 1;
+}